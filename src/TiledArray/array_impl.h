@@ -31,6 +31,9 @@
 #include <TiledArray/transform_iterator.h>
 #include <TiledArray/type_traits.h>
 
+#include <atomic>
+#include <cstdint>
+
 namespace TiledArray {
 namespace detail {
 
@@ -437,6 +440,7 @@ class ArrayImpl : public TensorImpl<Policy> {
 
  private:
   storage_type data_;  ///< Tile container
+  std::atomic<std::uint64_t> version_{0ul};  ///< Number of local tile sets
 
  public:
   /// Constructor
@@ -451,7 +455,10 @@ class ArrayImpl : public TensorImpl<Policy> {
   ArrayImpl(World& world, const trange_type& trange, const shape_type& shape,
             const std::shared_ptr<pmap_interface>& pmap)
       : TensorImpl_(world, trange, shape, pmap),
-        data_(world, trange.tiles_range().volume(), pmap) {}
+        data_(world, trange.tiles_range().volume(), pmap) {
+    data_.memory().add(MemoryCategory::shapes,
+                       std::int64_t(memory_bytes(TensorImpl_::shape())));
+  }
 
   /// Virtual destructor
   virtual ~ArrayImpl() {}
@@ -479,6 +486,31 @@ class ArrayImpl : public TensorImpl<Policy> {
     return get<std::initializer_list<Integer>>(i);
   }
 
+  /// Start fetching a tile
+
+  /// The size of a remote tile is estimated from the volume of its range.
+  /// \tparam Index The index type
+  /// \param i The tile index
+  /// \return \c false if the tile was not fetched because the budget of the
+  /// remote tile cache is full
+  /// \note Zero tiles, and local tiles that are in memory, are ignored
+  template <typename Index>
+  bool prefetch(const Index& i) const {
+    if (TensorImpl_::is_zero(i)) return true;
+    const auto ord = TensorImpl_::trange().tiles_range().ordinal(i);
+    const std::size_t bytes =
+        TensorImpl_::trange().make_tile_range(ord).volume() *
+        sizeof(numeric_type);
+    return data_.prefetch(ord, bytes);
+  }
+
+  /// Remote tile cache status
+
+  /// \return \c true if the cache of remote tiles is enabled
+  bool has_remote_cache() const {
+    return data_.has_remote_cache();
+  }
+
   /// Set tile
 
   /// Set the tile at \c i with \c value . \c Value type may be \c value_type ,
@@ -493,6 +525,7 @@ class ArrayImpl : public TensorImpl<Policy> {
     TA_ASSERT(!TensorImpl_::is_zero(i));
     const auto ord = TensorImpl_::trange().tiles_range().ordinal(i);
     data_.set(ord, value);
+    version_.fetch_add(1ul, std::memory_order_relaxed);
     if (set_notifier_accessor()) {
       set_notifier_accessor()(*this, ord);
     }
@@ -542,11 +575,67 @@ class ArrayImpl : public TensorImpl<Policy> {
     return const_iterator(this, TensorImpl_::pmap()->end());
   }
 
+  /// Enable or disable the cache of remote tiles
+
+  /// \param max_bytes The byte budget of the cache; 0 disables the cache
+  void set_remote_cache(const std::size_t max_bytes) {
+    data_.set_remote_cache(max_bytes);
+  }
+
+  /// Clear the cache of remote tiles
+  void invalidate_remote_cache() { data_.invalidate_remote_cache(); }
+
+  /// Remote tile cache statistics accessor
+
+  /// \return The statistics of the remote tile cache
+  TileCacheStats remote_cache_stats() const {
+    return data_.remote_cache_stats();
+  }
+
+  /// Enable or disable out-of-core storage of local tiles
+
+  /// \param max_bytes The byte budget of the local tiles held in memory; 0
+  /// disables out-of-core storage
+  /// \param directory The directory of the spill file
+  void set_spill(const std::size_t max_bytes, const std::string& directory) {
+    data_.set_spill(max_bytes, directory);
+  }
+
+  /// Out-of-core storage statistics accessor
+
+  /// \return The statistics of the out-of-core storage of local tiles
+  TileSpillStats spill_stats() const { return data_.spill_stats(); }
+
+  /// Memory statistics accessor
+
+  /// \return The memory held by the local tiles and the shape of this array
+  MemoryStats memory_stats() const { return data_.memory().snapshot(); }
+
+  /// Select the compression of tiles sent by this array
+
+  /// \param params The compression parameters
+  void set_compression(const CompressionParams& params) {
+    data_.set_compression(params);
+  }
+
+  /// Compression parameters accessor
+
+  /// \return The compression parameters selected for this array, or null if
+  /// the default parameters are used
+  const CompressionParams* compression() const { return data_.compression(); }
+
   /// Unique object id accessor
 
   /// \return A const reference to this object unique id
   const madness::uniqueidT& id() const { return data_.id(); }
 
+  /// Version accessor
+
+  /// \return The number of local tiles that were set in this array
+  std::uint64_t version() const {
+    return version_.load(std::memory_order_relaxed);
+  }
+
   static std::function<void(const ArrayImpl_&, int64_t)>&
   set_notifier_accessor() {
     static std::function<void(const ArrayImpl_&, int64_t)> value;
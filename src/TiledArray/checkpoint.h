@@ -0,0 +1,225 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  checkpoint.h
+ *  Nov 21, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_CHECKPOINT_H__INCLUDED
+#define TILEDARRAY_CHECKPOINT_H__INCLUDED
+
+#include <TiledArray/tile_file.h>
+
+#include <cmath>
+#include <unordered_map>
+
+namespace TiledArray {
+namespace detail {
+
+/// 64-bit FNV-1a hash of a byte buffer
+
+/// \param data The bytes to be hashed
+/// \return The hash of \c data
+inline std::uint64_t hash_bytes(const std::vector<unsigned char>& data) {
+  std::uint64_t result = 0xcbf29ce484222325ull;
+  for (const auto byte : data) {
+    result ^= byte;
+    result *= 0x100000001b3ull;
+  }
+  return result;
+}
+
+}  // namespace detail
+
+/// Incremental checkpoints of an array
+
+/// The first call to \c write() stores a full base checkpoint; each
+/// following call stores a delta that holds only the tiles that changed
+/// since they were last stored. A tile is considered changed when its hash
+/// differs and the norm of its difference from the version that was last
+/// stored exceeds the tolerance; with a zero tolerance any change in content
+/// is stored. Since a tile is compared to the version that was last stored,
+/// small changes that accumulate beyond the tolerance are eventually stored.
+/// With a nonzero tolerance, a copy of every local tile as it was last
+/// stored is kept in memory. Checkpoints are tile files (see
+/// \c write_tile_file ) named <tt>prefix.0</tt> (the base),
+/// <tt>prefix.1</tt>, ... (the deltas), so every process writes its own
+/// tiles directly. \c restore() reads each tile only once, from the last
+/// checkpoint that holds it.
+/// \tparam Array The array type
+template <typename Array>
+class Checkpoint {
+ public:
+  typedef typename Array::value_type value_type;  ///< Tile type
+
+ private:
+  /// State of a local tile when it was last stored
+  struct Record {
+    std::uint64_t hash;  ///< The hash of the serialized tile
+    value_type tile;     ///< A copy of the tile, if the tolerance is nonzero
+  };  // struct Record
+
+  std::string prefix_;  ///< The checkpoint file name prefix
+  double tolerance_;    ///< Change below which tiles are not stored
+  std::size_t count_;   ///< The number of checkpoints in the sequence
+  std::unordered_map<std::size_t, Record>
+      records_;  ///< Local tiles, as they were last stored
+
+ public:
+  /// Constructor
+
+  /// \param prefix The checkpoint file name prefix
+  /// \param tolerance Norm of the change of a tile below which it is not
+  /// stored
+  explicit Checkpoint(const std::string& prefix, const double tolerance = 0.0)
+      : prefix_(prefix), tolerance_(tolerance), count_(0ul), records_() {
+    TA_ASSERT(tolerance >= 0.0);
+  }
+
+  /// Checkpoint file name
+
+  /// \param n The position of the checkpoint in the sequence
+  /// \return The name of checkpoint \c n
+  static std::string filename(const std::string& prefix, const std::size_t n) {
+    return prefix + "." + std::to_string(n);
+  }
+
+  /// Number of checkpoints accessor
+
+  /// \return The number of checkpoints written in the sequence, including
+  /// the base
+  std::size_t size() const { return count_; }
+
+  /// Write a checkpoint of an array
+
+  /// Writes a base checkpoint if none was written yet, otherwise a delta.
+  /// \param array The array; it must have the same tiled range as the
+  /// arrays previously written in the sequence
+  /// \return The number of tiles written by this process
+  /// \note This is a collective operation that fences before and after
+  /// writing.
+  std::size_t write(const Array& array) {
+    World& world = array.world();
+    const bool base = (count_ == 0ul);
+
+    // Forget the tiles that are no longer stored by this process
+    for (auto it = records_.begin(); it != records_.end();) {
+      if (array.is_zero(it->first) || !array.is_local(it->first))
+        it = records_.erase(it);
+      else
+        ++it;
+    }
+
+    // Remove the deltas of a previous sequence, so they are not restored
+    if (base && world.rank() == 0)
+      for (std::size_t n = 1ul;
+           std::remove(filename(prefix_, n).c_str()) == 0; ++n)
+        ;
+
+    std::size_t written = 0ul;
+    detail::write_tile_file(
+        array, filename(prefix_, count_),
+        [this, base, &written](std::size_t ord, const value_type& tile,
+                               const std::vector<unsigned char>& bytes) {
+          const std::uint64_t hash = detail::hash_bytes(bytes);
+          auto it = records_.find(ord);
+          const bool changed =
+              base || (it == records_.end()) ||
+              ((hash != it->second.hash) &&
+               ((tolerance_ == 0.0) ||
+                (double(norm(subt(tile, it->second.tile))) > tolerance_)));
+          if (changed) {
+            Record& record = records_[ord];
+            record.hash = hash;
+            if (tolerance_ != 0.0) record.tile = clone(tile);
+            ++written;
+          }
+          return changed;
+        });
+    ++count_;
+
+    return written;
+  }
+
+  /// Start a new sequence with a base checkpoint
+
+  /// \param array The array
+  /// \return The number of tiles written by this process
+  /// \note This is a collective operation that fences before and after
+  /// writing.
+  std::size_t rebase(const Array& array) {
+    count_ = 0ul;
+    records_.clear();
+    return write(array);
+  }
+
+  /// Restore an array from a checkpoint sequence
+
+  /// The base and every delta are opened, and each local tile is read from
+  /// the last checkpoint that holds it.
+  /// \param world The world where the array will live
+  /// \param prefix The checkpoint file name prefix
+  /// \param pmap The process map of the array [default = the policy's
+  /// default process map]
+  /// \return The array, as of the last checkpoint in the sequence
+  /// \throw TiledArray::Exception When there is no base checkpoint, or the
+  /// checkpoints are inconsistent
+  /// \note This is a collective operation. The tiles are available after the
+  /// next fence.
+  static Array restore(World& world, const std::string& prefix,
+                       const std::shared_ptr<typename Array::pmap_interface>&
+                           pmap = {}) {
+    std::vector<std::shared_ptr<detail::PosixFile> > files;
+    std::vector<detail::TileFileHeader<Array> > headers;
+    for (std::size_t n = 0ul;; ++n) {
+      const std::string name = filename(prefix, n);
+      if (::access(name.c_str(), R_OK) != 0) break;
+      files.push_back(std::make_shared<detail::PosixFile>(name, O_RDONLY));
+      headers.emplace_back(*files.back());
+      if (headers.back().trange != headers.front().trange)
+        TA_EXCEPTION("Checkpoint: delta tiled range != base tiled range");
+    }
+    if (files.empty()) TA_EXCEPTION("Checkpoint: no base checkpoint");
+
+    const auto& last = headers.back();
+    Array result(world, last.trange, last.shape, pmap);
+    for (auto ord : *result.pmap()) {
+      if (result.is_zero(ord)) continue;
+
+      // Find the last checkpoint that holds the tile
+      std::size_t n = headers.size();
+      while (n > 0ul && headers[n - 1ul].index[ord].size == 0ul) --n;
+      if (n == 0ul) TA_EXCEPTION("Checkpoint: missing tile");
+
+      auto file = files[n - 1ul];
+      const detail::TileFileLayout::Entry entry = headers[n - 1ul].index[ord];
+      Future<value_type> tile =
+          world.taskq.add([file, entry]() -> value_type {
+            return detail::read_tile<value_type>(*file, entry);
+          });
+      result.set(ord, tile);
+    }
+
+    return result;
+  }
+
+};  // class Checkpoint
+
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_CHECKPOINT_H__INCLUDED
@@ -0,0 +1,82 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  redistribute.h
+ *  Nov 12, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_CONVERSIONS_REDISTRIBUTE_H__INCLUDED
+#define TILEDARRAY_CONVERSIONS_REDISTRIBUTE_H__INCLUDED
+
+#include <TiledArray/redistributor.h>
+
+namespace TiledArray {
+
+/// Forward declarations
+template <typename, typename>
+class DistArray;
+
+/// Default batch size, in bytes, used by \c redistribute
+constexpr std::size_t redistribute_default_batch_bytes = 1ul << 24;
+
+/// Copy an array to a different process map
+
+/// Tiles that change owner are aggregated per destination process and
+/// shipped in batches of (approximately) \c max_batch_bytes , which bounds
+/// the communication buffer memory of each message. The result array has the
+/// same tiled range and shape as \c arg . Tile data is shared, not copied,
+/// for tiles that do not change owner.
+/// \tparam Tile The tile type of the array
+/// \tparam Policy The policy of the array
+/// \param arg The array to be redistributed
+/// \param pmap The process map of the result array
+/// \param max_batch_bytes The size of tile data, in bytes, that triggers the
+/// send of a batch
+/// \return An array that is equal to \c arg and distributed with \c pmap
+/// \note This is a collective operation. The result is complete after the
+/// next fence.
+template <typename Tile, typename Policy>
+inline DistArray<Tile, Policy> redistribute(
+    const DistArray<Tile, Policy>& arg,
+    const std::shared_ptr<typename DistArray<Tile, Policy>::pmap_interface>&
+        pmap,
+    const std::size_t max_batch_bytes = redistribute_default_batch_bytes) {
+  typedef DistArray<Tile, Policy> array_type;
+
+  if (pmap == arg.pmap()) return arg;
+
+  World& world = arg.world();
+
+  // Make an empty result array
+  array_type result(world, arg.trange(), arg.shape(), pmap);
+
+  // Create the redistributor object that will ship the local tiles
+  auto redistributor = std::make_shared<detail::Redistributor<array_type>>(
+      arg, result, max_batch_bytes);
+
+  // Put the redistributor pointer in the deferred cleanup object so it will
+  // be deleted at the end of the next fence.
+  TA_ASSERT(redistributor.unique());  // Required for deferred_cleanup
+  madness::detail::deferred_cleanup(world, redistributor);
+
+  return result;
+}
+
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_CONVERSIONS_REDISTRIBUTE_H__INCLUDED
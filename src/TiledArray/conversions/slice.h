@@ -0,0 +1,400 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  slice.h
+ *  Dec 12, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_CONVERSIONS_SLICE_H__INCLUDED
+#define TILEDARRAY_CONVERSIONS_SLICE_H__INCLUDED
+
+#include <TiledArray/dense_shape.h>
+#include <TiledArray/error.h>
+#include <TiledArray/external/madness.h>
+#include <TiledArray/sparse_shape.h>
+#include <TiledArray/tiled_range.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+namespace TiledArray {
+
+/// Forward declarations
+template <typename, typename>
+class DistArray;
+
+namespace detail {
+
+/// Tiling of an element slice of an array
+
+/// The tile boundaries of the slice are the boundaries of the array tiles
+/// that lie inside of the slice, so every slice tile is a sub-block of exactly
+/// one array tile and only the first and last tiles of each dimension may be
+/// partial. The element range of the slice starts at zero.
+class ElementSlice {
+ public:
+  typedef std::size_t size_type;          ///< Size type
+  typedef std::vector<size_type> index;  ///< Element or tile index type
+
+  /// Tile ordinal of array tiles that are not in the slice
+  static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+ private:
+  TiledRange source_;  ///< The tiled range of the array
+  TiledRange trange_;  ///< The tiled range of the slice
+  index lobound_;      ///< The lower bound of the slice in the array
+  index upbound_;      ///< The upper bound of the slice in the array
+  std::vector<index>
+      source_tiles_;  ///< The array tile of each slice tile, per dimension
+  std::vector<index> slice_tiles_;  ///< The slice tile of each array tile, or
+                                    ///< \c npos , per dimension
+
+ public:
+  /// Constructor
+
+  /// \tparam Index The bound index type
+  /// \param source The tiled range of the array
+  /// \param lower_bound The lower bound of the slice elements
+  /// \param upper_bound The upper bound of the slice elements
+  template <typename Index>
+  ElementSlice(const TiledRange& source, const Index& lower_bound,
+               const Index& upper_bound)
+      : source_(source),
+        trange_(),
+        lobound_(std::begin(lower_bound), std::end(lower_bound)),
+        upbound_(std::begin(upper_bound), std::end(upper_bound)),
+        source_tiles_(source.rank()),
+        slice_tiles_(source.rank()) {
+    const auto rank = source_.rank();
+    TA_USER_ASSERT((lobound_.size() == rank) && (upbound_.size() == rank),
+                   "ElementSlice: the rank of the bounds does not match the "
+                   "array.");
+
+    std::vector<TiledRange1> ranges;
+    ranges.reserve(rank);
+    for (unsigned int d = 0u; d < rank; ++d) {
+      const TiledRange1& tr1 = source_.data()[d];
+      const size_type lo = lobound_[d];
+      const size_type up = upbound_[d];
+      TA_USER_ASSERT((lo < up) && (lo >= tr1.elements_range().first) &&
+                         (up <= tr1.elements_range().second),
+                     "ElementSlice: the slice bounds are not inside of the "
+                     "array elements.");
+
+      index hashmarks(1, 0ul);
+      slice_tiles_[d].assign(tr1.tile_extent(), size_type(npos));
+      for (size_type t = tr1.tiles_range().first;
+           t < tr1.tiles_range().second; ++t) {
+        const auto& tile = tr1.tile(t);
+        if ((tile.second <= lo) || (tile.first >= up)) continue;
+        slice_tiles_[d][t - tr1.tiles_range().first] =
+            source_tiles_[d].size();
+        source_tiles_[d].push_back(t);
+        hashmarks.push_back(std::min(tile.second, up) - lo);
+      }
+      ranges.emplace_back(hashmarks.begin(), hashmarks.end());
+    }
+    TiledRange(ranges.begin(), ranges.end()).swap(trange_);
+  }
+
+  /// \return The tiled range of the slice
+  const TiledRange& trange() const { return trange_; }
+
+  /// The array tile of a slice tile
+
+  /// \param i The ordinal of the slice tile
+  /// \return The ordinal of the array tile that contains slice tile \c i
+  size_type source_tile(const size_type i) const {
+    const auto tile = trange_.tiles_range().idx(i);
+    index result(tile.size());
+    for (unsigned int d = 0u; d < tile.size(); ++d)
+      result[d] = source_tiles_[d][tile[d]];
+    return source_.tiles_range().ordinal(result);
+  }
+
+  /// The slice tile of an array tile
+
+  /// \param i The ordinal of the array tile
+  /// \return The ordinal of the slice tile that is a sub-block of array tile
+  /// \c i , or \c npos if tile \c i is not in the slice
+  size_type slice_tile(const size_type i) const {
+    const auto tile = source_.tiles_range().idx(i);
+    index result(tile.size());
+    for (unsigned int d = 0u; d < tile.size(); ++d) {
+      result[d] =
+          slice_tiles_[d][tile[d] - source_.data()[d].tiles_range().first];
+      if (result[d] == npos) return npos;
+    }
+    return trange_.tiles_range().ordinal(result);
+  }
+
+  /// Test that an array tile is inside of the slice
+
+  /// \param i The ordinal of the array tile
+  /// \return \c true if every element of array tile \c i is in the slice
+  bool covers(const size_type i) const {
+    const auto range = source_.make_tile_range(i);
+    for (unsigned int d = 0u; d < range.rank(); ++d)
+      if ((range.lobound(d) < lobound_[d]) || (range.upbound(d) > upbound_[d]))
+        return false;
+    return true;
+  }
+
+  /// The array elements of a slice tile
+
+  /// \param i The ordinal of the slice tile
+  /// \param[out] lower_bound The lower bound of the tile in the array
+  /// \param[out] upper_bound The upper bound of the tile in the array
+  void source_bounds(const size_type i, index& lower_bound,
+                     index& upper_bound) const {
+    const auto range = trange_.make_tile_range(i);
+    lower_bound.resize(range.rank());
+    upper_bound.resize(range.rank());
+    for (unsigned int d = 0u; d < range.rank(); ++d) {
+      lower_bound[d] = range.lobound(d) + lobound_[d];
+      upper_bound[d] = range.upbound(d) + lobound_[d];
+    }
+  }
+
+  /// \return The shift from array element indices to slice element indices
+  std::vector<long> shift() const {
+    std::vector<long> result(lobound_.size());
+    for (unsigned int d = 0u; d < lobound_.size(); ++d)
+      result[d] = -long(lobound_[d]);
+    return result;
+  }
+
+  /// The shape of the slice of a dense array
+  DenseShape shape(const DenseShape&) const { return DenseShape(); }
+
+  /// The shape of the slice of a sparse array
+
+  /// The norm of a slice tile is bounded by the norm of its array tile.
+  /// \param shape The shape of the array
+  /// \return The shape of the slice
+  template <typename T>
+  SparseShape<T> shape(const SparseShape<T>& shape) const {
+    Tensor<T> tile_norms(trange_.tiles_range(), T(0));
+    for (size_type i = 0ul; i < tile_norms.size(); ++i) {
+      const size_type s = source_tile(i);
+      tile_norms[i] = shape.data()[s] *
+                      T(source_.make_tile_range(s).volume()) /
+                      T(trange_.make_tile_range(i).volume());
+    }
+    return SparseShape<T>(tile_norms, trange_, true);
+  }
+
+  /// The shape of a dense array with an updated slice
+  DenseShape update_shape(const DenseShape&, const DenseShape&) const {
+    return DenseShape();
+  }
+
+  /// The shape of a sparse array with an updated slice
+
+  /// The norm of an updated array tile is bounded by the sum of the norms of
+  /// the old tile and of the new slice tile.
+  /// \param shape The shape of the array
+  /// \param value The shape of the new slice
+  /// \return The shape of the array with the new slice
+  template <typename T>
+  SparseShape<T> update_shape(const SparseShape<T>& shape,
+                              const SparseShape<T>& value) const {
+    Tensor<T> tile_norms = shape.data().clone();
+    for (size_type i = 0ul; i < tile_norms.size(); ++i) {
+      const size_type j = slice_tile(i);
+      if (j == npos) continue;
+      const T volume = source_.make_tile_range(i).volume();
+      const T value_norm =
+          value.data()[j] * T(trange_.make_tile_range(j).volume());
+      tile_norms[i] =
+          ((covers(i) ? T(0) : tile_norms[i] * volume) + value_norm) / volume;
+    }
+    return SparseShape<T>(tile_norms, source_, true);
+  }
+};  // class ElementSlice
+
+}  // namespace detail
+
+/// Copy an element slice of an array
+
+/// The bounds of the slice do not need to be on tile boundaries. The tiles
+/// of the result are the parts of the array tiles that lie inside of the
+/// slice (see \c detail::ElementSlice ), and the element range of the result
+/// starts at zero. Each result tile is cut from its array tile by the owner
+/// of the array tile, so only the elements of the slice are communicated.
+/// The shape of a sparse result is bounded by the norms of the array tiles.
+/// \tparam Tile The tile type of the array, which must provide \c block()
+/// and \c shift_to() , e.g. \c TiledArray::Tensor
+/// \tparam Policy The policy of the array
+/// \tparam Index The bound index type
+/// \param arg The array to be sliced
+/// \param lower_bound The lower bound of the slice elements
+/// \param upper_bound The upper bound of the slice elements
+/// \return An array that holds the elements of \c arg in
+/// [ \c lower_bound , \c upper_bound )
+/// \note This is a collective operation. The result is complete after the
+/// next fence.
+template <typename Tile, typename Policy, typename Index>
+inline DistArray<Tile, Policy> slice(const DistArray<Tile, Policy>& arg,
+                                     const Index& lower_bound,
+                                     const Index& upper_bound) {
+  typedef DistArray<Tile, Policy> array_type;
+  typedef typename array_type::value_type value_type;
+  typedef detail::ElementSlice::index index;
+
+  World& world = arg.world();
+  const detail::ElementSlice element_slice(arg.trange(), lower_bound,
+                                           upper_bound);
+  const std::vector<long> shift = element_slice.shift();
+
+  // Make an empty result array
+  array_type result(world, element_slice.trange(),
+                    element_slice.shape(arg.shape()));
+
+  // Cut the result tiles from the local array tiles
+  for (std::size_t i = 0ul; i < result.size(); ++i) {
+    if (result.is_zero(i)) continue;
+    const auto source = element_slice.source_tile(i);
+    if (!arg.is_local(source)) continue;
+
+    index lobound, upbound;
+    element_slice.source_bounds(i, lobound, upbound);
+    auto op = [lobound, upbound, shift](const value_type& tile) {
+      value_type result_tile(tile.block(lobound, upbound));
+      result_tile.shift_to(shift);
+      return result_tile;
+    };
+    result.set(i, world.taskq.add(op, arg.find(source)));
+  }
+
+  return result;
+}
+
+/// Copy an element slice of an array
+
+/// \tparam Tile The tile type of the array
+/// \tparam Policy The policy of the array
+/// \param arg The array to be sliced
+/// \param lower_bound The lower bound of the slice elements
+/// \param upper_bound The upper bound of the slice elements
+/// \return An array that holds the elements of \c arg in
+/// [ \c lower_bound , \c upper_bound )
+template <typename Tile, typename Policy>
+inline DistArray<Tile, Policy> slice(
+    const DistArray<Tile, Policy>& arg,
+    const std::initializer_list<std::size_t>& lower_bound,
+    const std::initializer_list<std::size_t>& upper_bound) {
+  return slice<Tile, Policy, std::initializer_list<std::size_t>>(
+      arg, lower_bound, upper_bound);
+}
+
+/// Assign an element slice of an array
+
+/// The elements of \c arg in [ \c lower_bound , \c upper_bound ) are replaced
+/// by the elements of \c value , whose tiled range must be the tiled range of
+/// \c slice(arg,lower_bound,upper_bound) . Each updated array tile is copied
+/// by its owner, which fetches only the slice tile that overlaps it; the
+/// array tiles outside of the slice are shared, not copied.
+/// \tparam Tile The tile type of the array, which must provide \c block()
+/// and \c clone() , e.g. \c TiledArray::Tensor
+/// \tparam Policy The policy of the array
+/// \tparam Index The bound index type
+/// \param[in,out] arg The array to be updated
+/// \param lower_bound The lower bound of the slice elements
+/// \param upper_bound The upper bound of the slice elements
+/// \param value The new elements of the slice
+/// \note This is a collective operation. \c arg is complete after the next
+/// fence.
+template <typename Tile, typename Policy, typename Index>
+inline void assign_slice(DistArray<Tile, Policy>& arg, const Index& lower_bound,
+                         const Index& upper_bound,
+                         const DistArray<Tile, Policy>& value) {
+  typedef DistArray<Tile, Policy> array_type;
+  typedef typename array_type::value_type value_type;
+  typedef detail::ElementSlice::index index;
+
+  World& world = arg.world();
+  const detail::ElementSlice element_slice(arg.trange(), lower_bound,
+                                           upper_bound);
+  TA_USER_ASSERT(value.trange() == element_slice.trange(),
+                 "assign_slice(): the tiled range of the value does not match "
+                 "the slice.");
+
+  // Make an empty result array
+  array_type result(world, arg.trange(),
+                    element_slice.update_shape(arg.shape(), value.shape()),
+                    arg.pmap());
+
+  for (const auto i : *arg.pmap()) {
+    if (result.is_zero(i)) continue;
+    const auto j = element_slice.slice_tile(i);
+    if (j == detail::ElementSlice::npos) {
+      result.set(i, arg.find(i));
+      continue;
+    }
+
+    // Zero tiles are passed to the task as empty tiles
+    Future<value_type> arg_tile =
+        (arg.is_zero(i) ? Future<value_type>(value_type()) : arg.find(i));
+    Future<value_type> slice_tile =
+        (value.is_zero(j) ? Future<value_type>(value_type()) : value.find(j));
+
+    index lobound, upbound;
+    element_slice.source_bounds(j, lobound, upbound);
+    const auto range = arg.trange().make_tile_range(i);
+    auto op = [lobound, upbound, range](const value_type& tile,
+                                        const value_type& value_tile) {
+      value_type result_tile =
+          (tile.empty() ? value_type(range, typename value_type::value_type())
+                        : tile.clone());
+      if (value_tile.empty())
+        result_tile.block(lobound, upbound) = value_type(
+            Range(lobound, upbound), typename value_type::value_type());
+      else
+        result_tile.block(lobound, upbound) = value_tile;
+      return result_tile;
+    };
+    result.set(i, world.taskq.add(op, arg_tile, slice_tile));
+  }
+
+  result.swap(arg);
+}
+
+/// Assign an element slice of an array
+
+/// \tparam Tile The tile type of the array
+/// \tparam Policy The policy of the array
+/// \param[in,out] arg The array to be updated
+/// \param lower_bound The lower bound of the slice elements
+/// \param upper_bound The upper bound of the slice elements
+/// \param value The new elements of the slice
+template <typename Tile, typename Policy>
+inline void assign_slice(DistArray<Tile, Policy>& arg,
+                         const std::initializer_list<std::size_t>& lower_bound,
+                         const std::initializer_list<std::size_t>& upper_bound,
+                         const DistArray<Tile, Policy>& value) {
+  assign_slice<Tile, Policy, std::initializer_list<std::size_t>>(
+      arg, lower_bound, upper_bound, value);
+}
+
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_CONVERSIONS_SLICE_H__INCLUDED
@@ -29,6 +29,7 @@
 //#include <TiledArray/tensor.h>
 #include <TiledArray/array_impl.h>
 #include <TiledArray/conversions/clone.h>
+#include <TiledArray/conversions/redistribute.h>
 #include <TiledArray/conversions/truncate.h>
 #include <TiledArray/policies/dense_policy.h>
 #include <TiledArray/tile_interface/cast.h>
@@ -309,6 +310,17 @@ class DistArray : public madness::archive::ParallelSerializableObject {
   /// should not rely on this function.
   madness::uniqueidT id() const { return pimpl_->id(); }
 
+  /// Local version of the array data
+
+  /// The version is incremented each time a local tile is set, so it
+  /// differs between processes. Modifications of tiles in place, e.g.
+  /// through the futures returned by \c find(), are not counted.
+  /// \return The number of local tiles that were set in this array
+  std::uint64_t version() const {
+    check_pimpl();
+    return pimpl_->version();
+  }
+
   /// Begin iterator factory function
 
   /// \return An iterator to the first local tile.
@@ -364,6 +376,143 @@ class DistArray : public madness::archive::ParallelSerializableObject {
     return find<std::initializer_list<Integer>>(i);
   }
 
+  /// Enable or disable the cache of remote tiles
+
+  /// When enabled, remote tiles returned by \c find() are kept in a local
+  /// cache with least-recently-used eviction, so repeated \c find() calls
+  /// for the same tile do not communicate. The cache is cleared at the first
+  /// fence after a tile is cached, so that modified tiles are not read.
+  /// \param max_bytes The byte budget of the cache; 0 disables the cache
+  /// \note This is a local operation; it must be called from the main thread.
+  void set_remote_cache(const std::size_t max_bytes) {
+    check_pimpl();
+    pimpl_->set_remote_cache(max_bytes);
+  }
+
+  /// Start fetching remote tiles
+
+  /// Requests the remote tiles in \c indices from their owners and returns
+  /// immediately. The tiles are staged in the remote tile cache, which must
+  /// be enabled with \c set_remote_cache() , so later calls to \c find()
+  /// for these tiles are satisfied locally. Tiles are requested in the order
+  /// of \c indices while their estimated size fits in the budget of the
+  /// cache; a prefetched tile is not evicted before it is found, so the
+  /// tiles past the budget are not requested. Local tiles that were spilled
+  /// to disk (see \c set_spill() ) are read back; other local tiles and zero
+  /// tiles are ignored.
+  /// \tparam Indices A container of ordinal or coordinate tile indices
+  /// \param indices The tiles to prefetch
+  /// \return \c true if all tiles were requested, \c false if the budget of
+  /// the remote tile cache was exhausted first
+  /// \throw TiledArray::Exception If a tile is remote and the remote tile
+  /// cache is disabled.
+  /// \note This function must be called from the main thread.
+  template <typename Indices>
+  bool prefetch(const Indices& indices) {
+    check_pimpl();
+    for (const auto& i : indices) {
+      check_index(i);
+      if (!pimpl_->prefetch(i)) return false;
+    }
+    return true;
+  }
+
+  /// Start fetching a block of remote tiles
+
+  /// Prefetches all tiles with indices in the range
+  /// [\c lower_bound, \c upper_bound). See \c prefetch(indices)
+  /// \tparam Index A coordinate index type
+  /// \param lower_bound The lower bound of the tile block
+  /// \param upper_bound The upper bound of the tile block
+  /// \return \c true if all tiles were requested, \c false if the budget of
+  /// the remote tile cache was exhausted first
+  template <typename Index,
+            typename = std::enable_if_t<!std::is_integral<Index>::value>>
+  bool prefetch(const Index& lower_bound, const Index& upper_bound) {
+    return prefetch(Range(lower_bound, upper_bound));
+  }
+
+  /// Clear the cache of remote tiles
+
+  /// Call this after modifying remote tiles, if the cache is enabled and
+  /// there was no fence since the modification.
+  void invalidate_remote_cache() {
+    check_pimpl();
+    pimpl_->invalidate_remote_cache();
+  }
+
+  /// Remote tile cache statistics accessor
+
+  /// \return The number of cache hits, misses, and evictions, and the size
+  /// of the cached tiles
+  detail::TileCacheStats remote_cache_stats() const {
+    check_pimpl();
+    return pimpl_->remote_cache_stats();
+  }
+
+  /// Enable or disable out-of-core storage of local tiles
+
+  /// When enabled, the local tiles that exceed a memory budget are written
+  /// to a temporary file by tasks (least recently used first) and released
+  /// from memory. They are read back transparently by tasks when
+  /// \c find() is called; \c prefetch() starts reading them early. Memory
+  /// is reclaimed only for tiles whose futures are not held elsewhere: a
+  /// released tile stays in memory while a future returned by \c find() , or
+  /// an expression that uses the tile, still refers to it, and such tiles do
+  /// not count against the budget.
+  /// \param max_bytes The byte budget of the local tiles held in memory; 0
+  /// disables out-of-core storage
+  /// \param directory The directory of the spill file [default = the value
+  /// of the \c TA_SPILL_DIR or \c TMPDIR environment variables, or \c /tmp]
+  /// \note This is a local operation; it must be called from the main thread
+  /// while no tasks use this array.
+  void set_spill(const std::size_t max_bytes,
+                 const std::string& directory =
+                     detail::TileSpill<value_type>::default_directory()) {
+    check_pimpl();
+    pimpl_->set_spill(max_bytes, directory);
+  }
+
+  /// Select the compression of tiles sent by this array
+
+  /// Tiles sent to other processes by \c set() and \c find() , and tiles
+  /// written by \c serialize() , are compressed losslessly with \c params
+  /// instead of the default parameters (see
+  /// \c detail::CompressionParams::default_params() , which also apply to
+  /// tiles broadcast during evaluation). Compression counters are collected
+  /// by \c detail::CompressionCounters::global() .
+  /// \param params The compression parameters
+  /// \note This is a local operation; it must be called from the main thread
+  /// while no tasks use this array.
+  void set_compression(const detail::CompressionParams& params) {
+    check_pimpl();
+    pimpl_->set_compression(params);
+  }
+
+  /// Out-of-core storage statistics accessor
+
+  /// \return The number of tiles written, read, and released, the size of
+  /// the local tiles in memory, and the size of the spill file
+  detail::TileSpillStats spill_stats() const {
+    check_pimpl();
+    return pimpl_->spill_stats();
+  }
+
+  /// Memory statistics accessor
+
+  /// The memory of all arrays, and of the temporaries of expression
+  /// evaluations, is accumulated per world; see
+  /// \c TiledArray::memory_stats(World&) .
+  /// \return The number of bytes held on this process by the local tiles,
+  /// including spilled tiles, and by the shape of this array, and the peak
+  /// of their sum
+  /// \note Tiles that are still being computed are not counted until they
+  /// are ready.
+  detail::MemoryStats memory_stats() const {
+    check_pimpl();
+    return pimpl_->memory_stats();
+  }
+
   /// Set a tile and fill it using a sequence
 
   /// \tparam Index An index or integral type
@@ -800,6 +949,26 @@ class DistArray : public madness::archive::ParallelSerializableObject {
     }
   }
 
+  /// Move this array to a different process map
+
+  /// The tiles of this array are shipped to their new owners in aggregated,
+  /// per-destination batches. See TiledArray::redistribute for details.
+  /// \param pmap The new process map
+  /// \param max_batch_bytes The size of tile data, in bytes, that triggers
+  /// the send of a batch
+  /// \note This is a collective operation. The data is in place after the
+  /// next fence.
+  void redistribute(
+      const std::shared_ptr<pmap_interface>& pmap,
+      const std::size_t max_batch_bytes = redistribute_default_batch_bytes) {
+    check_pimpl();
+    TA_USER_ASSERT(pmap->size() == size(),
+                   "Array::redistribute() -- The size of the process map is "
+                   "not equal to the number of tiles in the array.");
+    DistArray_::operator=(TiledArray::redistribute(*this, pmap,
+                                                   max_batch_bytes));
+  }
+
   /// Update shape data and remove tiles that are below the zero threshold
 
   /// \note This function is a no-op for dense arrays.
@@ -828,6 +997,7 @@ class DistArray : public madness::archive::ParallelSerializableObject {
     int64_t count = 0;
     for (auto it = begin(); it != end(); ++it) ++count;
     ar& count;
+    detail::CompressionScope scope(pimpl_->compression());
     for (auto it = begin(); it != end(); ++it) ar & it->get();
   }
 
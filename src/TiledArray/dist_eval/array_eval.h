@@ -28,6 +28,9 @@
 
 #include <TiledArray/block_range.h>
 #include <TiledArray/dist_eval/dist_eval.h>
+#include <TiledArray/tile_interface/clone.h>
+
+#include <unordered_map>
 
 namespace TiledArray {
 namespace detail {
@@ -269,6 +272,14 @@ class ArrayEvalImpl
  private:
   value_type make_tile(const typename array_type::value_type& tile,
                        const bool consume) const {
+    // Remote tiles are consumable, and permutations are applied lazily
+    const auto& counters = DistEvalImpl_::counters();
+    if (counters) {
+      if (consume)
+        counters->add_bytes(EvalBytes::communicated, memory_bytes(tile));
+      if (op_->permutation())
+        counters->add_bytes(EvalBytes::permuted, memory_bytes(tile));
+    }
     return value_type(tile, op_, consume);
   }
 
@@ -321,6 +332,107 @@ class ArrayEvalImpl
 
 };  // class ArrayEvalImpl
 
+/// Distributed evaluator of the tiles of a cached intermediate array
+
+/// The tiles are those of an array that was materialized from an earlier
+/// evaluation of the same expression (see \c expressions::ExprCache ), so
+/// they are already in the result layout. Local tiles are cloned because
+/// the consumers of evaluated tiles may modify them in place, except for
+/// the tiles of the materializing evaluation, which are moved to the
+/// consumers while the array holds their clones.
+/// \tparam Array The array type
+/// \tparam Policy The evaluator policy type
+template <typename Array, typename Policy>
+class CachedEvalImpl
+    : public DistEvalImpl<typename Array::value_type, Policy> {
+ public:
+  typedef CachedEvalImpl<Array, Policy> CachedEvalImpl_;  ///< This object type
+  typedef DistEvalImpl<typename Array::value_type, Policy>
+      DistEvalImpl_;  ///< The base class type
+  typedef typename DistEvalImpl_::TensorImpl_
+      TensorImpl_;           ///< The base, base class type
+  typedef Array array_type;  ///< The array type
+  typedef typename DistEvalImpl_::size_type size_type;  ///< Size type
+  typedef typename DistEvalImpl_::shape_type shape_type;  ///< Shape type
+  typedef typename DistEvalImpl_::pmap_interface
+      pmap_interface;  ///< Process map interface type
+  typedef
+      typename DistEvalImpl_::trange_type trange_type;  ///< tiled range type
+  typedef typename DistEvalImpl_::value_type value_type;  ///< Tile type
+
+ private:
+  array_type array_;  ///< The cached array
+  std::unordered_map<size_type, Future<value_type> >
+      tiles_;  ///< Local tiles that are not held by the array
+
+ public:
+  /// Task function that copies a local tile of the cached array
+  static value_type clone_tile(const value_type& tile) {
+    return TiledArray::clone(tile);
+  }
+
+  /// Constructor
+
+  /// \param array The cached array
+  /// \param world The world where array will be evaluated
+  /// \param pmap The process map for the result tensor tiles
+  /// \param tiles The local tiles to be moved to the consumers, which
+  /// are not held by \c array
+  CachedEvalImpl(
+      const array_type& array, World& world,
+      const std::shared_ptr<pmap_interface>& pmap,
+      std::unordered_map<size_type, Future<value_type> > tiles = {})
+      : DistEvalImpl_(world, array.trange(), array.shape(), pmap,
+                      Permutation()),
+        array_(array),
+        tiles_(std::move(tiles)) {}
+
+  /// Virtual destructor
+  virtual ~CachedEvalImpl() {}
+
+  virtual Future<value_type> get_tile(size_type i) const {
+    Future<value_type> tile;
+    const auto it = tiles_.find(i);
+    if (it != tiles_.end()) {
+      tile = it->second;
+    } else {
+      tile = array_.find(i);
+      if (array_.is_local(i))
+        tile = TensorImpl_::world().taskq.add(&CachedEvalImpl_::clone_tile,
+                                              tile,
+                                              madness::TaskAttributes::hipri());
+      else if (DistEvalImpl_::counters())
+        count_bytes(tile, DistEvalImpl_::counters(), EvalBytes::communicated);
+    }
+    tile.register_callback(const_cast<CachedEvalImpl_*>(this));
+    return tile;
+  }
+
+  /// Discard a tile that is not needed
+
+  /// This function handles the cleanup for tiles that are not needed in
+  /// subsequent computation.
+  virtual void discard_tile(size_type) const {
+    const_cast<CachedEvalImpl_*>(this)->notify();
+  }
+
+ private:
+  /// Evaluate the tiles of this tensor
+
+  /// The tiles are evaluated on demand by \c get_tile().
+  /// \return The number of tiles that will be set by this process
+  virtual int internal_eval() {
+    if (TensorImpl_::shape().is_dense())
+      return TensorImpl_::pmap()->local_size();
+
+    int task_count = 0;
+    for (const auto index : *TensorImpl_::pmap())
+      if (!TensorImpl_::is_zero(index)) ++task_count;
+    return task_count;
+  }
+
+};  // class CachedEvalImpl
+
 }  // namespace detail
 }  // namespace TiledArray
 
@@ -106,7 +106,12 @@ class BinaryEvalImpl : public DistEvalImpl<typename Op::result_type, Policy>,
                                     // should have the same owner
 
     const madness::DistributedID key(DistEvalImpl_::id(), i);
-    return TensorImpl_::world().gop.template recv<value_type>(source, key);
+    Future<value_type> result =
+        TensorImpl_::world().gop.template recv<value_type>(source, key);
+    if (source != TensorImpl_::world().rank())
+      timeline_future(result, TimelineCategory::recv, "recv_tile",
+                      DistEvalImpl_::timeline_node(), i);
+    return result;
   }
 
   /// Discard a tile that is not needed
@@ -126,6 +131,8 @@ class BinaryEvalImpl : public DistEvalImpl<typename Op::result_type, Policy>,
   template <typename L, typename R, typename U = value_type>
   std::enable_if_t<!detail::is_cuda_tile<U>::value, void> eval_tile(
       const size_type i, L left, R right) {
+    TimelineScope scope(TimelineCategory::tile_op, "binary",
+                        DistEvalImpl_::timeline_node(), i);
     DistEvalImpl_::set_tile(i, op_(left, right));
   }
 
@@ -146,6 +153,8 @@ class BinaryEvalImpl : public DistEvalImpl<typename Op::result_type, Policy>,
   /// \param right The right-hand tile
   template <typename L, typename R>
   void eval_tile(const size_type i, L left, R right) {
+    TimelineScope scope(TimelineCategory::tile_op, "binary",
+                        DistEvalImpl_::timeline_node(), i);
     DistEvalImpl_::set_tile(i, op_(left, right));
   }
 #endif
@@ -190,7 +199,8 @@ class BinaryEvalImpl : public DistEvalImpl<typename Op::result_type, Policy>,
             self,
             &BinaryEvalImpl_::template eval_tile<left_argument_type,
                                                  right_argument_type>,
-            target_index, left_.get(source_index), right_.get(source_index));
+            target_index, left_.get(source_index), right_.get(source_index),
+            DistEvalImpl_::task_attr(target_index));
 
         ++task_count;
       }
@@ -209,19 +219,22 @@ class BinaryEvalImpl : public DistEvalImpl<typename Op::result_type, Policy>,
                 self,
                 &BinaryEvalImpl_::template eval_tile<const ZeroTensor,
                                                      right_argument_type>,
-                target_index, ZeroTensor(), right_.get(index));
+                target_index, ZeroTensor(), right_.get(index),
+                DistEvalImpl_::task_attr(target_index));
           } else if (right_.is_zero(index)) {
             TensorImpl_::world().taskq.add(
                 self,
                 &BinaryEvalImpl_::template eval_tile<left_argument_type,
                                                      const ZeroTensor>,
-                target_index, left_.get(index), ZeroTensor());
+                target_index, left_.get(index), ZeroTensor(),
+                DistEvalImpl_::task_attr(target_index));
           } else {
             TensorImpl_::world().taskq.add(
                 self,
                 &BinaryEvalImpl_::template eval_tile<left_argument_type,
                                                      right_argument_type>,
-                target_index, left_.get(index), right_.get(index));
+                target_index, left_.get(index), right_.get(index),
+                DistEvalImpl_::task_attr(target_index));
           }
 
           ++task_count;
@@ -20,6 +20,7 @@
 #ifndef TILEDARRAY_DIST_EVAL_CONTRACTION_EVAL_H__INCLUDED
 #define TILEDARRAY_DIST_EVAL_CONTRACTION_EVAL_H__INCLUDED
 
+#include <cmath>
 #include <vector>
 
 #include <TiledArray/config.h>
@@ -27,7 +28,9 @@
 #include <TiledArray/proc_grid.h>
 #include <TiledArray/reduce_task.h>
 #include <TiledArray/shape.h>
+#include <TiledArray/tile_op/contract_fold.h>
 #include <TiledArray/type_traits.h>
+#include <TiledArray/util/memory.h>
 
 //#define TILEDARRAY_ENABLE_SUMMA_TRACE_EVAL 1
 //#define TILEDARRAY_ENABLE_SUMMA_TRACE_INITIALIZE 1
@@ -38,6 +41,43 @@
 namespace TiledArray {
 namespace detail {
 
+/// Process lists of the sparse broadcast groups of a contraction
+
+/// The lists depend only on the process grid and on the shapes of the
+/// arguments and the result, so they can be reused by later evaluations of
+/// a contraction with the same structure (see \c expressions::ExprPlan ).
+class SummaGroupPlan : private madness::Spinlock {
+ public:
+  typedef std::shared_ptr<const std::vector<ProcessID> >
+      list_type;  ///< Process list type; an empty list excludes this rank
+
+ private:
+  std::vector<list_type> lists_;  ///< Process lists of the group keys
+
+ public:
+  /// Constructor
+
+  /// \param size The number of group keys, i.e. twice the number of tiles
+  /// in the inner dimension of the contraction
+  explicit SummaGroupPlan(const std::size_t size) : lists_(size) {}
+
+  /// \param key The group key
+  /// \return The process list of group \c key , or null if it is unknown
+  list_type find(const std::size_t key) {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    TA_ASSERT(key < lists_.size());
+    return lists_[key];
+  }
+
+  /// \param key The group key
+  /// \param list The process list of group \c key
+  void insert(const std::size_t key, const list_type& list) {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    TA_ASSERT(key < lists_.size());
+    lists_[key] = list;
+  }
+};  // class SummaGroupPlan
+
 /// \brief Distributed contraction evaluator implementation
 
 /// \tparam Left The left-hand argument evaluator type
@@ -86,6 +126,8 @@ class Summa
   // Broadcast groups for dense arguments (empty for non-dense arguments)
   madness::Group row_group_;  ///< The row process group for this rank
   madness::Group col_group_;  ///< The column process group for this rank
+  std::shared_ptr<SummaGroupPlan>
+      group_plan_;  ///< Reused sparse group process lists, or null
 
   // Dimension information
   const size_type k_;         ///< Number of tiles in the inner dimension
@@ -174,9 +216,9 @@ class Summa
 
   // Process groups --------------------------------------------------------
 
-  /// Process group factory function
+  /// Process list factory function
 
-  /// This function generates a sparse process group.
+  /// This function generates the process list of a sparse process group.
   /// \tparam Shape The shape type
   /// \tparam ProcMap The process map operation type
   /// \param shape The shape that will be used to select processes that are
@@ -192,19 +234,16 @@ class Summa
   /// \param max_group_size The maximum number of processes in the result
   /// group, which is equal to the number of process in this process row or
   /// column as defined by \c proc_grid_.
-  /// \param key_offset The key that will be used to identify the process group
   /// \param proc_map The operator that will convert a process row/column
   /// index into the absolute process index (ProcessID)
-  /// \return A sparse process group that includes process in the row or
+  /// \return The processes of the sparse process group in the row or
   /// column of this process as defined by \c proc_grid_.
   template <typename Shape, typename ProcMap>
-  madness::Group make_group(const Shape& shape,
-                            const std::vector<bool>& process_mask,
-                            size_type index, const size_type end,
-                            const size_type stride,
-                            const size_type max_group_size, const size_type k,
-                            const size_type key_offset,
-                            const ProcMap& proc_map) const {
+  std::vector<ProcessID> make_group_list(
+      const Shape& shape, const std::vector<bool>& process_mask,
+      size_type index, const size_type end, const size_type stride,
+      const size_type max_group_size, const size_type k,
+      const ProcMap& proc_map) const {
     // Generate the list of processes in rank_row
     std::vector<ProcessID> proc_list(max_group_size, -1);
 
@@ -233,9 +272,33 @@ class Summa
     // Truncate invalid process id's
     proc_list.resize(count);
 
-    return madness::Group(
-        TensorImpl_::world(), proc_list,
-        madness::DistributedID(DistEvalImpl_::id(), k + key_offset));
+    return proc_list;
+  }
+
+  /// Process group factory function
+
+  /// The process list of the group is taken from \c group_plan_ if it was
+  /// computed by an earlier evaluation, otherwise it is generated by
+  /// \c list_op and recorded.
+  /// \tparam ListOp The process list generator type
+  /// \param key The key that identifies the process group
+  /// \param list_op The generator of the process list, which returns an
+  /// empty list if this process is not in the group
+  /// \return The process group, which is empty if this process is not a
+  /// member
+  template <typename ListOp>
+  madness::Group make_planned_group(const size_type key,
+                                    const ListOp& list_op) const {
+    SummaGroupPlan::list_type proc_list;
+    if (group_plan_) proc_list = group_plan_->find(key);
+    if (!proc_list) {
+      proc_list = std::make_shared<const std::vector<ProcessID> >(list_op());
+      if (group_plan_) group_plan_->insert(key, proc_list);
+    }
+
+    if (proc_list->empty()) return madness::Group();
+    return madness::Group(TensorImpl_::world(), *proc_list,
+                          madness::DistributedID(DistEvalImpl_::id(), key));
   }
 
   /// Row process group factory function
@@ -243,22 +306,24 @@ class Summa
   /// \param k The broadcast group index
   /// \return A row process group
   madness::Group make_row_group(const size_type k) const {
-    // Construct the sparse broadcast group
-    const size_type right_begin_k = k * proc_grid_.cols();
-    const size_type right_end_k = right_begin_k + proc_grid_.cols();
-    // make the row mask; using the same mask for all tiles avoids having to
-    // compute mask for every tile and use of masked broadcasts
-    auto result_row_mask_k = make_row_mask(k);
-
-    // return empty group if I am not in this group, otherwise make a group
-    if (result_row_mask_k[proc_grid_.rank_col()])
-      return make_group(right_.shape(), result_row_mask_k, right_begin_k,
-                        right_end_k, right_stride_, proc_grid_.proc_cols(), k,
-                        k_, [&](const ProcGrid::size_type col) {
-                          return proc_grid_.map_col(col);
-                        });
-    else
-      return madness::Group();
+    return make_planned_group(k + k_, [&]() {
+      // Construct the sparse broadcast group
+      const size_type right_begin_k = k * proc_grid_.cols();
+      const size_type right_end_k = right_begin_k + proc_grid_.cols();
+      // make the row mask; using the same mask for all tiles avoids having
+      // to compute mask for every tile and use of masked broadcasts
+      auto result_row_mask_k = make_row_mask(k);
+
+      // return empty list if I am not in this group
+      if (!result_row_mask_k[proc_grid_.rank_col()])
+        return std::vector<ProcessID>();
+      return make_group_list(right_.shape(), result_row_mask_k, right_begin_k,
+                             right_end_k, right_stride_,
+                             proc_grid_.proc_cols(), k,
+                             [&](const ProcGrid::size_type col) {
+                               return proc_grid_.map_col(col);
+                             });
+    });
   }
 
   /// Column process group factory function
@@ -266,19 +331,20 @@ class Summa
   /// \param k The broadcast group index
   /// \return A column process group
   madness::Group make_col_group(const size_type k) const {
-    // make the column mask; using the same mask for all tiles avoids having to
-    // compute mask for every tile and use of masked broadcasts
-    auto result_col_mask_k = make_col_mask(k);
-
-    // return empty group if I am not in this group, otherwise make a group
-    if (result_col_mask_k[proc_grid_.rank_row()])
-      return make_group(left_.shape(), result_col_mask_k, k, left_end_,
-                        left_stride_, proc_grid_.proc_rows(), k, 0ul,
-                        [&](const ProcGrid::size_type row) {
-                          return proc_grid_.map_row(row);
-                        });
-    else
-      return madness::Group();
+    return make_planned_group(k, [&]() {
+      // make the column mask; using the same mask for all tiles avoids
+      // having to compute mask for every tile and use of masked broadcasts
+      auto result_col_mask_k = make_col_mask(k);
+
+      // return empty list if I am not in this group
+      if (!result_col_mask_k[proc_grid_.rank_row()])
+        return std::vector<ProcessID>();
+      return make_group_list(left_.shape(), result_col_mask_k, k, left_end_,
+                             left_stride_, proc_grid_.proc_rows(), k,
+                             [&](const ProcGrid::size_type row) {
+                               return proc_grid_.map_row(row);
+                             });
+    });
   }
 
   /// Makes the row result mask
@@ -520,9 +586,11 @@ class Summa
   /// \param[in] end The end of the range of tiles to be broadcast
   /// \param[in] stride The stride between tile indices to be broadcast
   /// \param[out] vec The vector that will hold broadcast tiles
+  /// \param[in] memory The counters of the memory of received tiles
   template <typename Arg, typename Datum>
   void get_vector(Arg& arg, size_type index, const size_type end,
-                  const size_type stride, std::vector<Datum>& vec) const {
+                  const size_type stride, std::vector<Datum>& vec,
+                  const std::shared_ptr<MemoryCounters>& memory) const {
     TA_ASSERT(vec.size() == 0ul);
 
     // Iterate over vector of tiles
@@ -534,7 +602,14 @@ class Summa
     } else {
       for (size_type i = 0ul; index < end; ++i, index += stride) {
         if (arg.shape().is_zero(index)) continue;
-        vec.emplace_back(i, Future<typename Arg::eval_type>());
+        Future<typename Arg::eval_type> tile;
+        track_memory(tile, memory, MemoryCategory::broadcast);
+        timeline_future(tile, TimelineCategory::recv, "bcast_recv",
+                        DistEvalImpl_::timeline_node(), index);
+        if (DistEvalImpl_::counters())
+          count_bytes(tile, DistEvalImpl_::counters(),
+                      EvalBytes::communicated);
+        vec.emplace_back(i, tile);
       }
     }
 
@@ -545,17 +620,21 @@ class Summa
 
   /// \param[in] k The column to be retrieved
   /// \param[out] col The column vector that will hold the tiles
-  void get_col(const size_type k, std::vector<col_datum>& col) const {
+  /// \param[in] memory The counters of the memory of received tiles
+  void get_col(const size_type k, std::vector<col_datum>& col,
+               const std::shared_ptr<MemoryCounters>& memory) const {
     col.reserve(proc_grid_.local_rows());
     get_vector(left_, left_start_local_ + k, left_end_, left_stride_local_,
-               col);
+               col, memory);
   }
 
   /// Collect non-zero tiles from row \c k of \c right_
 
   /// \param[in] k The row to be retrieved
   /// \param[out] row The row vector that will hold the tiles
-  void get_row(const size_type k, std::vector<row_datum>& row) const {
+  /// \param[in] memory The counters of the memory of received tiles
+  void get_row(const size_type k, std::vector<row_datum>& row,
+               const std::shared_ptr<MemoryCounters>& memory) const {
     row.reserve(proc_grid_.local_cols());
 
     // Compute local iteration limits for row k of right_.
@@ -563,7 +642,7 @@ class Summa
     const size_type end = begin + proc_grid_.cols();
     begin += proc_grid_.rank_col();
 
-    get_vector(right_, begin, end, right_stride_local_, row);
+    get_vector(right_, begin, end, right_stride_local_, row, memory);
   }
 
   /// Broadcast tiles from \c arg
@@ -594,6 +673,8 @@ class Summa
 #endif  // TILEDARRAY_ENABLE_SUMMA_TRACE_BCAST
 
     // Iterate over tiles to be broadcast
+    TimelineScope scope(TimelineCategory::bcast, "bcast",
+                        DistEvalImpl_::timeline_node());
     for (typename std::vector<Datum>::iterator it = vec.begin();
          it != vec.end(); ++it) {
       const size_type index = it->first * stride + start;
@@ -862,6 +943,27 @@ class Summa
 
   // Initialization functions ----------------------------------------------
 
+  /// Tile operation of a result tile
+
+  /// \return The contraction operation
+  template <typename O = op_type>
+  typename std::enable_if<!is_contract_fold<O>::value, const op_type&>::type
+  tile_op(const size_type) const {
+    return op_;
+  }
+
+  /// Tile operation of a result tile
+
+  /// Folding operations reduce the products with the matching tile of
+  /// another array, so they are bound to the result tile.
+  /// \param index The ordinal index of the result tile
+  /// \return The contraction operation bound to the tile at \c index
+  template <typename O = op_type>
+  typename std::enable_if<is_contract_fold<O>::value, op_type>::type tile_op(
+      const size_type index) const {
+    return op_.bind(DistEvalImpl_::perm_index_to_target(index));
+  }
+
   /// Initialize reduce tasks and construct broadcast groups
   size_type initialize(const DenseShape&) {
     // Construct static broadcast groups for dense arguments
@@ -888,13 +990,27 @@ class Summa
     std::allocator<ReducePairTask<op_type> > alloc;
     reduce_tasks_ = alloc.allocate(proc_grid_.local_size());
 
+    // Initialize iteration variables
+    size_type row_start = proc_grid_.rank_row() * proc_grid_.cols();
+    size_type row_end = row_start + proc_grid_.cols();
+    row_start += proc_grid_.rank_col();
+    const size_type col_stride =  // The stride to iterate down a column
+        proc_grid_.proc_rows() * proc_grid_.cols();
+    const size_type row_stride =  // The stride to iterate across a row
+        proc_grid_.proc_cols();
+    const size_type end = TensorImpl_::size();
+
     // Iterate over all local tiles
-    const size_type n = proc_grid_.local_size();
-    for (size_type t = 0ul; t < n; ++t) {
-      // Initialize the reduction task
-      ReducePairTask<op_type>* MADNESS_RESTRICT const reduce_task =
-          reduce_tasks_ + t;
-      new (reduce_task) ReducePairTask<op_type>(TensorImpl_::world(), op_);
+    ReducePairTask<op_type>* MADNESS_RESTRICT reduce_task = reduce_tasks_;
+    for (; row_start < end; row_start += col_stride, row_end += col_stride) {
+      for (size_type index = row_start; index < row_end;
+           index += row_stride, ++reduce_task) {
+        // Initialize the reduction task
+        new (reduce_task)
+            ReducePairTask<op_type>(TensorImpl_::world(), tile_op(index));
+        reduce_task->timeline_tag(DistEvalImpl_::timeline_node(),
+                                  DistEvalImpl_::perm_index_to_target(index));
+      }
     }
 
     return proc_grid_.local_size();
@@ -938,7 +1054,10 @@ class Summa
           ss << index << " ";
 #endif  // TILEDARRAY_ENABLE_SUMMA_TRACE_INITIALIZE
 
-          new (reduce_task) ReducePairTask<op_type>(TensorImpl_::world(), op_);
+          new (reduce_task)
+              ReducePairTask<op_type>(TensorImpl_::world(), tile_op(index));
+          reduce_task->timeline_tag(DistEvalImpl_::timeline_node(),
+                                    DistEvalImpl_::perm_index_to_target(index));
           ++tile_count;
         } else {
           // Construct an empty task to represent zero tiles.
@@ -1211,9 +1330,54 @@ class Summa
   }
 #endif  // TILEDARRAY_DISABLE_TILE_CONTRACTION_FILTER
 
+  /// Record the floating point operations of the tile contractions of a step
+
+  /// The product of an m x k tile and a k x n tile costs 2mnk operations,
+  /// which is <tt>2 sqrt(|left| |right| |result|)</tt> in terms of the tile
+  /// volumes.
+  /// \param k The k step for this contraction set
+  /// \param col A column of tiles from the left-hand argument
+  /// \param row A row of tiles from the right-hand argument
+  void count_flops(const size_type k, const std::vector<col_datum>& col,
+                   const std::vector<row_datum>& row) {
+    const size_type left_start = left_start_local_ + k;
+    const size_type right_start =
+        k * proc_grid_.cols() + proc_grid_.rank_col();
+    double flops = 0.0;
+    for (size_type i = 0ul; i < col.size(); ++i) {
+      const double left_volume =
+          left_.trange()
+              .make_tile_range(left_start + col[i].first * left_stride_local_)
+              .volume();
+      const size_type result_row =
+          proc_grid_.rank_row() + col[i].first * proc_grid_.proc_rows();
+      const size_type reduce_task_offset =
+          col[i].first * proc_grid_.local_cols();
+      for (size_type j = 0ul; j < row.size(); ++j) {
+        if (!reduce_tasks_[reduce_task_offset + row[j].first]) continue;
+        const double right_volume =
+            right_.trange()
+                .make_tile_range(right_start +
+                                 row[j].first * right_stride_local_)
+                .volume();
+        const size_type result_index =
+            result_row * proc_grid_.cols() + proc_grid_.rank_col() +
+            row[j].first * proc_grid_.proc_cols();
+        const double result_volume =
+            TensorImpl_::trange()
+                .make_tile_range(
+                    DistEvalImpl_::perm_index_to_target(result_index))
+                .volume();
+        flops += 2.0 * std::sqrt(left_volume * right_volume * result_volume);
+      }
+    }
+    DistEvalImpl_::counters()->add_flops(std::uint64_t(flops + 0.5));
+  }
+
   void contract(const size_type k, const std::vector<col_datum>& col,
                 const std::vector<row_datum>& row,
                 madness::TaskInterface* const task) {
+    if (DistEvalImpl_::counters()) count_flops(k, col, row);
     contract(TensorImpl_::shape(), k, col, row, task);
   }
 
@@ -1234,9 +1398,14 @@ class Summa
     StepTask* next_step_task_ = nullptr;  ///< The next SUMMA step task
     StepTask* tail_step_task_ =
         nullptr;  ///< The last SUMMA step task that currently exists
+    std::shared_ptr<MemoryCounters>
+        bcast_memory_;  ///< Memory of the tiles received by this step
+    std::vector<std::shared_ptr<MemoryCounters> >
+        retired_memory_;  ///< Memory of the tiles received by steps that
+                          ///< complete before this task runs
 
     void get_col(const size_type k) {
-      owner_->get_col(k, col_);
+      owner_->get_col(k, col_, bcast_memory_);
       if (trace_tasks)
         this->notify_debug("StepTask::spawn_col");
       else
@@ -1244,7 +1413,7 @@ class Summa
     }
 
     void get_row(const size_type k) {
-      owner_->get_row(k, row_);
+      owner_->get_row(k, row_, bcast_memory_);
       if (trace_tasks)
         this->notify_debug("StepTask::spawn_row");
       else
@@ -1262,7 +1431,9 @@ class Summa
 #endif
           owner_(owner),
           world_(owner->world()),
-          finalize_task_(new FinalizeTask(owner, finalize_ndep)) {
+          finalize_task_(new FinalizeTask(owner, finalize_ndep)),
+          bcast_memory_(
+              std::make_shared<MemoryCounters>(memory_counters(world_))) {
       TA_ASSERT(owner_);
       owner_->world().taskq.add(finalize_task_);
     }
@@ -1281,7 +1452,9 @@ class Summa
 #endif
           owner_(parent->owner_),
           world_(parent->world_),
-          finalize_task_(parent->finalize_task_) {
+          finalize_task_(parent->finalize_task_),
+          bcast_memory_(
+              std::make_shared<MemoryCounters>(memory_counters(world_))) {
       TA_ASSERT(parent);
       parent->next_step_task_ = this;
     }
@@ -1331,6 +1504,10 @@ class Summa
       printf("step:  start rank=%i k=%lu\n", owner_->world().rank(), k);
 #endif  // TILEDARRAY_ENABLE_SUMMA_TRACE_STEP
 
+      // The contractions of the steps that retired their tiles to this task
+      // are done
+      retired_memory_.clear();
+
       if (k < owner_->k_) {
         // Initialize next tail task and submit next task
         TA_ASSERT(next_step_task_);
@@ -1353,8 +1530,12 @@ class Summa
         // Submit tasks for the contraction of col and row tiles.
         owner_->contract(k, col_, row_, tail_step_task_);
 
-        // Notify task dependencies
+        // The received tiles are released when the contractions are done,
+        // i.e. before the tail task runs
         TA_ASSERT(tail_step_task_);
+        tail_step_task_->retired_memory_.push_back(std::move(bcast_memory_));
+
+        // Notify task dependencies
         if (trace_tasks)
           tail_step_task_->notify_debug("StepTask nth ctor");
         else
@@ -1523,6 +1704,7 @@ class Summa
         op_(op),
         row_group_(),
         col_group_(),
+        group_plan_(),
         k_(k),
         proc_grid_(proc_grid),
         reduce_tasks_(NULL),
@@ -1535,6 +1717,16 @@ class Summa
 
   virtual ~Summa() {}
 
+  /// Set the process lists of the sparse broadcast groups
+
+  /// \param group_plan The process lists of an earlier evaluation of a
+  /// contraction with the same process grid and shapes, which are completed
+  /// by this evaluation
+  void group_plan(const std::shared_ptr<SummaGroupPlan>& group_plan) {
+    TA_ASSERT(group_plan);
+    group_plan_ = group_plan;
+  }
+
   /// Get tile at index \c i
 
   /// \param i The index of the tile
@@ -1557,7 +1749,12 @@ class Summa
     const ProcessID source = proc_row * proc_grid_.proc_cols() + proc_col;
 
     const madness::DistributedID key(DistEvalImpl_::id(), i);
-    return TensorImpl_::world().gop.template recv<value_type>(source, key);
+    Future<value_type> result =
+        TensorImpl_::world().gop.template recv<value_type>(source, key);
+    if (source != TensorImpl_::world().rank())
+      timeline_future(result, TimelineCategory::recv, "recv_tile",
+                      DistEvalImpl_::timeline_node(), i);
+    return result;
   }
 
   /// Discard a tile that is not needed
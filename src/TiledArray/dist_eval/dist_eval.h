@@ -25,6 +25,9 @@
 #include <TiledArray/permutation.h>
 #include <TiledArray/tensor_impl.h>
 #include <TiledArray/type_traits.h>
+#include <TiledArray/util/eval_counters.h>
+#include <TiledArray/util/task_priority.h>
+#include <TiledArray/util/timeline.h>
 #ifdef TILEDARRAY_HAS_CUDA
 #include <TiledArray/cuda/cuda_task_fn.h>
 #include <TiledArray/external/cuda.h>
@@ -76,6 +79,9 @@ class DistEvalImpl : public TensorImpl<Policy>,
 
   volatile int task_count_;         ///< Total number of local tasks
   madness::AtomicInt set_counter_;  ///< The number of tiles set by this node
+  std::shared_ptr<EvalCounters>
+      counters_;        ///< Performance counters of this node, or null
+  TaskRank task_rank_;  ///< Scheduling rank of the tile tasks
 
  protected:
   /// Permute \c index from a source index to a target index
@@ -132,6 +138,41 @@ class DistEvalImpl : public TensorImpl<Policy>,
   /// \return This object's unique identifier
   const madness::uniqueidT& id() const { return id_; }
 
+  /// Timeline node accessor
+
+  /// \return The expression node id of the timeline events of this object
+  std::uint64_t timeline_node() const { return id_.get_obj_id(); }
+
+  /// Performance counters accessor
+
+  /// \return The performance counters of this object, or null
+  const std::shared_ptr<EvalCounters>& counters() const { return counters_; }
+
+  /// Set the performance counters
+
+  /// \param counters The counters that record the evaluation of this object
+  void counters(const std::shared_ptr<EvalCounters>& counters) {
+    counters_ = counters;
+  }
+
+  /// Task rank accessor
+
+  /// \return The scheduling rank of the tile tasks of this object
+  const TaskRank& task_rank() const { return task_rank_; }
+
+  /// Set the task rank
+
+  /// \param task_rank The scheduling rank of the tile tasks of this object
+  void task_rank(const TaskRank& task_rank) { task_rank_ = task_rank; }
+
+  /// Task attributes of the evaluation of a tile
+
+  /// \param i The index of the result tile
+  /// \return The attributes of the task that evaluates tile \c i
+  madness::TaskAttributes task_attr(const size_type i) const {
+    return task_rank_.attr(!TensorImpl_::is_local(i));
+  }
+
   /// Get tile at index \c i
 
   /// \param i The index of the tile
@@ -154,7 +195,18 @@ class DistEvalImpl : public TensorImpl<Policy>,
   void set_tile(size_type i, const value_type& value) {
     // Store value
     madness::DistributedID id(id_, i);
-    TensorImpl_::world().gop.send(TensorImpl_::owner(i), id, value);
+    const ProcessID owner = TensorImpl_::owner(i);
+    if (owner == TensorImpl_::world().rank()) {
+      TensorImpl_::world().gop.send(owner, id, value);
+    } else {
+      TimelineScope scope(TimelineCategory::send, "send_tile", timeline_node(),
+                          i);
+      TensorImpl_::world().gop.send(owner, id, value);
+      if (counters_)
+        counters_->add_bytes(EvalBytes::communicated, memory_bytes(value));
+    }
+    if (counters_ && counters_->permute_tiles())
+      counters_->add_bytes(EvalBytes::permuted, memory_bytes(value));
 
     // Record the assignment of a tile
     DistEvalImpl_::notify();
@@ -169,14 +221,24 @@ class DistEvalImpl : public TensorImpl<Policy>,
   void set_tile(size_type i, Future<value_type> f) {
     // Store value
     madness::DistributedID id(id_, i);
-    TensorImpl_::world().gop.send(TensorImpl_::owner(i), id, f);
+    const ProcessID owner = TensorImpl_::owner(i);
+    TensorImpl_::world().gop.send(owner, id, f);
+    if (counters_) {
+      if (owner != TensorImpl_::world().rank())
+        count_bytes(f, counters_, EvalBytes::communicated);
+      if (counters_->permute_tiles())
+        count_bytes(f, counters_, EvalBytes::permuted);
+    }
 
     // Record the assignment of a tile
     f.register_callback(this);
   }
 
   /// Tile set notification
-  virtual void notify() { set_counter_++; }
+  virtual void notify() {
+    set_counter_++;
+    if (counters_) counters_->add_tile();
+  }
 
   /// Wait for all tiles to be assigned
   void wait() const {
@@ -230,6 +292,15 @@ class DistEvalImpl : public TensorImpl<Policy>,
   /// this object).
   void eval() {
     TA_ASSERT(task_count_ == -1);
+    if (counters_) {
+      counters_->start();
+      if (!TensorImpl_::shape().is_dense()) {
+        std::uint64_t screened = 0ul;
+        for (const auto index : *TensorImpl_::pmap())
+          if (TensorImpl_::is_zero(index)) ++screened;
+        counters_->add_screened(screened);
+      }
+    }
     task_count_ = this->internal_eval();
     TA_ASSERT(task_count_ >= 0);
   }
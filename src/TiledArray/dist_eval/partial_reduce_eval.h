@@ -0,0 +1,305 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_DIST_EVAL_PARTIAL_REDUCE_EVAL_H__INCLUDED
+#define TILEDARRAY_DIST_EVAL_PARTIAL_REDUCE_EVAL_H__INCLUDED
+
+#include <TiledArray/dist_eval/dist_eval.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace TiledArray {
+namespace detail {
+
+/// Tensor that is a partial reduction of an argument tensor
+
+/// The argument tiles are reduced to result tiles by the tile operation,
+/// which keeps the leading (row reduction) or trailing (column reduction)
+/// modes of the argument. The argument tiles that are local to a process
+/// are joined first, and the partial results of the processes that hold
+/// argument tiles of a result tile are then joined on the owner of the
+/// result tile with a tree reduction over the group of those processes.
+/// The owner also joins the reduction of a zero tile if any argument tile
+/// of the result tile is zero, unless zeros do not change the reduction.
+/// \tparam Arg The input distributed evaluator argument type
+/// \tparam Op The partial reduction tile operation
+/// \tparam Policy The evaluator policy type
+template <typename Arg, typename Op, typename Policy>
+class PartialReduceEvalImpl
+    : public DistEvalImpl<typename Op::result_type, Policy>,
+      public std::enable_shared_from_this<
+          PartialReduceEvalImpl<Arg, Op, Policy> > {
+ public:
+  typedef PartialReduceEvalImpl<Arg, Op, Policy>
+      PartialReduceEvalImpl_;  ///< This object type
+  typedef DistEvalImpl<typename Op::result_type, Policy>
+      DistEvalImpl_;  ///< The base class type
+  typedef typename DistEvalImpl_::TensorImpl_
+      TensorImpl_;       ///< The base, base class type
+  typedef Arg arg_type;  ///< The argument tensor type
+  typedef typename DistEvalImpl_::size_type size_type;    ///< Size type
+  typedef typename DistEvalImpl_::range_type range_type;  ///< Range type
+  typedef typename DistEvalImpl_::shape_type shape_type;  ///< Shape type
+  typedef typename DistEvalImpl_::pmap_interface
+      pmap_interface;  ///< Process map interface type
+  typedef
+      typename DistEvalImpl_::trange_type trange_type;    ///< Tiled range type
+  typedef typename DistEvalImpl_::value_type value_type;  ///< Tile type
+  typedef
+      typename DistEvalImpl_::eval_type eval_type;  ///< Tile evaluation type
+  typedef Op op_type;  ///< Tile reduction operator type
+
+  /// Join operation of the reductions between processes
+  class JoinOp {
+    op_type op_;  ///< The tile reduction operation
+
+   public:
+    typedef value_type result_type;  ///< The result tile type
+
+    /// \param op The tile reduction operation
+    JoinOp(const op_type& op) : op_(op) {}
+
+    /// \param first The first partial result
+    /// \param second The second partial result
+    /// \return The joined partial result
+    value_type operator()(const value_type& first,
+                          const value_type& second) const {
+      return op_(first, second);
+    }
+  };  // class JoinOp
+
+  /// Constructor
+
+  /// \param arg The argument
+  /// \param world The world where the tensor lives
+  /// \param trange The tiled range object
+  /// \param shape The tensor shape object
+  /// \param pmap The tile-process map
+  /// \param op The tile reduction operation
+  PartialReduceEvalImpl(const arg_type& arg, World& world,
+                        const trange_type& trange, const shape_type& shape,
+                        const std::shared_ptr<pmap_interface>& pmap,
+                        const op_type& op)
+      : DistEvalImpl_(world, trange, shape, pmap, Permutation()),
+        arg_(arg),
+        op_(op),
+        reduced_(arg.size() / trange.tiles_range().volume()) {
+    TA_ASSERT(reduced_ * trange.tiles_range().volume() == arg.size());
+  }
+
+  /// Virtual destructor
+  virtual ~PartialReduceEvalImpl() {}
+
+  /// Get tile at index \c i
+
+  /// \param i The index of the tile
+  /// \return A \c Future to the tile at index i
+  /// \throw TiledArray::Exception When tile \c i is owned by a remote node.
+  /// \throw TiledArray::Exception When tile \c i a zero tile.
+  virtual Future<value_type> get_tile(size_type i) const {
+    TA_ASSERT(TensorImpl_::is_local(i));
+    TA_ASSERT(!TensorImpl_::is_zero(i));
+    const madness::DistributedID key(DistEvalImpl_::id(), i);
+    return TensorImpl_::world().gop.template recv<value_type>(
+        TensorImpl_::world().rank(), key);
+  }
+
+  /// Discard a tile that is not needed
+
+  /// This function handles the cleanup for tiles that are not needed in
+  /// subsequent computation.
+  /// \param i The index of the tile
+  virtual void discard_tile(size_type i) const { get_tile(i); }
+
+ private:
+  /// \param index The ordinal index of an argument tile
+  /// \return The ordinal index of the result tile of \c index
+  size_type result_index(const size_type index) const {
+    return (op_.row() ? index / reduced_ : index % TensorImpl_::size());
+  }
+
+  /// \param i The ordinal index of a result tile
+  /// \param k The position of an argument tile in the reduction
+  /// \return The ordinal index of the argument tile
+  size_type arg_index(const size_type i, const size_type k) const {
+    return (op_.row() ? i * reduced_ + k : k * TensorImpl_::size() + i);
+  }
+
+  /// Task function for reducing argument tiles
+
+  /// \param i The result tile index
+  /// \param tile The argument tile
+  /// \return The reduced tile
+  value_type reduce_tile(const size_type i,
+                         const typename arg_type::value_type& tile) {
+    TimelineScope scope(TimelineCategory::reduce, "partial_reduce",
+                        DistEvalImpl_::timeline_node(), i);
+    return op_(tile);
+  }
+
+  /// Task function for reducing the zero argument tiles of a result tile
+
+  /// \param i The result tile index
+  /// \return The reduced zero tile
+  value_type zero_tile(const size_type i) {
+    return op_.zero(TensorImpl_::trange().make_tile_range(i));
+  }
+
+  /// \param i The ordinal index of a result tile
+  /// \return \c true if any argument tile of \c i is zero
+  bool has_zero_arg(const size_type i) const {
+    if (arg_.shape().is_dense()) return false;
+    for (size_type k = 0ul; k < reduced_; ++k)
+      if (arg_.is_zero(arg_index(i, k))) return true;
+    return false;
+  }
+
+  /// Task function for joining partial results
+
+  /// \param first The first partial result
+  /// \param second The second partial result
+  /// \return The joined partial result
+  value_type join_tiles(const value_type& first, const value_type& second) {
+    return op_(first, second);
+  }
+
+  /// Join the partial results of a result tile on its owner
+
+  /// The process group of the reduction is shared by the result tiles that
+  /// are joined over the same processes; its id is that of the first such
+  /// tile, so result tiles must be joined in increasing order.
+  /// \param i The result tile index
+  /// \param partial The partial result of this process, which is empty if
+  /// this process holds no argument tiles of \c i
+  /// \param groups The process groups of the reductions
+  void reduce_group(const size_type i, const Future<value_type>& partial,
+                    std::map<std::vector<ProcessID>, madness::Group>& groups) {
+    World& world = TensorImpl_::world();
+    const ProcessID owner = TensorImpl_::owner(i);
+
+    // The processes that hold argument tiles of the result tile
+    std::vector<ProcessID> procs(1, owner);
+    for (size_type k = 0ul; k < reduced_; ++k) {
+      const size_type index = arg_index(i, k);
+      if (!arg_.is_zero(index)) procs.push_back(arg_.owner(index));
+    }
+    std::sort(procs.begin(), procs.end());
+    procs.erase(std::unique(procs.begin(), procs.end()), procs.end());
+
+    if (procs.size() == 1ul) {
+      TA_ASSERT(owner == world.rank());
+      DistEvalImpl_::set_tile(i, partial);
+    } else {
+      auto it = groups.find(procs);
+      if (it == groups.end()) {
+        const madness::DistributedID did(DistEvalImpl_::id(), i);
+        it = groups.emplace(procs, madness::Group(world, procs, did)).first;
+      }
+      const madness::Group& group = it->second;
+      const madness::DistributedID key(DistEvalImpl_::id(),
+                                       i + TensorImpl_::size());
+      Future<value_type> result = world.gop.reduce(
+          key, partial, JoinOp(op_), group.rank(owner), group);
+      if (owner == world.rank()) DistEvalImpl_::set_tile(i, result);
+    }
+  }
+
+  /// Evaluate the tiles of this tensor
+
+  /// This function will evaluate the children of this distributed evaluator
+  /// and evaluate the tiles for this distributed evaluator. It will block
+  /// until the tasks for the children are evaluated (not for the tasks of
+  /// this object).
+  /// \return The number of tiles that will be set by this process
+  virtual int internal_eval() {
+    // Convert pimpl to this object type so it can be used in tasks
+    std::shared_ptr<PartialReduceEvalImpl_> self = std::enable_shared_from_this<
+        PartialReduceEvalImpl_>::shared_from_this();
+
+    // Evaluate argument
+    arg_.eval();
+
+    // Reduce the local argument tiles of each result tile
+    World& world = TensorImpl_::world();
+    std::map<size_type, Future<value_type> > partials;
+    for (const auto index : *arg_.pmap()) {
+      if (arg_.is_zero(index)) continue;
+
+      const size_type i = result_index(index);
+      if (TensorImpl_::is_zero(i)) {
+        arg_.discard(index);
+        continue;
+      }
+
+      const madness::TaskAttributes attr = DistEvalImpl_::task_attr(i);
+      Future<value_type> tile = world.taskq.add(
+          self, &PartialReduceEvalImpl_::reduce_tile, i, arg_.get(index), attr);
+      auto it = partials.find(i);
+      if (it == partials.end())
+        partials.emplace(i, tile);
+      else
+        it->second = world.taskq.add(self, &PartialReduceEvalImpl_::join_tiles,
+                                     it->second, tile, attr);
+    }
+
+    // Join the zero argument tiles of the local result tiles
+    int task_count = 0;
+    for (const auto i : *TensorImpl_::pmap()) {
+      if (TensorImpl_::is_zero(i)) continue;
+      ++task_count;
+
+      auto it = partials.find(i);
+      if (op_.zero_is_identity() || !has_zero_arg(i)) {
+        if (it == partials.end())
+          partials.emplace(i, Future<value_type>(value_type()));
+        continue;
+      }
+
+      const madness::TaskAttributes attr = DistEvalImpl_::task_attr(i);
+      Future<value_type> tile =
+          world.taskq.add(self, &PartialReduceEvalImpl_::zero_tile, i, attr);
+      if (it == partials.end())
+        partials.emplace(i, tile);
+      else
+        it->second = world.taskq.add(self, &PartialReduceEvalImpl_::join_tiles,
+                                     it->second, tile, attr);
+    }
+
+    // Join the partial results of all processes on the result tile owners
+    std::map<std::vector<ProcessID>, madness::Group> groups;
+    for (const auto& partial : partials)
+      reduce_group(partial.first, partial.second, groups);
+
+    // Wait for local tiles of argument to be evaluated
+    arg_.wait();
+
+    return task_count;
+  }
+
+  arg_type arg_;       ///< Argument
+  op_type op_;         ///< The tile reduction operation
+  size_type reduced_;  ///< The number of argument tiles of a result tile
+};  // class PartialReduceEvalImpl
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_DIST_EVAL_PARTIAL_REDUCE_EVAL_H__INCLUDED
@@ -84,7 +84,12 @@ class UnaryEvalImpl
     TA_ASSERT(!TensorImpl_::is_zero(i));
     const size_type source = arg_.owner(DistEvalImpl_::perm_index_to_source(i));
     const madness::DistributedID key(DistEvalImpl_::id(), i);
-    return TensorImpl_::world().gop.template recv<value_type>(source, key);
+    Future<value_type> result =
+        TensorImpl_::world().gop.template recv<value_type>(source, key);
+    if (source != TensorImpl_::world().rank())
+      timeline_future(result, TimelineCategory::recv, "recv_tile",
+                      DistEvalImpl_::timeline_node(), i);
+    return result;
   }
 
   /// Discard a tile that is not needed
@@ -122,12 +127,16 @@ class UnaryEvalImpl
   template <typename U = value_type>
   std::enable_if_t<!detail::is_cuda_tile<U>::value, void> eval_tile(
       const size_type i, tile_argument_type tile) {
+    TimelineScope scope(TimelineCategory::tile_op, "unary",
+                        DistEvalImpl_::timeline_node(), i);
     DistEvalImpl_::set_tile(i, op_(tile));
   }
 #else
   /// \param i The tile index
   /// \param tile The tile to be evaluated
   void eval_tile(const size_type i, tile_argument_type tile) {
+    TimelineScope scope(TimelineCategory::tile_op, "unary",
+                        DistEvalImpl_::timeline_node(), i);
     DistEvalImpl_::set_tile(i, op_(tile));
   }
 #endif
@@ -163,12 +172,13 @@ class UnaryEvalImpl
 
         // Schedule tile evaluation task
 #ifdef TILEDARRAY_HAS_CUDA
-        TensorImpl_::world().taskq.add(self,
-                                       &UnaryEvalImpl_::template eval_tile<>,
-                                       target_index, arg_.get(index));
+        TensorImpl_::world().taskq.add(
+            self, &UnaryEvalImpl_::template eval_tile<>, target_index,
+            arg_.get(index), DistEvalImpl_::task_attr(target_index));
 #else
-        TensorImpl_::world().taskq.add(self, &UnaryEvalImpl_::eval_tile,
-                                       target_index, arg_.get(index));
+        TensorImpl_::world().taskq.add(
+            self, &UnaryEvalImpl_::eval_tile, target_index, arg_.get(index),
+            DistEvalImpl_::task_attr(target_index));
 #endif
 
         ++task_count;
@@ -21,10 +21,101 @@
 #define TILEDARRAY_DISTRIBUTED_STORAGE_H__INCLUDED
 
 #include <TiledArray/pmap/pmap.h>
+#include <TiledArray/tile_cache.h>
+#include <TiledArray/tile_spill.h>
+#include <TiledArray/util/compression.h>
+#include <TiledArray/util/memory.h>
+#include <TiledArray/util/time.h>
+
+#include <atomic>
 
 namespace TiledArray {
 namespace detail {
 
+/// Remote set aggregation parameters
+
+/// When aggregation is enabled, elements that are set on a remote process
+/// are buffered per destination process and sent in a single active message
+/// per buffer. A buffer is sent when it holds \c max_bytes of element data,
+/// when its oldest element has waited \c max_delay seconds, or when no other
+/// tasks are pending, whichever comes first. Buffers are always sent before
+/// the next fence completes.
+struct SetAggregation {
+  std::size_t max_bytes = 0ul;  ///< Buffer size threshold, 0 disables
+  double max_delay = 1.0e-3;    ///< Buffer age threshold, in seconds
+
+  /// Aggregation status
+
+  /// \return \c true if remote sets are aggregated
+  bool enabled() const { return max_bytes != 0ul; }
+
+  /// Default aggregation parameters
+
+  /// The default parameters are used by every \c DistributedStorage object
+  /// constructed after they are modified.
+  /// \return A reference to the default aggregation parameters
+  static SetAggregation& default_params() {
+    static SetAggregation value;
+    return value;
+  }
+};  // struct SetAggregation
+
+/// Snapshot of remote set counters
+struct RemoteSetStats {
+  std::size_t messages = 0ul;  ///< The number of active messages sent
+  std::size_t elements = 0ul;  ///< The number of elements sent
+  std::size_t bytes = 0ul;     ///< Bytes of aggregated element data sent
+
+  /// Aggregation ratio
+
+  /// \return The average number of elements per message
+  double ratio() const {
+    return (messages ? double(elements) / double(messages) : 0.0);
+  }
+};  // struct RemoteSetStats
+
+/// Remote set counters
+class RemoteSetCounters {
+  std::atomic<std::size_t> messages_{0ul};
+  std::atomic<std::size_t> elements_{0ul};
+  std::atomic<std::size_t> bytes_{0ul};
+
+ public:
+  /// Record one message
+
+  /// \param elements The number of elements in the message
+  /// \param bytes The number of bytes of element data in the message
+  void record(const std::size_t elements, const std::size_t bytes) {
+    messages_.fetch_add(1ul, std::memory_order_relaxed);
+    elements_.fetch_add(elements, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  /// \return The current value of the counters
+  RemoteSetStats snapshot() const {
+    RemoteSetStats result;
+    result.messages = messages_.load(std::memory_order_relaxed);
+    result.elements = elements_.load(std::memory_order_relaxed);
+    result.bytes = bytes_.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  /// Set all counters to zero
+  void reset() {
+    messages_ = 0ul;
+    elements_ = 0ul;
+    bytes_ = 0ul;
+  }
+
+  /// Counters for all \c DistributedStorage objects
+
+  /// \return A reference to the global remote set counters
+  static RemoteSetCounters& global() {
+    static RemoteSetCounters value;
+    return value;
+  }
+};  // class RemoteSetCounters
+
 /// Distributed storage container.
 
 /// Each element in this container is owned by a single node, but any node
@@ -34,12 +125,21 @@ namespace detail {
 /// initialized because they will be added to the container when the element
 /// is first accessed, though you may manually initialize an element with
 /// the \c insert() function. All elements are stored in \c Future ,
-/// which may be set only once.
+/// which may be set only once. When the process map provides local ordinals
+/// (see \c Pmap::known_local_ordinal() ), local elements are held in a
+/// vector indexed by the local ordinal, which requires no hashing or locking;
+/// otherwise they are held in a concurrent hash map.
 /// \note This object is derived from \c WorldObject , which means
 /// the order of construction of object must be the same on all nodes. This
 /// can easily be achieved by only constructing world objects in the main
 /// thread. DO NOT construct world objects within tasks where the order of
 /// execution is nondeterministic.
+/// \note Remote sets may be aggregated into one message per destination
+/// process; see \c SetAggregation .
+/// \note Local elements may be spilled to disk when they exceed a memory
+/// budget; see \c set_spill() .
+/// \note The size of local elements is accounted in \c memory() , which
+/// rolls up into the memory counters of the world.
 template <typename T>
 class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
  public:
@@ -64,22 +164,78 @@ class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
                               ///< stored by this container
   std::shared_ptr<pmap_interface>
       pmap_;  ///< The process map that defines the element distribution
+  const bool flat_;  ///< Use \c local_data_ instead of \c data_
   mutable container_type data_;     ///< The local data container
+  std::vector<future>
+      local_data_;  ///< Local data indexed by the pmap's local ordinal
+  mutable std::vector<std::atomic<bool> >
+      local_used_;  ///< Flags for the elements of \c local_data_ in use
+  mutable std::atomic<size_type>
+      local_used_count_;  ///< Number of elements of \c local_data_ in use
   madness::AtomicInt num_live_ds_;  ///< Number of live DelayedSet objects
 
+  /// Buffer of elements that will be sent to one process
+  struct SendBuffer : public madness::Spinlock {
+    std::vector<key_type> keys;      ///< Element keys
+    std::vector<value_type> values;  ///< Element values
+    std::size_t bytes = 0ul;         ///< Size of the buffered element data
+    time_point first;                ///< Insertion time of the first element
+    bool flush_pending = false;      ///< A flush task has been scheduled
+  };
+
+  SetAggregation aggregation_;  ///< Remote set aggregation parameters
+  std::unique_ptr<SendBuffer[]>
+      buffers_;                 ///< Send buffers, one per process
+  RemoteSetCounters counters_;  ///< Remote set counters
+  std::shared_ptr<TileCache<value_type> >
+      cache_;  ///< Cache of remote elements (optional)
+  std::shared_ptr<TileSpill<value_type> >
+      spill_;  ///< Out-of-core storage of local elements (optional)
+  std::unique_ptr<CompressionParams>
+      compression_;  ///< Compression of sent elements (optional)
+  std::shared_ptr<MemoryCounters> memory_;  ///< Memory of local elements
+
   // not allowed
   DistributedStorage(const DistributedStorage_&);
   DistributedStorage_& operator=(const DistributedStorage_&);
 
+  /// Position of local element \c i in \c local_data_
+  size_type local_slot(const size_type i) const {
+    const size_type n = pmap_->local_ordinal(i);
+    TA_ASSERT(n < local_data_.size());
+    // Count the element on first use
+    if (!local_used_[n].load(std::memory_order_relaxed) &&
+        !local_used_[n].exchange(true))
+      ++local_used_count_;
+    return n;
+  }
+
   future get_local(const size_type i) const {
     TA_ASSERT(pmap_->is_local(i));
 
+    // Spilled storage holds all local elements when it is enabled
+    if (spill_) return spill_->get(i);
+
+    // Lock-free lookup when the pmap numbers the local elements
+    if (flat_) return local_data_[local_slot(i)];
+
     // Return the local element.
     const_accessor acc;
     data_.insert(acc, i);
     return acc->second;
   }
 
+  /// Store local element \c i in memory, replacing any held element
+  void insert_local(const size_type i, const future& f) {
+    if (flat_) {
+      local_data_[local_slot(i)] = f;
+    } else {
+      accessor acc;
+      data_.insert(acc, i);
+      acc->second = f;
+    }
+  }
+
   void set_handler(const size_type i, const value_type& value) {
     future f = get_local(i);
 
@@ -89,17 +245,144 @@ class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
 #endif  // NDEBUG
 
     f.set(value);
+    memory_->add(MemoryCategory::tiles, std::int64_t(memory_bytes(value)));
   }
 
   void get_handler(const size_type i, const typename future::remote_refT& ref) {
     future f = get_local(i);
+    if (compression_ && !f.probe()) {
+      // Send the element when it is set, with this object's compression
+      get_world().taskq.add(
+          [this, ref](const value_type& value) {
+            CompressionScope scope(compression_.get(), true);
+            future remote_f(ref);
+            remote_f.set(value);
+          },
+          f);
+      return;
+    }
+
+    CompressionScope scope(compression_.get(), true);
     future remote_f(ref);
     remote_f.set(f);
   }
 
-  void set_remote(const size_type i, const value_type& value) {
-    WorldObject_::task(owner(i), &DistributedStorage_::set_handler, i, value,
+  /// Send a request to the owner of \c i for the element
+  future get_remote(const size_type i) const {
+    future result;
+    WorldObject_::task(owner(i), &DistributedStorage_::get_handler, i,
+                       result.remote_ref(get_world()),
                        madness::TaskAttributes::hipri());
+    return result;
+  }
+
+  void set_batch_handler(const std::vector<key_type>& keys,
+                         const std::vector<value_type>& values) {
+    TA_ASSERT(keys.size() == values.size());
+    for (std::size_t n = 0ul; n < keys.size(); ++n)
+      set_handler(keys[n], values[n]);
+  }
+
+  /// Size of the serialized element data, before compression
+  static std::size_t value_bytes(const value_type& value) {
+    return uncompressed_bytes(value);
+  }
+
+  void record(const std::size_t elements, const std::size_t bytes) {
+    counters_.record(elements, bytes);
+    RemoteSetCounters::global().record(elements, bytes);
+  }
+
+  void set_remote(const size_type i, const value_type& value) {
+    if (!aggregation_.enabled()) {
+      CompressionScope scope(compression_.get(), true);
+      record(1ul, 0ul);
+      WorldObject_::task(owner(i), &DistributedStorage_::set_handler, i, value,
+                         madness::TaskAttributes::hipri());
+      return;
+    }
+
+    const std::size_t bytes = value_bytes(value);
+    const ProcessID dest = owner(i);
+    SendBuffer& buffer = buffers_[dest];
+    std::vector<key_type> keys;
+    std::vector<value_type> values;
+    std::size_t batch_bytes = 0ul;
+    bool schedule_flush = false;
+    {
+      madness::ScopedMutex<madness::Spinlock> locker(&buffer);
+      if (buffer.keys.empty()) buffer.first = now();
+      buffer.keys.push_back(i);
+      buffer.values.push_back(value);
+      buffer.bytes += bytes;
+      if (buffer.bytes >= aggregation_.max_bytes) {
+        keys.swap(buffer.keys);
+        values.swap(buffer.values);
+        std::swap(batch_bytes, buffer.bytes);
+      } else if (!buffer.flush_pending) {
+        buffer.flush_pending = true;
+        schedule_flush = true;
+      }
+    }
+
+    if (!keys.empty()) send_batch(dest, keys, values, batch_bytes);
+    if (schedule_flush) schedule_flush_task(dest);
+  }
+
+  /// Send the elements of a buffer in a single message
+
+  /// \param bytes The size of the element data, as tracked by the buffer
+  void send_batch(const ProcessID dest, const std::vector<key_type>& keys,
+                  const std::vector<value_type>& values,
+                  const std::size_t bytes) {
+    record(keys.size(), bytes);
+    CompressionScope scope(compression_.get(), true);
+    WorldObject_::task(dest, &DistributedStorage_::set_batch_handler, keys,
+                       values, madness::TaskAttributes::hipri());
+  }
+
+  /// Take the contents of the buffer for \c dest and send them
+
+  /// \param flushed Clear the pending flush flag of the buffer
+  void flush_buffer(const ProcessID dest, const bool flushed = false) {
+    SendBuffer& buffer = buffers_[dest];
+    std::vector<key_type> keys;
+    std::vector<value_type> values;
+    std::size_t bytes = 0ul;
+    {
+      madness::ScopedMutex<madness::Spinlock> locker(&buffer);
+      keys.swap(buffer.keys);
+      values.swap(buffer.values);
+      std::swap(bytes, buffer.bytes);
+      if (flushed) buffer.flush_pending = false;
+    }
+    if (!keys.empty()) send_batch(dest, keys, values, bytes);
+  }
+
+  void schedule_flush_task(const ProcessID dest) {
+    get_world().taskq.add([this, dest]() { this->flush_task(dest); });
+  }
+
+  /// Task that sends a buffer once it is old enough
+
+  /// The task runs other tasks until the oldest element of the buffer has
+  /// waited \c max_delay seconds, the buffer has been sent because it is
+  /// full, or no other tasks are pending. Since this task is pending until
+  /// the buffer is sent, fence will not complete while the buffer holds data.
+  void flush_task(const ProcessID dest) {
+    SendBuffer& buffer = buffers_[dest];
+    World& world = get_world();
+    const double max_delay = aggregation_.max_delay;
+    world.await(
+        [&buffer, &world, max_delay]() {
+          madness::ScopedMutex<madness::Spinlock> locker(&buffer);
+          // Wait for more elements while other tasks may still produce them
+          return buffer.keys.empty() ||
+                 (duration_in_s(buffer.first, now()) >= max_delay) ||
+                 (world.taskq.size() <= 1ul);
+        },
+        true);
+    flush_buffer(dest, true);
   }
 
   struct DelayedSet : public madness::CallbackInterface {
@@ -139,7 +422,16 @@ class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
       : WorldObject_(world),
         max_size_(max_size),
         pmap_(pmap),
-        data_((max_size / world.size()) + 11) {
+        flat_(pmap && pmap->known_local_ordinal() &&
+              pmap->known_local_size()),
+        data_(flat_ ? 1 : (max_size / world.size()) + 11),
+        local_data_(flat_ ? pmap->local_size() : 0ul),
+        local_used_(flat_ ? pmap->local_size() : 0ul),
+        local_used_count_(0ul),
+        aggregation_(SetAggregation::default_params()),
+        buffers_(aggregation_.enabled() ? new SendBuffer[world.size()]
+                                        : nullptr),
+        memory_(std::make_shared<MemoryCounters>(memory_counters(world))) {
     // Check that the process map is appropriate for this storage object
     TA_ASSERT(pmap_);
     TA_ASSERT(pmap_->size() == max_size);
@@ -150,6 +442,8 @@ class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
   }
 
   virtual ~DistributedStorage() {
+    // Elements that are set later are not counted
+    memory_->release();
     if (num_live_ds_ != 0) {
       madness::print_error(
           "DistributedStorage (object id=\", id(), \") destroyed while "
@@ -161,6 +455,46 @@ class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
 
   using WorldObject_::get_world;
 
+  /// Send all buffered remote elements
+
+  /// Buffers are flushed automatically, so this is only needed to send
+  /// buffered elements earlier than the aggregation thresholds would.
+  void flush() {
+    if (aggregation_.enabled())
+      for (ProcessID dest = 0; dest < get_world().size(); ++dest)
+        flush_buffer(dest);
+  }
+
+  /// Select the compression of elements sent by this object
+
+  /// Elements sent to other processes by \c set() , and in reply to \c get()
+  /// , are compressed with \c params instead of the default compression
+  /// parameters (see \c CompressionParams::default_params() ).
+  /// \param params The compression parameters
+  /// \note This function is not thread safe; call it from the main thread
+  /// only, while no tasks use this object.
+  void set_compression(const CompressionParams& params) {
+    compression_.reset(new CompressionParams(params));
+  }
+
+  /// Compression parameters accessor
+
+  /// \return The compression parameters selected for this object, or null if
+  /// the default parameters are used
+  const CompressionParams* compression() const { return compression_.get(); }
+
+  /// Remote set aggregation parameters accessor
+
+  /// \return The parameters used to aggregate remote sets
+  const SetAggregation& aggregation() const { return aggregation_; }
+
+  /// Remote set counters accessor
+
+  /// \return The number of messages, elements, and bytes sent by this
+  /// object to set remote elements; bytes are counted only when remote sets
+  /// are aggregated
+  RemoteSetStats remote_set_stats() const { return counters_.snapshot(); }
+
   /// Process map accessor
 
   /// \return A shared pointer to the process map.
@@ -193,7 +527,10 @@ class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
   /// No communication.
   /// \return The number of local elements stored by the container.
   /// \throw nothing
-  size_type size() const { return data_.size(); }
+  size_type size() const {
+    if (spill_) return spill_->size();
+    return (flat_ ? size_type(local_used_count_) : data_.size());
+  }
 
   /// Max size accessor
 
@@ -214,16 +551,146 @@ class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
     if (is_local(i)) {
       return get_local(i);
     } else {
-      // Send a request to the owner of i for the element.
       future result;
-      WorldObject_::task(owner(i), &DistributedStorage_::get_handler, i,
-                         result.remote_ref(get_world()),
-                         madness::TaskAttributes::hipri());
+      if (cache_ && cache_->find(i, result)) return result;
 
+      result = get_remote(i);
+      if (cache_) cache_->insert(i, result);
       return result;
     }
   }
 
+  /// Start fetching an element
+
+  /// A remote element is placed in the remote element cache, so a
+  /// subsequent \c get(i) does not communicate, unless the cache is
+  /// invalidated first. The element is fetched only if its estimated size
+  /// fits in the budget of the cache with the elements already cached, and
+  /// it is not evicted before it is requested by \c get() . A local element
+  /// is read back from disk if it was spilled; other local elements are
+  /// ignored.
+  /// \param i The element to prefetch
+  /// \param bytes The estimated size of element \c i , or 0 if it is unknown
+  /// \return \c false if remote element \c i was not fetched because the
+  /// budget of the cache is full, otherwise \c true
+  /// \throw TiledArray::Exception If \c i is remote and the remote element
+  /// cache is disabled.
+  bool prefetch(size_type i, const std::size_t bytes = 0ul) const {
+    TA_ASSERT(i < max_size_);
+    if (is_local(i)) {
+      if (spill_) spill_->prefetch(i);
+      return true;
+    }
+    TA_USER_ASSERT(cache_,
+                   "DistributedStorage::prefetch() -- The remote element "
+                   "cache is disabled.");
+    if (cache_->contains(i)) return true;
+    if (!cache_->reserve(bytes)) return false;
+    cache_->prefetch(i, get_remote(i), bytes);
+    return true;
+  }
+
+  /// Enable or disable the cache of remote elements
+
+  /// When enabled, remote elements returned by \c get() are kept in a
+  /// local cache with least-recently-used eviction, so repeated requests
+  /// for the same element do not communicate. The cache is cleared at the
+  /// first fence after an element is cached.
+  /// \param max_bytes The byte budget of the cache; 0 disables the cache
+  /// \note This function is not thread safe; call it from the main thread
+  /// only, while no tasks use this object.
+  void set_remote_cache(const std::size_t max_bytes) {
+    if (max_bytes == 0ul)
+      cache_.reset();
+    else
+      cache_ = std::make_shared<TileCache<value_type> >(get_world(), max_bytes);
+  }
+
+  /// Remote element cache status
+
+  /// \return \c true if the cache of remote elements is enabled
+  bool has_remote_cache() const { return static_cast<bool>(cache_); }
+
+  /// Clear the cache of remote elements
+  void invalidate_remote_cache() {
+    if (cache_) cache_->invalidate();
+  }
+
+  /// Remote element cache statistics accessor
+
+  /// \return The statistics of the remote element cache, or empty statistics
+  /// if the cache is disabled
+  TileCacheStats remote_cache_stats() const {
+    return (cache_ ? cache_->stats() : TileCacheStats());
+  }
+
+  /// Enable or disable out-of-core storage of local elements
+
+  /// When enabled, local elements are held in memory within a byte budget.
+  /// The least recently used elements past the budget are written to a
+  /// temporary file in \c directory by tasks and released from memory; they
+  /// are read back by tasks when they are requested by \c get() or
+  /// \c prefetch() . Local elements that are already held are moved to the
+  /// out-of-core storage when it is enabled, and back to memory when it is
+  /// disabled. The memory of a released element is reclaimed only when no
+  /// other object, e.g. a future returned by \c get() , holds it.
+  /// \param max_bytes The byte budget of the local elements held in memory;
+  /// 0 disables out-of-core storage
+  /// \param directory The directory of the spill file
+  /// \throw TiledArray::Exception When the spill file cannot be created
+  /// \note This function is not thread safe; call it from the main thread
+  /// only, while no tasks use this object.
+  void set_spill(const std::size_t max_bytes,
+                 const std::string& directory =
+                     TileSpill<value_type>::default_directory()) {
+    // Move the elements back to memory
+    if (spill_) {
+      auto spill = std::move(spill_);
+      spill_.reset();
+      for (auto i : spill->keys()) insert_local(i, spill->get(i));
+    }
+    if (max_bytes == 0ul) return;
+
+    auto spill = std::make_shared<TileSpill<value_type> >(get_world(),
+                                                          max_bytes, directory);
+    if (flat_) {
+      for (auto i : *pmap_) {
+        const size_type n = pmap_->local_ordinal(i);
+        if (!local_used_[n].load()) continue;
+        spill->insert(i, local_data_[n]);
+        local_data_[n] = future();
+        local_used_[n] = false;
+      }
+      local_used_count_ = 0ul;
+    } else {
+      for (const auto& datum : data_) spill->insert(datum.first, datum.second);
+      data_.clear();
+    }
+    spill_ = spill;
+  }
+
+  /// Memory counters accessor
+
+  /// The \c tiles category holds the size of the local elements that have
+  /// been set, including elements that are spilled to disk (see
+  /// \c spill_stats() for the bytes held in memory). Other categories may be
+  /// recorded by the owner of this object, e.g. the size of the array shape.
+  /// \return The memory counters of this object
+  MemoryCounters& memory() const { return *memory_; }
+
+  /// Out-of-core storage status
+
+  /// \return \c true if local elements may be spilled to disk
+  bool has_spill() const { return static_cast<bool>(spill_); }
+
+  /// Out-of-core storage statistics accessor
+
+  /// \return The statistics of the out-of-core storage, or empty statistics
+  /// if it is disabled
+  TileSpillStats spill_stats() const {
+    return (spill_ ? spill_->stats() : TileSpillStats());
+  }
+
   /// Set element \c i with \c value
 
   /// \param i The element to be set
@@ -251,7 +718,15 @@ class DistributedStorage : public madness::WorldObject<DistributedStorage<T> > {
   /// max_size() .
   void set(size_type i, const future& f) {
     TA_ASSERT(i < max_size_);
-    if (is_local(i)) {
+    if (is_local(i) && (spill_ || flat_)) {
+      future existing_f = get_local(i);
+#ifndef NDEBUG
+      if (existing_f.probe()) TA_EXCEPTION("Tile has already been assigned.");
+#endif  // NDEBUG
+      existing_f.set(f);
+      track_memory(f, memory_, MemoryCategory::tiles);
+    } else if (is_local(i)) {
+      track_memory(f, memory_, MemoryCategory::tiles);
       const_accessor acc;
       if (!data_.insert(acc, typename container_type::datumT(i, f))) {
         // The element was already in the container, so set it with f.
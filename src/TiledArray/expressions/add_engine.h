@@ -312,6 +312,15 @@ class ScalAddEngine
     return ss.str();
   }
 
+  /// Exact expression identification tag
+
+  /// \param os The output stream
+  void key_tag(std::ostream& os) const {
+    os << "[+] [";
+    ExprEngine_::write_key(os, factor_);
+    os << "] ";
+  }
+
 };  // class ScalAddEngine
 
 }  // namespace expressions
@@ -128,6 +128,19 @@ class BinaryEngine : public ExprEngine<Derived> {
     }
   }
 
+  /// Attach this expression and its arguments to an evaluation plan
+
+  /// \param plan The evaluation plan
+  /// \return The combined reuse state of this expression and its arguments
+  ExprPlanState init_plan(const std::shared_ptr<ExprPlanImpl>& plan) {
+    const ExprPlanState self = ExprEngine_::init_plan(plan);
+    const ExprPlanState left = left_.init_plan(plan);
+    const ExprPlanState right = right_.init_plan(plan);
+    return ExprEngine_::plan_state(
+        ExprPlanState{self.tiling && left.tiling && right.tiling,
+                      self.shape && left.shape && right.shape});
+  }
+
   /// Initialize the variable list of this expression
 
   /// \param target_vars The target variable list for this expression
@@ -176,6 +189,15 @@ class BinaryEngine : public ExprEngine<Derived> {
     ExprEngine_::init_struct(target_vars);
   }
 
+  /// Initialize the task rank of this expression and its arguments
+
+  /// \param rank The task rank given by the parent expression
+  void init_task_rank(const TiledArray::detail::TaskRank& rank) {
+    ExprEngine_::init_task_rank(rank);
+    left_.init_task_rank(ExprEngine_::task_rank().arg(false));
+    right_.init_task_rank(ExprEngine_::task_rank().arg(false));
+  }
+
   /// Initialize result tensor distribution
 
   /// This function will initialize the world and process map for the result
@@ -219,10 +241,24 @@ class BinaryEngine : public ExprEngine<Derived> {
     std::shared_ptr<impl_type> pimpl =
         std::make_shared<impl_type>(left, right, *world_, trange_, shape_,
                                     pmap_, perm_, ExprEngine_::make_op());
+    pimpl->counters(ExprEngine_::counters());
+    pimpl->task_rank(ExprEngine_::task_rank());
 
     return dist_eval_type(pimpl);
   }
 
+  /// Write the structure of this expression
+
+  /// \param os The output stream
+  void cache_key(std::ostream& os) const {
+    ExprEngine_::cache_key(os);
+    os << "(";
+    left_.cache_key(os);
+    os << ",";
+    right_.cache_key(os);
+    os << ")";
+  }
+
   /// Expression print
 
   /// \param os The output stream
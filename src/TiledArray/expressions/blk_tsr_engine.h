@@ -257,10 +257,32 @@ class BlkTsrEngineBase : public LeafEngine<Derived> {
 
   void init_distribution(World* world,
                          const std::shared_ptr<pmap_interface>& pmap) {
-    ExprEngine_::init_distribution(
-        world,
-        (pmap ? pmap
-              : policy::default_pmap(*world, trange_.tiles_range().volume())));
+    ExprEngine_::init_distribution(world, (pmap ? pmap : make_pmap(*world)));
+  }
+
+  /// Default process map factory function
+
+  /// The process map is kept in the evaluation plan, if any, and reused
+  /// while the tiling of the block is unchanged.
+  /// \param world The world were the result will be distributed
+  /// \return The default process map of the block
+  std::shared_ptr<pmap_interface> make_pmap(World& world) const {
+    typedef typename LeafEngine_::PlanArray PlanArray;
+    PlanArray* planned = nullptr;
+    if (ExprEngine_::plan_)
+      planned = static_cast<PlanArray*>(
+          ExprEngine_::plan_->node(ExprEngine_::plan_node_).extra.get());
+
+    if (planned && planned->default_pmap &&
+        (planned->default_pmap->procs() ==
+         typename pmap_interface::size_type(world.size())) &&
+        (planned->default_pmap->size() == trange_.tiles_range().volume()))
+      return planned->default_pmap;
+
+    std::shared_ptr<pmap_interface> pmap =
+        policy::default_pmap(world, trange_.tiles_range().volume());
+    if (planned) planned->default_pmap = pmap;
+    return pmap;
   }
 
   /// Construct the distributed evaluator for array
@@ -273,6 +295,8 @@ class BlkTsrEngineBase : public LeafEngine<Derived> {
     std::shared_ptr<impl_type> pimpl = std::make_shared<impl_type>(
         array_, *world_, trange_, shape_, pmap_, perm_, ExprEngine_::make_op(),
         lower_bound_, upper_bound_);
+    pimpl->counters(ExprEngine_::counters());
+    pimpl->task_rank(ExprEngine_::task_rank());
 
     return dist_eval_type(pimpl);
   }
@@ -391,7 +415,9 @@ class BlkTsrEngine
       range_shift.emplace_back(-base_d);
     }
 
-    return op_type(op_base_type(range_shift));
+    // Tiles of intermediate results share the data of the array tiles;
+    // the tiles of a root result are stored in an array, so they are copied
+    return op_type(op_base_type(range_shift, !ExprEngine_::root_));
   }
 
   /// Permuting tile operation factory function
@@ -570,6 +596,15 @@ class ScalBlkTsrEngine
     return BlkTsrEngineBase_::make_tag() + ss.str();
   }
 
+  /// Exact expression identification tag
+
+  /// \param os The output stream
+  void key_tag(std::ostream& os) const {
+    os << BlkTsrEngineBase_::make_tag() << "[block] [";
+    ExprEngine_::write_key(os, factor_);
+    os << "] ";
+  }
+
 };  // class ScalBlkTsrEngine
 
 }  // namespace expressions
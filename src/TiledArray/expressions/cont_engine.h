@@ -28,11 +28,18 @@
 
 #include <TiledArray/dist_eval/contraction_eval.h>
 #include <TiledArray/expressions/binary_engine.h>
+#include <TiledArray/expressions/expr_cache.h>
 #include <TiledArray/proc_grid.h>
 #include <TiledArray/tensor/utility.h>
+#include <TiledArray/tile_op/contract_fold.h>
 #include <TiledArray/tile_op/contract_reduce.h>
 
 namespace TiledArray {
+
+// Forward declaration
+template <typename, typename>
+class DistArray;
+
 namespace expressions {
 
 // Forward declarations
@@ -113,6 +120,22 @@ class ContEngine : public BinaryEngine<Derived> {
   TiledArray::detail::ProcGrid
       proc_grid_;  ///< Process grid for the contraction
   size_type K_;    ///< Inner dimension size
+  std::shared_ptr<TiledArray::detail::SummaGroupPlan>
+      group_plan_;  ///< Planned sparse broadcast groups, or null
+
+  /// Distribution of a contraction that is kept in an evaluation plan
+  struct PlanDistribution {
+    World* world;              ///< The world of the contraction
+    trange_type left_trange;   ///< The tiled range of the left argument
+    trange_type right_trange;  ///< The tiled range of the right argument
+    TiledArray::detail::ProcGrid proc_grid;  ///< The process grid
+    size_type K;                             ///< Inner dimension size
+    std::shared_ptr<pmap_interface> left_pmap;   ///< Left argument pmap
+    std::shared_ptr<pmap_interface> right_pmap;  ///< Right argument pmap
+    std::shared_ptr<pmap_interface> pmap;  ///< Default result pmap, or null
+    std::shared_ptr<TiledArray::detail::SummaGroupPlan>
+        group_plan;  ///< Sparse broadcast groups
+  };
 
   static unsigned int find(const VariableList& vars, std::string var,
                            unsigned int i, const unsigned int n) {
@@ -139,7 +162,8 @@ class ContEngine : public BinaryEngine<Derived> {
         right_op_(permute_to_no_trans),
         op_(),
         proc_grid_(),
-        K_(1u) {}
+        K_(1u),
+        group_plan_() {}
 
   /// Constructor
 
@@ -157,7 +181,8 @@ class ContEngine : public BinaryEngine<Derived> {
         right_op_(permute_to_no_trans),
         op_(),
         proc_grid_(),
-        K_(1u) {}
+        K_(1u),
+        group_plan_() {}
 
   // Pull base class functions into this class.
   using ExprEngine_::derived;
@@ -384,14 +409,16 @@ class ContEngine : public BinaryEngine<Derived> {
       op_ =
           op_type(left_op, right_op, factor_, vars_.dim(), left_vars_.dim(),
                   right_vars_.dim(), (permute_tiles_ ? perm_ : Permutation()));
-      trange_ = ContEngine_::make_trange(perm_);
-      shape_ = ContEngine_::make_shape(perm_);
+      ExprEngine_::init_planned_struct(
+          target_vars, [this]() { return ContEngine_::make_trange(perm_); },
+          [this]() { return ContEngine_::make_shape(perm_); });
     } else {
       // Initialize non-permuted structure
       op_ = op_type(left_op, right_op, factor_, vars_.dim(), left_vars_.dim(),
                     right_vars_.dim());
-      trange_ = ContEngine_::make_trange();
-      shape_ = ContEngine_::make_shape();
+      ExprEngine_::init_planned_struct(
+          target_vars, [this]() { return ContEngine_::make_trange(); },
+          [this]() { return ContEngine_::make_shape(); });
     }
 
     if (ExprEngine_::override_ptr_ && ExprEngine_::override_ptr_->shape) {
@@ -399,6 +426,17 @@ class ContEngine : public BinaryEngine<Derived> {
     }
   }
 
+  /// Initialize the task rank of this expression and its arguments
+
+  /// The argument tiles are broadcast to the processes of the SUMMA rows
+  /// and columns, so other processes wait on them.
+  /// \param rank The task rank given by the parent expression
+  void init_task_rank(const TiledArray::detail::TaskRank& rank) {
+    ExprEngine_::init_task_rank(rank);
+    left_.init_task_rank(ExprEngine_::task_rank().arg(true));
+    right_.init_task_rank(ExprEngine_::task_rank().arg(true));
+  }
+
   /// Initialize result tensor distribution
 
   /// This function will initialize the world and process map for the result
@@ -406,6 +444,28 @@ class ContEngine : public BinaryEngine<Derived> {
   /// \param world The world were the result will be distributed
   /// \param pmap The process map for the result tensor tiles
   void init_distribution(World* world, std::shared_ptr<pmap_interface> pmap) {
+    // Reuse the distribution of an earlier evaluation with the same tiling
+    PlanDistribution* planned = planned_distribution(world);
+    if (planned) {
+      proc_grid_ = planned->proc_grid;
+      K_ = planned->K;
+      left_.init_distribution(world, planned->left_pmap);
+      right_.init_distribution(world, planned->right_pmap);
+      if (!pmap) {
+        if (!planned->pmap) planned->pmap = proc_grid_.make_pmap();
+        pmap = planned->pmap;
+      }
+      ExprEngine_::init_distribution(world, pmap);
+
+      // The broadcast groups depend on the argument and result shapes
+      if (!ExprEngine_::plan_state().shape ||
+          (ExprEngine_::override_ptr_ && ExprEngine_::override_ptr_->shape))
+        planned->group_plan =
+            std::make_shared<TiledArray::detail::SummaGroupPlan>(2ul * K_);
+      group_plan_ = planned->group_plan;
+      return;
+    }
+
     const unsigned int inner_rank = op_.gemm_helper().num_contract_ranks();
     const unsigned int left_rank = op_.gemm_helper().left_rank();
     const unsigned int right_rank = op_.gemm_helper().right_rank();
@@ -438,12 +498,42 @@ class ContEngine : public BinaryEngine<Derived> {
     proc_grid_ = TiledArray::detail::ProcGrid(*world, M, N, m, n);
 
     // Initialize children
-    left_.init_distribution(world, proc_grid_.make_row_phase_pmap(K_));
-    right_.init_distribution(world, proc_grid_.make_col_phase_pmap(K_));
+    std::shared_ptr<pmap_interface> left_pmap =
+        proc_grid_.make_row_phase_pmap(K_);
+    std::shared_ptr<pmap_interface> right_pmap =
+        proc_grid_.make_col_phase_pmap(K_);
+    left_.init_distribution(world, left_pmap);
+    right_.init_distribution(world, right_pmap);
 
     // Initialize the process map in not already defined
-    if (!pmap) pmap = proc_grid_.make_pmap();
+    std::shared_ptr<pmap_interface> default_pmap;
+    if (!pmap) pmap = default_pmap = proc_grid_.make_pmap();
     ExprEngine_::init_distribution(world, pmap);
+
+    // Record the distribution in the evaluation plan
+    if (ExprEngine_::plan_) {
+      group_plan_ =
+          std::make_shared<TiledArray::detail::SummaGroupPlan>(2ul * K_);
+      ExprEngine_::plan_->node(ExprEngine_::plan_node_).extra =
+          std::make_shared<PlanDistribution>(PlanDistribution{
+              world, left_.trange(), right_.trange(), proc_grid_, K_,
+              left_pmap, right_pmap, default_pmap, group_plan_});
+    }
+  }
+
+  /// \param world The world were the result will be distributed
+  /// \return The distribution of this contraction that was recorded in the
+  /// evaluation plan, or null if it cannot be reused
+  PlanDistribution* planned_distribution(World* world) const {
+    if (!ExprEngine_::plan_ || !ExprEngine_::plan_state().tiling)
+      return nullptr;
+    PlanDistribution* planned = static_cast<PlanDistribution*>(
+        ExprEngine_::plan_->node(ExprEngine_::plan_node_).extra.get());
+    if (planned && (planned->world == world) &&
+        (planned->left_trange == left_.trange()) &&
+        (planned->right_trange == right_.trange()))
+      return planned;
+    return nullptr;
   }
 
   /// Tiled range factory function
@@ -519,7 +609,31 @@ class ContEngine : public BinaryEngine<Derived> {
     return left_.shape().gemm(right_.shape(), factor_, shape_gemm_helper, perm);
   }
 
+  /// Construct the distributed evaluator for this expression
+
+  /// In an expression cache scope (see \c ExprCache ), the result of a
+  /// contraction that is a subexpression is kept as an intermediate and
+  /// reused by contractions with the same structure, unless its structure
+  /// cannot be identified.
+  /// \return The distributed evaluator that will evaluate this expression
   dist_eval_type make_dist_eval() const {
+    ExprCacheImpl* const cache = detail::expr_cache();
+    if (cache && !ExprEngine_::root_ && (&cache->world() == world_)) {
+      std::stringstream key;
+      derived().cache_key(key);
+      if (!key.fail())
+        return cache->template dist_eval<DistArray<value_type, policy>,
+                                         dist_eval_type>(
+            key.str(), pmap_, [this]() { return make_summa_dist_eval(); });
+    }
+
+    return make_summa_dist_eval();
+  }
+
+  /// Construct the SUMMA evaluator for this expression
+
+  /// \return The distributed evaluator that will evaluate this expression
+  dist_eval_type make_summa_dist_eval() const {
     // Define the impl type
     typedef TiledArray::detail::Summa<typename left_type::dist_eval_type,
                                       typename right_type::dist_eval_type,
@@ -532,10 +646,51 @@ class ContEngine : public BinaryEngine<Derived> {
     std::shared_ptr<impl_type> pimpl =
         std::make_shared<impl_type>(left, right, *world_, trange_, shape_,
                                     pmap_, perm_, op_, K_, proc_grid_);
+    pimpl->counters(ExprEngine_::counters());
+    pimpl->task_rank(ExprEngine_::task_rank());
+    if (group_plan_) pimpl->group_plan(group_plan_);
 
     return dist_eval_type(pimpl);
   }
 
+  /// Construct a distributed evaluator that folds this contraction
+
+  /// The result tiles of the evaluator are the binary reductions of the
+  /// result tiles of this contraction with the tiles of another array, which
+  /// are computed without storing the result tiles of this contraction.
+  /// \tparam Fold The binary reduction operation type
+  /// \param fold The binary reduction operation
+  /// \param others The local tiles of the other array, which must be
+  /// distributed like the result of this contraction
+  /// \param shape The shape of the evaluated tiles, e.g. the result shape
+  /// masked by the shape of the other array
+  /// \return The distributed evaluator of the folded result tiles
+  template <typename Fold>
+  TiledArray::detail::DistEval<typename Fold::result_type, policy>
+  make_fold_dist_eval(
+      const Fold& fold,
+      const std::shared_ptr<const typename TiledArray::detail::ContractFold<
+          op_type, Fold>::other_map>& others,
+      const shape_type& shape) const {
+    typedef TiledArray::detail::ContractFold<op_type, Fold> fold_op_type;
+    typedef TiledArray::detail::Summa<typename left_type::dist_eval_type,
+                                      typename right_type::dist_eval_type,
+                                      fold_op_type, typename Derived::policy>
+        impl_type;
+
+    typename left_type::dist_eval_type left = left_.make_dist_eval();
+    typename right_type::dist_eval_type right = right_.make_dist_eval();
+
+    std::shared_ptr<impl_type> pimpl = std::make_shared<impl_type>(
+        left, right, *world_, trange_, shape, pmap_, perm_,
+        fold_op_type(op_, fold, others), K_, proc_grid_);
+    pimpl->counters(ExprEngine_::counters());
+    pimpl->task_rank(ExprEngine_::task_rank());
+
+    return TiledArray::detail::DistEval<typename Fold::result_type, policy>(
+        pimpl);
+  }
+
   /// Expression identification tag
 
   /// \return An expression tag used to identify this expression
@@ -546,6 +701,18 @@ class ContEngine : public BinaryEngine<Derived> {
     return ss.str();
   }
 
+  /// Exact expression identification tag
+
+  /// \param os The output stream
+  void key_tag(std::ostream& os) const {
+    os << "[*]";
+    if (factor_ != scalar_type(1)) {
+      os << "[";
+      ExprEngine_::write_key(os, factor_);
+      os << "]";
+    }
+  }
+
   /// Expression print
 
   /// \param os The output stream
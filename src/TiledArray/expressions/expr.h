@@ -27,14 +27,19 @@
 #define TILEDARRAY_EXPRESSIONS_EXPR_H__INCLUDED
 
 #include <TiledArray/config.h>
+#include <algorithm>
 #include "../reduce_task.h"
+#include "../shape.h"
 #include "../tile_interface/cast.h"
 #include "../tile_interface/scale.h"
 #include "../tile_op/binary_reduction.h"
+#include "../tile_op/contract_fold.h"
 #include "../tile_op/reduce_wrapper.h"
 #include "../tile_op/shift.h"
 #include "../tile_op/unary_reduction.h"
 #include "../tile_op/unary_wrapper.h"
+#include "../util/memory.h"
+#include "../util/task_priority.h"
 #include "expr_engine.h"
 #ifdef TILEDARRAY_HAS_CUDA
 #include <TiledArray/cuda/cuda_task_fn.h>
@@ -53,10 +58,16 @@ template <typename, bool>
 class BlkTsrExpr;
 template <typename>
 struct is_aliased;
+template <typename>
+class ContEngine;
 
 template <typename Engine>
 struct EngineParamOverride {
-  EngineParamOverride() : world(nullptr), pmap(), shape(nullptr) {}
+  EngineParamOverride()
+      : world(nullptr),
+        pmap(),
+        shape(nullptr),
+        priority(TaskPriority::automatic) {}
 
   typedef
       typename EngineTrait<Engine>::policy policy;  ///< The result policy type
@@ -68,6 +79,8 @@ struct EngineParamOverride {
   World* world;
   std::shared_ptr<pmap_interface> pmap;
   const shape_type* shape;
+  std::shared_ptr<ExprPlanImpl> plan;  ///< Planning data to reuse
+  TaskPriority priority;               ///< Priority of the tile tasks
 };
 
 /// \brief type trait checks if T has array() member
@@ -144,6 +157,21 @@ class Expr {
     }
     return derived();
   }
+  /// \param plan the plan that keeps the structure and distribution of this
+  /// expression between evaluations (see \c ExprPlan )
+  Expr<Derived>& set_plan(const ExprPlan& plan) {
+    if (!override_ptr_) override_ptr_ = std::make_shared<override_type>();
+    override_ptr_->plan = plan.pimpl();
+    return derived();
+  }
+  /// \param priority the scheduling priority of the tile tasks of this
+  /// expression; sub-expressions inherit it unless they set their own
+  /// priority (see \c TaskPriority )
+  Expr<Derived>& set_priority(const TaskPriority priority) {
+    if (!override_ptr_) override_ptr_ = std::make_shared<override_type>();
+    override_ptr_->priority = priority;
+    return derived();
+  }
 
  private:
   /// Task function used to evaluate a lazy tile and apply an op
@@ -398,6 +426,9 @@ class Expr {
     // Get result variable list.
     VariableList target_vars(tsr.vars());
 
+    // Report the peak memory of the evaluation, if requested
+    TiledArray::detail::MemoryReport memory_report(world, target_vars);
+
     // Construct the expression engine
     engine_type engine(derived());
     engine.init(world, pmap, target_vars);
@@ -421,6 +452,9 @@ class Expr {
     dist_eval.wait();
     // Swap the new array with the result array object.
     result.swap(tsr.array());
+
+    // Print the performance counters of each node, if requested
+    print_eval_trace(engine, world, target_vars);
   }
 
   /// Evaluate this object and assign it to \c tsr
@@ -468,6 +502,9 @@ class Expr {
     // Get result variable list.
     VariableList target_vars(tsr.vars());
 
+    // Report the peak memory of the evaluation, if requested
+    TiledArray::detail::MemoryReport memory_report(world, target_vars);
+
     // Construct the expression engine
     engine_type engine(derived());
     engine.init(world, pmap, target_vars);
@@ -519,6 +556,9 @@ class Expr {
     dist_eval.wait();
     // Swap the new array with the result array object.
     result.swap(tsr.array());
+
+    // Print the performance counters of each node, if requested
+    print_eval_trace(engine, world, target_vars);
   }
 
   /// Expression print
@@ -533,7 +573,190 @@ class Expr {
     engine.print(os, target_vars);
   }
 
+  /// Evaluate this expression in batches of result tiles
+
+  /// The result tiles are partitioned into slabs along the first result
+  /// mode, such that the data of the non-zero result tiles of a slab that
+  /// are owned by any one process does not exceed \c max_bytes ; a slab has
+  /// at least one row of tiles. The slabs are evaluated one at a
+  /// time, as arrays whose tiles outside the slab are zero; each array is
+  /// passed to \c sink and released before the next slab is evaluated, so
+  /// the result tiles and the intermediates of only one slab are held at a
+  /// time. Expressions that contain other expressions evaluate those for
+  /// every slab. E.g. the dot product of a contraction with another array
+  /// is computed with
+  /// \code
+  /// double result = 0.0;
+  /// (a("i,j,k,l") * b("k,l,m,n"))
+  ///     .eval_batched<TSpArrayD>("i,j,m,n", max_bytes, [&](TSpArrayD& r) {
+  ///       result += r("i,j,m,n").dot(c("i,j,m,n")).get();
+  ///     });
+  /// \endcode
+  /// \note This function is collective; \c sink is called on every process.
+  /// \tparam A The array type of the batches, which must have a sparse policy
+  /// \tparam Sink A callable with signature <tt>void(A&)</tt>
+  /// \param vars The target variable list of the result
+  /// \param max_bytes The budget of result tile data of a batch, per process
+  /// \param sink The consumer of the batches
+  /// \param world The world where the result is evaluated
+  /// \return The number of batches
+  template <typename A, typename Sink>
+  std::size_t eval_batched(const std::string& vars,
+                           const std::size_t max_bytes, Sink&& sink,
+                           World& world) const {
+    return eval_batched_impl<A>(world, nullptr, VariableList(vars), max_bytes,
+                                std::forward<Sink>(sink));
+  }
+
+  /// Evaluate this expression in batches of result tiles
+
+  /// Batches are evaluated in the world of this expression, see
+  /// \c eval_batched(vars,max_bytes,sink,world) .
+  template <typename A, typename Sink>
+  std::size_t eval_batched(const std::string& vars,
+                           const std::size_t max_bytes, Sink&& sink) const {
+    return eval_batched<A>(vars, max_bytes, std::forward<Sink>(sink),
+                           default_world());
+  }
+
+  /// Evaluate this expression in batches and assign it to \c tsr
+
+  /// The tiles of each batch are moved to the result array, so only the
+  /// intermediates of one batch are held at a time; see
+  /// \c eval_batched(vars,max_bytes,sink,world) .
+  /// \tparam A The array type, which must have a sparse policy
+  /// \tparam Alias Tile alias flag
+  /// \param tsr The tensor to be assigned
+  /// \param max_bytes The budget of result tile data of a batch, per process
+  /// \return The number of batches
+  template <typename A, bool Alias>
+  std::size_t eval_batched_to(TsrExpr<A, Alias> tsr,
+                              const std::size_t max_bytes) const {
+    World& world = (tsr.array().is_initialized() ? tsr.array().world()
+                                                 : default_world());
+    std::shared_ptr<typename A::pmap_interface> pmap;
+    if (tsr.array().is_initialized()) pmap = tsr.array().pmap();
+    const VariableList target_vars(tsr.vars());
+
+    // Construct the result array with the shape of all batches
+    engine_type engine(derived());
+    engine.init(world, pmap, target_vars);
+    A result(world, engine.trange(), engine.shape(), engine.pmap());
+
+    const std::size_t batches = eval_batched_impl<A>(
+        world, engine.pmap(), target_vars, max_bytes, [&result](A& batch) {
+          // Batches have the distribution of the result
+          for (const auto index : *batch.pmap())
+            if (!batch.is_zero(index)) result.set(index, batch.find(index));
+        });
+
+    result.swap(tsr.array());
+    return batches;
+  }
+
  private:
+  /// Evaluate this expression in batches of result tiles
+
+  /// \param world The world where the result is evaluated
+  /// \param pmap The process map of the result, or null
+  /// \param target_vars The target variable list of the result
+  /// \param max_bytes The budget of result tile data of a batch, per process
+  /// \param sink The consumer of the batches
+  /// \return The number of batches
+  template <typename A, typename Sink>
+  std::size_t eval_batched_impl(
+      World& world,
+      const std::shared_ptr<typename override_type::pmap_interface>& pmap,
+      const VariableList& target_vars, const std::size_t max_bytes,
+      Sink&& sink) const {
+    static_assert(!is_dense<typename A::policy_type>::value,
+                  "Batched evaluation requires arrays with a sparse policy; "
+                  "result tiles outside a batch are skipped by their shape.");
+    typedef typename override_type::shape_type shape_type;
+    typedef typename shape_type::value_type norm_type;
+    TA_USER_ASSERT(max_bytes > 0ul,
+                   "Expr::eval_batched() -- The batch budget is zero.");
+
+    // Initialize the structure of the whole result
+    engine_type engine(derived());
+    engine.init(world, pmap, target_vars);
+    const auto& trange = engine.trange();
+    const auto& tiles_range = trange.tiles_range();
+    const shape_type& shape = engine.shape();
+    const auto result_pmap = engine.pmap();
+    TA_ASSERT(tiles_range.rank() > 0u);
+
+    // Sum the data of the non-zero tiles of each row of tiles, per owner
+    const std::size_t row_stride = tiles_range.stride(0);
+    const std::size_t nprocs = world.size();
+    std::vector<std::vector<std::size_t> > row_bytes(
+        tiles_range.extent(0), std::vector<std::size_t>(nprocs, 0ul));
+    for (std::size_t ord = 0ul; ord < tiles_range.volume(); ++ord) {
+      if (shape.is_zero(ord)) continue;
+      row_bytes[ord / row_stride][result_pmap->owner(ord)] +=
+          trange.make_tile_range(ord).volume() *
+          sizeof(typename A::element_type);
+    }
+
+    // A row is added to a batch if no process exceeds the budget
+    auto fits = [max_bytes](const std::vector<std::size_t>& batch_bytes,
+                            const std::vector<std::size_t>& row) {
+      for (std::size_t p = 0ul; p < row.size(); ++p)
+        if (batch_bytes[p] + row[p] > max_bytes) return false;
+      return true;
+    };
+    auto add = [](std::vector<std::size_t>& batch_bytes,
+                  const std::vector<std::size_t>& row) {
+      for (std::size_t p = 0ul; p < row.size(); ++p)
+        batch_bytes[p] += row[p];
+    };
+
+    // Evaluate the batches
+    std::size_t batches = 0ul;
+    for (std::size_t first = 0ul; first < row_bytes.size();) {
+      std::size_t last = first + 1ul;
+      std::vector<std::size_t> bytes = row_bytes[first];
+      while (last < row_bytes.size() && fits(bytes, row_bytes[last]))
+        add(bytes, row_bytes[last++]);
+
+      // Skip batches without non-zero tiles
+      if (std::all_of(bytes.begin(), bytes.end(),
+                      [](const std::size_t b) { return b == 0ul; })) {
+        first = last;
+        continue;
+      }
+
+      // Mask the result tiles outside the batch
+      Tensor<norm_type> mask_norms(shape.data().range(), norm_type(0));
+      std::fill(mask_norms.data() + first * row_stride,
+                mask_norms.data() + last * row_stride, norm_type(1));
+      shape_type mask(mask_norms, trange, true);
+      if (override_ptr_ && override_ptr_->shape)
+        mask = mask.mask(*override_ptr_->shape);
+
+      {
+        Derived expr(derived());
+        Expr_& expr_base = expr;
+        expr_base.override_ptr_ = std::make_shared<override_type>(
+            override_ptr_ ? *override_ptr_ : override_type());
+        expr_base.set_world(world);
+        expr_base.set_pmap(result_pmap);
+        expr_base.set_shape(mask);
+
+        A batch;
+        batch(target_vars.string()) = expr;
+        sink(batch);
+      }
+
+      // Release the batch before the next one is evaluated
+      world.gop.fence();
+      ++batches;
+      first = last;
+    }
+
+    return batches;
+  }
+
   struct ExpressionReduceTag {};
 
   template <typename D, typename Enabler = void>
@@ -604,6 +827,33 @@ class Expr {
         "no_alias() expressions are not allowed on the right-hand side of "
         "the assignment operator.");
 
+    // Evaluate this expression
+    engine_type left_engine(derived());
+    left_engine.init(world,
+                     std::shared_ptr<typename engine_type::pmap_interface>(),
+                     VariableList());
+
+    return reduce(left_engine, right_expr, op, world);
+  }
+
+  template <typename D, typename Op>
+  Future<typename Op::result_type> reduce(const Expr<D>& right_expr,
+                                          const Op& op) const {
+    return reduce(right_expr, op, default_world());
+  }
+
+ private:
+  /// Binary reduction of an initialized expression engine
+
+  /// \param left_engine The engine of this expression
+  /// \param right_expr The right-hand expression
+  /// \param op The binary reduction operation
+  /// \param world The world where the reduction is evaluated
+  /// \return The result of the reduction
+  template <typename D, typename Op>
+  static Future<typename Op::result_type> reduce(engine_type& left_engine,
+                                                 const Expr<D>& right_expr,
+                                                 const Op& op, World& world) {
     // Typedefs
     typedef madness::TaggedKey<madness::uniqueidT, ExpressionReduceTag>
         key_type;
@@ -612,12 +862,6 @@ class Expr {
         Op>
         reduction_op_type;
 
-    // Evaluate this expression
-    engine_type left_engine(derived());
-    left_engine.init(world,
-                     std::shared_ptr<typename engine_type::pmap_interface>(),
-                     VariableList());
-
     // Create the distributed evaluator for this expression
     typename engine_type::dist_eval_type left_dist_eval =
         left_engine.make_dist_eval();
@@ -678,12 +922,131 @@ class Expr {
     return result;
   }
 
+  /// Binary reduction of a contraction that is linear in the contraction
+
+  /// When this expression is a contraction, the product of each pair of
+  /// argument tiles is reduced with the matching tile of \c right_expr and
+  /// then discarded, so the result of the contraction is never stored.
+  /// Otherwise this is equivalent to \c reduce() .
+  /// \param right_expr The right-hand expression
+  /// \param op The binary reduction operation, which is linear in its
+  /// left-hand argument (e.g. \c DotReduction )
+  /// \param world The world where the reduction is evaluated
+  /// \return The result of the reduction
   template <typename D, typename Op>
-  Future<typename Op::result_type> reduce(const Expr<D>& right_expr,
-                                          const Op& op) const {
-    return reduce(right_expr, op, default_world());
+  Future<typename Op::result_type> linear_reduce(const Expr<D>& right_expr,
+                                                 const Op& op,
+                                                 World& world) const {
+    return linear_reduce(
+        right_expr, op, world,
+        std::integral_constant<bool, std::is_base_of<ContEngine<engine_type>,
+                                                     engine_type>::value>());
+  }
+
+  template <typename D, typename Op>
+  Future<typename Op::result_type> linear_reduce(const Expr<D>& right_expr,
+                                                 const Op& op, World& world,
+                                                 std::false_type) const {
+    return reduce(right_expr, op, world);
+  }
+
+  template <typename D, typename Op>
+  Future<typename Op::result_type> linear_reduce(const Expr<D>& right_expr,
+                                                 const Op& op, World& world,
+                                                 std::true_type) const {
+    static_assert(
+        is_aliased<D>::value,
+        "no_alias() expressions are not allowed on the right-hand side of "
+        "the assignment operator.");
+
+    // Typedefs
+    typedef madness::TaggedKey<madness::uniqueidT, ExpressionReduceTag>
+        key_type;
+    typedef TiledArray::math::BinaryReduceWrapper<
+        typename engine_type::value_type, typename D::engine_type::value_type,
+        Op>
+        reduction_op_type;
+    typedef TiledArray::detail::ContractFold<
+        typename engine_type::ContEngine_::op_type, reduction_op_type>
+        fold_op_type;
+    typedef TiledArray::detail::FoldReduce<reduction_op_type> fold_reduce_type;
+
+    // Evaluate this expression
+    engine_type left_engine(derived());
+    left_engine.init(world,
+                     std::shared_ptr<typename engine_type::pmap_interface>(),
+                     VariableList());
+    if (!left_engine.is_contraction())
+      return reduce(left_engine, right_expr, op, world);
+
+    // Evaluate the right-hand expression with the distribution of the
+    // contraction result
+    typename D::engine_type right_engine(right_expr.derived());
+    right_engine.init(world, left_engine.pmap(), left_engine.vars());
+
+    // Create the distributed evaluator for the right-hand expression
+    typename D::engine_type::dist_eval_type right_dist_eval =
+        right_engine.make_dist_eval();
+    right_dist_eval.eval();
+
+#ifndef NDEBUG
+    if (left_engine.trange() != right_dist_eval.trange()) {
+      if (TiledArray::get_default_world().rank() == 0) {
+        TA_USER_ERROR_MESSAGE(
+            "The TiledRanges of the left- and right-hand arguments the binary "
+            "reduction are not equal:"
+            << "\n    left  = " << left_engine.trange()
+            << "\n    right = " << right_dist_eval.trange());
+      }
+
+      TA_EXCEPTION(
+          "The TiledRange objects of a binary expression are not equal.");
+    }
+#endif  // NDEBUG
+
+    // Collect the local right-hand tiles, which are read by the contraction
+    // tasks, so they must be evaluated before the contraction
+    auto others = std::make_shared<typename fold_op_type::other_map>();
+    typename D::engine_type::dist_eval_type::pmap_interface::const_iterator it =
+        right_dist_eval.pmap()->begin();
+    const typename D::engine_type::dist_eval_type::pmap_interface::
+        const_iterator end = right_dist_eval.pmap()->end();
+    for (; it != end; ++it)
+      if (!right_dist_eval.is_zero(*it))
+        others->emplace(*it, right_dist_eval.get(*it));
+    for (auto& other : *others) other.second.get();
+
+    // Only the tiles that are non-zero in both arguments are evaluated
+    const auto shape = left_engine.shape().mask(right_dist_eval.shape());
+
+    // Create the distributed evaluator of the folded contraction
+    reduction_op_type wrapped_op(op);
+    auto fold_dist_eval = left_engine.make_fold_dist_eval(
+        wrapped_op,
+        std::shared_ptr<const typename fold_op_type::other_map>(others),
+        shape);
+    fold_dist_eval.eval();
+
+    // Create a local reduction task
+    TiledArray::detail::ReduceTask<fold_reduce_type> local_reduce_task(
+        world, fold_reduce_type(wrapped_op));
+
+    // Move the data from fold_dist_eval into the local reduction task
+    auto fold_it = fold_dist_eval.pmap()->begin();
+    const auto fold_end = fold_dist_eval.pmap()->end();
+    for (; fold_it != fold_end; ++fold_it)
+      if (!fold_dist_eval.is_zero(*fold_it))
+        local_reduce_task.add(fold_dist_eval.get(*fold_it));
+
+    auto result = world.gop.all_reduce(key_type(fold_dist_eval.id()),
+                                       local_reduce_task.submit(), op);
+    fold_dist_eval.wait();
+    right_dist_eval.wait();
+    return result;
   }
 
+ public:
+
   Future<typename TiledArray::TraceReduction<
       typename EngineTrait<engine_type>::eval_type>::result_type>
   trace(World& world) const {
@@ -837,9 +1200,9 @@ class Expr {
     typedef typename EngineTrait<engine_type>::eval_type left_value_type;
     typedef typename EngineTrait<typename D::engine_type>::eval_type
         right_value_type;
-    return reduce(right_expr,
-                  TiledArray::DotReduction<left_value_type, right_value_type>(),
-                  world);
+    return linear_reduce(
+        right_expr,
+        TiledArray::DotReduction<left_value_type, right_value_type>(), world);
   }
 
   template <typename D>
@@ -858,7 +1221,7 @@ class Expr {
     typedef typename EngineTrait<engine_type>::eval_type left_value_type;
     typedef typename EngineTrait<typename D::engine_type>::eval_type
         right_value_type;
-    return reduce(
+    return linear_reduce(
         right_expr,
         TiledArray::InnerProductReduction<left_value_type, right_value_type>(),
         world);
@@ -0,0 +1,196 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  expr_cache.h
+ *  Dec 9, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_EXPRESSIONS_EXPR_CACHE_H__INCLUDED
+#define TILEDARRAY_EXPRESSIONS_EXPR_CACHE_H__INCLUDED
+
+#include <TiledArray/dist_eval/array_eval.h>
+#include <TiledArray/error.h>
+#include <TiledArray/external/madness.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace TiledArray {
+namespace expressions {
+
+/// Intermediate arrays of an expression cache scope
+
+/// The arrays are keyed on the structure of the subexpression that they
+/// hold (see \c ExprEngine::cache_key() ).
+class ExprCacheImpl {
+  /// A cached intermediate array
+  struct Entry {
+    const std::type_info* type;   ///< The array type
+    std::shared_ptr<void> array;  ///< The array
+  };
+
+  World& world_;                                   ///< The world of the scope
+  std::unordered_map<std::string, Entry> arrays_;  ///< Intermediate arrays
+  std::size_t hits_ = 0ul;    ///< Number of reused intermediates
+  std::size_t misses_ = 0ul;  ///< Number of materialized intermediates
+
+ public:
+  /// Constructor
+
+  /// \param world The world of the cached expressions
+  explicit ExprCacheImpl(World& world) : world_(world) {}
+
+  /// \return The world of the cached expressions
+  World& world() const { return world_; }
+
+  /// Distributed evaluator of a cached intermediate
+
+  /// If the intermediate identified by \c key is in the cache of every
+  /// process, its tiles are evaluated from the cached array. Otherwise the
+  /// evaluator made by \c make_dist_eval is evaluated, its tiles are moved
+  /// to the consumers, and their clones are kept in a new array, which is
+  /// added to the cache. This is a collective operation.
+  /// \tparam Array The intermediate array type
+  /// \tparam DistEval The distributed evaluator type
+  /// \tparam Op The evaluator factory type
+  /// \param key The structure of the intermediate
+  /// \param pmap The process map of the evaluated tiles
+  /// \param make_dist_eval The factory of the evaluator of the intermediate
+  /// \return The distributed evaluator of the intermediate
+  template <typename Array, typename DistEval, typename Op>
+  DistEval dist_eval(
+      const std::string& key,
+      const std::shared_ptr<typename Array::pmap_interface>& pmap,
+      const Op& make_dist_eval) {
+    std::shared_ptr<Array> array;
+    auto it = arrays_.find(key);
+    if ((it != arrays_.end()) && (*it->second.type == typeid(Array)))
+      array = std::static_pointer_cast<Array>(it->second.array);
+
+    // The intermediate is reused only if all processes have it, since the
+    // array versions in the key are local
+    int misses = (array ? 0 : 1);
+    world_.gop.sum(misses);
+
+    typedef TiledArray::detail::CachedEvalImpl<Array,
+                                               typename Array::policy_type>
+        impl_type;
+    std::unordered_map<typename impl_type::size_type,
+                       Future<typename Array::value_type> >
+        tiles;
+    if (misses) {
+      DistEval dist_eval = make_dist_eval();
+      dist_eval.eval();
+      array = std::make_shared<Array>(dist_eval.world(), dist_eval.trange(),
+                                      dist_eval.shape(), dist_eval.pmap());
+      for (const auto index : *dist_eval.pmap()) {
+        if (dist_eval.is_zero(index)) continue;
+        auto tile = dist_eval.get(index);
+        array->set(index, world_.taskq.add(&impl_type::clone_tile, tile,
+                                           madness::TaskAttributes::hipri()));
+        tiles.emplace(index, std::move(tile));
+      }
+      dist_eval.wait();
+      arrays_[key] = Entry{&typeid(Array), array};
+      ++misses_;
+    } else {
+      ++hits_;
+    }
+
+    return DistEval(
+        std::make_shared<impl_type>(*array, world_, pmap, std::move(tiles)));
+  }
+
+  /// \return The number of evaluations that reused a cached intermediate
+  std::size_t hits() const { return hits_; }
+
+  /// \return The number of intermediates that were materialized
+  std::size_t misses() const { return misses_; }
+
+  /// \return The number of cached intermediates
+  std::size_t size() const { return arrays_.size(); }
+};  // class ExprCacheImpl
+
+namespace detail {
+
+/// \return A reference to the expression cache of the innermost
+/// \c ExprCache scope, or null
+inline ExprCacheImpl*& expr_cache() {
+  static ExprCacheImpl* cache = nullptr;
+  return cache;
+}
+
+}  // namespace detail
+
+/// Scope of an expression cache
+
+/// While an \c ExprCache object exists, every contraction that is evaluated
+/// as a subexpression is kept as an intermediate array, and a contraction
+/// with the same structure (the same array instances and versions, variable
+/// lists, scaling factors and result layout) is not evaluated again but
+/// takes its tiles from the intermediate. The intermediates are freed when
+/// the scope ends. For example, \c t2*g is evaluated once in
+/// \code
+/// {
+///   TA::expressions::ExprCache cache(world);
+///   r1("i,j") = (t2("i,j,c,d") * g("c,d,a,b")) * x("a,b");
+///   r2("i,j") = (t2("i,j,c,d") * g("c,d,a,b")) * y("a,b");
+/// }
+/// \endcode
+/// Scopes are entered and left collectively by the main thread; an inner
+/// scope hides the intermediates of the enclosing one. Tiles that are
+/// modified in place are not detected (see \c DistArray::version() ).
+class ExprCache {
+  ExprCacheImpl impl_;          ///< The intermediates of this scope
+  ExprCacheImpl* const outer_;  ///< The cache of the enclosing scope
+
+ public:
+  /// Enter an expression cache scope
+
+  /// \param world The world of the cached expressions
+  explicit ExprCache(World& world = TiledArray::get_default_world())
+      : impl_(world), outer_(detail::expr_cache()) {
+    detail::expr_cache() = &impl_;
+  }
+
+  ExprCache(const ExprCache&) = delete;
+  ExprCache& operator=(const ExprCache&) = delete;
+
+  /// Leave the expression cache scope and free its intermediates
+  ~ExprCache() {
+    TA_ASSERT(detail::expr_cache() == &impl_);
+    detail::expr_cache() = outer_;
+  }
+
+  /// \return The number of evaluations that reused a cached intermediate
+  std::size_t hits() const { return impl_.hits(); }
+
+  /// \return The number of intermediates that were materialized
+  std::size_t misses() const { return impl_.misses(); }
+
+  /// \return The number of cached intermediates
+  std::size_t size() const { return impl_.size(); }
+};  // class ExprCache
+
+}  // namespace expressions
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_EXPRESSIONS_EXPR_CACHE_H__INCLUDED
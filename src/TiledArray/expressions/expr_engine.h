@@ -26,8 +26,18 @@
 #ifndef TILEDARRAY_EXPRESSIONS_EXPR_ENGINE_H__INCLUDED
 #define TILEDARRAY_EXPRESSIONS_EXPR_ENGINE_H__INCLUDED
 
+#include <TiledArray/expressions/expr_plan.h>
 #include <TiledArray/expressions/expr_trace.h>
 #include <TiledArray/external/madness.h>
+#include <TiledArray/type_traits.h>
+#include <TiledArray/util/eval_counters.h>
+#include <TiledArray/util/task_priority.h>
+
+#include <complex>
+#include <cstdint>
+#include <ios>
+#include <sstream>
+#include <type_traits>
 
 namespace TiledArray {
 namespace expressions {
@@ -81,6 +91,21 @@ class ExprEngine : private NO_DEFAULTS {
       pmap_;  ///< The process map for the result tensor
   std::shared_ptr<EngineParamOverride<Derived> >
       override_ptr_;  ///< The engine params overriding the default
+  std::shared_ptr<TiledArray::detail::EvalCounters>
+      counters_;  ///< Performance counters of the evaluation, or null
+  std::shared_ptr<ExprPlanImpl> plan_;  ///< The evaluation plan, or null
+  std::size_t plan_node_;               ///< The plan node of this expression
+  ExprPlanState plan_state_;  ///< Reuse state of the plan of this expression
+  bool root_;  ///< This expression is the root of the expression graph
+  TiledArray::detail::TaskRank
+      task_rank_;  ///< Scheduling rank of the tile tasks of this expression
+
+  /// Structure of an expression node that is kept in an evaluation plan
+  struct PlanData {
+    VariableList target_vars;  ///< The target variable list of the node
+    trange_type trange;        ///< The tiled range of the result
+    shape_type shape;          ///< The shape of the result before masking
+  };
 
  public:
   /// Default constructor
@@ -95,19 +120,31 @@ class ExprEngine : private NO_DEFAULTS {
         trange_(),
         shape_(),
         pmap_(),
-        override_ptr_(expr.override_ptr_) {}
+        override_ptr_(expr.override_ptr_),
+        counters_(),
+        plan_(),
+        plan_node_(0ul),
+        plan_state_{false, false},
+        root_(false),
+        task_rank_() {}
 
   /// Construct and initialize the expression engine
 
   /// This function will initialize all expression engines in the expression
-  /// graph. The <tt>init_vars()</tt>, <tt>init_struct()</tt>, and
-  /// <tt>init_distribution()</tt> will be called for each node and leaf of
-  /// the graph in that order.
+  /// graph. The <tt>init_vars()</tt>, <tt>init_struct()</tt>,
+  /// <tt>init_task_rank()</tt>, and <tt>init_distribution()</tt> will be
+  /// called for each node and leaf of the graph in that order.
   /// \param world The world where the expression will be evaluated
   /// \param pmap The process map for the result tensor (may be NULL)
   /// \param target_vars The target variable list of the result tensor
   void init(World& world, std::shared_ptr<pmap_interface> pmap,
             const VariableList& target_vars) {
+    root_ = true;
+    if (override_ptr_ && override_ptr_->plan) {
+      override_ptr_->plan->start();
+      derived().init_plan(override_ptr_->plan);
+    }
+
     if (target_vars.dim()) {
       derived().init_vars(target_vars);
       derived().init_struct(target_vars);
@@ -115,6 +152,7 @@ class ExprEngine : private NO_DEFAULTS {
       derived().init_vars();
       derived().init_struct(vars_);
     }
+    derived().init_task_rank(TiledArray::detail::TaskRank());
 
     auto override_world = override_ptr_ != nullptr && override_ptr_->world;
     auto override_pmap = override_ptr_ != nullptr && override_ptr_->pmap;
@@ -147,17 +185,72 @@ class ExprEngine : private NO_DEFAULTS {
   void init_struct(const VariableList& target_vars) {
     if (target_vars != vars_) {
       perm_ = derived().make_perm(target_vars);
-      trange_ = derived().make_trange(perm_);
-      shape_ = derived().make_shape(perm_);
+      init_planned_struct(
+          target_vars, [this]() { return derived().make_trange(perm_); },
+          [this]() { return derived().make_shape(perm_); });
     } else {
-      trange_ = derived().make_trange();
-      shape_ = derived().make_shape();
+      init_planned_struct(target_vars,
+                          [this]() { return derived().make_trange(); },
+                          [this]() { return derived().make_shape(); });
     }
 
     if (override_ptr_ && override_ptr_->shape)
       shape_ = shape_.mask(*override_ptr_->shape);
   }
 
+  /// Initialize the tiled range and shape of the result tensor
+
+  /// The tiled range and shape are taken from the evaluation plan when the
+  /// arrays below this node are unchanged (see \c plan_state() ), otherwise
+  /// they are generated and recorded in the plan.
+  /// \tparam TRangeOp The tiled range factory type
+  /// \tparam ShapeOp The shape factory type
+  /// \param target_vars The target variable list for the result tensor
+  /// \param trange_op The tiled range factory
+  /// \param shape_op The shape factory
+  template <typename TRangeOp, typename ShapeOp>
+  void init_planned_struct(const VariableList& target_vars,
+                           const TRangeOp& trange_op,
+                           const ShapeOp& shape_op) {
+    if (!plan_) {
+      trange_ = trange_op();
+      shape_ = shape_op();
+      return;
+    }
+
+    ExprPlanImpl::Node& node = plan_->node(plan_node_);
+    const PlanData* data = static_cast<const PlanData*>(node.data.get());
+    if (data && plan_state_.tiling && (data->target_vars == target_vars)) {
+      trange_ = data->trange;
+      if (plan_state_.shape) {
+        shape_ = data->shape;
+        plan_->reuse();
+        return;
+      }
+    } else {
+      trange_ = trange_op();
+    }
+    shape_ = shape_op();
+    node.data =
+        std::make_shared<PlanData>(PlanData{target_vars, trange_, shape_});
+  }
+
+  /// Initialize the task rank of this expression
+
+  /// The rank is combined with the priority that was set for this
+  /// expression, if any. Derived classes pass the ranks of their arguments
+  /// (see \c TaskRank::arg() ) to their children.
+  /// \param rank The task rank given by the parent expression
+  void init_task_rank(const TiledArray::detail::TaskRank& rank) {
+    task_rank_ = rank.with_priority(
+        override_ptr_ ? override_ptr_->priority : TaskPriority::automatic);
+  }
+
+  /// Task rank accessor
+
+  /// \return The scheduling rank of the tile tasks of this expression
+  const TiledArray::detail::TaskRank& task_rank() const { return task_rank_; }
+
   /// Initialize result tensor distribution
 
   /// This function will initialize the world and process map for the result
@@ -175,8 +268,100 @@ class ExprEngine : private NO_DEFAULTS {
 
     world_ = world;
     pmap_ = pmap;
+
+    // Count the work of this node if evaluations are traced
+    if (TiledArray::detail::expr_trace_stream())
+      counters_ = std::make_shared<TiledArray::detail::EvalCounters>(
+          perm_ && permute_tiles_);
+  }
+
+  /// Attach this expression to an evaluation plan
+
+  /// This function is called for each node of the expression graph before
+  /// \c init_vars() , parents before children. Derived classes combine this
+  /// state with the reuse state of their children or, for leaves, compare
+  /// the arrays with those of the previous evaluation.
+  /// \param plan The evaluation plan
+  /// \return The reuse state of this node, which is set if the exact
+  /// expression tag (see \c key_tag() ), e.g. a scaling factor, is unchanged
+  ExprPlanState init_plan(const std::shared_ptr<ExprPlanImpl>& plan) {
+    plan_ = plan;
+    plan_node_ = plan->template add_node<Derived>();
+    ExprPlanImpl::Node& node = plan->node(plan_node_);
+    std::ostringstream ss;
+    derived().key_tag(ss);
+    std::string tag(ss.str());
+    const bool same = (node.data || node.extra) && (node.tag == tag);
+    node.tag = std::move(tag);
+    return ExprPlanState{same, same};
+  }
+
+  /// Set the reuse state of the evaluation plan of this expression
+
+  /// \param state The reuse state of the arrays below this expression
+  /// \return \c state
+  ExprPlanState plan_state(const ExprPlanState state) {
+    plan_state_ = state;
+    return state;
+  }
+
+  /// \return The reuse state of the evaluation plan of this expression
+  const ExprPlanState& plan_state() const { return plan_state_; }
+
+  /// Write the structure of this expression
+
+  /// The structure identifies the result of this expression in an
+  /// expression cache (see \c ExprCache ). Derived classes append the
+  /// structure of their children or, for leaves, the array identity. A node
+  /// that cannot be identified sets the failbit of \c os , and the
+  /// expression is not cached.
+  /// \param os The output stream
+  void cache_key(std::ostream& os) const {
+    derived().key_tag(os);
+    os << vars_;
+    if (perm_) os << perm_ << (permute_tiles_ ? "" : "~");
+    if (override_ptr_ && override_ptr_->shape) {
+      os << "@";
+      write_shape_key(os, *override_ptr_->shape);
+    }
+  }
+
+ private:
+  /// Write the tile norms of a shape to an expression cache key
+
+  /// The norms are identified by their range and a 64-bit FNV-1a hash.
+  /// \tparam Shape The shape type
+  /// \param os The output stream
+  /// \param shape The shape
+  template <typename Shape>
+  static std::enable_if_t<
+      TiledArray::detail::has_member_function_data_anyreturn_v<const Shape> >
+  write_shape_key(std::ostream& os, const Shape& shape) {
+    const auto& norms = shape.data();
+    const unsigned char* const bytes =
+        reinterpret_cast<const unsigned char*>(norms.data());
+    const std::size_t n = norms.size() * sizeof(*norms.data());
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (std::size_t i = 0ul; i < n; ++i) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ull;
+    }
+    os << norms.range() << std::hex << hash << std::dec;
+  }
+
+  /// Write a shape without tile norms, i.e. a dense shape, to a cache key
+
+  /// \tparam Shape The shape type
+  /// \param os The output stream
+  template <typename Shape>
+  static std::enable_if_t<
+      !TiledArray::detail::has_member_function_data_anyreturn_v<const Shape> >
+  write_shape_key(std::ostream& os, const Shape&) {
+    os << "dense";
   }
 
+ public:
+
   /// Permutation factory function
 
   /// This function will generate the permutation that will be applied to
@@ -237,6 +422,15 @@ class ExprEngine : private NO_DEFAULTS {
   /// \return A const reference to the process map
   const std::shared_ptr<pmap_interface>& pmap() const { return pmap_; }
 
+  /// Performance counters accessor
+
+  /// \return The performance counters of the evaluation of this expression,
+  /// which are null unless evaluations are traced (see
+  /// \c TiledArray::detail::expr_trace_stream() )
+  const std::shared_ptr<TiledArray::detail::EvalCounters>& counters() const {
+    return counters_;
+  }
+
   /// Set the permute tiles flag
 
   /// \param status The new status for permute tiles (true == permtue result
@@ -245,16 +439,24 @@ class ExprEngine : private NO_DEFAULTS {
 
   /// Expression print
 
+  /// If \c os prints statistics, the performance counters of the evaluation
+  /// are appended; this is a collective operation in that case.
   /// \param os The output stream
   /// \param target_vars The target variable list for this expression
   void print(ExprOStream& os, const VariableList& target_vars) const {
     if (perm_) {
       os << "[P " << target_vars << "]"
          << (permute_tiles_ ? " " : " [no permute tiles] ")
-         << derived().make_tag() << vars_ << "\n";
+         << derived().make_tag() << vars_;
     } else {
-      os << derived().make_tag() << vars_ << "\n";
+      os << derived().make_tag() << vars_;
+    }
+    if (os.stats() && counters_) {
+      TiledArray::detail::EvalStats stats = counters_->stats();
+      stats.reduce(*world_);
+      os.get_stream() << " [" << stats << "]";
     }
+    os.get_stream() << "\n";
   }
 
   /// Expression identification tag
@@ -262,6 +464,48 @@ class ExprEngine : private NO_DEFAULTS {
   /// \return An expression tag used to identify this expression
   const char* make_tag() const { return ""; }
 
+  /// Exact expression identification tag
+
+  /// Unlike \c make_tag() , which prints scaling factors for the reader,
+  /// the key tag identifies this expression in cache keys and evaluation
+  /// plans. Derived classes with scaling factors write them with
+  /// \c write_key() .
+  /// \param os The output stream
+  void key_tag(std::ostream& os) const { os << derived().make_tag(); }
+
+  /// Write a floating-point factor exactly
+
+  /// \param os The output stream
+  /// \param value The factor, which is written in hexadecimal
+  template <typename S>
+  static std::enable_if_t<std::is_floating_point<S>::value> write_key(
+      std::ostream& os, const S value) {
+    const std::ios_base::fmtflags flags = os.flags();
+    os << std::hexfloat << value;
+    os.flags(flags);
+  }
+
+  /// Write an integer factor
+
+  /// \param os The output stream
+  /// \param value The factor
+  template <typename S>
+  static std::enable_if_t<std::is_integral<S>::value> write_key(
+      std::ostream& os, const S value) {
+    os << value;
+  }
+
+  /// Write a complex factor exactly
+
+  /// \param os The output stream
+  /// \param value The factor
+  template <typename S>
+  static void write_key(std::ostream& os, const std::complex<S>& value) {
+    write_key(os, value.real());
+    os << ",";
+    write_key(os, value.imag());
+  }
+
 };  // class ExprEngine
 
 }  // namespace expressions
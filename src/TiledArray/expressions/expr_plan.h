@@ -0,0 +1,168 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  expr_plan.h
+ *  Dec 6, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_EXPRESSIONS_EXPR_PLAN_H__INCLUDED
+#define TILEDARRAY_EXPRESSIONS_EXPR_PLAN_H__INCLUDED
+
+#include <TiledArray/dense_shape.h>
+#include <TiledArray/error.h>
+#include <TiledArray/sparse_shape.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace TiledArray {
+namespace expressions {
+
+/// Reuse state of the planning data of an expression node
+struct ExprPlanState {
+  bool tiling;  ///< The tiled ranges and process maps of the leaves match
+  bool shape;   ///< The tiling and the shapes of the leaves match
+};
+
+/// Identity test of leaf shapes
+
+/// Dense shapes carry no data, so they are always identical.
+inline bool is_same_shape(const DenseShape&, const DenseShape&) {
+  return true;
+}
+
+/// Identity test of leaf shapes
+
+/// Copies of a sparse shape share their tile norms, so a shape is identical
+/// to another if it refers to the same norms.
+template <typename T>
+inline bool is_same_shape(const SparseShape<T>& left,
+                          const SparseShape<T>& right) {
+  return left.data().data() == right.data().data();
+}
+
+/// Planning data of the nodes of an expression
+
+/// The nodes are numbered in the order in which they are visited by
+/// \c ExprEngine::init_plan() .
+class ExprPlanImpl {
+ public:
+  /// Planning data of a node
+  struct Node {
+    const std::type_info* type = nullptr;  ///< The engine type of the node
+    std::string tag;              ///< The exact expression tag of the node
+    std::shared_ptr<void> data;   ///< Structure of the node (\c ExprEngine )
+    std::shared_ptr<void> extra;  ///< Data of the derived engine type
+  };
+
+ private:
+  std::vector<Node> nodes_;   ///< The nodes of the expression
+  std::size_t next_ = 0ul;    ///< The number of visited nodes
+  std::size_t reused_ = 0ul;  ///< The number of reused node shapes
+
+ public:
+  /// Start a new evaluation
+  void start() {
+    next_ = 0ul;
+    reused_ = 0ul;
+  }
+
+  /// Add the next node of an evaluation
+
+  /// The data of a node is discarded if its engine type differs from the
+  /// type of the previous evaluation.
+  /// \tparam Engine The engine type of the node
+  /// \return The index of the node
+  template <typename Engine>
+  std::size_t add_node() {
+    const std::size_t index = next_++;
+    if (index == nodes_.size()) nodes_.emplace_back();
+    Node& node = nodes_[index];
+    if (node.type != &typeid(Engine)) {
+      node = Node();
+      node.type = &typeid(Engine);
+    }
+    return index;
+  }
+
+  /// \return A reference to the node at \c index
+  Node& node(const std::size_t index) {
+    TA_ASSERT(index < nodes_.size());
+    return nodes_[index];
+  }
+
+  /// Record a node whose shape was reused
+  void reuse() { ++reused_; }
+
+  /// \return The number of nodes of the last evaluation that reused their
+  /// shape
+  std::size_t reused() const { return reused_; }
+
+  /// \return The number of planned nodes
+  std::size_t size() const { return nodes_.size(); }
+
+  /// Discard the planning data
+  void clear() {
+    nodes_.clear();
+    start();
+  }
+};  // class ExprPlanImpl
+
+/// Reusable plan of a repeatedly evaluated expression
+
+/// A plan keeps the tiled ranges, shapes, process maps, process grids and
+/// sparse broadcast groups of every node of an expression. When the plan is
+/// attached to an expression again (see \c Expr::set_plan() ), a node
+/// reuses its tiling and distribution if the tiled ranges and process maps
+/// of the arrays below it are unchanged, and also its shape and broadcast
+/// groups if the shapes of those arrays are the same objects. For example,
+/// \code
+/// TA::expressions::ExprPlan plan;
+/// for (auto iter = 0; iter != maxiter; ++iter)
+///   r("i,j") = (g("i,j,a,b") * t("a,b")).set_plan(plan);
+/// \endcode
+/// A plan belongs to one expression and must not be used by concurrent
+/// evaluations.
+class ExprPlan {
+  std::shared_ptr<ExprPlanImpl> pimpl_;  ///< The planning data
+
+ public:
+  /// Construct an empty plan
+  ExprPlan() : pimpl_(std::make_shared<ExprPlanImpl>()) {}
+
+  /// \return The number of planned expression nodes
+  std::size_t size() const { return pimpl_->size(); }
+
+  /// \return The number of nodes of the last evaluation that reused their
+  /// shape
+  std::size_t reused() const { return pimpl_->reused(); }
+
+  /// Discard the planning data, e.g. after the arrays are redistributed
+  void clear() { pimpl_->clear(); }
+
+  /// \return The planning data
+  const std::shared_ptr<ExprPlanImpl>& pimpl() const { return pimpl_; }
+};  // class ExprPlan
+
+}  // namespace expressions
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_EXPRESSIONS_EXPR_PLAN_H__INCLUDED
@@ -27,9 +27,30 @@
 #define TILEDARRAY_EXPR_TRACE_H__INCLUDED
 
 #include <TiledArray/expressions/variable_list.h>
+#include <TiledArray/external/madness.h>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 
 namespace TiledArray {
+namespace detail {
+
+/// Expression trace stream
+
+/// When not null, every evaluated expression is written to this stream with
+/// the performance counters of each node (see \c ExprOStream::stats() ); the
+/// default is \c std::cout if the \c TA_EXPR_TRACE environment variable is
+/// set, otherwise null. It must be set on all processes, since the counters
+/// are combined over processes; only rank 0 writes.
+/// \return A reference to the expression trace stream pointer
+inline std::ostream*& expr_trace_stream() {
+  static std::ostream* value =
+      (std::getenv("TA_EXPR_TRACE") ? &std::cout : nullptr);
+  return value;
+}
+
+}  // namespace detail
+
 namespace expressions {
 
 template <typename>
@@ -41,17 +62,21 @@ class TsrExpr;
 class ExprOStream {
   std::ostream& os_;  ///< output stream
   unsigned int tab_;  ///< Number of leading tabs
+  bool stats_;        ///< Print the performance counters of each node
 
  public:
   /// Constructor
 
   /// \param os The output stream
-  ExprOStream(std::ostream& os) : os_(os), tab_(0u) {}
+  /// \param stats Print the performance counters of each evaluated node
+  ExprOStream(std::ostream& os, const bool stats = false)
+      : os_(os), tab_(0u), stats_(stats) {}
 
   /// Copy constructor
 
   /// \param other The stream object to be copied
-  ExprOStream(const ExprOStream& other) : os_(other.os_), tab_(other.tab_) {}
+  ExprOStream(const ExprOStream& other)
+      : os_(other.os_), tab_(other.tab_), stats_(other.stats_) {}
 
   /// Output operator
 
@@ -76,8 +101,39 @@ class ExprOStream {
   /// Output stream accessor
   std::ostream& get_stream() const { return os_; }
 
+  /// \return \c true if the performance counters of each node are printed
+  bool stats() const { return stats_; }
+
 };  // class ExprOStream
 
+/// Print an evaluated expression with the performance counters of each node
+
+/// Each node is followed by its wall time, floating point operations, bytes
+/// of permuted and communicated tiles, and the numbers of produced tiles and
+/// of tiles screened out by the shape, e.g.
+/// <tt>[*] i,j [1.2 s 12.3 GF 0 B perm 3.4 GB comm 120 tiles 30 screened]</tt>.
+/// Nothing is printed unless the expression trace stream is set (see
+/// \c TiledArray::detail::expr_trace_stream() ). This is a collective
+/// operation.
+/// \tparam Engine The expression engine type
+/// \param engine The engine of the evaluated expression
+/// \param world The world of the evaluation
+/// \param target_vars The target variable list for the expression
+template <typename Engine>
+inline void print_eval_trace(const Engine& engine, World& world,
+                             const VariableList& target_vars) {
+  std::ostream* const os = TiledArray::detail::expr_trace_stream();
+  if (!os) return;
+
+  std::stringstream ss;
+  ss << target_vars << " =\n";
+  ExprOStream expr_stream(ss, true);
+  expr_stream.inc();
+  engine.print(expr_stream, target_vars);
+
+  if (world.rank() == 0) *os << ss.str();
+}
+
 /// Expression trace target
 
 /// Wrapper object that helps start the expression
@@ -0,0 +1,174 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  func_engine.h
+ *  Dec 18, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_EXPRESSIONS_FUNC_ENGINE_H__INCLUDED
+#define TILEDARRAY_EXPRESSIONS_FUNC_ENGINE_H__INCLUDED
+
+#include <TiledArray/expressions/unary_engine.h>
+#include <TiledArray/tile_op/func.h>
+#include <TiledArray/tile_op/unary_wrapper.h>
+
+namespace TiledArray {
+namespace expressions {
+
+// Forward declarations
+template <typename, typename>
+class FuncExpr;
+template <typename, typename, typename>
+class FuncEngine;
+
+template <typename Arg, typename Op, typename Result>
+struct EngineTrait<FuncEngine<Arg, Op, Result> > {
+  // Argument typedefs
+  typedef Arg argument_type;  ///< The argument expression engine type
+
+  // Operational typedefs
+  typedef Op element_op_type;  ///< The element function type
+  typedef TiledArray::detail::Func<Result, typename EngineTrait<Arg>::eval_type,
+                                   element_op_type,
+                                   EngineTrait<Arg>::consumable>
+      op_base_type;  ///< The tile base operation type
+  typedef TiledArray::detail::UnaryWrapper<op_base_type>
+      op_type;  ///< The tile operation type
+  typedef typename op_type::result_type value_type;  ///< The result tile type
+  typedef typename eval_trait<value_type>::type
+      eval_type;                                  ///< Evaluation tile type
+  typedef typename argument_type::policy policy;  ///< The result policy type
+  typedef TiledArray::detail::DistEval<value_type, policy>
+      dist_eval_type;  ///< The distributed evaluator type
+
+  // Meta data typedefs
+  typedef typename policy::size_type size_type;      ///< Size type
+  typedef typename policy::trange_type trange_type;  ///< Tiled range type
+  typedef typename policy::shape_type shape_type;    ///< Shape type
+  typedef typename policy::pmap_interface
+      pmap_interface;  ///< Process map interface type
+
+  static constexpr bool consumable = true;
+  static constexpr unsigned int leaves = EngineTrait<Arg>::leaves;
+};
+
+/// Element-wise function expression engine
+
+/// The shape of the result is the shape of the argument, so only the
+/// non-zero tiles of a sparse argument are transformed.
+/// \tparam Arg The argument expression engine type
+/// \tparam Op The element function type
+/// \tparam Result The result tile type
+template <typename Arg, typename Op, typename Result>
+class FuncEngine : public UnaryEngine<FuncEngine<Arg, Op, Result> > {
+ public:
+  // Class hierarchy typedefs
+  typedef FuncEngine<Arg, Op, Result> FuncEngine_;  ///< This class type
+  typedef UnaryEngine<FuncEngine_>
+      UnaryEngine_;  ///< Unary expression engine base type
+  typedef typename UnaryEngine_::ExprEngine_
+      ExprEngine_;  ///< Expression engine base type
+
+  // Argument typedefs
+  typedef typename EngineTrait<FuncEngine_>::argument_type
+      argument_type;  ///< The argument expression engine type
+
+  // Operational typedefs
+  typedef typename EngineTrait<FuncEngine_>::value_type
+      value_type;  ///< The result tile type
+  typedef typename EngineTrait<FuncEngine_>::element_op_type
+      element_op_type;  ///< The element function type
+  typedef typename EngineTrait<FuncEngine_>::op_base_type
+      op_base_type;  ///< The tile base operation type
+  typedef typename EngineTrait<FuncEngine_>::op_type
+      op_type;  ///< The tile operation type
+  typedef typename EngineTrait<FuncEngine_>::policy
+      policy;  ///< The result policy type
+  typedef typename EngineTrait<FuncEngine_>::dist_eval_type
+      dist_eval_type;  ///< The distributed evaluator type
+
+  // Meta data typedefs
+  typedef
+      typename EngineTrait<FuncEngine_>::size_type size_type;  ///< Size type
+  typedef typename EngineTrait<FuncEngine_>::trange_type
+      trange_type;  ///< Tiled range type
+  typedef
+      typename EngineTrait<FuncEngine_>::shape_type shape_type;  ///< Shape type
+  typedef typename EngineTrait<FuncEngine_>::pmap_interface
+      pmap_interface;  ///< Process map interface type
+
+ private:
+  element_op_type op_;  ///< The element function
+
+ public:
+  /// Constructor
+
+  /// \tparam A The argument expression type
+  /// \tparam O The element function type
+  /// \param expr The parent expression
+  template <typename A, typename O>
+  FuncEngine(const FuncExpr<A, O>& expr) : UnaryEngine_(expr), op_(expr.op()) {}
+
+  /// Non-permuting shape factory function
+
+  /// \return The result shape
+  shape_type make_shape() const { return UnaryEngine_::arg_.shape(); }
+
+  /// Permuting shape factory function
+
+  /// \param perm The permutation to be applied to the array
+  /// \return The result shape
+  shape_type make_shape(const Permutation& perm) const {
+    return UnaryEngine_::arg_.shape().perm(perm);
+  }
+
+  /// Non-permuting tile operation factory function
+
+  /// \return The tile operation
+  op_type make_tile_op() const { return op_type(op_base_type(op_)); }
+
+  /// Permuting tile operation factory function
+
+  /// \param perm The permutation to be applied to tiles
+  /// \return The tile operation
+  op_type make_tile_op(const Permutation& perm) const {
+    return op_type(op_base_type(op_), perm);
+  }
+
+  /// Write the structure of this expression
+
+  /// \param os The output stream
+  void cache_key(std::ostream& os) const {
+    using TiledArray::detail::func_key;
+    os << "[";
+    func_key(os, op_);
+    os << "]";
+    UnaryEngine_::cache_key(os);
+  }
+
+  /// Expression identification tag
+
+  /// \return An expression tag used to identify this expression
+  const char* make_tag() const { return "[func] "; }
+
+};  // class FuncEngine
+
+}  // namespace expressions
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_EXPRESSIONS_FUNC_ENGINE_H__INCLUDED
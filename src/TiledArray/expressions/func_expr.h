@@ -0,0 +1,189 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  func_expr.h
+ *  Dec 18, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_EXPRESSIONS_FUNC_EXPR_H__INCLUDED
+#define TILEDARRAY_EXPRESSIONS_FUNC_EXPR_H__INCLUDED
+
+#include <TiledArray/expressions/func_engine.h>
+#include <TiledArray/expressions/unary_expr.h>
+
+namespace TiledArray {
+namespace expressions {
+
+template <typename Arg, typename Op>
+struct ExprTrait<FuncExpr<Arg, Op> > {
+  typedef Arg argument_type;   ///< The argument expression type
+  typedef Op element_op_type;  ///< The element function type
+  typedef TiledArray::result_of_unary_t<
+      typename EngineTrait<typename ExprTrait<Arg>::engine_type>::eval_type,
+      element_op_type>
+      result_type;  ///< Result tile type
+  typedef FuncEngine<typename ExprTrait<Arg>::engine_type, Op, result_type>
+      engine_type;  ///< Expression engine type
+  typedef TiledArray::detail::numeric_t<
+      typename EngineTrait<engine_type>::eval_type>
+      numeric_type;  ///< Result numeric type
+  typedef TiledArray::detail::scalar_t<
+      typename EngineTrait<engine_type>::eval_type>
+      scalar_type;  ///< Result scalar type
+};
+
+/// Element-wise function expression
+
+/// The element function is applied to each element of the argument, i.e.
+/// <tt>r[i] = op(arg[i])</tt>, within the tile operations of the
+/// expression, so <tt>r("i,j") = exp(a("i,j")) * b("i,j")</tt> is evaluated
+/// in one pass over the tiles without an intermediate array.
+/// \note The shape of the result is the shape of the argument, so for sparse
+/// arrays only the non-zero tiles are transformed, as with \c foreach .
+/// \tparam Arg The argument expression type
+/// \tparam Op The element function type
+template <typename Arg, typename Op>
+class FuncExpr : public UnaryExpr<FuncExpr<Arg, Op> > {
+ public:
+  typedef FuncExpr<Arg, Op> FuncExpr_;      ///< This class type
+  typedef UnaryExpr<FuncExpr_> UnaryExpr_;  ///< Unary base class type
+  typedef typename ExprTrait<FuncExpr_>::argument_type
+      argument_type;  ///< The argument expression type
+  typedef typename ExprTrait<FuncExpr_>::engine_type
+      engine_type;  ///< Expression engine type
+  typedef typename ExprTrait<FuncExpr_>::element_op_type
+      element_op_type;  ///< The element function type
+
+ private:
+  element_op_type op_;  ///< The element function
+
+ public:
+  // Compiler generated functions
+  FuncExpr(const FuncExpr_&) = default;
+  FuncExpr(FuncExpr_&&) = default;
+  ~FuncExpr() = default;
+  FuncExpr_& operator=(const FuncExpr_&) = delete;
+  FuncExpr_& operator=(FuncExpr_&&) = delete;
+
+  /// Element-wise function expression constructor
+
+  /// \param arg The argument expression
+  /// \param op The element function
+  FuncExpr(const argument_type& arg, const element_op_type& op)
+      : UnaryExpr_(arg), op_(op) {}
+
+  /// Element function accessor
+
+  /// \return A const reference to the element function
+  const element_op_type& op() const { return op_; }
+
+};  // class FuncExpr
+
+/// Element-wise function expression factory
+
+/// \tparam Arg The expression type
+/// \tparam Op The element function type
+/// \param expr The expression object
+/// \param op The element function, which is called as <tt>op(arg[i])</tt>
+/// and returns the result element
+/// \return An element-wise function expression object
+/// \note For sparse arrays, the zero tiles of \c expr remain zero, so the
+/// result is correct only where \c expr is non-zero if <tt>op(0) != 0</tt>.
+/// \note Expressions that contain \c op are cached by \c ExprCache only if
+/// \c op is empty, e.g. a lambda without captures, or is identified by a
+/// \c func_key() overload (see \c TiledArray::detail::func_key() ).
+template <typename Arg, typename Op>
+inline FuncExpr<Arg, Op> apply(const Expr<Arg>& expr, const Op& op) {
+  static_assert(
+      TiledArray::expressions::is_aliased<Arg>::value,
+      "no_alias() expressions are not allowed on the right-hand side of "
+      "the assignment operator.");
+  return FuncExpr<Arg, Op>(expr.derived(), op);
+}
+
+/// Element-wise exponential expression factory
+
+/// \tparam Arg The expression type
+/// \param expr The expression object
+/// \return An expression of the exponentials of the elements of \c expr
+/// \note For sparse arrays, the zero tiles of \c expr remain zero, not 1.
+template <typename Arg>
+inline auto exp(const Expr<Arg>& expr) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  return apply(expr, TiledArray::detail::ExpOp<numeric_type>());
+}
+
+/// Element-wise natural logarithm expression factory
+
+/// \tparam Arg The expression type
+/// \param expr The expression object
+/// \return An expression of the logarithms of the elements of \c expr
+/// \note For sparse arrays, the zero tiles of \c expr remain zero, not -inf.
+template <typename Arg>
+inline auto log(const Expr<Arg>& expr) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  return apply(expr, TiledArray::detail::LogOp<numeric_type>());
+}
+
+/// Element-wise square root expression factory
+
+/// \tparam Arg The expression type
+/// \param expr The expression object
+/// \return An expression of the square roots of the elements of \c expr
+/// \note For sparse arrays, the zero tiles of \c expr remain zero, which
+/// is their square root.
+template <typename Arg>
+inline auto sqrt(const Expr<Arg>& expr) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  return apply(expr, TiledArray::detail::SqrtOp<numeric_type>());
+}
+
+/// Element-wise reciprocal expression factory
+
+/// \tparam Arg The expression type
+/// \param expr The expression object
+/// \return An expression of the reciprocals of the elements of \c expr
+/// \note For sparse arrays, the zero tiles of \c expr remain zero, not inf.
+template <typename Arg>
+inline auto inv(const Expr<Arg>& expr) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  return apply(expr, TiledArray::detail::InvOp<numeric_type>());
+}
+
+/// Element-wise power expression factory
+
+/// \tparam Arg The expression type
+/// \tparam Scalar The exponent type
+/// \param expr The expression object
+/// \param exponent The exponent
+/// \return An expression of the elements of \c expr raised to \c exponent
+/// \note For sparse arrays, the zero tiles of \c expr remain zero, which
+/// is correct only if \c exponent is positive.
+template <typename Arg, typename Scalar,
+          typename std::enable_if<
+              TiledArray::detail::is_numeric_v<Scalar> >::type* = nullptr>
+inline auto pow(const Expr<Arg>& expr, const Scalar exponent) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  return apply(expr,
+               TiledArray::detail::PowOp<numeric_type, Scalar>(exponent));
+}
+
+}  // namespace expressions
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_EXPRESSIONS_FUNC_EXPR_H__INCLUDED
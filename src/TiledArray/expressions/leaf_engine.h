@@ -80,6 +80,16 @@ class LeafEngine : public ExprEngine<Derived> {
 
   array_type array_;  ///< The array object
 
+  /// Arrays of a leaf that are kept in an evaluation plan
+  struct PlanArray {
+    VariableList vars;                     ///< The variable list of the leaf
+    trange_type trange;                    ///< The tiled range of the array
+    std::shared_ptr<pmap_interface> pmap;  ///< The process map of the array
+    shape_type shape;                      ///< The shape of the array
+    std::shared_ptr<pmap_interface>
+        default_pmap;  ///< The default process map of the leaf, or null
+  };
+
  public:
   /// Engine constructor
 
@@ -98,6 +108,34 @@ class LeafEngine : public ExprEngine<Derived> {
   /// This function is a noop since the variable list is fixed.
   void perm_vars(const VariableList&) {}
 
+  /// Attach this expression to an evaluation plan
+
+  /// The tiling of the leaf can be reused if the array has the same
+  /// variable list, tiled range, and process map as the array of the
+  /// previous evaluation, and the shape can be reused if the array shape is
+  /// also the same object (see \c is_same_shape() ).
+  /// \param plan The evaluation plan
+  /// \return The reuse state of this leaf
+  ExprPlanState init_plan(const std::shared_ptr<ExprPlanImpl>& plan) {
+    ExprPlanState state = ExprEngine_::init_plan(plan);
+    ExprPlanImpl::Node& node = plan->node(ExprEngine_::plan_node_);
+    const PlanArray* planned = static_cast<const PlanArray*>(node.extra.get());
+
+    state.tiling = state.tiling && planned && (planned->vars == vars_) &&
+                   (planned->pmap == array_.pmap()) &&
+                   (planned->trange == array_.trange());
+    state.shape =
+        state.tiling && is_same_shape(planned->shape, array_.shape());
+
+    // Keep the array shape alive so its identity can be checked
+    if (!state.shape)
+      node.extra = std::make_shared<PlanArray>(PlanArray{
+          vars_, array_.trange(), array_.pmap(), array_.shape(),
+          (state.tiling ? planned->default_pmap
+                        : std::shared_ptr<pmap_interface>())});
+    return ExprEngine_::plan_state(state);
+  }
+
   /// Initialize the variable list of this expression
 
   /// This function only checks for valid variable lists.
@@ -156,6 +194,17 @@ class LeafEngine : public ExprEngine<Derived> {
     return array_.shape().perm(perm);
   }
 
+  /// Write the structure of this expression
+
+  /// The identity of a leaf is the id and the local version of its array.
+  /// \param os The output stream
+  void cache_key(std::ostream& os) const {
+    ExprEngine_::cache_key(os);
+    const madness::uniqueidT id = array_.id();
+    os << "{" << id.get_world_id() << ":" << id.get_obj_id() << ":"
+       << array_.version() << "}";
+  }
+
   /// Construct the distributed evaluator for array
   dist_eval_type make_dist_eval() const {
     // Define the distributed evaluator implementation type
@@ -165,6 +214,8 @@ class LeafEngine : public ExprEngine<Derived> {
     /// Create the pimpl for the distributed evaluator
     std::shared_ptr<impl_type> pimpl = std::make_shared<impl_type>(
         array_, *world_, trange_, shape_, pmap_, perm_, ExprEngine_::make_op());
+    pimpl->counters(ExprEngine_::counters());
+    pimpl->task_rank(ExprEngine_::task_rank());
 
     return dist_eval_type(pimpl);
   }
@@ -252,6 +252,16 @@ class MultEngine : public ContEngine<MultEngine<Left, Right, Result> > {
       BinaryEngine_::init_struct(target_vars);
   }
 
+  /// Initialize the task rank of this expression and its arguments
+
+  /// \param rank The task rank given by the parent expression
+  void init_task_rank(const TiledArray::detail::TaskRank& rank) {
+    if (contract_)
+      ContEngine_::init_task_rank(rank);
+    else
+      BinaryEngine_::init_task_rank(rank);
+  }
+
   /// Initialize result tensor distribution
 
   /// This function will initialize the world and process map for the result
@@ -315,6 +325,11 @@ class MultEngine : public ContEngine<MultEngine<Left, Right, Result> > {
     return op_type(op_base_type(), perm);
   }
 
+  /// Contraction query
+
+  /// \return \c true if this expression is a contraction, otherwise \c false
+  bool is_contraction() const { return contract_; }
+
   /// Construct the distributed evaluator for this expression
 
   /// \return The distributed evaluator that will evaluate this expression
@@ -469,6 +484,16 @@ class ScalMultEngine
       BinaryEngine_::init_struct(target_vars);
   }
 
+  /// Initialize the task rank of this expression and its arguments
+
+  /// \param rank The task rank given by the parent expression
+  void init_task_rank(const TiledArray::detail::TaskRank& rank) {
+    if (contract_)
+      ContEngine_::init_task_rank(rank);
+    else
+      BinaryEngine_::init_task_rank(rank);
+  }
+
   /// Initialize result tensor distribution
 
   /// This function will initialize the world and process map for the result
@@ -482,6 +507,11 @@ class ScalMultEngine
       BinaryEngine_::init_distribution(world, pmap);
   }
 
+  /// Contraction query
+
+  /// \return \c true if this expression is a contraction, otherwise \c false
+  bool is_contraction() const { return contract_; }
+
   /// Construct the distributed evaluator for this expression
 
   /// \return The distributed evaluator that will evaluate this expression
@@ -554,6 +584,15 @@ class ScalMultEngine
     return ss.str();
   }
 
+  /// Exact expression identification tag
+
+  /// \param os The output stream
+  void key_tag(std::ostream& os) const {
+    os << "[*] [";
+    ExprEngine_::write_key(os, ContEngine_::factor_);
+    os << "] ";
+  }
+
   /// Expression print
 
   /// \param os The output stream
@@ -0,0 +1,397 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  partial_reduce_engine.h
+ *  Dec 16, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_EXPRESSIONS_PARTIAL_REDUCE_ENGINE_H__INCLUDED
+#define TILEDARRAY_EXPRESSIONS_PARTIAL_REDUCE_ENGINE_H__INCLUDED
+
+#include <TiledArray/dense_shape.h>
+#include <TiledArray/dist_eval/partial_reduce_eval.h>
+#include <TiledArray/expressions/expr_engine.h>
+#include <TiledArray/sparse_shape.h>
+#include <TiledArray/tile_op/func.h>
+#include <TiledArray/tile_op/partial_reduce.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace TiledArray {
+namespace expressions {
+
+// Forward declarations
+template <typename, typename, typename, typename>
+class PartialReduceExpr;
+template <typename, typename, typename, typename>
+class PartialReduceEngine;
+
+template <typename Arg, typename ReduceOp, typename JoinOp, typename Scalar>
+struct EngineTrait<PartialReduceEngine<Arg, ReduceOp, JoinOp, Scalar> > {
+  // Argument typedefs
+  typedef Arg argument_type;  ///< The argument expression engine type
+
+  // Operational typedefs
+  typedef Scalar scalar_type;  ///< The identity type
+  typedef TiledArray::detail::PartialReduce<
+      typename EngineTrait<Arg>::eval_type, ReduceOp, JoinOp, scalar_type>
+      op_type;  ///< The tile operation type
+  typedef typename op_type::result_type value_type;  ///< The result tile type
+  typedef typename eval_trait<value_type>::type
+      eval_type;                                  ///< Evaluation tile type
+  typedef typename argument_type::policy policy;  ///< The result policy type
+  typedef TiledArray::detail::DistEval<value_type, policy>
+      dist_eval_type;  ///< The distributed evaluator type
+
+  // Meta data typedefs
+  typedef typename policy::size_type size_type;      ///< Size type
+  typedef typename policy::trange_type trange_type;  ///< Tiled range type
+  typedef typename policy::shape_type shape_type;    ///< Shape type
+  typedef typename policy::pmap_interface
+      pmap_interface;  ///< Process map interface type
+
+  static constexpr bool consumable = true;
+  static constexpr unsigned int leaves = EngineTrait<Arg>::leaves;
+};
+
+/// Partial reduction expression engine
+
+/// The variables of the argument that are not in the target variable list
+/// are reduced. The argument is evaluated with the kept variables leading
+/// or trailing its variable list, and is permuted only if neither is the
+/// case, so the result tiles are never permuted.
+/// \tparam Arg The argument expression engine type
+/// \tparam ReduceOp The element reduction operation type
+/// \tparam JoinOp The element join operation type
+/// \tparam Scalar The identity type of the reduction
+template <typename Arg, typename ReduceOp, typename JoinOp, typename Scalar>
+class PartialReduceEngine
+    : public ExprEngine<PartialReduceEngine<Arg, ReduceOp, JoinOp, Scalar> > {
+ public:
+  // Class hierarchy typedefs
+  typedef PartialReduceEngine<Arg, ReduceOp, JoinOp, Scalar>
+      PartialReduceEngine_;  ///< This class type
+  typedef ExprEngine<PartialReduceEngine_>
+      ExprEngine_;  ///< Expression engine base type
+
+  // Argument typedefs
+  typedef typename EngineTrait<PartialReduceEngine_>::argument_type
+      argument_type;  ///< The argument expression engine type
+
+  // Operational typedefs
+  typedef typename EngineTrait<PartialReduceEngine_>::value_type
+      value_type;  ///< The result tile type
+  typedef typename EngineTrait<PartialReduceEngine_>::scalar_type
+      scalar_type;  ///< The identity type
+  typedef typename EngineTrait<PartialReduceEngine_>::op_type
+      op_type;  ///< The tile operation type
+  typedef typename EngineTrait<PartialReduceEngine_>::policy
+      policy;  ///< The result policy type
+  typedef typename EngineTrait<PartialReduceEngine_>::dist_eval_type
+      dist_eval_type;  ///< The distributed evaluator type
+
+  // Meta data typedefs
+  typedef typename EngineTrait<PartialReduceEngine_>::size_type
+      size_type;  ///< Size type
+  typedef typename EngineTrait<PartialReduceEngine_>::trange_type
+      trange_type;  ///< Tiled range type
+  typedef typename EngineTrait<PartialReduceEngine_>::shape_type
+      shape_type;  ///< Shape type
+  typedef typename EngineTrait<PartialReduceEngine_>::pmap_interface
+      pmap_interface;  ///< Process map interface type
+
+  static constexpr bool consumable = true;
+  static constexpr unsigned int leaves = argument_type::leaves;
+
+ protected:
+  // Import base class variables to this scope
+  using ExprEngine_::perm_;
+  using ExprEngine_::pmap_;
+  using ExprEngine_::shape_;
+  using ExprEngine_::trange_;
+  using ExprEngine_::vars_;
+  using ExprEngine_::world_;
+
+  argument_type arg_;      ///< The argument
+  VariableList arg_vars_;  ///< The variable list of the evaluated argument
+  ReduceOp reduce_op_;     ///< The element reduction operation
+  JoinOp join_op_;         ///< The element join operation
+  scalar_type identity_;   ///< The identity of the reduction
+  bool row_;               ///< The kept variables lead the argument variables
+
+ private:
+  // Not allowed
+  PartialReduceEngine(const PartialReduceEngine_&);
+  PartialReduceEngine_& operator=(const PartialReduceEngine_&);
+
+  /// The shape of a dense argument
+  DenseShape reduce_shape(const DenseShape&) const { return DenseShape(); }
+
+  /// The shape of a sparse argument
+
+  /// The norm of a result tile is estimated by the norms of its argument
+  /// tiles, so that it is zero only if all of its argument tiles are zero.
+  /// \param shape The argument shape
+  /// \return The result shape
+  template <typename T>
+  SparseShape<T> reduce_shape(const SparseShape<T>& shape) const {
+    const trange_type& arg_trange = arg_.trange();
+    const size_type size = trange_.tiles_range().volume();
+    const size_type reduced = arg_trange.tiles_range().volume() / size;
+
+    Tensor<T> tile_norms(trange_.tiles_range(), T(0));
+    for (size_type index = 0ul; index < reduced * size; ++index) {
+      const size_type i = (row_ ? index / reduced : index % size);
+      tile_norms[i] += shape.data()[index] *
+                       T(arg_trange.make_tile_range(index).volume());
+    }
+    for (size_type i = 0ul; i < size; ++i)
+      tile_norms[i] /= T(trange_.make_tile_range(i).volume());
+
+    return SparseShape<T>(tile_norms, trange_, true);
+  }
+
+ public:
+  /// Constructor
+
+  /// \tparam A The argument expression type
+  /// \tparam R The element reduction operation type
+  /// \tparam J The element join operation type
+  /// \tparam S The identity type
+  /// \param expr The parent expression
+  template <typename A, typename R, typename J, typename S>
+  PartialReduceEngine(const PartialReduceExpr<A, R, J, S>& expr)
+      : ExprEngine_(expr),
+        arg_(expr.arg()),
+        arg_vars_(),
+        reduce_op_(expr.reduce_op()),
+        join_op_(expr.join_op()),
+        identity_(expr.identity()),
+        row_(true) {}
+
+  /// Set the variable list for this expression
+
+  /// The target variables must be a subset of the argument variables. The
+  /// argument variable list is chosen such that the argument is permuted
+  /// only if the target variables neither lead nor trail it.
+  /// \param target_vars The target variable list for this expression
+  void perm_vars(const VariableList& target_vars) {
+    const VariableList& vars = arg_.vars();
+
+    // Split the argument variables into kept and reduced variables
+    std::vector<std::string> reduced;
+    for (const auto& var : vars)
+      if (std::find(target_vars.begin(), target_vars.end(), var) ==
+          target_vars.end())
+        reduced.push_back(var);
+
+    if ((reduced.size() + target_vars.dim()) != vars.dim()) {
+      if (TiledArray::get_default_world().rank() == 0) {
+        TA_USER_ERROR_MESSAGE(
+            "The target variable list of a partial reduction is not a "
+            "subset of the argument variable list:"
+            << "\n    target   = " << target_vars
+            << "\n    argument = " << vars);
+      }
+
+      TA_EXCEPTION(
+          "The target variable list of a partial reduction is not a subset "
+          "of the argument variable list.");
+    }
+
+    vars_ = target_vars;
+    const unsigned int rank = target_vars.dim();
+    if (std::equal(target_vars.begin(), target_vars.end(), vars.begin())) {
+      arg_vars_ = vars;
+      row_ = true;
+    } else if (std::equal(target_vars.begin(), target_vars.end(),
+                          vars.begin() + (vars.dim() - rank))) {
+      arg_vars_ = vars;
+      row_ = false;
+    } else {
+      std::vector<std::string> arg_vars(target_vars.begin(),
+                                        target_vars.end());
+      arg_vars.insert(arg_vars.end(), reduced.begin(), reduced.end());
+      arg_vars_ = VariableList(arg_vars.begin(), arg_vars.end());
+      row_ = true;
+      arg_.perm_vars(arg_vars_);
+    }
+  }
+
+  /// Attach this expression and its argument to an evaluation plan
+
+  /// \param plan The evaluation plan
+  /// \return The combined reuse state of this expression and its argument
+  ExprPlanState init_plan(const std::shared_ptr<ExprPlanImpl>& plan) {
+    const ExprPlanState self = ExprEngine_::init_plan(plan);
+    const ExprPlanState arg = arg_.init_plan(plan);
+    return ExprEngine_::plan_state(
+        ExprPlanState{self.tiling && arg.tiling, self.shape && arg.shape});
+  }
+
+  /// Initialize the variable list of this expression
+
+  /// \param target_vars The target variable list for this expression
+  void init_vars(const VariableList& target_vars) {
+    arg_.init_vars();
+    perm_vars(target_vars);
+  }
+
+  /// Initialize the variable list of this expression
+
+  /// \throw TiledArray::Exception The reduced variables of a partial
+  /// reduction are defined by a target variable list.
+  void init_vars() {
+    TA_EXCEPTION(
+        "A partial reduction must be assigned to an annotated array or used "
+        "in an expression with a target variable list.");
+  }
+
+  /// Initialize result tensor structure
+
+  /// The result is always generated in the order of \c target_vars , since
+  /// the kept variables of the argument are chosen to match it.
+  /// \param target_vars The target variable list for the result tensor
+  void init_struct(const VariableList& target_vars) {
+    if (target_vars != vars_) perm_vars(target_vars);
+    arg_.init_struct(arg_vars_);
+    ExprEngine_::init_struct(vars_);
+  }
+
+  /// Initialize the task rank of this expression and its argument
+
+  /// \param rank The task rank given by the parent expression
+  void init_task_rank(const TiledArray::detail::TaskRank& rank) {
+    ExprEngine_::init_task_rank(rank);
+    arg_.init_task_rank(ExprEngine_::task_rank().arg(false));
+  }
+
+  /// Initialize result tensor distribution
+
+  /// The argument is distributed independently of the result, since their
+  /// tiled ranges differ.
+  /// \param world The world were the result will be distributed
+  /// \param pmap The process map for the result tensor tiles
+  void init_distribution(World* world, std::shared_ptr<pmap_interface> pmap) {
+    arg_.init_distribution(
+        world, std::shared_ptr<typename argument_type::pmap_interface>());
+    if (!pmap)
+      pmap = policy::default_pmap(*world, trange_.tiles_range().volume());
+    ExprEngine_::init_distribution(world, pmap);
+  }
+
+  /// Non-permuting tiled range factory function
+
+  /// \return The result tiled range
+  trange_type make_trange() const {
+    const auto& ranges = arg_.trange().data();
+    const unsigned int offset = (row_ ? 0u : ranges.size() - vars_.dim());
+    return trange_type(ranges.begin() + offset,
+                       ranges.begin() + offset + vars_.dim());
+  }
+
+  /// Permuting tiled range factory function
+
+  /// \param perm The permutation to be applied to the tiled range
+  /// \return The result tiled range
+  trange_type make_trange(const Permutation& perm) const {
+    return perm * make_trange();
+  }
+
+  /// Non-permuting shape factory function
+
+  /// \return The result shape
+  shape_type make_shape() const { return reduce_shape(arg_.shape()); }
+
+  /// Permuting shape factory function
+
+  /// \param perm The permutation to be applied to the shape
+  /// \return The result shape
+  shape_type make_shape(const Permutation& perm) const {
+    return make_shape().perm(perm);
+  }
+
+  /// Tile operation factory function
+
+  /// \return The tile operation
+  op_type make_tile_op() const {
+    return op_type(reduce_op_, join_op_, identity_, vars_.dim(), row_);
+  }
+
+  /// Construct the distributed evaluator for this expression
+
+  /// \return The distributed evaluator that will evaluate this expression
+  dist_eval_type make_dist_eval() const {
+    typedef TiledArray::detail::PartialReduceEvalImpl<
+        typename argument_type::dist_eval_type, op_type,
+        typename dist_eval_type::policy>
+        impl_type;
+
+    // Construct the argument distributed evaluator
+    const typename argument_type::dist_eval_type arg = arg_.make_dist_eval();
+
+    // Construct the distributed evaluator type
+    std::shared_ptr<impl_type> pimpl = std::make_shared<impl_type>(
+        arg, *world_, trange_, shape_, pmap_, make_tile_op());
+    pimpl->counters(ExprEngine_::counters());
+    pimpl->task_rank(ExprEngine_::task_rank());
+
+    return dist_eval_type(pimpl);
+  }
+
+  /// Write the structure of this expression
+
+  /// \param os The output stream
+  void cache_key(std::ostream& os) const {
+    using TiledArray::detail::func_key;
+    ExprEngine_::cache_key(os);
+    os << "[";
+    func_key(os, reduce_op_);
+    os << ",";
+    func_key(os, join_op_);
+    os << ",";
+    ExprEngine_::write_key(os, identity_);
+    os << "](";
+    arg_.cache_key(os);
+    os << ")";
+  }
+
+  /// Expression print
+
+  /// \param os The output stream
+  /// \param target_vars The target variable list for this expression
+  void print(ExprOStream os, const VariableList& target_vars) const {
+    ExprEngine_::print(os, target_vars);
+    os.inc();
+    arg_.print(os, arg_vars_);
+    os.dec();
+  }
+
+  /// Expression identification tag
+
+  /// \return An expression tag used to identify this expression
+  const char* make_tag() const { return "[reduce] "; }
+
+};  // class PartialReduceEngine
+
+}  // namespace expressions
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_EXPRESSIONS_PARTIAL_REDUCE_ENGINE_H__INCLUDED
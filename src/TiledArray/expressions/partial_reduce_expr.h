@@ -0,0 +1,190 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  partial_reduce_expr.h
+ *  Dec 16, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_EXPRESSIONS_PARTIAL_REDUCE_EXPR_H__INCLUDED
+#define TILEDARRAY_EXPRESSIONS_PARTIAL_REDUCE_EXPR_H__INCLUDED
+
+#include <TiledArray/expressions/partial_reduce_engine.h>
+#include <TiledArray/expressions/unary_expr.h>
+
+#include <limits>
+
+namespace TiledArray {
+namespace expressions {
+
+template <typename Arg, typename ReduceOp, typename JoinOp, typename Scalar>
+struct ExprTrait<PartialReduceExpr<Arg, ReduceOp, JoinOp, Scalar> > {
+  typedef Arg argument_type;  ///< The argument expression type
+  typedef PartialReduceEngine<typename ExprTrait<Arg>::engine_type, ReduceOp,
+                              JoinOp, Scalar>
+      engine_type;  ///< Expression engine type
+  typedef TiledArray::detail::numeric_t<
+      typename EngineTrait<engine_type>::eval_type>
+      numeric_type;  ///< Result numeric type
+  typedef TiledArray::detail::scalar_t<
+      typename EngineTrait<engine_type>::eval_type>
+      scalar_type;  ///< Result scalar type
+};
+
+/// Partial reduction expression
+
+/// The variables of the argument that are not in the target variable list
+/// are reduced, e.g. <tt>v("i") = partial_sum(a("i,j"))</tt> sums over
+/// \c j . The result elements are initialized with the identity, the
+/// argument elements are reduced into them with
+/// <tt>reduce_op(result, arg)</tt> and the partial results of different
+/// tiles are combined with <tt>join_op(result, other)</tt>, as in
+/// \c Tensor::reduce() .
+/// \note For sparse arrays, the elements of zero argument tiles are reduced
+/// as zeros, and a result tile is zero if all of its argument tiles are
+/// zero.
+/// \tparam Arg The argument expression type
+/// \tparam ReduceOp The element reduction operation type
+/// \tparam JoinOp The element join operation type
+/// \tparam Scalar The identity type of the reduction
+template <typename Arg, typename ReduceOp, typename JoinOp, typename Scalar>
+class PartialReduceExpr
+    : public UnaryExpr<PartialReduceExpr<Arg, ReduceOp, JoinOp, Scalar> > {
+ public:
+  typedef PartialReduceExpr<Arg, ReduceOp, JoinOp, Scalar>
+      PartialReduceExpr_;                            ///< This class type
+  typedef UnaryExpr<PartialReduceExpr_> UnaryExpr_;  ///< Unary base class type
+  typedef typename ExprTrait<PartialReduceExpr_>::argument_type
+      argument_type;  ///< The argument expression type
+  typedef typename ExprTrait<PartialReduceExpr_>::engine_type
+      engine_type;  ///< Expression engine type
+
+ private:
+  ReduceOp reduce_op_;  ///< The element reduction operation
+  JoinOp join_op_;      ///< The element join operation
+  Scalar identity_;     ///< The identity of the reduction
+
+ public:
+  // Compiler generated functions
+  PartialReduceExpr(const PartialReduceExpr_&) = default;
+  PartialReduceExpr(PartialReduceExpr_&&) = default;
+  ~PartialReduceExpr() = default;
+  PartialReduceExpr_& operator=(const PartialReduceExpr_&) = delete;
+  PartialReduceExpr_& operator=(PartialReduceExpr_&&) = delete;
+
+  /// Partial reduction expression constructor
+
+  /// \param arg The argument expression
+  /// \param reduce_op The element reduction operation
+  /// \param join_op The element join operation
+  /// \param identity The identity of the reduction
+  PartialReduceExpr(const argument_type& arg, const ReduceOp& reduce_op,
+                    const JoinOp& join_op, const Scalar identity)
+      : UnaryExpr_(arg),
+        reduce_op_(reduce_op),
+        join_op_(join_op),
+        identity_(identity) {}
+
+  /// \return The element reduction operation
+  const ReduceOp& reduce_op() const { return reduce_op_; }
+
+  /// \return The element join operation
+  const JoinOp& join_op() const { return join_op_; }
+
+  /// \return The identity of the reduction
+  Scalar identity() const { return identity_; }
+
+};  // class PartialReduceExpr
+
+/// Partial reduction expression factory
+
+/// \tparam Arg The expression type
+/// \tparam ReduceOp The element reduction operation type
+/// \tparam JoinOp The element join operation type
+/// \tparam Scalar The identity type
+/// \param expr The expression object
+/// \param reduce_op The element reduction operation
+/// \param join_op The element join operation
+/// \param identity The identity of the reduction
+/// \return A partial reduction expression object
+template <typename Arg, typename ReduceOp, typename JoinOp, typename Scalar>
+inline PartialReduceExpr<Arg, ReduceOp, JoinOp, Scalar> partial_reduce(
+    const Expr<Arg>& expr, const ReduceOp& reduce_op, const JoinOp& join_op,
+    const Scalar identity) {
+  static_assert(
+      TiledArray::expressions::is_aliased<Arg>::value,
+      "no_alias() expressions are not allowed on the right-hand side of "
+      "the assignment operator.");
+  return PartialReduceExpr<Arg, ReduceOp, JoinOp, Scalar>(
+      expr.derived(), reduce_op, join_op, identity);
+}
+
+/// Partial sum expression factory
+
+/// \tparam Arg The expression type
+/// \param expr The expression object
+/// \return An expression of the sums over the reduced variables
+template <typename Arg>
+inline auto partial_sum(const Expr<Arg>& expr) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  const TiledArray::detail::PartialSumOp<numeric_type> sum_op{};
+  return partial_reduce(expr, sum_op, sum_op, numeric_type(0));
+}
+
+/// Partial squared norm expression factory
+
+/// \tparam Arg The expression type
+/// \param expr The expression object
+/// \return An expression of the squared 2-norms over the reduced variables
+template <typename Arg>
+inline auto partial_squared_norm(const Expr<Arg>& expr) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  return partial_reduce(
+      expr, TiledArray::detail::PartialSquaredNormOp<numeric_type>(),
+      TiledArray::detail::PartialSumOp<numeric_type>(), numeric_type(0));
+}
+
+/// Partial maximum expression factory
+
+/// \tparam Arg The expression type
+/// \param expr The expression object
+/// \return An expression of the maxima over the reduced variables
+template <typename Arg>
+inline auto partial_max(const Expr<Arg>& expr) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  const TiledArray::detail::PartialMaxOp<numeric_type> max_op{};
+  return partial_reduce(expr, max_op, max_op,
+                        std::numeric_limits<numeric_type>::lowest());
+}
+
+/// Partial minimum expression factory
+
+/// \tparam Arg The expression type
+/// \param expr The expression object
+/// \return An expression of the minima over the reduced variables
+template <typename Arg>
+inline auto partial_min(const Expr<Arg>& expr) {
+  typedef typename ExprTrait<Arg>::numeric_type numeric_type;
+  const TiledArray::detail::PartialMinOp<numeric_type> min_op{};
+  return partial_reduce(expr, min_op, min_op,
+                        std::numeric_limits<numeric_type>::max());
+}
+
+}  // namespace expressions
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_EXPRESSIONS_PARTIAL_REDUCE_EXPR_H__INCLUDED
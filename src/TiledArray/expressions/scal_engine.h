@@ -159,6 +159,15 @@ class ScalEngine : public UnaryEngine<ScalEngine<Arg, Scalar, Result> > {
     return ss.str();
   }
 
+  /// Exact expression identification tag
+
+  /// \param os The output stream
+  void key_tag(std::ostream& os) const {
+    os << "[";
+    ExprEngine_::write_key(os, factor_);
+    os << "] ";
+  }
+
 };  // class ScalEngine
 
 }  // namespace expressions
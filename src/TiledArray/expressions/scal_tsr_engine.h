@@ -156,6 +156,15 @@ class ScalTsrEngine : public LeafEngine<ScalTsrEngine<Array, Scalar, Result> > {
     return ss.str();
   }
 
+  /// Exact expression identification tag
+
+  /// \param os The output stream
+  void key_tag(std::ostream& os) const {
+    os << "[";
+    ExprEngine_::write_key(os, factor_);
+    os << "] ";
+  }
+
 };  // class ScalTsrEngine
 
 }  // namespace expressions
@@ -307,6 +307,15 @@ class ScalSubtEngine
     return ss.str();
   }
 
+  /// Exact expression identification tag
+
+  /// \param os The output stream
+  void key_tag(std::ostream& os) const {
+    os << "[-] [";
+    ExprEngine_::write_key(os, factor_);
+    os << "] ";
+  }
+
 };  // class ScalSubtEngine
 
 }  // namespace expressions
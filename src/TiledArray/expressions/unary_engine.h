@@ -91,6 +91,7 @@ class UnaryEngine : ExprEngine<Derived> {
 
   // Pull base class functions into this class.
   using ExprEngine_::derived;
+  using ExprEngine_::task_rank;
   using ExprEngine_::vars;
 
   /// Set the variable list for this expression
@@ -105,6 +106,17 @@ class UnaryEngine : ExprEngine<Derived> {
     if (arg_.vars() != target_vars) arg_.perm_vars(target_vars);
   }
 
+  /// Attach this expression and its argument to an evaluation plan
+
+  /// \param plan The evaluation plan
+  /// \return The combined reuse state of this expression and its argument
+  ExprPlanState init_plan(const std::shared_ptr<ExprPlanImpl>& plan) {
+    const ExprPlanState self = ExprEngine_::init_plan(plan);
+    const ExprPlanState arg = arg_.init_plan(plan);
+    return ExprEngine_::plan_state(
+        ExprPlanState{self.tiling && arg.tiling, self.shape && arg.shape});
+  }
+
   /// Initialize the variable list of this expression
 
   /// \param target_vars The target variable list for this expression
@@ -129,6 +141,14 @@ class UnaryEngine : ExprEngine<Derived> {
     ExprEngine_::init_struct(target_vars);
   }
 
+  /// Initialize the task rank of this expression and its argument
+
+  /// \param rank The task rank given by the parent expression
+  void init_task_rank(const TiledArray::detail::TaskRank& rank) {
+    ExprEngine_::init_task_rank(rank);
+    arg_.init_task_rank(ExprEngine_::task_rank().arg(false));
+  }
+
   /// Initialize result tensor distribution
 
   /// This function will initialize the world and process map for the result
@@ -169,10 +189,22 @@ class UnaryEngine : ExprEngine<Derived> {
     // Construct the distributed evaluator type
     std::shared_ptr<impl_type> pimpl = std::make_shared<impl_type>(
         arg, *world_, trange_, shape_, pmap_, perm_, ExprEngine_::make_op());
+    pimpl->counters(ExprEngine_::counters());
+    pimpl->task_rank(ExprEngine_::task_rank());
 
     return dist_eval_type(pimpl);
   }
 
+  /// Write the structure of this expression
+
+  /// \param os The output stream
+  void cache_key(std::ostream& os) const {
+    ExprEngine_::cache_key(os);
+    os << "(";
+    arg_.cache_key(os);
+    os << ")";
+  }
+
   /// Expression print
 
   /// \param os The output stream
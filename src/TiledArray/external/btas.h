@@ -418,6 +418,29 @@ inline btas::Tensor<T, Range, Storage> neg(
   return arg_view.neg(perm);
 }
 
+template <typename T, typename Range, typename Storage, typename Op>
+inline btas::Tensor<T, Range, Storage> unary(
+    const btas::Tensor<T, Range, Storage>& arg, Op&& op) {
+  auto arg_view = make_ti(arg);
+  return arg_view.unary(std::forward<Op>(op));
+}
+
+template <typename T, typename Range, typename Storage, typename Op>
+inline btas::Tensor<T, Range, Storage> unary(
+    const btas::Tensor<T, Range, Storage>& arg, Op&& op,
+    const TiledArray::Permutation& perm) {
+  auto arg_view = make_ti(arg);
+  return arg_view.unary(std::forward<Op>(op), perm);
+}
+
+template <typename T, typename Range, typename Storage, typename Op>
+inline btas::Tensor<T, Range, Storage>& inplace_unary(
+    btas::Tensor<T, Range, Storage>& result, Op&& op) {
+  auto result_view = make_ti(result);
+  result_view.inplace_unary(std::forward<Op>(op));
+  return result;
+}
+
 template <typename T, typename Range, typename Storage>
 inline btas::Tensor<T, Range, Storage> conj(
     const btas::Tensor<T, Range, Storage>& arg) {
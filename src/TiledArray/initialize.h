@@ -8,6 +8,11 @@
 #include <TiledArray/config.h>
 
 #include <TiledArray/external/madness.h>
+#include <TiledArray/util/metrics.h>
+#include <TiledArray/util/timeline.h>
+
+#include <iostream>
+#include <sstream>
 #ifdef TILEDARRAY_HAS_CUDA
 #include <TiledArray/external/cuda.h>
 #include <TiledArray/math/cublas.h>
@@ -121,6 +126,18 @@ inline void finalize() {
 #endif
   TiledArray::get_default_world()
       .gop.fence();  // TODO remove when madness::finalize() fences
+  // Write the timeline requested by the TA_TIMELINE environment variable
+  if (!detail::timeline().prefix.empty())
+    TiledArray::write_timeline(TiledArray::get_default_world(),
+                               detail::timeline().prefix);
+  // Report the metrics requested by the TA_METRICS environment variable
+  if (detail::metrics().report) {
+    std::stringstream ss;
+    ss << "TiledArray metrics: rank=" << TiledArray::get_default_world().rank()
+       << "\n"
+       << metrics_snapshot();
+    std::cout << ss.str();
+  }
   if (detail::initialized_madworld()) {
     madness::finalize();
   }
@@ -0,0 +1,614 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  low_rank_tile.h
+ *  Nov 28, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_LOW_RANK_TILE_H__INCLUDED
+#define TILEDARRAY_LOW_RANK_TILE_H__INCLUDED
+
+#include <TiledArray/math/eigen.h>
+#include <TiledArray/math/gemm_helper.h>
+#include <TiledArray/permutation.h>
+#include <TiledArray/tensor.h>
+
+#include <Eigen/QR>
+#include <Eigen/SVD>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace TiledArray {
+
+/// Low-rank matrix tile
+
+/// A matrix tile \f$ A \f$ stored as the product of two factors,
+/// \f$ A = U V^T \f$, where \f$ U \f$ and \f$ V \f$ have \c rank() columns.
+/// The tile implements the intrusive tile interface (see
+/// \c tile_op/tile_interface.h ) on the factors, so blocks of numerically
+/// low rank take \f$ O((m + n) r) \f$ memory, contractions take
+/// \f$ O((m + n) r^2) \f$ operations, and sums are recompressed to the
+/// smallest rank that represents them within \c threshold() in the
+/// Frobenius norm. Like \c Tensor , it is a shallow copy object.
+/// \tparam T The element type
+/// \note Only tiles of rank-2 ranges (matrices) are supported.
+template <typename T>
+class LowRankTile {
+ public:
+  typedef LowRankTile<T> LowRankTile_;  ///< This class type
+  typedef Range range_type;             ///< Tile range type
+  typedef T value_type;                 ///< Element type
+  typedef typename detail::numeric_type<T>::type
+      numeric_type;  ///< The scalar type that is compatible with value_type
+  typedef typename detail::scalar_type<T>::type
+      scalar_type;                       ///< The real scalar type
+  typedef std::size_t size_type;         ///< Size type
+  typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+      matrix_type;  ///< Factor matrix type
+
+ private:
+  /// Tile data
+  struct Impl {
+    range_type range;  ///< The tile range
+    matrix_type u;     ///< The left factor
+    matrix_type v;     ///< The right factor
+  };  // struct Impl
+
+  std::shared_ptr<Impl> pimpl_;       ///< Tile data
+  static scalar_type threshold_;      ///< The truncation threshold
+
+  /// Truncated rank
+
+  /// \param sigma The singular values, in decreasing order
+  /// \param threshold The truncation threshold
+  /// \return The smallest number of leading singular values such that the
+  /// norm of the remaining ones does not exceed \c threshold
+  template <typename Vector>
+  static Eigen::Index truncated_rank(const Vector& sigma,
+                                     const scalar_type threshold) {
+    const scalar_type max_tail = threshold * threshold;
+    scalar_type tail = 0;
+    Eigen::Index k = sigma.size();
+    while (k > 0 && tail + sigma[k - 1] * sigma[k - 1] <= max_tail) {
+      tail += sigma[k - 1] * sigma[k - 1];
+      --k;
+    }
+    return k;
+  }
+
+  /// Recompress a pair of factors
+
+  /// The factors are orthogonalized with QR decompositions, and the product
+  /// of the triangular factors is truncated with an SVD, so the rank of the
+  /// factors is reduced to the numerical rank of their product.
+  /// \param[in,out] u The left factor
+  /// \param[in,out] v The right factor
+  /// \param threshold The truncation threshold
+  static void recompress(matrix_type& u, matrix_type& v,
+                         const scalar_type threshold) {
+    const Eigen::Index r = u.cols();
+    if (r == 0) return;
+    const Eigen::Index m = u.rows(), n = v.rows();
+    const Eigen::Index ru = std::min(m, r), rv = std::min(n, r);
+
+    Eigen::HouseholderQR<matrix_type> qr_u(u), qr_v(v);
+    const matrix_type r_u =
+        qr_u.matrixQR().topRows(ru).template triangularView<Eigen::Upper>();
+    const matrix_type r_v =
+        qr_v.matrixQR().topRows(rv).template triangularView<Eigen::Upper>();
+
+    Eigen::BDCSVD<matrix_type> svd(r_u * r_v.transpose(),
+                                   Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const Eigen::Index k = truncated_rank(svd.singularValues(), threshold);
+
+    const matrix_type q_u = qr_u.householderQ() * matrix_type::Identity(m, ru);
+    const matrix_type q_v = qr_v.householderQ() * matrix_type::Identity(n, rv);
+    u = q_u * svd.matrixU().leftCols(k) *
+        svd.singularValues().head(k).template cast<T>().asDiagonal();
+    v = q_v * svd.matrixV().leftCols(k).conjugate();
+  }
+
+  /// Construct a tile from factors without checks
+  LowRankTile(const range_type& range, matrix_type&& u, matrix_type&& v,
+              std::nullptr_t)
+      : pimpl_(std::make_shared<Impl>()) {
+    pimpl_->range = range;
+    pimpl_->u = std::move(u);
+    pimpl_->v = std::move(v);
+  }
+
+  /// Factors of the transpose or adjoint, as selected by \c op
+  static std::pair<matrix_type, matrix_type> factors(
+      const LowRankTile_& tile, const madness::cblas::CBLAS_TRANSPOSE op) {
+    switch (op) {
+      case madness::cblas::NoTrans:
+        return {tile.u(), tile.v()};
+      case madness::cblas::Trans:
+        return {tile.v(), tile.u()};
+      default:
+        return {tile.v().conjugate(), tile.u().conjugate()};
+    }
+  }
+
+ public:
+  /// Default constructor
+
+  /// Constructs an empty tile.
+  LowRankTile() = default;
+  LowRankTile(const LowRankTile_&) = default;
+  LowRankTile(LowRankTile_&&) = default;
+  LowRankTile_& operator=(const LowRankTile_&) = default;
+  LowRankTile_& operator=(LowRankTile_&&) = default;
+
+  /// Construct a zero tile
+
+  /// \param range The tile range
+  explicit LowRankTile(const range_type& range)
+      : LowRankTile(range, matrix_type(range.extent(0), 0),
+                    matrix_type(range.extent(1), 0), nullptr) {
+    TA_ASSERT(range.rank() == 2u);
+  }
+
+  /// Construct a tile from its factors
+
+  /// \param range The tile range
+  /// \param u The left factor, with a row for each row of the tile
+  /// \param v The right factor, with a row for each column of the tile
+  LowRankTile(const range_type& range, matrix_type u, matrix_type v)
+      : LowRankTile(range, std::move(u), std::move(v), nullptr) {
+    TA_ASSERT(range.rank() == 2u);
+    TA_ASSERT(pimpl_->u.rows() == Eigen::Index(range.extent(0)));
+    TA_ASSERT(pimpl_->v.rows() == Eigen::Index(range.extent(1)));
+    TA_ASSERT(pimpl_->u.cols() == pimpl_->v.cols());
+  }
+
+  /// Compress a dense tile
+
+  /// The factors are computed with a truncated SVD of \c tensor .
+  /// \param tensor A matrix tile
+  /// \param threshold The truncation threshold, the largest Frobenius norm
+  /// of the difference of \c tensor and the result
+  explicit LowRankTile(const Tensor<T>& tensor,
+                       const scalar_type threshold = threshold_)
+      : LowRankTile(tensor.range()) {
+    const Eigen::Index m = tensor.range().extent(0);
+    const Eigen::Index n = tensor.range().extent(1);
+    if (m == 0 || n == 0) return;
+
+    Eigen::BDCSVD<matrix_type> svd(
+        math::eigen_map(tensor.data(), m, n),
+        Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const Eigen::Index k = truncated_rank(svd.singularValues(), threshold);
+    pimpl_->u = svd.matrixU().leftCols(k) *
+                svd.singularValues().head(k).template cast<T>().asDiagonal();
+    pimpl_->v = svd.matrixV().leftCols(k).conjugate();
+  }
+
+  /// Truncation threshold accessor
+
+  /// \return The Frobenius norm of the error below which results of sums
+  /// and compressions are truncated
+  static scalar_type threshold() { return threshold_; }
+
+  /// Set the truncation threshold
+
+  /// \param threshold The new threshold
+  static void threshold(const scalar_type threshold) {
+    TA_ASSERT(threshold >= scalar_type(0));
+    threshold_ = threshold;
+  }
+
+  /// Initialization check
+
+  /// \return \c true if this tile has no data
+  bool empty() const { return !pimpl_; }
+
+  /// Range accessor
+
+  /// \return A const reference to the tile range
+  const range_type& range() const {
+    TA_ASSERT(pimpl_);
+    return pimpl_->range;
+  }
+
+  /// \return The number of elements of the tile
+  size_type size() const { return range().volume(); }
+
+  /// \return The number of columns of the factors
+  size_type rank() const {
+    TA_ASSERT(pimpl_);
+    return pimpl_->u.cols();
+  }
+
+  /// \return The left factor
+  const matrix_type& u() const {
+    TA_ASSERT(pimpl_);
+    return pimpl_->u;
+  }
+
+  /// \return The right factor
+  const matrix_type& v() const {
+    TA_ASSERT(pimpl_);
+    return pimpl_->v;
+  }
+
+  /// \return A deep copy of this tile
+  LowRankTile_ clone() const {
+    LowRankTile_ result;
+    if (pimpl_) result.pimpl_ = std::make_shared<Impl>(*pimpl_);
+    return result;
+  }
+
+  /// Convert to a dense tile
+
+  /// \return A tensor with the elements of this tile
+  explicit operator Tensor<T>() const {
+    Tensor<T> result(range());
+    if (result.size())
+      math::eigen_map(result.data(), range().extent(0), range().extent(1)) =
+          pimpl_->u * pimpl_->v.transpose();
+    return result;
+  }
+
+  /// Recompress this tile
+
+  /// \param threshold The truncation threshold
+  /// \return A reference to this tile
+  LowRankTile_& truncate(const scalar_type threshold = threshold_) {
+    TA_ASSERT(pimpl_);
+    recompress(pimpl_->u, pimpl_->v, threshold);
+    return *this;
+  }
+
+  // Permutation operations -------------------------------------------------
+
+  /// \param perm The permutation
+  /// \return A copy of this tile permuted by \c perm
+  LowRankTile_ permute(const Permutation& perm) const {
+    TA_ASSERT(perm.dim() == 2u);
+    if (perm[0] == 0u)
+      return LowRankTile_(perm * range(), matrix_type(u()), matrix_type(v()),
+                          nullptr);
+    return LowRankTile_(perm * range(), matrix_type(v()), matrix_type(u()),
+                        nullptr);
+  }
+
+  // Scaling operations -----------------------------------------------------
+
+  /// \param factor The scaling factor
+  /// \return A copy of this tile scaled by \c factor
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_ scale(const Scalar factor) const {
+    return LowRankTile_(range(), u() * numeric_type(factor), matrix_type(v()),
+                        nullptr);
+  }
+
+  /// \param factor The scaling factor
+  /// \param perm The permutation
+  /// \return A copy of this tile scaled by \c factor and permuted by \c perm
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_ scale(const Scalar factor, const Permutation& perm) const {
+    return scale(factor).permute(perm);
+  }
+
+  /// \param factor The scaling factor
+  /// \return A reference to this tile, scaled by \c factor
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_& scale_to(const Scalar factor) {
+    TA_ASSERT(pimpl_);
+    pimpl_->u *= numeric_type(factor);
+    return *this;
+  }
+
+  /// \return A negated copy of this tile
+  LowRankTile_ neg() const { return scale(-1); }
+
+  /// \param perm The permutation
+  /// \return A negated copy of this tile permuted by \c perm
+  LowRankTile_ neg(const Permutation& perm) const { return scale(-1, perm); }
+
+  /// \return A reference to this tile, negated
+  LowRankTile_& neg_to() { return scale_to(-1); }
+
+  // Addition operations ----------------------------------------------------
+
+  /// \param right The right-hand tile
+  /// \param factor The scaling factor
+  /// \return <tt>(*this + right) * factor</tt>, recompressed
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_ add(const LowRankTile_& right, const Scalar factor) const {
+    return clone().add_to(right, factor);
+  }
+
+  /// \param right The right-hand tile
+  /// \return <tt>*this + right</tt>, recompressed
+  LowRankTile_ add(const LowRankTile_& right) const { return add(right, 1); }
+
+  /// \param right The right-hand tile
+  /// \param perm The permutation
+  /// \return <tt>perm ^ (*this + right)</tt>, recompressed
+  LowRankTile_ add(const LowRankTile_& right, const Permutation& perm) const {
+    return add(right).permute(perm);
+  }
+
+  /// \param right The right-hand tile
+  /// \param factor The scaling factor
+  /// \param perm The permutation
+  /// \return <tt>perm ^ ((*this + right) * factor)</tt>, recompressed
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_ add(const LowRankTile_& right, const Scalar factor,
+                   const Permutation& perm) const {
+    return add(right, factor).permute(perm);
+  }
+
+  /// Add a tile to this tile
+
+  /// The factors of \c right are appended to the factors of this tile, and
+  /// the result is recompressed.
+  /// \param right The right-hand tile
+  /// \param factor The scaling factor
+  /// \return A reference to this tile, equal to
+  /// <tt>(*this + right) * factor</tt>
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_& add_to(const LowRankTile_& right, const Scalar factor) {
+    TA_ASSERT(pimpl_);
+    TA_ASSERT(!right.empty());
+    TA_ASSERT(range().extent() == right.range().extent());
+    append(right.u(), right.v(), numeric_type(1));
+    if (factor != Scalar(1)) pimpl_->u *= numeric_type(factor);
+    return truncate();
+  }
+
+  /// \param right The right-hand tile
+  /// \return A reference to this tile, equal to <tt>*this + right</tt>
+  LowRankTile_& add_to(const LowRankTile_& right) { return add_to(right, 1); }
+
+  // Subtraction operations -------------------------------------------------
+
+  /// \param right The right-hand tile
+  /// \param factor The scaling factor
+  /// \return <tt>(*this - right) * factor</tt>, recompressed
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_ subt(const LowRankTile_& right, const Scalar factor) const {
+    return clone().subt_to(right, factor);
+  }
+
+  /// \param right The right-hand tile
+  /// \return <tt>*this - right</tt>, recompressed
+  LowRankTile_ subt(const LowRankTile_& right) const { return subt(right, 1); }
+
+  /// \param right The right-hand tile
+  /// \param perm The permutation
+  /// \return <tt>perm ^ (*this - right)</tt>, recompressed
+  LowRankTile_ subt(const LowRankTile_& right, const Permutation& perm) const {
+    return subt(right).permute(perm);
+  }
+
+  /// \param right The right-hand tile
+  /// \param factor The scaling factor
+  /// \param perm The permutation
+  /// \return <tt>perm ^ ((*this - right) * factor)</tt>, recompressed
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_ subt(const LowRankTile_& right, const Scalar factor,
+                    const Permutation& perm) const {
+    return subt(right, factor).permute(perm);
+  }
+
+  /// \param right The right-hand tile
+  /// \param factor The scaling factor
+  /// \return A reference to this tile, equal to
+  /// <tt>(*this - right) * factor</tt>
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_& subt_to(const LowRankTile_& right, const Scalar factor) {
+    TA_ASSERT(pimpl_);
+    TA_ASSERT(!right.empty());
+    TA_ASSERT(range().extent() == right.range().extent());
+    append(right.u(), right.v(), numeric_type(-1));
+    if (factor != Scalar(1)) pimpl_->u *= numeric_type(factor);
+    return truncate();
+  }
+
+  /// \param right The right-hand tile
+  /// \return A reference to this tile, equal to <tt>*this - right</tt>
+  LowRankTile_& subt_to(const LowRankTile_& right) {
+    return subt_to(right, 1);
+  }
+
+  // Contraction operations -------------------------------------------------
+
+  /// Contract this tile with another tile
+
+  /// The product of the factors is formed through the small inner product
+  /// of the inner factors, so the rank of the result is the smaller of the
+  /// argument ranks.
+  /// \param right The right-hand tile
+  /// \param factor The scaling factor
+  /// \param gemm_helper The contraction description
+  /// \return <tt>op(*this) * op(right) * factor</tt>
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_ gemm(const LowRankTile_& right, const Scalar factor,
+                    const math::GemmHelper& gemm_helper) const {
+    TA_ASSERT(gemm_helper.result_rank() == 2u);
+    TA_ASSERT(gemm_helper.num_contract_ranks() == 1u);
+    TA_ASSERT(gemm_helper.left_right_congruent(range().extent_data(),
+                                               right.range().extent_data()));
+
+    const auto left_factors = factors(*this, gemm_helper.left_op());
+    const auto right_factors = factors(right, gemm_helper.right_op());
+
+    // op(left) * op(right) = ul * (vl^T * ur) * vr^T
+    const matrix_type inner =
+        left_factors.second.transpose() * right_factors.first;
+    matrix_type u, v;
+    if (inner.rows() <= inner.cols()) {
+      u = left_factors.first * numeric_type(factor);
+      v = right_factors.second * inner.transpose();
+    } else {
+      u = left_factors.first * inner * numeric_type(factor);
+      v = right_factors.second;
+    }
+
+    return LowRankTile_(
+        gemm_helper.make_result_range<range_type>(range(), right.range()),
+        std::move(u), std::move(v), nullptr);
+  }
+
+  /// Contract two tiles and add the result to this tile
+
+  /// \param left The left-hand tile
+  /// \param right The right-hand tile
+  /// \param factor The scaling factor
+  /// \param gemm_helper The contraction description
+  /// \return A reference to this tile, equal to
+  /// <tt>*this + op(left) * op(right) * factor</tt>, recompressed
+  template <typename Scalar, typename std::enable_if<
+                                 detail::is_numeric_v<Scalar>>::type* = nullptr>
+  LowRankTile_& gemm(const LowRankTile_& left, const LowRankTile_& right,
+                     const Scalar factor,
+                     const math::GemmHelper& gemm_helper) {
+    TA_ASSERT(pimpl_);
+    const LowRankTile_ product = left.gemm(right, factor, gemm_helper);
+    TA_ASSERT(range().extent() == product.range().extent());
+    append(product.u(), product.v(), numeric_type(1));
+    return truncate();
+  }
+
+  // Reduction operations ---------------------------------------------------
+
+  /// \return The sum of the diagonal elements
+  numeric_type trace() const {
+    const Eigen::Index k = std::min(u().rows(), v().rows());
+    return u().topRows(k).cwiseProduct(v().topRows(k)).sum();
+  }
+
+  /// \return The sum of the elements
+  numeric_type sum() const {
+    return u().colwise().sum().cwiseProduct(v().colwise().sum()).sum();
+  }
+
+  /// \return The square of the Frobenius norm
+  scalar_type squared_norm() const {
+    // ||u v^T||^2 = sum_ij (u^H u)_ij (v^H v)_ij
+    return std::real(
+        (u().adjoint() * u()).cwiseProduct(v().adjoint() * v()).sum());
+  }
+
+  /// \return The Frobenius norm
+  scalar_type norm() const {
+    return std::sqrt(std::max(squared_norm(), scalar_type(0)));
+  }
+
+  // Serialization ----------------------------------------------------------
+
+  /// Serialize the tile
+
+  /// \tparam Archive The output archive type
+  /// \param ar The archive
+  template <typename Archive,
+            typename std::enable_if<madness::archive::is_output_archive<
+                Archive>::value>::type* = nullptr>
+  void serialize(Archive& ar) {
+    ar & bool(pimpl_);
+    if (pimpl_) {
+      ar & pimpl_->range & std::size_t(pimpl_->u.cols());
+      ar & madness::archive::wrap(pimpl_->u.data(), pimpl_->u.size());
+      ar & madness::archive::wrap(pimpl_->v.data(), pimpl_->v.size());
+    }
+  }
+
+  /// Deserialize the tile
+
+  /// \tparam Archive The input archive type
+  /// \param ar The archive
+  template <typename Archive,
+            typename std::enable_if<madness::archive::is_input_archive<
+                Archive>::value>::type* = nullptr>
+  void serialize(Archive& ar) {
+    bool have_data = false;
+    ar & have_data;
+    if (have_data) {
+      range_type range;
+      std::size_t rank = 0ul;
+      ar & range & rank;
+      matrix_type u(range.extent(0), rank), v(range.extent(1), rank);
+      ar & madness::archive::wrap(u.data(), u.size());
+      ar & madness::archive::wrap(v.data(), v.size());
+      *this = LowRankTile_(range, std::move(u), std::move(v), nullptr);
+    } else {
+      pimpl_.reset();
+    }
+  }
+
+ private:
+  /// Append factors to the factors of this tile
+  void append(const matrix_type& u, const matrix_type& v,
+              const numeric_type factor) {
+    const Eigen::Index r = pimpl_->u.cols();
+    pimpl_->u.conservativeResize(Eigen::NoChange, r + u.cols());
+    pimpl_->v.conservativeResize(Eigen::NoChange, r + v.cols());
+    pimpl_->u.rightCols(u.cols()) = u * factor;
+    pimpl_->v.rightCols(v.cols()) = v;
+  }
+
+};  // class LowRankTile
+
+template <typename T>
+typename LowRankTile<T>::scalar_type LowRankTile<T>::threshold_ =
+    std::sqrt(std::numeric_limits<typename LowRankTile<T>::scalar_type>::epsilon());
+
+/// Size of the factors of a low-rank tile
+
+/// \tparam T The element type
+/// \param tile The tile
+/// \return The number of bytes of the factors of \c tile
+template <typename T>
+inline std::size_t memory_bytes(const LowRankTile<T>& tile) {
+  if (tile.empty()) return 0ul;
+  return std::size_t(tile.u().size() + tile.v().size()) * sizeof(T);
+}
+
+/// Low-rank tile output operator
+
+/// \tparam T The element type
+/// \param os The output stream
+/// \param tile The tile
+/// \return A reference to the output stream
+template <typename T>
+inline std::ostream& operator<<(std::ostream& os, const LowRankTile<T>& tile) {
+  if (tile.empty())
+    os << "LowRankTile: empty";
+  else
+    os << "LowRankTile: range=" << tile.range() << " rank=" << tile.rank();
+  return os;
+}
+
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_LOW_RANK_TILE_H__INCLUDED
@@ -92,6 +92,17 @@ class BlockedPmap : public Pmap {
     return ((tile >= local_first_) && (tile < local_last_));
   }
 
+  virtual bool known_local_ordinal() const { return true; }
+
+  /// Maps a local tile to its position among the local tiles
+
+  /// \param tile A local tile
+  /// \return The position of \c tile in this process's block
+  virtual size_type local_ordinal(const size_type tile) const {
+    TA_ASSERT(is_local(tile));
+    return tile - local_first_;
+  }
+
   virtual const_iterator begin() const {
     return Iterator(*this, local_first_, local_last_, local_first_, false);
   }
@@ -148,6 +148,20 @@ class CyclicPmap : public Pmap {
     return (CyclicPmap::owner(tile) == rank_);
   }
 
+  virtual bool known_local_ordinal() const { return true; }
+
+  /// Maps a local tile to its position among the local tiles
+
+  /// Local tiles are numbered in row-major order of the local tile matrix.
+  /// \param tile A local tile
+  /// \return The position of \c tile among the local tiles
+  virtual size_type local_ordinal(const size_type tile) const {
+    TA_ASSERT(CyclicPmap::is_local(tile));
+    const size_type local_row = (tile / cols_) / proc_rows_;
+    const size_type local_col = (tile % cols_) / proc_cols_;
+    return local_row * local_cols_ + local_col;
+  }
+
  private:
   virtual void advance(size_type& value, bool increment) const {
     if (increment) {
@@ -126,6 +126,23 @@ class Pmap {
     return local_size_ == 0;
   }
 
+  /// Queries whether local elements have a local ordinal
+
+  /// \return true if \c local_ordinal() maps local elements onto
+  /// \c [0,local_size())
+  /// \note Override if the local ordinal can be computed in O(1)
+  virtual bool known_local_ordinal() const { return false; }
+
+  /// Maps a local element to its position among the local elements
+
+  /// \param tile A local tile
+  /// \return The position of \c tile in the range \c [0,local_size())
+  /// \warning asserts that \c known_local_ordinal()==true
+  virtual size_type local_ordinal(const size_type tile) const {
+    TA_ASSERT(known_local_ordinal());
+    return tile;
+  }
+
   /// Replicated array status
 
   /// \return \c true if the array is replicated, and false otherwise
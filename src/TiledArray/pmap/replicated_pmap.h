@@ -77,6 +77,17 @@ class ReplicatedPmap : public Pmap {
   /// \return \c true if the array is replicated, and false otherwise
   virtual bool is_replicated() const { return true; }
 
+  virtual bool known_local_ordinal() const { return true; }
+
+  /// Maps a local tile to its position among the local tiles
+
+  /// \param tile A tile
+  /// \return \c tile , since all tiles are local
+  virtual size_type local_ordinal(const size_type tile) const {
+    TA_ASSERT(tile < size_);
+    return tile;
+  }
+
   virtual const_iterator begin() const {
     return Iterator(*this, 0, this->size_, 0, false);
   }
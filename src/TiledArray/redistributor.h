@@ -0,0 +1,283 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  redistributor.h
+ *  Nov 12, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_REDISTRIBUTOR_H__INCLUDED
+#define TILEDARRAY_REDISTRIBUTOR_H__INCLUDED
+
+#include <TiledArray/external/madness.h>
+#include <TiledArray/pmap/pmap.h>
+#include <TiledArray/type_traits.h>
+
+namespace TiledArray {
+namespace detail {
+
+/// Tile redistribution plan
+
+/// Lists, for each destination process, the local source tiles that must be
+/// shipped to it when an array is moved from one process map to another.
+/// Because process maps are deterministic the plan is computed locally on
+/// every process, without communication.
+class RedistributionPlan {
+ public:
+  typedef std::size_t size_type;  ///< Size type
+
+ private:
+  std::vector<std::vector<size_type> >
+      send_;                    ///< Tiles to send, grouped by destination
+  std::vector<size_type> keep_;  ///< Tiles that stay on this process
+
+ public:
+  RedistributionPlan() = default;
+
+  /// Compute the plan for the local tiles of an array
+
+  /// \tparam A The array type
+  /// \param source The array to be redistributed
+  /// \param pmap The destination process map
+  template <typename A>
+  RedistributionPlan(const A& source, const Pmap& pmap)
+      : send_(pmap.procs()), keep_() {
+    TA_ASSERT(source.pmap()->size() == pmap.size());
+    for (auto index : *source.pmap()) {
+      if (source.is_zero(index)) continue;
+      const auto dest = pmap.owner(index);
+      if (dest == pmap.rank())
+        keep_.push_back(index);
+      else
+        send_[dest].push_back(index);
+    }
+  }
+
+  /// Local tiles that must be sent to \c dest
+
+  /// \param dest The destination process
+  /// \return The ordinal indices of the tiles that will be sent to \c dest
+  const std::vector<size_type>& send(const ProcessID dest) const {
+    TA_ASSERT(std::size_t(dest) < send_.size());
+    return send_[dest];
+  }
+
+  /// Local tiles that do not move
+
+  /// \return The ordinal indices of the tiles that remain on this process
+  const std::vector<size_type>& keep() const { return keep_; }
+
+  /// Number of local tiles that leave this process
+
+  /// \return The total number of tiles sent by this process
+  size_type send_count() const {
+    size_type result = 0ul;
+    for (const auto& indices : send_) result += indices.size();
+    return result;
+  }
+
+};  // class RedistributionPlan
+
+/// Move the tiles of an \c Array object to a different process map
+
+/// Tiles that change owner are shipped in batches, one active message per
+/// batch, instead of one active message per tile. Each batch holds tiles
+/// for a single destination, and is closed when it reaches
+/// \c max_batch_bytes or holds the last tile for its destination. A
+/// destination has at most one batch in flight: the next batch is gathered
+/// only after the previous one has been delivered. Hence the send buffers
+/// of a process hold at most \c max_batch_bytes (plus the size of one tile)
+/// per destination, not per process.
+/// \tparam A The array type
+template <typename A>
+class Redistributor : public madness::WorldObject<Redistributor<A> > {
+ public:
+  typedef Redistributor<A> Redistributor_;  ///< This object type
+  typedef madness::WorldObject<Redistributor_>
+      wobj_type;                              ///< The base object type
+  typedef typename A::size_type size_type;    ///< Size type
+  typedef typename A::value_type value_type;  ///< Tile type
+  typedef std::vector<size_type> index_vector;  ///< Tile index list type
+  typedef std::vector<Future<value_type> > tile_vector;  ///< Tile list type
+
+ private:
+  A source_;                 ///< The array to be redistributed
+  A destination_;            ///< The redistributed array
+  RedistributionPlan plan_;  ///< The local redistribution plan
+  std::vector<std::size_t> next_;  ///< The next tile to send, by destination
+  World& world_;
+  std::size_t max_batch_bytes_;  ///< Batch size threshold
+  madness::AtomicInt batches_;   ///< The number of batches sent
+  madness::AtomicInt tiles_;     ///< The number of tiles sent
+
+  /// Task that sends a batch when all of its tiles are ready
+  class BatchSend : public madness::TaskInterface {
+   private:
+    Redistributor_& parent_;  ///< The parent redistribution operation
+    const ProcessID dest_;    ///< The destination process
+    index_vector indices_;    ///< The ordinal indices of the tiles
+    tile_vector tiles_;       ///< The tiles to be sent
+
+   public:
+    /// Constructor
+    BatchSend(Redistributor_& parent, const ProcessID dest,
+              index_vector&& indices, tile_vector&& tiles)
+        : madness::TaskInterface(madness::TaskAttributes::hipri()),
+          parent_(parent),
+          dest_(dest),
+          indices_(std::move(indices)),
+          tiles_(std::move(tiles)) {
+      for (auto& tile : tiles_) {
+        if (!tile.probe()) {
+          madness::DependencyInterface::inc();
+          tile.register_callback(this);
+        }
+      }
+    }
+
+    /// Virtual destructor
+    virtual ~BatchSend() {}
+
+    /// Task send task function
+    virtual void run(const madness::TaskThreadEnv&) {
+      parent_.send(dest_, indices_, tiles_);
+    }
+
+  };  // class BatchSend
+
+  /// Callback that gathers the next batch when a batch has been delivered
+  class BatchSent : public madness::CallbackInterface {
+   private:
+    Redistributor_& parent_;  ///< The parent redistribution operation
+    const ProcessID dest_;    ///< The destination process
+
+   public:
+    BatchSent(Redistributor_& parent, const ProcessID dest)
+        : parent_(parent), dest_(dest) {}
+
+    virtual void notify() {
+      parent_.next(dest_);
+      delete this;
+    }
+
+  };  // class BatchSent
+
+  /// Estimated size of a tile in bytes
+
+  /// \param index The ordinal index of the tile
+  /// \return The number of bytes needed to hold the tile elements
+  std::size_t tile_bytes(const size_type index) const {
+    return destination_.trange().make_tile_range(index).volume() *
+           sizeof(typename numeric_type<value_type>::type);
+  }
+
+  /// Gather the next batch of tiles for \c dest and schedule its send
+
+  /// Only one batch per destination is in flight, so this is called for the
+  /// first batch and then when the previous batch has been delivered.
+  /// \param dest The destination process
+  void next(const ProcessID dest) {
+    const index_vector& send = plan_.send(dest);
+    std::size_t& first = next_[dest];
+    if (first == send.size()) return;
+
+    index_vector indices;
+    tile_vector tiles;
+    std::size_t bytes = 0ul;
+    do {
+      const size_type index = send[first++];
+      indices.push_back(index);
+      tiles.push_back(source_.find(index));
+      bytes += tile_bytes(index);
+    } while (first < send.size() && bytes < max_batch_bytes_);
+    world_.taskq.add(
+        new BatchSend(*this, dest, std::move(indices), std::move(tiles)));
+  }
+
+  /// Send a batch to \c dest
+  void send(const ProcessID dest, const index_vector& indices,
+            const tile_vector& tiles) {
+    ++batches_;
+    tiles_ += indices.size();
+    Future<void> done =
+        wobj_type::task(dest, &Redistributor_::send_handler, indices, tiles,
+                        madness::TaskAttributes::hipri());
+    done.register_callback(new BatchSent(*this, dest));
+  }
+
+  void send_handler(const index_vector& indices, const tile_vector& tiles) {
+    TA_ASSERT(indices.size() == tiles.size());
+    auto tile_it = tiles.begin();
+    for (auto index : indices) destination_.set(index, (tile_it++)->get());
+  }
+
+ public:
+  /// Constructor
+
+  /// Starts the redistribution of \c source into \c destination . The
+  /// operation is complete after the next fence.
+  /// \param source The array to be redistributed
+  /// \param destination An empty array with the same tiled range and shape
+  /// as \c source , and the target process map
+  /// \param max_batch_bytes The number of bytes of tile data that triggers
+  /// the send of a batch
+  Redistributor(const A& source, const A& destination,
+                const std::size_t max_batch_bytes)
+      : wobj_type(source.world()),
+        source_(source),
+        destination_(destination),
+        plan_(source, *destination.pmap()),
+        next_(source.world().size(), 0ul),
+        world_(source.world()),
+        max_batch_bytes_(max_batch_bytes),
+        batches_(),
+        tiles_() {
+    batches_ = 0;
+    tiles_ = 0;
+
+    // Tiles that do not move are forwarded without communication
+    for (auto index : plan_.keep()) destination_.set(index, source.find(index));
+
+    // Start the first batch of every destination; the others follow as the
+    // previous batches are delivered
+    for (ProcessID dest = 0; dest < world_.size(); ++dest) next(dest);
+
+    // Process any pending messages
+    wobj_type::process_pending();
+  }
+
+  /// Redistribution plan accessor
+
+  /// \return The plan used to ship the local tiles
+  const RedistributionPlan& plan() const { return plan_; }
+
+  /// Number of batches sent by this process
+
+  /// \return The number of active messages sent so far
+  std::size_t batches() const { return batches_; }
+
+  /// Number of tiles sent by this process
+
+  /// \return The number of tiles sent so far
+  std::size_t tiles() const { return tiles_; }
+
+};  // class Redistributor
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_REDISTRIBUTOR_H__INCLUDED
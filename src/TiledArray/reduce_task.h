@@ -23,6 +23,8 @@
 #include <TiledArray/config.h>
 #include <TiledArray/error.h>
 #include <TiledArray/external/madness.h>
+#include <TiledArray/util/memory.h>
+#include <TiledArray/util/timeline.h>
 
 #ifdef TILEDARRAY_HAS_CUDA
 #include <TiledArray/cuda/cuda_task_fn.h>
@@ -430,6 +432,44 @@ class ReduceTask {
       return PoolTaskInterface::make_id(id, *this);
     }
 
+    /// Record a change of the memory of the partial results
+
+    /// \param bytes The number of allocated bytes, negative if freed
+    void record_memory(const std::int64_t bytes) {
+      memory_->add(MemoryCategory::reduction, bytes);
+    }
+
+    /// Construct an empty partial result
+
+    /// The memory of the result is accounted until it is destroyed, or
+    /// until this task is destroyed, whichever comes first.
+    /// \return A pointer to the new result object
+    std::shared_ptr<result_type> make_result() {
+      std::shared_ptr<MemoryCounters> memory = memory_;
+      std::shared_ptr<result_type> result(
+          new result_type(op_()), [memory](result_type* const p) {
+            memory->add(MemoryCategory::reduction,
+                        -std::int64_t(memory_bytes(*p)));
+            delete p;
+          });
+      record_memory(std::int64_t(memory_bytes(*result)));
+      return result;
+    }
+
+    /// Reduce an argument into a partial result
+
+    /// \tparam Arg The argument type
+    /// \param result The partial result
+    /// \param arg The argument to be reduced
+    template <typename Arg>
+    void reduce_into(result_type& result, const Arg& arg) {
+      TimelineScope scope(TimelineCategory::reduce, "reduce", timeline_node_,
+                          timeline_index_);
+      const std::int64_t bytes = memory_bytes(result);
+      op_(result, arg);
+      record_memory(std::int64_t(memory_bytes(result)) - bytes);
+    }
+
     /// Check for ready reduce arguments and reduce them
 
     /// This function will check for and reduce data that is ready until
@@ -448,7 +488,7 @@ class ReduceTask {
           lock_.unlock();  // <<< End critical section
 
           // Reduce the argument that was held by ready_object_
-          op_(*result, ready_object->arg());
+          reduce_into(*result, ready_object->arg());
 
           // cleanup the argument
 #ifdef TILEDARRAY_HAS_CUDA
@@ -483,7 +523,7 @@ class ReduceTask {
           lock_.unlock();  // <<< End critical section
 
           // Reduce the result that was held by ready_result_
-          op_(*result, *ready_result);
+          reduce_into(*result, *ready_result);
 
           // cleanup the result
 #ifdef TILEDARRAY_HAS_CUDA
@@ -523,7 +563,7 @@ class ReduceTask {
     void reduce_result_object(std::shared_ptr<result_type> result,
                               const ReduceObject* object) {
       // Reduce the argument
-      op_(*result, object->arg());
+      reduce_into(*result, object->arg());
 
       // Cleanup the argument
 #ifdef TILEDARRAY_HAS_CUDA
@@ -570,11 +610,11 @@ class ReduceTask {
     void reduce_object_object(const ReduceObject* object1,
                               const ReduceObject* object2) {
       // Construct an empty result object
-      auto result = std::make_shared<result_type>(op_());
+      auto result = make_result();
 
       // Reduce the two arguments
-      op_(*result, object1->arg());
-      op_(*result, object2->arg());
+      reduce_into(*result, object1->arg());
+      reduce_into(*result, object2->arg());
 
       // Cleanup arguments
 #ifdef TILEDARRAY_HAS_CUDA
@@ -653,6 +693,8 @@ class ReduceTask {
 
     World& world_;  ///< The world that owns this task
     opT op_;        ///< The reduction operation
+    std::shared_ptr<MemoryCounters>
+        memory_;  ///< Memory of the partial results
     std::shared_ptr<result_type>
         ready_result_;  ///< Result object that is ready to be reduced
     volatile ReduceObject*
@@ -660,6 +702,8 @@ class ReduceTask {
     Future<result_type> result_;  ///< The result of the reduction task
     madness::Spinlock lock_;      ///< Task lock
     madness::CallbackInterface* callback_;  ///< The completion callback
+    std::uint64_t timeline_node_ = 0ul;  ///< Expression node of the events
+    std::int64_t timeline_index_ = -1;   ///< Tile index of the events
 
    public:
     /// Implementation constructor
@@ -672,13 +716,19 @@ class ReduceTask {
         : madness::TaskInterface(1, TaskAttributes::hipri()),
           world_(world),
           op_(op),
-          ready_result_(std::make_shared<result_type>(op())),
+          memory_(std::make_shared<MemoryCounters>(memory_counters(world))),
+          ready_result_(make_result()),
           ready_object_(nullptr),
           result_(),
           lock_(),
           callback_(callback) {}
 
-    virtual ~ReduceTaskImpl() {}
+    virtual ~ReduceTaskImpl() {
+      // Return the memory of results that were moved from while they were
+      // accounted; results that outlive this task are no longer accounted
+      ready_result_.reset();
+      memory_->release();
+    }
 
     /// Task function
     virtual void run(const madness::TaskThreadEnv& threadEnv) {
@@ -724,6 +774,15 @@ class ReduceTask {
     /// \return The world that owns this task.
     World& world() const { return world_; }
 
+    /// Set the expression node and tile of the timeline events
+
+    /// \param node The expression node id
+    /// \param index The tile index
+    void timeline_tag(const std::uint64_t node, const std::int64_t index) {
+      timeline_node_ = node;
+      timeline_index_ = index;
+    }
+
   };  // class ReduceTaskImpl
 
   ReduceTaskImpl* pimpl_;  ///< The reduction task object.
@@ -795,6 +854,19 @@ class ReduceTask {
   /// \return The total number of arguments added to this task
   int count() const { return count_; }
 
+  /// Tag the timeline events of this task
+
+  /// The reductions of this task, and the operations they invoke (e.g.
+  /// GEMMs), are recorded with \c node and \c index .
+  /// \param node The expression node id
+  /// \param index The tile index
+  /// \note This must be called before arguments are added.
+  void timeline_tag(const std::uint64_t node, const std::int64_t index) {
+    TA_ASSERT(pimpl_);
+    TA_ASSERT(count_ == 0ul);
+    pimpl_->timeline_tag(node, index);
+  }
+
   /// Submit the reduction task to the task queue
 
   /// \return The result of the reduction
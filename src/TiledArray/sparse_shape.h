@@ -485,6 +485,53 @@ class SparseShape {
     return tile_norms_[index];
   }
 
+  /// Upper bound of the numerical rank of a tile
+
+  /// The tile is viewed as a matrix whose rows span its first \c row_modes
+  /// modes. Since the squares of the singular values of a tile sum to its
+  /// squared Frobenius norm, at most <tt>norm^2 / tolerance^2</tt> singular
+  /// values exceed \c tolerance ; e.g. this bounds the rank, and the cost,
+  /// of a low-rank representation of the tile (see \c LowRankTile ).
+  /// \tparam Index The index type
+  /// \param index The index of the tile
+  /// \param tolerance The singular value below which the rank is truncated
+  /// \param row_modes The number of modes spanned by the matrix rows
+  /// \return An upper bound of the number of singular values of the tile
+  /// that exceed \c tolerance
+  template <typename Index>
+  size_type rank_bound(const Index& index, const value_type tolerance,
+                       const unsigned int row_modes = 1u) const {
+    TA_ASSERT(!tile_norms_.empty());
+    TA_ASSERT(tolerance > value_type(0));
+    const auto& range = tile_norms_.range();
+    TA_ASSERT(row_modes <= range.rank());
+    const auto& i = range.idx(index);
+
+    size_type rows = 1ul, cols = 1ul;
+    for (unsigned int d = 0u; d < range.rank(); ++d)
+      (d < row_modes ? rows : cols) *= size_type(size_vectors_.get()[d][i[d]]);
+    const size_type max_rank = std::min(rows, cols);
+
+    // Tile norms are stored per element
+    const double norm = double(tile_norms_[i]) * double(rows * cols);
+    const double bound =
+        std::floor(norm * norm / (double(tolerance) * double(tolerance)));
+    return (bound < double(max_rank) ? size_type(bound) : max_rank);
+  }
+
+  /// Size of the shape data
+
+  /// \return The number of bytes of the tile norms and tile sizes
+  std::size_t memory_bytes() const {
+    std::size_t result = tile_norms_.size() * sizeof(value_type);
+    if (tile_norms_unscaled_)
+      result += tile_norms_unscaled_->size() * sizeof(value_type);
+    if (size_vectors_)
+      for (unsigned int d = 0u; d < tile_norms_.range().rank(); ++d)
+        result += size_vectors_.get()[d].size() * sizeof(value_type);
+    return result;
+  }
+
   /// Transform the norm tensor with an operation
 
   /// \return A deep copy of the norms of the object having
@@ -1264,6 +1311,16 @@ inline std::ostream& operator<<(std::ostream& os, const SparseShape<T>& shape) {
   return os;
 }
 
+/// Size of the shape data
+
+/// \tparam T the numeric type supporting the type of \c shape
+/// \param shape the SparseShape<T> object
+/// \return The number of bytes of the tile norms and tile sizes
+template <typename T>
+inline std::size_t memory_bytes(const SparseShape<T>& shape) {
+  return shape.memory_bytes();
+}
+
 /// collective bitwise-compare-reduce for SparseShape objects
 
 /// @param world the World object
@@ -1281,6 +1338,33 @@ bool is_replicated(World& world, const SparseShape<T>& shape) {
   return true;
 }
 
+/// Lossy compression parameters tied to the screening threshold
+
+/// The elements of tensors serialized with these parameters are
+/// reconstructed with an absolute error of at most
+/// <tt>fraction * SparseShape<T>::threshold()</tt>, with the threshold at
+/// the time of the call, so the per-element norm
+/// of a tile changes by less than the threshold below which tiles are
+/// screened. Select them globally with
+/// <tt>detail::CompressionParams::default_params()</tt> (e.g. for broadcasts
+/// of contraction arguments), or for the stored tiles of an intermediate
+/// with \c DistArray::set_compression() . The error bound does not change
+/// when the threshold changes later; call this function again and select
+/// the new parameters instead.
+/// \tparam T The numeric type of the shape
+/// \param fraction The error bound, as a fraction of the threshold
+/// \return Compression parameters with an error bound of \c fraction times
+/// the current threshold
+template <typename T = float>
+detail::CompressionParams lossy_compression_params(
+    const double fraction = 0.5) {
+  TA_ASSERT(fraction > 0.0);
+  detail::CompressionParams result;
+  result.enabled = true;
+  result.abs_error = fraction * double(SparseShape<T>::threshold());
+  return result;
+}
+
 #ifndef TILEDARRAY_HEADER_ONLY
 
 extern template class SparseShape<float>;
@@ -24,7 +24,9 @@
 #include <TiledArray/math/gemm_helper.h>
 #include <TiledArray/tensor/complex.h>
 #include <TiledArray/tensor/kernels.h>
+#include <TiledArray/util/compression.h>
 #include <TiledArray/util/logger.h>
+#include <TiledArray/util/metrics.h>
 
 namespace TiledArray {
 
@@ -83,6 +85,7 @@ class Tensor {
     explicit Impl(const range_type& range)
         : allocator_type(), range_(range), data_(NULL) {
       data_ = allocator_type::allocate(range.volume());
+      detail::metrics_allocation(range.volume() * sizeof(value_type));
     }
 
     /// Construct with rvalue range
@@ -91,17 +94,28 @@ class Tensor {
     explicit Impl(range_type&& range)
         : allocator_type(), range_(range), data_(NULL) {
       data_ = allocator_type::allocate(range.volume());
+      detail::metrics_allocation(range.volume() * sizeof(value_type));
     }
 
+    /// Construct with range and externally owned data
+
+    /// \param range The N-dimensional range for this tensor
+    /// \param data The tensor data, which is not copied
+    Impl(const range_type& range, std::shared_ptr<value_type> data)
+        : allocator_type(), range_(range), data_(data.get()), external_(data) {}
+
     ~Impl() {
-      math::destroy_vector(range_.volume(), data_);
-      allocator_type::deallocate(data_, range_.volume());
+      if (!external_) {
+        math::destroy_vector(range_.volume(), data_);
+        allocator_type::deallocate(data_, range_.volume());
+      }
       data_ = NULL;
     }
 
     range_type range_;  ///< Tensor size info
     pointer data_;      ///< Tensor data
-  };                    // class Impl
+    std::shared_ptr<value_type> external_;  ///< Owner of external data
+  };  // class Impl
 
   template <typename... Ts>
   struct is_tensor {
@@ -119,6 +133,36 @@ class Tensor {
     math::uninitialized_fill_vector(n, U(), u);
   }
 
+  /// Compress the elements of a tensor of numeric type for serialization
+  template <typename Archive, typename U,
+            typename std::enable_if<detail::is_numeric_v<U>>::type* = nullptr>
+  static bool compress(const Archive& ar, const U* data, const size_type n,
+                       std::vector<unsigned char>& packed) {
+    return detail::compress_elements(ar, data, n, packed);
+  }
+
+  /// Elements of other types are not compressed
+  template <typename Archive, typename U,
+            typename std::enable_if<!detail::is_numeric_v<U>>::type* = nullptr>
+  static bool compress(const Archive&, const U*, const size_type,
+                       std::vector<unsigned char>&) {
+    return false;
+  }
+
+  template <typename U,
+            typename std::enable_if<detail::is_numeric_v<U>>::type* = nullptr>
+  static void decompress(const std::vector<unsigned char>& packed, U* data,
+                         const size_type n, const bool has_codec) {
+    detail::decompress_elements(packed, data, n, has_codec);
+  }
+
+  template <typename U,
+            typename std::enable_if<!detail::is_numeric_v<U>>::type* = nullptr>
+  static void decompress(const std::vector<unsigned char>&, U*,
+                         const size_type, const bool) {
+    TA_EXCEPTION("Tensor: compressed elements of non-numeric type");
+  }
+
   std::shared_ptr<Impl> pimpl_;  ///< Shared pointer to implementation object
   static const range_type empty_range_;  ///< Empty range
 
@@ -192,6 +236,17 @@ class Tensor {
     math::uninitialized_copy_vector(range.volume(), u, pimpl_->data_);
   }
 
+  /// Construct a tensor that refers to external data
+
+  /// The data is neither copied nor initialized; \c data must hold at least
+  /// \c range.volume() elements, and the tensor shares ownership of it.
+  /// \param range The range of the tensor
+  /// \param data The tensor data
+  Tensor(const range_type& range, std::shared_ptr<value_type> data)
+      : pimpl_(std::make_shared<Impl>(range, std::move(data))) {
+    TA_ASSERT(pimpl_->data_);
+  }
+
   /// Construct a copy of a tensor interface object
 
   /// \tparam T1 A tensor type
@@ -493,8 +548,17 @@ class Tensor {
                 Archive>::value>::type* = nullptr>
   void serialize(Archive& ar) {
     if (pimpl_) {
-      ar & pimpl_->range_.volume();
-      ar& madness::archive::wrap(pimpl_->data_, pimpl_->range_.volume());
+      const size_type n = pimpl_->range_.volume();
+      std::vector<unsigned char> packed;
+      if (compress(ar, pimpl_->data_, n, packed)) {
+        // The flags in the element count mark compressed elements
+        ar& size_type(n | detail::compressed_flag | detail::codec_flag) &
+            packed.size();
+        ar& madness::archive::wrap(packed.data(), packed.size());
+      } else {
+        ar& n;
+        ar& madness::archive::wrap(pimpl_->data_, n);
+      }
       ar & pimpl_->range_;
     } else {
       ar& size_type(0ul);
@@ -512,9 +576,13 @@ class Tensor {
   void serialize(Archive& ar) {
     size_type n = 0ul;
     ar& n;
+    const bool compressed = (n & detail::compressed_flag);
+    const bool has_codec = (n & detail::codec_flag);
+    n &= ~(detail::compressed_flag | detail::codec_flag);
     if (n) {
       std::shared_ptr<Impl> temp = std::make_shared<Impl>();
       temp->data_ = temp->allocate(n);
+      detail::metrics_allocation(n * sizeof(value_type));
       try {
         // need to construct elements of data_ using placement new in case its
         // default ctor is not trivial N.B. for fundamental types and standard
@@ -523,7 +591,15 @@ class Tensor {
         for (size_type i = 0; i != n; ++i, ++data_ptr)
           new (static_cast<void*>(data_ptr)) value_type;
 
-        ar& madness::archive::wrap(temp->data_, n);
+        if (compressed) {
+          std::size_t nbytes = 0ul;
+          ar& nbytes;
+          std::vector<unsigned char> packed(nbytes);
+          ar& madness::archive::wrap(packed.data(), nbytes);
+          decompress(packed, temp->data_, n, has_codec);
+        } else {
+          ar& madness::archive::wrap(temp->data_, n);
+        }
         ar & temp->range_;
       } catch (...) {
         temp->deallocate(temp->data_, n);
@@ -606,6 +682,21 @@ class Tensor {
     return result;
   }
 
+  /// Shift the lower and upper bound of this range without copying the data
+
+  /// The result shares the data of this tensor, and keeps it alive, so
+  /// modifications of the elements of either tensor are visible in both.
+  /// \tparam Index The shift array type
+  /// \param bound_shift The shift to be applied to the tensor range
+  /// \return A shifted view of this tensor
+  template <typename Index>
+  Tensor_ shift_view(const Index& bound_shift) const {
+    TA_ASSERT(pimpl_);
+    range_type range = pimpl_->range_;
+    range.inplace_shift(bound_shift);
+    return Tensor_(range, std::shared_ptr<value_type>(pimpl_, pimpl_->data_));
+  }
+
   // Generic vector operations
 
   /// Use a binary, element wise operation to construct a new tensor
@@ -1244,9 +1335,12 @@ class Tensor {
     const integer ldb =
         (gemm_helper.right_op() == madness::cblas::NoTrans ? n : k);
 
-    math::gemm(gemm_helper.left_op(), gemm_helper.right_op(), m, n, k, factor,
-               pimpl_->data_, lda, other.data(), ldb, numeric_type(0),
-               result.data(), n);
+    {
+      detail::MetricsGemmScope metrics(m, n, k);
+      math::gemm(gemm_helper.left_op(), gemm_helper.right_op(), m, n, k,
+                 factor, pimpl_->data_, lda, other.data(), ldb,
+                 numeric_type(0), result.data(), n);
+    }
 
 #ifdef TA_ENABLE_TILE_OPS_LOGGING
     if (TiledArray::TileOpsLogger<T>::get_instance_ptr() != nullptr &&
@@ -1402,9 +1496,13 @@ class Tensor {
         data_copy = std::make_unique<T[]>(tile_volume);
         std::copy(pimpl_->data_, pimpl_->data_ + tile_volume, data_copy.get());
       }
-      math::gemm(gemm_helper.left_op(), gemm_helper.right_op(), m, n, k, factor,
-                 left.data(), lda, right.data(), ldb,
-                 twostep ? numeric_type(0) : numeric_type(1), pimpl_->data_, n);
+      {
+        detail::MetricsGemmScope metrics(m, n, k);
+        math::gemm(gemm_helper.left_op(), gemm_helper.right_op(), m, n, k,
+                   factor, left.data(), lda, right.data(), ldb,
+                   twostep ? numeric_type(0) : numeric_type(1), pimpl_->data_,
+                   n);
+      }
 
       if (TiledArray::TileOpsLogger<T>::get_instance_ptr() != nullptr &&
           TiledArray::TileOpsLogger<T>::get_instance().gemm) {
@@ -1454,9 +1552,12 @@ class Tensor {
       }
     }
 #else   // TA_ENABLE_TILE_OPS_LOGGING
-    math::gemm(gemm_helper.left_op(), gemm_helper.right_op(), m, n, k, factor,
-               left.data(), lda, right.data(), ldb, numeric_type(1),
-               pimpl_->data_, n);
+    {
+      detail::MetricsGemmScope metrics(m, n, k);
+      math::gemm(gemm_helper.left_op(), gemm_helper.right_op(), m, n, k,
+                 factor, left.data(), lda, right.data(), ldb, numeric_type(1),
+                 pimpl_->data_, n);
+    }
 #endif  // TA_ENABLE_TILE_OPS_LOGGING
 
     return *this;
@@ -59,10 +59,13 @@ namespace TiledArray {
 /// \li \c scale_to
 /// \li \c gemm
 /// \li \c neg
+/// \li \c unary (optional)
+/// \li \c inplace_unary (optional)
 /// \li \c permute
 /// \li \c empty
 /// \li \c shift
 /// \li \c shift_to
+/// \li \c shift_view (optional)
 /// \li \c trace
 /// \li \c sum
 /// \li \c product
@@ -474,6 +477,19 @@ inline decltype(auto) shift(const Tile<Arg>& arg, const Index& range_shift) {
   return detail::make_tile(shift(arg.tensor(), range_shift));
 }
 
+/// Shift the range of \c arg without copying its data
+
+/// \tparam Arg The tensor argument type
+/// \tparam Index An array type
+/// \param arg The tile argument to be shifted
+/// \param range_shift The offset to be applied to the argument range
+/// \return A tile with a new range that shares the data of \c arg
+template <typename Arg, typename Index>
+inline auto shift_view(const Tile<Arg>& arg, const Index& range_shift)
+    -> decltype(detail::make_tile(shift_view(arg.tensor(), range_shift))) {
+  return detail::make_tile(shift_view(arg.tensor(), range_shift));
+}
+
 /// Shift the range of \c arg in place
 
 /// \tparam Arg The tensor argument type
@@ -931,6 +947,48 @@ inline Tile<Result>& neg_to(Tile<Result>& result) {
   return result;
 }
 
+// Element-wise function operations ------------------------------------------
+
+/// Apply an element-wise function to a tile
+
+/// \tparam Arg The tile argument type
+/// \tparam Op The element function type
+/// \param arg The tile argument
+/// \param op The element function
+/// \return A tile with elements <tt>op(arg[i])</tt>
+template <typename Arg, typename Op>
+inline decltype(auto) unary(const Tile<Arg>& arg, Op&& op) {
+  return detail::make_tile(unary(arg.tensor(), std::forward<Op>(op)));
+}
+
+/// Apply an element-wise function to a tile and permute the result
+
+/// \tparam Arg The tile argument type
+/// \tparam Op The element function type
+/// \param arg The tile argument
+/// \param op The element function
+/// \param perm The permutation to be applied to the result
+/// \return A tile that is equal to <tt>perm ^ op(arg)</tt>
+template <typename Arg, typename Op>
+inline decltype(auto) unary(const Tile<Arg>& arg, Op&& op,
+                            const Permutation& perm) {
+  return detail::make_tile(unary(arg.tensor(), std::forward<Op>(op), perm));
+}
+
+/// Modify the elements of a tile in-place
+
+/// \tparam Result The result tile type
+/// \tparam Op The element operation type
+/// \param result The result tile
+/// \param op The element operation, which is called as <tt>op(result[i])</tt>
+/// with a reference to each element
+/// \return A reference to \c result
+template <typename Result, typename Op>
+inline Tile<Result>& inplace_unary(Tile<Result>& result, Op&& op) {
+  inplace_unary(result.tensor(), std::forward<Op>(op));
+  return result;
+}
+
 // Complex conjugate operations ---------------------------------------------
 
 /// Create a complex conjugated copy of a tile
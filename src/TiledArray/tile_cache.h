@@ -0,0 +1,291 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  tile_cache.h
+ *  Nov 14, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_TILE_CACHE_H__INCLUDED
+#define TILEDARRAY_TILE_CACHE_H__INCLUDED
+
+#include <TiledArray/external/madness.h>
+#include <TiledArray/util/compression.h>
+
+#include <list>
+#include <unordered_map>
+
+namespace TiledArray {
+namespace detail {
+
+/// Tile cache statistics
+struct TileCacheStats {
+  std::size_t hits = 0ul;       ///< The number of lookups that found a tile
+  std::size_t misses = 0ul;     ///< The number of lookups that did not
+  std::size_t evictions = 0ul;  ///< The number of tiles evicted
+  std::size_t prefetches = 0ul;  ///< The number of tiles prefetched
+  std::size_t bytes = 0ul;      ///< The size of the cached tiles, in bytes
+
+  /// Hit rate
+
+  /// \return The fraction of lookups that found a tile
+  double hit_rate() const {
+    const std::size_t lookups = hits + misses;
+    return (lookups ? double(hits) / double(lookups) : 0.0);
+  }
+};  // struct TileCacheStats
+
+/// Cache of remote tiles with least-recently-used eviction
+
+/// Holds futures of remote tiles, keyed by their ordinal index, within a
+/// byte budget. The size of a tile is accounted for when its future is
+/// set. When the budget is exceeded, the least recently used tiles are
+/// evicted, except prefetched tiles that were not found yet, which are
+/// admitted only within the budget instead (see \c prefetch() ). The whole
+/// cache is invalidated at the first fence that follows
+/// the insertion of a tile, since tiles may be modified or replaced between
+/// fences.
+/// \tparam T The tile type
+template <typename T>
+class TileCache : public std::enable_shared_from_this<TileCache<T> >,
+                  private madness::Spinlock {
+ public:
+  typedef TileCache<T> TileCache_;  ///< This object type
+  typedef std::size_t key_type;     ///< Tile key type
+  typedef Future<T> future;         ///< Tile future type
+
+ private:
+  typedef std::list<key_type> lru_list;  ///< Keys, most recent first
+
+  struct Entry {
+    future value;                        ///< The cached tile
+    std::size_t bytes;                   ///< Tile size, 0 until it is set
+    bool reserved;                       ///< \c bytes is an estimate
+    bool pinned;                         ///< Prefetched and not found yet
+    typename lru_list::iterator lru_it;  ///< Position in the LRU list
+  };  // struct Entry
+
+  /// Clears the cache when deleted at fence
+  struct Invalidator {
+    std::weak_ptr<TileCache_> cache;
+    Invalidator(const std::shared_ptr<TileCache_>& c) : cache(c) {}
+    ~Invalidator() {
+      if (auto c = cache.lock()) c->invalidate();
+    }
+  };  // struct Invalidator
+
+  World& world_;
+  const std::size_t max_bytes_;  ///< Byte budget
+  lru_list lru_;
+  std::unordered_map<key_type, Entry> entries_;
+  bool invalidator_pending_;  ///< An invalidator awaits the next fence
+  TileCacheStats stats_;
+
+  /// Evict tiles until the byte budget is satisfied
+
+  /// \note Assume the object is already locked
+  void evict() {
+    auto lru_it = lru_.end();
+    while ((stats_.bytes > max_bytes_) && (lru_it != lru_.begin())) {
+      --lru_it;
+      auto it = entries_.find(*lru_it);
+      TA_ASSERT(it != entries_.end());
+      if (it->second.pinned) continue;
+      stats_.bytes -= it->second.bytes;
+      entries_.erase(it);
+      lru_it = lru_.erase(lru_it);
+      ++stats_.evictions;
+    }
+  }
+
+  /// Record the size of tile \c key once it is available
+  void account(const key_type key, const std::size_t bytes) {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return;
+    Entry& entry = it->second;
+    if (!entry.reserved && entry.bytes != 0ul) return;
+    stats_.bytes -= entry.bytes;
+    entry.bytes = bytes;
+    entry.reserved = false;
+    stats_.bytes += bytes;
+    evict();
+  }
+
+  /// Insert a tile in the cache
+
+  /// \param key The tile key
+  /// \param value The tile future
+  /// \param bytes The estimated size of the tile, or 0 if it is unknown
+  /// \param pinned The tile may not be evicted until it is found
+  /// \note Assume the object is already locked
+  /// \return \c true if an invalidator must be registered
+  bool insert_entry(const key_type key, const future& value,
+                    const std::size_t bytes, const bool pinned) {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      stats_.bytes -= it->second.bytes;
+      lru_.erase(it->second.lru_it);
+      entries_.erase(it);
+    }
+    lru_.push_front(key);
+    entries_.emplace(key,
+                     Entry{value, bytes, bytes != 0ul, pinned, lru_.begin()});
+    stats_.bytes += bytes;
+    if (invalidator_pending_) return false;
+    invalidator_pending_ = true;
+    return true;
+  }
+
+  /// Account for the tile size when it arrives and register the invalidator
+
+  /// \param key The tile key
+  /// \param value The tile future
+  /// \param register_invalidator Register the invalidator of the cache
+  void track(const key_type key, const future& value,
+             const bool register_invalidator) {
+    std::weak_ptr<TileCache_> weak_this = this->shared_from_this();
+    world_.taskq.add(
+        [weak_this, key](const T& tile) {
+          if (auto cache = weak_this.lock())
+            cache->account(key, uncompressed_bytes(tile));
+        },
+        value);
+
+    if (register_invalidator) {
+      // The invalidator is deleted, and the cache cleared, at the next fence
+      auto invalidator =
+          std::make_shared<Invalidator>(this->shared_from_this());
+      madness::detail::deferred_cleanup(world_, invalidator);
+    }
+  }
+
+ public:
+  /// Constructor
+
+  /// \param world The world that owns the cached tiles
+  /// \param max_bytes The byte budget of the cache
+  TileCache(World& world, const std::size_t max_bytes)
+      : madness::Spinlock(),
+        world_(world),
+        max_bytes_(max_bytes),
+        lru_(),
+        entries_(),
+        invalidator_pending_(false),
+        stats_() {}
+
+  /// Find a tile in the cache
+
+  /// \param key The tile key
+  /// \param[out] result The cached tile, if it is found
+  /// \return \c true if the tile is cached
+  bool find(const key_type key, future& result) {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      ++stats_.misses;
+      return false;
+    }
+
+    ++stats_.hits;
+    it->second.pinned = false;
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    result = it->second.value;
+    return true;
+  }
+
+  /// Check for a tile in the cache
+
+  /// Unlike \c find() , this does not count as a lookup.
+  /// \param key The tile key
+  /// \return \c true if the tile is cached
+  bool contains(const key_type key) const {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    return entries_.find(key) != entries_.end();
+  }
+
+  /// Reserve space for a prefetched tile
+
+  /// The tile is admitted only if its estimated size fits in the budget
+  /// with the tiles that are already cached. It is not evicted until it is
+  /// found, so a prefetch does not evict the tiles of earlier prefetches.
+  /// \param bytes The estimated size of the tile
+  /// \return \c true if the tile should be fetched and inserted with
+  /// \c prefetch() , \c false if the budget is full
+  bool reserve(const std::size_t bytes) const {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    return (stats_.bytes + bytes <= max_bytes_);
+  }
+
+  /// Insert a prefetched tile in the cache
+
+  /// \param key The tile key
+  /// \param value The tile future
+  /// \param bytes The estimated size of the tile, which is accounted until
+  /// the tile arrives
+  void prefetch(const key_type key, const future& value,
+                const std::size_t bytes) {
+    bool register_invalidator = false;
+    {
+      madness::ScopedMutex<madness::Spinlock> locker(this);
+      register_invalidator = insert_entry(key, value, bytes, true);
+      ++stats_.prefetches;
+    }
+    track(key, value, register_invalidator);
+  }
+
+  /// Insert a tile in the cache
+
+  /// \param key The tile key
+  /// \param value The tile future
+  void insert(const key_type key, const future& value) {
+    bool register_invalidator = false;
+    {
+      madness::ScopedMutex<madness::Spinlock> locker(this);
+      register_invalidator = insert_entry(key, value, 0ul, false);
+    }
+    track(key, value, register_invalidator);
+  }
+
+  /// Remove all tiles from the cache
+  void invalidate() {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    entries_.clear();
+    lru_.clear();
+    stats_.bytes = 0ul;
+    invalidator_pending_ = false;
+  }
+
+  /// Byte budget accessor
+
+  /// \return The maximum size of the cached tiles, in bytes
+  std::size_t max_bytes() const { return max_bytes_; }
+
+  /// Cache statistics accessor
+
+  /// \return A snapshot of the cache statistics
+  TileCacheStats stats() const {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    return stats_;
+  }
+
+};  // class TileCache
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_TILE_CACHE_H__INCLUDED
@@ -0,0 +1,518 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  tile_file.h
+ *  Nov 18, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_TILE_FILE_H__INCLUDED
+#define TILEDARRAY_TILE_FILE_H__INCLUDED
+
+#include <sys/mman.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <TiledArray/dist_array.h>
+#include <TiledArray/util/posix_file.h>
+
+namespace TiledArray {
+namespace detail {
+
+/// Layout of a tile file
+
+/// A tile file holds one array and has the following layout:
+/// \li preamble: magic number, format version, size of the header in bytes,
+///     and number of tiles (4 x 64-bit integers);
+/// \li header: type descriptor (see \c TileFileLayout::descriptor() ), tiled
+///     range, and shape, serialized with a MADNESS archive;
+/// \li tile index: offset and size in bytes of each tile, ordered by tile
+///     ordinal (2 x 64-bit integers per tile, zero for tiles that are not
+///     stored, such as zero tiles);
+/// \li tile payloads, serialized with a MADNESS archive, in ordinal order,
+///     each starting at a multiple of \c alignment bytes.
+///
+/// Version 1 files have the same layout, except that tile payloads are not
+/// aligned; they can be read, but not memory-mapped. Version 1 and 2 files
+/// hold a compiler-specific type hash instead of the type descriptor, which
+/// is not checked.
+///
+/// Since the location of every tile is recorded in the index, tiles can be
+/// read and written independently by the process that owns them, for any
+/// number of processes and any process map.
+struct TileFileLayout {
+  static constexpr std::uint64_t magic =
+      0x454C494654415401ull;  ///< File magic number
+  static constexpr std::uint64_t version = 3ull;  ///< Format version
+  static constexpr std::uint64_t min_version =
+      1ull;  ///< Oldest format version that can be read
+  static constexpr std::uint64_t aligned_version =
+      2ull;  ///< First format version with aligned tile payloads
+  static constexpr std::uint64_t descriptor_version =
+      3ull;  ///< First format version with a portable type descriptor
+  static constexpr std::uint64_t alignment =
+      64ull;  ///< Alignment of tile payloads
+
+  /// File preamble
+  struct Preamble {
+    std::uint64_t magic;         ///< Must equal TileFileLayout::magic
+    std::uint64_t version;       ///< Format version
+    std::uint64_t header_bytes;  ///< Size of the header
+    std::uint64_t ntiles;        ///< Number of tiles in the index
+  };  // struct Preamble
+
+  /// Tile index entry
+  struct Entry {
+    std::uint64_t offset;  ///< Offset of the tile payload
+    std::uint64_t size;    ///< Size of the tile payload, 0 for zero tiles
+  };  // struct Entry
+
+  /// Round \c offset up to the payload alignment
+  static constexpr std::uint64_t align(const std::uint64_t offset) {
+    return (offset + alignment - 1ull) / alignment * alignment;
+  }
+
+  /// Portable description of the type of an array
+
+  /// The descriptor holds the size of the scalar type of the tile elements
+  /// (bits 0-7), and flags for complex (bit 8), integer (bit 9), signed
+  /// (bit 10) and tensor-valued (bit 11) elements, and for dense shapes
+  /// (bit 16), which are serialized differently from other shapes. It does
+  /// not depend on the compiler, nor on the rest of the array policy.
+  /// \tparam Array The array type
+  /// \return The type descriptor of \c Array
+  template <typename Array>
+  static std::uint64_t descriptor() {
+    typedef typename Array::value_type tile_type;
+    typedef numeric_t<tile_type> numeric_type;
+    typedef scalar_t<tile_type> scalar_type;
+    return std::uint64_t(sizeof(scalar_type)) |
+           (std::uint64_t(is_complex_v<numeric_type>) << 8) |
+           (std::uint64_t(std::is_integral<scalar_type>::value) << 9) |
+           (std::uint64_t(std::is_signed<scalar_type>::value) << 10) |
+           (std::uint64_t(!is_numeric_v<typename tile_type::value_type>)
+            << 11) |
+           (std::uint64_t(std::is_same<typename Array::shape_type,
+                                       DenseShape>::value)
+            << 16);
+  }
+
+  /// Offset of the header
+  static constexpr std::uint64_t header_offset() { return sizeof(Preamble); }
+
+  /// Offset of the tile index
+
+  /// \param header_bytes The size of the header
+  static std::uint64_t index_offset(const std::uint64_t header_bytes) {
+    return sizeof(Preamble) + header_bytes;
+  }
+
+  /// Offset of the first tile payload
+
+  /// \param header_bytes The size of the header
+  /// \param ntiles The number of tiles
+  static std::uint64_t data_offset(const std::uint64_t header_bytes,
+                                   const std::uint64_t ntiles) {
+    return align(index_offset(header_bytes) + ntiles * sizeof(Entry));
+  }
+
+};  // struct TileFileLayout
+
+/// Serialize objects into a byte buffer
+
+/// \tparam Ts The object types
+/// \param values The objects to be serialized
+/// \return A buffer that holds the serialized objects, in order
+template <typename... Ts>
+std::vector<unsigned char> to_bytes(const Ts&... values) {
+  // Compress the elements once, for both passes
+  CompressionScope scope(nullptr, true);
+  madness::archive::BufferOutputArchive count;
+  int count_all[] = {0, (count & values, 0)...};
+  std::vector<unsigned char> result(count.size());
+  madness::archive::BufferOutputArchive ar(result.data(), result.size());
+  int store_all[] = {0, (ar & values, 0)...};
+  (void)count_all;
+  (void)store_all;
+  return result;
+}
+
+/// Contents of the header and index of a tile file
+template <typename Array>
+struct TileFileHeader {
+  std::uint64_t version;               ///< The format version of the file
+  typename Array::trange_type trange;  ///< The tiled range of the array
+  typename Array::shape_type shape;    ///< The shape of the array
+  std::vector<TileFileLayout::Entry> index;  ///< The tile index
+
+  /// Read the header and index of a tile file
+
+  /// \param file The tile file
+  /// \throw TiledArray::Exception When the file is not a tile file, or it
+  /// holds a different type of array
+  explicit TileFileHeader(const PosixFile& file) {
+    TileFileLayout::Preamble preamble;
+    file.read(&preamble, sizeof(preamble), 0ul);
+    if (preamble.magic != TileFileLayout::magic)
+      TA_EXCEPTION("TileFileHeader: not a tile file");
+    if ((preamble.version < TileFileLayout::min_version) ||
+        (preamble.version > TileFileLayout::version))
+      TA_EXCEPTION("TileFileHeader: unsupported tile file version");
+    version = preamble.version;
+
+    std::vector<unsigned char> header(preamble.header_bytes);
+    file.read(header.data(), header.size(), TileFileLayout::header_offset());
+    madness::archive::BufferInputArchive ar(header.data(), header.size());
+    std::uint64_t descriptor = 0ull;
+    ar& descriptor;
+    if ((version >= TileFileLayout::descriptor_version) &&
+        (descriptor != TileFileLayout::descriptor<Array>()))
+      TA_EXCEPTION("TileFileHeader: source array type != this array type");
+    ar& trange& shape;
+    if (trange.tiles_range().volume() != preamble.ntiles)
+      TA_EXCEPTION("TileFileHeader: corrupt tile index");
+
+    index.resize(preamble.ntiles);
+    file.read(index.data(), index.size() * sizeof(TileFileLayout::Entry),
+              TileFileLayout::index_offset(preamble.header_bytes));
+  }
+};  // struct TileFileHeader
+
+/// Read-only memory mapping of a whole file
+
+/// The file is mapped privately, so pages are loaded on demand from the page
+/// cache and shared with other processes that map the same file, while
+/// writes (if any) are copy-on-write and never reach the file.
+class MappedFile {
+ private:
+  void* data_;        ///< The start of the mapping
+  std::size_t size_;  ///< The size of the mapping
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+ public:
+  /// Map a file
+
+  /// \param file The file to be mapped, which must be open for reading
+  /// \throw TiledArray::Exception When the file cannot be mapped
+  explicit MappedFile(const PosixFile& file)
+      : data_(nullptr), size_(file.size()) {
+    data_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   file.fd(), 0);
+    if (data_ == MAP_FAILED) TA_EXCEPTION("MappedFile: mmap failed");
+  }
+
+  ~MappedFile() { ::munmap(data_, size_); }
+
+  /// Mapped data accessor
+
+  /// \param offset The offset in the file
+  /// \return A pointer to the byte at \c offset
+  unsigned char* data(const std::uint64_t offset = 0ul) const {
+    TA_ASSERT(offset <= size_);
+    return static_cast<unsigned char*>(data_) + offset;
+  }
+
+  /// Mapping size accessor
+
+  /// \return The size of the mapping in bytes
+  std::size_t size() const { return size_; }
+
+};  // class MappedFile
+
+/// Zero-copy view of the tiles of a memory-mapped tile file
+
+/// \tparam Array The array type, which must have \c Tensor tiles of numeric
+/// elements
+template <typename Array>
+class MappedTileFile {
+ public:
+  typedef typename Array::value_type tile_type;  ///< Tile type
+  typedef typename tile_type::value_type value_type;  ///< Element type
+  typedef typename tile_type::range_type range_type;  ///< Tile range type
+
+  static_assert(detail::is_numeric_v<value_type>,
+                "MappedTileFile: tiles must hold numeric elements");
+
+ private:
+  std::shared_ptr<MappedFile> mapping_;  ///< The mapped file
+  TileFileHeader<Array> header_;         ///< The header and tile index
+
+  /// Locate the elements of a tile in the mapping
+  value_type* elements(const std::size_t ord) const {
+    TA_ASSERT(ord < header_.index.size());
+    const TileFileLayout::Entry& entry = header_.index[ord];
+    TA_ASSERT(entry.size > 0ul);
+    if (!aligned())
+      TA_EXCEPTION("MappedTileFile: tile payloads are not aligned");
+
+    // A serialized tensor holds its volume, its elements, then its range
+    typename range_type::ordinal_type volume = 0ul;
+    std::memcpy(&volume, mapping_->data(entry.offset), sizeof(volume));
+    if (volume & compressed_flag)
+      TA_EXCEPTION("MappedTileFile: compressed tiles cannot be mapped");
+    if (volume != header_.trange.make_tile_range(ord).volume())
+      TA_EXCEPTION("MappedTileFile: corrupt tile");
+    return reinterpret_cast<value_type*>(
+        mapping_->data(entry.offset + sizeof(volume)));
+  }
+
+  explicit MappedTileFile(const PosixFile& file)
+      : mapping_(std::make_shared<MappedFile>(file)), header_(file) {}
+
+ public:
+  /// Map a tile file
+
+  /// \param filename The name of the file
+  /// \throw TiledArray::Exception When the file does not hold an \c Array
+  explicit MappedTileFile(const std::string& filename)
+      : MappedTileFile(PosixFile(filename, O_RDONLY)) {}
+
+  /// Check that the tiles of the file can be accessed
+
+  /// \return \c true if the tile payloads are aligned, i.e. the file was
+  /// written with format version 2 or later; otherwise \c tile() and
+  /// \c map() throw
+  bool aligned() const {
+    return header_.version >= TileFileLayout::aligned_version;
+  }
+
+  /// Header accessor
+
+  /// \return The header and tile index of the file
+  const TileFileHeader<Array>& header() const { return header_; }
+
+  /// Tile accessor
+
+  /// \param ord The ordinal index of a non-zero tile
+  /// \return A tensor whose elements refer to the mapped file; it keeps the
+  /// mapping alive
+  tile_type tile(const std::size_t ord) const {
+    return tile_type(header_.trange.make_tile_range(ord),
+                     std::shared_ptr<value_type>(mapping_, elements(ord)));
+  }
+
+  /// Tile view accessor
+
+  /// \param ord The ordinal index of a non-zero tile
+  /// \return A constant view of the tile elements in the mapped file, which
+  /// is valid while this object exists
+  TensorConstMap<value_type> map(const std::size_t ord) const {
+    return TensorConstMap<value_type>(header_.trange.make_tile_range(ord),
+                                      elements(ord));
+  }
+
+};  // class MappedTileFile
+
+/// Read a tile from a tile file
+
+/// \tparam Tile The tile type
+/// \param file The tile file
+/// \param entry The index entry of the tile
+/// \return The tile
+template <typename Tile>
+Tile read_tile(const PosixFile& file, const TileFileLayout::Entry& entry) {
+  TA_ASSERT(entry.size > 0ul);
+  std::vector<unsigned char> buffer(entry.size);
+  file.read(buffer.data(), buffer.size(), entry.offset);
+  madness::archive::BufferInputArchive ar(buffer.data(), buffer.size());
+  Tile tile;
+  ar& tile;
+  return tile;
+}
+
+/// Write selected tiles of an array to a tile file
+
+/// Tiles that are not selected are recorded with a zero size in the index.
+/// Every local non-zero tile is serialized once, and the selected tiles are
+/// written from the same buffer.
+/// \tparam Tile The tile type of the array
+/// \tparam Policy The policy of the array
+/// \tparam Select A predicate with signature <tt>bool(std::size_t ord,
+/// const Tile& tile, const std::vector<unsigned char>& bytes)</tt>
+/// \param array The array to be written
+/// \param filename The name of the file
+/// \param select The predicate that selects the local non-zero tiles that
+/// are written, given the tile and its serialized bytes; it is called once
+/// per tile, by the main thread
+/// \note This is a collective operation that fences before and after
+/// writing.
+template <typename Tile, typename Policy, typename Select>
+void write_tile_file(const DistArray<Tile, Policy>& array,
+                     const std::string& filename, Select&& select) {
+  typedef DistArray<Tile, Policy> array_type;
+  typedef TileFileLayout layout;
+
+  World& world = array.world();
+  world.gop.fence();
+
+  // Every process computes the header, so it knows where the data starts
+  const std::uint64_t descriptor = layout::descriptor<array_type>();
+  const auto header = to_bytes(descriptor, array.trange(), array.shape());
+  const std::uint64_t ntiles = array.size();
+
+  // Serialize the selected tiles and collect the sizes of all tiles
+  typedef std::shared_ptr<const std::vector<unsigned char> > buffer_ptr;
+  std::vector<std::pair<std::size_t, buffer_ptr> > buffers;
+  std::vector<std::uint64_t> sizes(ntiles, 0ul);
+  for (auto ord : *array.pmap()) {
+    if (array.is_zero(ord)) continue;
+    const Future<Tile> tile_future = array.find(ord);
+    const Tile& tile = tile_future.get();
+    auto buffer = std::make_shared<std::vector<unsigned char> >(to_bytes(tile));
+    if (!select(std::size_t(ord), tile, *buffer)) continue;
+    sizes[ord] = buffer->size();
+    buffers.emplace_back(ord, std::move(buffer));
+  }
+  world.gop.sum(sizes.data(), sizes.size());
+
+  std::vector<layout::Entry> index(ntiles);
+  std::uint64_t offset = layout::data_offset(header.size(), ntiles);
+  for (std::uint64_t ord = 0ul; ord < ntiles; ++ord) {
+    index[ord].offset = offset;
+    index[ord].size = sizes[ord];
+    offset = layout::align(offset + sizes[ord]);
+  }
+
+  // Process 0 creates the file and writes the header and index
+  if (world.rank() == 0) {
+    PosixFile file(filename, O_WRONLY | O_CREAT | O_TRUNC);
+    const layout::Preamble preamble = {layout::magic, layout::version,
+                                       header.size(), ntiles};
+    file.write(&preamble, sizeof(preamble), 0ul);
+    file.write(header.data(), header.size(), layout::header_offset());
+    file.write(index.data(), index.size() * sizeof(layout::Entry),
+               layout::index_offset(header.size()));
+  }
+  world.gop.fence();
+
+  // Every process writes its tiles
+  auto file = std::make_shared<PosixFile>(filename, O_WRONLY);
+  for (auto& ord_buffer : buffers) {
+    const layout::Entry entry = index[ord_buffer.first];
+    buffer_ptr buffer = std::move(ord_buffer.second);
+    world.taskq.add([file, entry, buffer]() {
+      file->write(buffer->data(), buffer->size(), entry.offset);
+    });
+  }
+  buffers.clear();
+  world.gop.fence();
+}
+
+}  // namespace detail
+
+/// Write an array to a tile file
+
+/// Every process writes its own tiles directly to the file, with positioned
+/// I/O executed concurrently in tasks. Only the tile sizes are communicated.
+/// The file can be read by any number of processes with any process map;
+/// see \c read_tile_file .
+/// \tparam Tile The tile type of the array
+/// \tparam Policy The policy of the array
+/// \param array The array to be written
+/// \param filename The name of the file
+/// \note This is a collective operation that fences before and after
+/// writing. The file system must be shared by all processes.
+template <typename Tile, typename Policy>
+void write_tile_file(const DistArray<Tile, Policy>& array,
+                     const std::string& filename) {
+  detail::write_tile_file(
+      array, filename,
+      [](std::size_t, const Tile&, const std::vector<unsigned char>&) {
+        return true;
+      });
+}
+
+/// Read an array from a tile file
+
+/// Every process reads the file header and index, then reads only the tiles
+/// that it owns, with positioned I/O executed concurrently in tasks.
+/// \tparam Array The array type
+/// \param world The world where the array will live
+/// \param filename The name of the file
+/// \param pmap The process map of the array [default = the policy's
+/// default process map]
+/// \return The array held in the file
+/// \throw TiledArray::Exception When the file does not hold an \c Array
+/// \note This is a collective operation. The tiles are available after the
+/// next fence. The file system must be shared by all processes.
+template <typename Array>
+Array read_tile_file(World& world, const std::string& filename,
+                     const std::shared_ptr<typename Array::pmap_interface>&
+                         pmap = {}) {
+  typedef typename Array::value_type tile_type;
+  typedef detail::TileFileLayout layout;
+
+  auto file = std::make_shared<detail::PosixFile>(filename, O_RDONLY);
+  detail::TileFileHeader<Array> header(*file);
+
+  Array result(world, header.trange, header.shape, pmap);
+  for (auto ord : *result.pmap()) {
+    if (result.is_zero(ord)) continue;
+    const layout::Entry entry = header.index[ord];
+    Future<tile_type> tile = world.taskq.add([file, entry]() -> tile_type {
+      return detail::read_tile<tile_type>(*file, entry);
+    });
+    result.set(ord, tile);
+  }
+
+  return result;
+}
+
+/// Open a tile file as a memory-mapped, read-only array
+
+/// The local tiles of the result refer directly to a private memory mapping
+/// of the file: no data is read when the array is opened, and tile pages are
+/// loaded on demand by the operating system and shared, through the page
+/// cache, by all processes on a node. Tiles may be modified, but changes are
+/// never written back to the file. The mapping is released when the last
+/// tile that refers to it is destroyed. Files of format version 1, whose
+/// tile payloads are not aligned, are read as with \c read_tile_file .
+/// \tparam Array The array type, which must have \c Tensor tiles of numeric
+/// elements
+/// \param world The world where the array will live
+/// \param filename The name of the file
+/// \param pmap The process map of the array [default = the policy's
+/// default process map]
+/// \return The array held in the file
+/// \throw TiledArray::Exception When the file does not hold an \c Array
+/// \note This is a collective operation. The file system must be shared by
+/// all processes.
+template <typename Array>
+Array map_tile_file(World& world, const std::string& filename,
+                    const std::shared_ptr<typename Array::pmap_interface>&
+                        pmap = {}) {
+  detail::MappedTileFile<Array> file(filename);
+  if (!file.aligned()) return read_tile_file<Array>(world, filename, pmap);
+
+  Array result(world, file.header().trange, file.header().shape, pmap);
+  for (auto ord : *result.pmap()) {
+    if (result.is_zero(ord)) continue;
+    result.set(ord, file.tile(ord));
+  }
+
+  return result;
+}
+
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_TILE_FILE_H__INCLUDED
@@ -28,6 +28,9 @@
 
 #include "../tile_interface/cast.h"
 #include "../type_traits.h"
+#include "../util/memory.h"
+#include "../util/metrics.h"
+#include "../util/timeline.h"
 
 namespace TiledArray {
 
@@ -41,6 +44,10 @@ class Permutation;
 /// \return A tile that is equal to <tt>perm ^ arg</tt>
 template <typename Arg>
 inline auto permute(const Arg& arg, const Permutation& perm) {
+  detail::TimelineScope scope(detail::TimelineCategory::permute, "permute");
+  using detail::memory_bytes;
+  detail::MetricsPermuteScope metrics(
+      detail::metrics_enabled() ? memory_bytes(arg) : 0ul);
   return arg.permute(perm);
 }
 
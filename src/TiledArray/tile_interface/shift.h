@@ -55,10 +55,34 @@ inline auto shift_to(Arg& arg, const Index& range_shift) {
   return arg.shift_to(range_shift);
 }
 
+/// Shift the range of \c arg without copying its data
+
+/// \tparam Arg The tile argument type
+/// \tparam Index An array type
+/// \param arg The tile argument to be shifted
+/// \param range_shift The offset to be applied to the argument range
+/// \return A tile with a new range that shares the data of \c arg
+template <typename Arg, typename Index>
+inline auto shift_view(const Arg& arg, const Index& range_shift)
+    -> decltype(arg.shift_view(range_shift)) {
+  return arg.shift_view(range_shift);
+}
+
 namespace tile_interface {
 
 using TiledArray::shift;
 using TiledArray::shift_to;
+using TiledArray::shift_view;
+
+template <typename T, typename Enabler = void>
+struct has_shift_view : public std::false_type {};
+
+template <typename T>
+struct has_shift_view<
+    T, typename std::enable_if<TiledArray::detail::is_type<decltype(
+           shift_view(std::declval<const T&>(),
+                      std::declval<std::vector<long> >()))>::value>::type>
+    : public std::true_type {};
 
 template <typename T>
 using result_of_shift_t = typename std::decay<decltype(
@@ -130,6 +154,25 @@ class ShiftTo<Result, Arg,
   }
 };
 
+template <typename Result, typename Arg, typename Enabler = void>
+class ShiftView : public TiledArray::tile_interface::Shift<Result, Arg> {};
+
+template <typename Result, typename Arg>
+class ShiftView<
+    Result, Arg,
+    typename std::enable_if<has_shift_view<Arg>::value &&
+                            std::is_same<Result, Arg>::value>::type> {
+ public:
+  typedef Result result_type;  ///< Result tile type
+  typedef Arg argument_type;   ///< Argument tile type
+
+  template <typename Index>
+  result_type operator()(const argument_type& arg,
+                         const Index& range_shift) const {
+    return shift_view(arg, range_shift);
+  }
+};
+
 template <typename Arg, typename Enabler = void>
 struct shift_trait {
   typedef Arg type;
@@ -161,6 +204,15 @@ class Shift : public TiledArray::tile_interface::Shift<Result, Arg> {};
 template <typename Result, typename Arg>
 class ShiftTo : public TiledArray::tile_interface::ShiftTo<Result, Arg> {};
 
+/// Shift the range of tile without copying its data
+
+/// The result shares the data of the argument tile if the tile type provides
+/// \c shift_view ; otherwise this operation is the same as \c Shift .
+/// \tparam Result The result tile type
+/// \tparam Argument The argument tile type
+template <typename Result, typename Arg>
+class ShiftView : public TiledArray::tile_interface::ShiftView<Result, Arg> {};
+
 }  // namespace TiledArray
 
 #endif  // TILEDARRAY_TILE_INTERFACE_SHIFT_H__INCLUDED
@@ -0,0 +1,165 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  contract_fold.h
+ *  Dec 2, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_TILE_OP_CONTRACT_FOLD_H__INCLUDED
+#define TILEDARRAY_TILE_OP_CONTRACT_FOLD_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/external/madness.h>
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+
+namespace TiledArray {
+namespace detail {
+
+/// Contract a pair of tiles and fold the product into a binary reduction
+
+/// Instead of accumulating the contraction result tile, each product of a
+/// pair of argument tiles is reduced with the matching tile of another
+/// array and then discarded, so the partial result of a tile is a value of
+/// the reduction (e.g. a dot product). This is only valid for reductions
+/// that are linear in their left-hand argument, such as \c DotReduction
+/// and \c InnerProductReduction .
+/// \tparam Contract The contraction operation type (see \c ContractReduce )
+/// \tparam Fold The binary reduction operation type
+template <typename Contract, typename Fold>
+class ContractFold {
+ public:
+  typedef ContractFold<Contract, Fold> ContractFold_;  ///< This class type
+  typedef typename Contract::first_argument_type
+      first_argument_type;  ///< The left tile type
+  typedef typename Contract::second_argument_type
+      second_argument_type;  ///< The right tile type
+  typedef typename Fold::result_type result_type;  ///< The result type
+  typedef typename std::remove_cv<typename std::remove_reference<
+      typename Fold::second_argument_type>::type>::type
+      other_type;  ///< The type of the tiles the products are reduced with
+  typedef std::unordered_map<std::size_t, Future<other_type> >
+      other_map;  ///< Map of result tile indices to tiles of the other array
+
+ private:
+  Contract contract_;  ///< The contraction operation
+  Fold fold_;          ///< The binary reduction
+  std::shared_ptr<const other_map> others_;  ///< Tiles of the other array
+  const Future<other_type>* other_;          ///< Tile of the bound result tile
+
+ public:
+  /// Constructor
+
+  /// \param contract The contraction operation
+  /// \param fold The binary reduction operation
+  /// \param others The local tiles of the other array
+  ContractFold(const Contract& contract, const Fold& fold,
+               const std::shared_ptr<const other_map>& others)
+      : contract_(contract), fold_(fold), others_(others), other_(nullptr) {}
+
+  ContractFold(const ContractFold_&) = default;
+  ContractFold_& operator=(const ContractFold_&) = default;
+
+  /// Bind this operation to a result tile
+
+  /// \param index The ordinal index of the result tile
+  /// \return A copy of this operation that reduces products with the tile of
+  /// the other array at \c index
+  ContractFold_ bind(const std::size_t index) const {
+    TA_ASSERT(others_);
+    const auto it = others_->find(index);
+    TA_ASSERT(it != others_->end());
+    ContractFold_ result(*this);
+    result.other_ = &(it->second);
+    return result;
+  }
+
+  /// Create a result type object
+  result_type operator()() const { return fold_(); }
+
+  /// Post processing step
+
+  /// The partial results are post processed after they are combined.
+  result_type operator()(const result_type& temp) const { return temp; }
+
+  /// Reduce two result objects
+  void operator()(result_type& result, const result_type& arg) const {
+    fold_(result, arg);
+  }
+
+  /// Contract a pair of tiles and fold the product into a result
+
+  /// \param[in,out] result The reduction target
+  /// \param[in] left The left-hand tile to be contracted
+  /// \param[in] right The right-hand tile to be contracted
+  void operator()(result_type& result, first_argument_type left,
+                  second_argument_type right) const {
+    TA_ASSERT(other_);
+    auto product = contract_();
+    contract_(product, left, right);
+    fold_(result, contract_(product), other_->get());
+  }
+
+};  // class ContractFold
+
+/// Local reduction of the partial results of a \c ContractFold
+
+/// \tparam Fold The binary reduction operation type
+template <typename Fold>
+class FoldReduce {
+ public:
+  typedef typename Fold::result_type result_type;  ///< The result type
+  typedef result_type argument_type;               ///< The argument type
+
+ private:
+  Fold fold_;  ///< The binary reduction
+
+ public:
+  /// Constructor
+
+  /// \param fold The binary reduction operation
+  FoldReduce(const Fold& fold) : fold_(fold) {}
+
+  /// Create a result type object
+  result_type operator()() const { return fold_(); }
+
+  /// Post processing step
+  result_type operator()(const result_type& temp) const { return fold_(temp); }
+
+  /// Reduce two result objects
+  void operator()(result_type& result, const argument_type& arg) const {
+    fold_(result, arg);
+  }
+
+};  // class FoldReduce
+
+/// Test for \c ContractFold operations
+template <typename T>
+struct is_contract_fold : public std::false_type {};
+
+template <typename Contract, typename Fold>
+struct is_contract_fold<ContractFold<Contract, Fold> > : public std::true_type {
+};
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_TILE_OP_CONTRACT_FOLD_H__INCLUDED
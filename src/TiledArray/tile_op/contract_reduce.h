@@ -30,6 +30,7 @@
 #include <TiledArray/permutation.h>
 #include <TiledArray/tensor/complex.h>
 #include <TiledArray/tile_op/tile_interface.h>
+#include <TiledArray/util/timeline.h>
 #include "../tile_interface/add.h"
 #include "../tile_interface/permute.h"
 
@@ -248,6 +249,8 @@ class ContractReduce : public ContractReduceBase<Result, Left, Right, Scalar> {
                   second_argument_type right) const {
     using TiledArray::empty;
     using TiledArray::gemm;
+    TiledArray::detail::TimelineScope scope(
+        TiledArray::detail::TimelineCategory::gemm, "gemm");
     if (empty(result))
       result = gemm(left, right, ContractReduceBase_::factor(),
                     ContractReduceBase_::gemm_helper());
@@ -353,6 +356,8 @@ class ContractReduce<Result, Left, Right,
                   second_argument_type right) const {
     using TiledArray::empty;
     using TiledArray::gemm;
+    TiledArray::detail::TimelineScope scope(
+        TiledArray::detail::TimelineCategory::gemm, "gemm");
     if (empty(result))
       result = gemm(left, right, 1, ContractReduceBase_::gemm_helper());
     else
@@ -458,6 +463,8 @@ class ContractReduce<Result, Left, Right,
                   second_argument_type right) const {
     using TiledArray::empty;
     using TiledArray::gemm;
+    TiledArray::detail::TimelineScope scope(
+        TiledArray::detail::TimelineCategory::gemm, "gemm");
     if (empty(result))
       result = gemm(left, right, 1, ContractReduceBase_::gemm_helper());
     else
@@ -0,0 +1,240 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  func.h
+ *  Dec 18, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_TILE_OP_FUNC_H__INCLUDED
+#define TILEDARRAY_TILE_OP_FUNC_H__INCLUDED
+
+#include <TiledArray/tile_op/tile_interface.h>
+
+#include <cmath>
+#include <ios>
+#include <ostream>
+#include <type_traits>
+#include <typeinfo>
+
+namespace TiledArray {
+namespace detail {
+
+/// Tile element-wise function operation
+
+/// This operation applies an element function to the content of a tile and
+/// applies a permutation to the result tensor. If no permutation is given or
+/// the permutation is null, then the result is not permuted. The element
+/// function is called as <tt>op(arg[i])</tt> and returns the result element.
+/// \tparam Result The result type
+/// \tparam Arg The argument type
+/// \tparam Op The element function type
+/// \tparam Consumable Flag that is \c true when Arg is consumable
+template <typename Result, typename Arg, typename Op, bool Consumable>
+class Func {
+ public:
+  typedef Func<Result, Arg, Op, Consumable> Func_;  ///< This object type
+  typedef Arg argument_type;                        ///< The argument type
+  typedef Result result_type;                       ///< The result tile type
+  typedef Op element_op_type;  ///< The element function type
+
+  static constexpr bool is_consumable =
+      Consumable && std::is_same<result_type, argument_type>::value;
+
+ private:
+  element_op_type op_;  ///< The element function
+
+  // Permuting tile evaluation function
+  // These operations cannot consume the argument tile since this operation
+  // requires temporary storage space.
+
+  result_type eval(const Arg& arg, const Permutation& perm) const {
+    using TiledArray::unary;
+    return unary(arg, op_, perm);
+  }
+
+  // Non-permuting tile evaluation functions
+  // The compiler will select the correct functions based on the
+  // consumability of the arguments.
+
+  template <bool C, typename std::enable_if<!C>::type* = nullptr>
+  result_type eval(const argument_type& arg) const {
+    using TiledArray::unary;
+    return unary(arg, op_);
+  }
+
+  template <bool C, typename std::enable_if<C>::type* = nullptr>
+  result_type eval(argument_type& arg) const {
+    using TiledArray::inplace_unary;
+    const element_op_type& op = op_;
+    return inplace_unary(arg, [&op](auto& element) {
+      element = op(element);
+    });
+  }
+
+ public:
+  // Compiler generated functions
+  Func(const Func_&) = default;
+  Func(Func_&&) = default;
+  ~Func() = default;
+  Func_& operator=(const Func_&) = default;
+  Func_& operator=(Func_&&) = default;
+
+  /// Constructor
+
+  /// \param op The element function
+  explicit Func(const element_op_type& op) : op_(op) {}
+
+  /// Element function accessor
+
+  /// \return A const reference to the element function
+  const element_op_type& op() const { return op_; }
+
+  /// Function and permute operator
+
+  /// \param arg The tile argument
+  /// \param perm The permutation applied to the result tile
+  /// \return A permuted copy of `arg` with the function applied
+  result_type operator()(const argument_type& arg,
+                         const Permutation& perm) const {
+    return eval(arg, perm);
+  }
+
+  /// Consuming function operation
+
+  /// \tparam A The tile argument type
+  /// \param arg The tile argument
+  /// \return A copy of `arg` with the function applied
+  template <typename A>
+  result_type operator()(A&& arg) const {
+    return Func_::template eval<is_consumable>(std::forward<A>(arg));
+  }
+
+  /// Explicit consuming function operation
+
+  /// \param arg The tile argument
+  /// \return `arg` with the function applied in-place
+  result_type consume(argument_type& arg) const {
+    constexpr bool can_consume =
+        is_consumable_tile<argument_type>::value &&
+        std::is_same<result_type, argument_type>::value;
+    return Func_::template eval<can_consume>(arg);
+  }
+
+};  // class Func
+
+/// Element exponential
+
+/// \tparam T The element type
+template <typename T>
+struct ExpOp {
+  T operator()(const T arg) const {
+    using std::exp;
+    return exp(arg);
+  }
+};  // struct ExpOp
+
+/// Element natural logarithm
+
+/// \tparam T The element type
+template <typename T>
+struct LogOp {
+  T operator()(const T arg) const {
+    using std::log;
+    return log(arg);
+  }
+};  // struct LogOp
+
+/// Element square root
+
+/// \tparam T The element type
+template <typename T>
+struct SqrtOp {
+  T operator()(const T arg) const {
+    using std::sqrt;
+    return sqrt(arg);
+  }
+};  // struct SqrtOp
+
+/// Element reciprocal
+
+/// \tparam T The element type
+template <typename T>
+struct InvOp {
+  T operator()(const T arg) const { return T(1) / arg; }
+};  // struct InvOp
+
+/// Element power
+
+/// \tparam T The element type
+/// \tparam Scalar The exponent type
+template <typename T, typename Scalar>
+class PowOp {
+  Scalar exponent_;  ///< The exponent
+
+ public:
+  /// \param exponent The exponent
+  explicit PowOp(const Scalar exponent) : exponent_(exponent) {}
+
+  /// \return The exponent
+  Scalar exponent() const { return exponent_; }
+
+  T operator()(const T arg) const {
+    using std::pow;
+    return pow(arg, exponent_);
+  }
+};  // class PowOp
+
+/// Write the identity of an element function
+
+/// An empty element function, e.g. a lambda without captures or one of the
+/// element operations of TiledArray, is identified by its type. Other
+/// element functions cannot be identified safely: their bytes may be
+/// pointers or references to values that change between evaluations. So the
+/// failbit of \c os is set and expressions that contain them are not cached
+/// (see \c expressions::ExprCache ), unless a \c func_key() overload for
+/// their type, which writes all of their state, is provided in their
+/// namespace.
+/// \tparam Op The element function type
+/// \param os The output stream
+/// \param op The element function
+template <typename Op>
+inline void func_key(std::ostream& os, const Op&) {
+  if (std::is_empty<Op>::value)
+    os << typeid(Op).name();
+  else
+    os.setstate(std::ios_base::failbit);
+}
+
+/// Write the identity of an element power function
+
+/// \tparam T The element type
+/// \tparam Scalar The exponent type
+/// \param os The output stream
+/// \param op The element power function
+template <typename T, typename Scalar>
+inline void func_key(std::ostream& os, const PowOp<T, Scalar>& op) {
+  // Write the exponent exactly
+  const std::ios_base::fmtflags flags = os.flags();
+  os << typeid(op).name() << "^" << std::hexfloat << op.exponent();
+  os.flags(flags);
+}
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_TILE_OP_FUNC_H__INCLUDED
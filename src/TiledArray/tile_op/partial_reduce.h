@@ -0,0 +1,235 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  partial_reduce.h
+ *  Dec 16, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_TILE_OP_PARTIAL_REDUCE_H__INCLUDED
+#define TILEDARRAY_TILE_OP_PARTIAL_REDUCE_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/math/partial_reduce.h>
+#include <TiledArray/tensor/complex.h>
+#include <TiledArray/tile_interface/clone.h>
+#include <TiledArray/tile_op/tile_interface.h>
+#include <TiledArray/type_traits.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace TiledArray {
+namespace detail {
+
+/// Partial reduction of tiles
+
+/// The modes of a tile are split into the kept modes, which are the result
+/// tile modes, and the reduced modes. The kept modes either lead (row
+/// reduction) or trail (column reduction) the modes of the argument tile.
+/// Elements are reduced with <tt>reduce_op(result[i], arg[i][j])</tt> and
+/// partial results are combined with <tt>join_op(result[i], other[i])</tt>,
+/// as in \c Tensor::reduce() .
+/// \tparam Result The result tile type
+/// \tparam ReduceOp The element reduction operation type
+/// \tparam JoinOp The element join operation type
+/// \tparam Scalar The identity type of the reduction
+template <typename Result, typename ReduceOp, typename JoinOp, typename Scalar>
+class PartialReduce {
+ public:
+  typedef PartialReduce<Result, ReduceOp, JoinOp, Scalar>
+      PartialReduce_;          ///< This class type
+  typedef Result result_type;  ///< The result tile type
+  typedef Scalar scalar_type;  ///< The identity type
+
+ private:
+  ReduceOp reduce_op_;    ///< The element reduction operation
+  JoinOp join_op_;        ///< The element join operation
+  scalar_type identity_;  ///< The identity of the reduction
+  unsigned int rank_;     ///< The number of kept modes
+  bool row_;              ///< The kept modes lead the argument modes
+  typename result_type::value_type
+      zero_;  ///< The reduction of a zero element into the identity
+
+  /// Reduce an evaluated tile
+
+  /// \tparam Arg The argument tile type
+  /// \param arg The argument tile
+  /// \return The reduced tile
+  template <typename Arg>
+  result_type reduce(const Arg& arg) const {
+    const auto& range = arg.range();
+    TA_ASSERT(range.rank() >= rank_);
+
+    // The range of the kept modes
+    const unsigned int offset = (row_ ? 0u : range.rank() - rank_);
+    std::vector<std::size_t> lower(rank_), upper(rank_);
+    for (unsigned int d = 0u; d < rank_; ++d) {
+      lower[d] = range.lobound_data()[offset + d];
+      upper[d] = range.upbound_data()[offset + d];
+    }
+
+    result_type result(typename result_type::range_type(lower, upper),
+                       identity_);
+    const std::size_t m = result.range().volume();
+    const std::size_t n = range.volume() / m;
+    if (row_)
+      math::row_reduce(m, n, arg.data(), result.data(), reduce_op_);
+    else
+      math::col_reduce(n, m, arg.data(), result.data(), reduce_op_);
+
+    return result;
+  }
+
+ public:
+  // Compiler generated functions
+  PartialReduce(const PartialReduce_&) = default;
+  PartialReduce(PartialReduce_&&) = default;
+  ~PartialReduce() = default;
+  PartialReduce_& operator=(const PartialReduce_&) = default;
+  PartialReduce_& operator=(PartialReduce_&&) = default;
+
+  /// Constructor
+
+  /// \param reduce_op The element reduction operation
+  /// \param join_op The element join operation
+  /// \param identity The identity of the reduction
+  /// \param rank The number of kept modes
+  /// \param row The kept modes lead the argument modes
+  PartialReduce(const ReduceOp& reduce_op, const JoinOp& join_op,
+                const scalar_type identity, const unsigned int rank,
+                const bool row)
+      : reduce_op_(reduce_op),
+        join_op_(join_op),
+        identity_(identity),
+        rank_(rank),
+        row_(row),
+        zero_(identity) {
+    reduce_op_(zero_, typename result_type::value_type(0));
+  }
+
+  /// \return The identity of the reduction
+  scalar_type identity() const { return identity_; }
+
+  /// \return The number of kept modes
+  unsigned int rank() const { return rank_; }
+
+  /// \return \c true if the kept modes lead the argument modes
+  bool row() const { return row_; }
+
+  /// \return \c true if the elements of zero tiles do not change a
+  /// reduction, e.g. of a sum
+  bool zero_is_identity() const {
+    return zero_ == typename result_type::value_type(identity_);
+  }
+
+  /// Reduce a zero tile
+
+  /// \tparam Range The range type
+  /// \param range The range of the result tile
+  /// \return The result tile of a zero argument tile
+  template <typename Range>
+  result_type zero(const Range& range) const {
+    return result_type(range, zero_);
+  }
+
+  /// Reduce a tile
+
+  /// \tparam Arg The argument tile type
+  /// \param arg The argument tile
+  /// \return The tile of the kept modes of \c arg
+  template <typename Arg,
+            typename std::enable_if<!is_lazy_tile<Arg>::value>::type* = nullptr>
+  result_type operator()(const Arg& arg) const {
+    return reduce(arg);
+  }
+
+  /// Reduce a lazy tile
+
+  /// \tparam Arg The lazy tile type
+  /// \param arg The argument tile
+  /// \return The tile of the kept modes of the evaluated \c arg
+  template <typename Arg,
+            typename std::enable_if<is_lazy_tile<Arg>::value>::type* = nullptr>
+  result_type operator()(const Arg& arg) const {
+    const typename eval_trait<Arg>::type eval_arg(arg);
+    return reduce(eval_arg);
+  }
+
+  /// Join two partial results
+
+  /// An empty tile is the identity of the join.
+  /// \param first The first partial result
+  /// \param second The second partial result
+  /// \return The joined result
+  result_type operator()(const result_type& first,
+                         const result_type& second) const {
+    if (second.empty()) return first;
+    if (first.empty()) return second;
+    TA_ASSERT(first.range() == second.range());
+
+    result_type result = clone(first);
+    math::inplace_vector_op(join_op_, result.range().volume(), result.data(),
+                            second.data());
+    return result;
+  }
+
+};  // class PartialReduce
+
+/// Element sum of partial reductions
+
+/// \tparam T The element type
+template <typename T>
+struct PartialSumOp {
+  void operator()(T& result, const T arg) const { result += arg; }
+};  // struct PartialSumOp
+
+/// Element squared norm of partial reductions
+
+/// The partial results are joined with \c PartialSumOp .
+/// \tparam T The element type
+template <typename T>
+struct PartialSquaredNormOp {
+  void operator()(T& result, const T arg) const {
+    result += TiledArray::detail::norm(arg);
+  }
+};  // struct PartialSquaredNormOp
+
+/// Element maximum of partial reductions
+
+/// \tparam T The element type
+template <typename T>
+struct PartialMaxOp {
+  void operator()(T& result, const T arg) const {
+    result = std::max(result, arg);
+  }
+};  // struct PartialMaxOp
+
+/// Element minimum of partial reductions
+
+/// \tparam T The element type
+template <typename T>
+struct PartialMinOp {
+  void operator()(T& result, const T arg) const {
+    result = std::min(result, arg);
+  }
+};  // struct PartialMinOp
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_TILE_OP_PARTIAL_REDUCE_H__INCLUDED
@@ -55,6 +55,7 @@ class Shift {
 
  private:
   std::vector<long> range_shift_;
+  bool view_;  ///< If true, non-consumable results share the argument data
 
   // Permuting tile evaluation function
   // These operations cannot consume the argument tile since this operation
@@ -70,10 +71,17 @@ class Shift {
 
   // Non-permuting tile evaluation functions
   // The compiler will select the correct functions based on the
-  // consumability of the arguments.
+  // consumability of the arguments. An argument that cannot be consumed is
+  // copied, unless the result is a view, i.e. it is passed to consumers
+  // that copy the data if they modify it, and its tile type supports
+  // shifted views.
 
   template <bool C, typename = void>
-  auto eval(const argument_type& arg) const {
+  result_type eval(const argument_type& arg) const {
+    if (view_) {
+      TiledArray::ShiftView<result_type, argument_type> shift_view;
+      return shift_view(arg, range_shift_);
+    }
     TiledArray::Shift<result_type, argument_type> shift;
     return shift(arg, range_shift_);
   }
@@ -104,7 +112,11 @@ class Shift {
   /// Default constructor
 
   /// Construct a no operation that does not permute the result tile
-  Shift(const std::vector<long>& range_shift) : range_shift_(range_shift) {}
+  /// \param range_shift The offset to be applied to the tile ranges
+  /// \param view If true, the results of arguments that cannot be consumed
+  /// may share their data, so they must not be stored in an array
+  Shift(const std::vector<long>& range_shift, const bool view = false)
+      : range_shift_(range_shift), view_(view) {}
 
   /// Shift and permute operator
 
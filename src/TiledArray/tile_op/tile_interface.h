@@ -547,6 +547,49 @@ using result_of_neg_t = decltype(neg(std::declval<T>()...));
 template <typename... T>
 using result_of_neg_to_t = decltype(neg_to(std::declval<T>()...));
 
+// Element-wise function operations ------------------------------------------
+
+/// Apply an element-wise function to a tile
+
+/// \tparam Arg The tile argument type
+/// \tparam Op The element function type
+/// \param arg The tile argument
+/// \param op The element function
+/// \return A tile with elements <tt>op(arg[i])</tt>
+template <typename Arg, typename Op>
+inline auto unary(const Arg& arg, Op&& op) {
+  return arg.unary(std::forward<Op>(op));
+}
+
+/// Apply an element-wise function to a tile and permute the result
+
+/// \tparam Arg The tile argument type
+/// \tparam Op The element function type
+/// \param arg The tile argument
+/// \param op The element function
+/// \param perm The permutation to be applied to the result
+/// \return A tile that is equal to <tt>perm ^ op(arg)</tt>
+template <typename Arg, typename Op>
+inline auto unary(const Arg& arg, Op&& op, const Permutation& perm) {
+  return arg.unary(std::forward<Op>(op), perm);
+}
+
+/// Modify the elements of a tile in-place
+
+/// \tparam Result The result tile type
+/// \tparam Op The element operation type
+/// \param result The result tile
+/// \param op The element operation, which is called as <tt>op(result[i])</tt>
+/// with a reference to each element
+/// \return A reference to \c result
+template <typename Result, typename Op>
+inline Result& inplace_unary(Result& result, Op&& op) {
+  return result.inplace_unary(std::forward<Op>(op));
+}
+
+template <typename... T>
+using result_of_unary_t = decltype(unary(std::declval<T>()...));
+
 // Complex conjugate operations ---------------------------------------------
 
 /// Create a complex conjugated copy of a tile
@@ -0,0 +1,433 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  tile_spill.h
+ *  Nov 20, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_TILE_SPILL_H__INCLUDED
+#define TILEDARRAY_TILE_SPILL_H__INCLUDED
+
+#include <TiledArray/external/madness.h>
+#include <TiledArray/util/compression.h>
+#include <TiledArray/util/posix_file.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace TiledArray {
+namespace detail {
+
+/// Tile spill statistics
+struct TileSpillStats {
+  std::size_t writes = 0ul;     ///< The number of tiles written to disk
+  std::size_t reads = 0ul;      ///< The number of tiles read from disk
+  std::size_t evictions = 0ul;  ///< The number of tiles released from memory
+  std::size_t resident_bytes = 0ul;  ///< The size of the tiles in memory
+  std::size_t file_bytes = 0ul;      ///< The size of the spill file
+};  // struct TileSpillStats
+
+/// Out-of-core storage of local tiles
+
+/// Holds the futures of local tiles, keyed by their ordinal index, within a
+/// byte budget. The size of a tile is accounted for when its future is set.
+/// When the budget is exceeded, the least recently used tiles are written to
+/// an anonymous temporary file by tasks (write-behind), and released from
+/// memory once written. A released tile is read back by a task when it is
+/// requested or prefetched (read-ahead); until then, requests receive a
+/// future that is set when the read completes. Since tiles are set only
+/// once, a tile is written at most once, and tiles that were read back are
+/// released again without I/O.
+/// \tparam T The tile type
+/// \note Memory is only reclaimed when no other object holds the future of
+/// a released tile, e.g. a future returned by \c get() that is still alive;
+/// such tiles are no longer counted in \c TileSpillStats::resident_bytes .
+template <typename T>
+class TileSpill : public std::enable_shared_from_this<TileSpill<T> >,
+                  private madness::Spinlock {
+ public:
+  typedef TileSpill<T> TileSpill_;  ///< This object type
+  typedef std::size_t key_type;     ///< Tile key type
+  typedef Future<T> future;         ///< Tile future type
+
+ private:
+  typedef std::list<key_type> lru_list;  ///< Keys, most recent first
+
+  /// Location of a tile
+  enum class State {
+    pending,   ///< In memory, not set yet
+    resident,  ///< In memory
+    writing,   ///< In memory, being written to disk
+    spilled,   ///< On disk only
+    reading    ///< Being read from disk
+  };
+
+  struct Entry {
+    future value;                        ///< The tile, if it is in memory
+    State state;                         ///< The location of the tile
+    std::size_t bytes;                   ///< Tile size, 0 until it is set
+    std::uint64_t offset;                ///< Offset of the tile in the file
+    bool on_disk;                        ///< The tile has been written
+    bool in_flight;                      ///< The tile is being written
+    typename lru_list::iterator lru_it;  ///< Position in the LRU list
+  };  // struct Entry
+
+  /// A tile that is moved between memory and disk
+  struct Transfer {
+    key_type key;
+    future value;
+    std::uint64_t offset;
+    std::size_t bytes;
+  };  // struct Transfer
+
+  World& world_;
+  const std::size_t max_bytes_;      ///< Byte budget
+  std::unique_ptr<PosixFile> file_;  ///< The spill file
+  std::unordered_map<key_type, Entry> entries_;
+  lru_list lru_;               ///< Resident tiles, most recent first
+  std::size_t writing_bytes_;  ///< Size of the tiles being written
+  TileSpillStats stats_;
+
+  /// Size of the serialized tile
+
+  /// Spilled tiles are not compressed, so their size does not depend on the
+  /// compression parameters of the thread that writes them.
+  static std::size_t value_bytes(const T& value) {
+    return uncompressed_bytes(value);
+  }
+
+  /// Select tiles for release until the byte budget is satisfied
+
+  /// Tiles that are already on disk are released immediately. A tile whose
+  /// write is still in flight, because it was requested and evicted again
+  /// meanwhile, keeps its offset and is released when that write completes.
+  /// \return The tiles that must be written before they are released
+  /// \note Assume the object is already locked
+  std::vector<Transfer> evict() {
+    std::vector<Transfer> writes;
+    while ((stats_.resident_bytes - writing_bytes_ > max_bytes_) &&
+           !lru_.empty()) {
+      const key_type key = lru_.back();
+      lru_.pop_back();
+      Entry& entry = entries_[key];
+      entry.lru_it = lru_.end();
+      ++stats_.evictions;
+      if (entry.on_disk) {
+        entry.value = future();
+        entry.state = State::spilled;
+        stats_.resident_bytes -= entry.bytes;
+      } else if (entry.in_flight) {
+        entry.state = State::writing;
+        writing_bytes_ += entry.bytes;
+      } else {
+        entry.state = State::writing;
+        entry.in_flight = true;
+        entry.offset = stats_.file_bytes;
+        stats_.file_bytes += entry.bytes;
+        writing_bytes_ += entry.bytes;
+        writes.push_back(
+            Transfer{key, entry.value, entry.offset, entry.bytes});
+      }
+    }
+    return writes;
+  }
+
+  /// Start the write-behind tasks
+  void write(const std::vector<Transfer>& writes) {
+    std::shared_ptr<TileSpill_> self = this->shared_from_this();
+    for (const auto& w : writes) {
+      const key_type key = w.key;
+      const std::uint64_t offset = w.offset;
+      const std::size_t bytes = w.bytes;
+      world_.taskq.add(
+          [self, key, offset, bytes](const T& value) {
+            const CompressionParams none;
+            CompressionScope scope(&none);
+            std::vector<unsigned char> buffer(bytes);
+            madness::archive::BufferOutputArchive ar(buffer.data(),
+                                                     buffer.size());
+            ar& value;
+            self->file_->write(buffer.data(), buffer.size(), offset);
+            self->written(key, offset);
+          },
+          w.value);
+    }
+  }
+
+  /// Release tile \c key once it has been written
+
+  /// \param key The tile key
+  /// \param offset The offset of the written tile
+  void written(const key_type key, const std::uint64_t offset) {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    Entry& entry = entries_[key];
+    TA_ASSERT(entry.in_flight);
+    entry.in_flight = false;
+    // The offset does not move while a write is in flight
+    TA_ASSERT(entry.offset == offset);
+    if (entry.offset != offset) return;
+    entry.on_disk = true;
+    ++stats_.writes;
+    // The tile was requested while it was written, if it is not writing
+    if (entry.state == State::writing) {
+      entry.value = future();
+      entry.state = State::spilled;
+      stats_.resident_bytes -= entry.bytes;
+      writing_bytes_ -= entry.bytes;
+    }
+  }
+
+  /// Mark spilled tile \c key for reading
+
+  /// \note Assume the object is already locked and the tile is spilled
+  Transfer start_read(const key_type key, Entry& entry) {
+    TA_ASSERT(entry.state == State::spilled);
+    entry.value = future();
+    entry.state = State::reading;
+    return Transfer{key, entry.value, entry.offset, entry.bytes};
+  }
+
+  /// Start the read-ahead task
+  void read(const Transfer& r) {
+    std::shared_ptr<TileSpill_> self = this->shared_from_this();
+    const key_type key = r.key;
+    const std::uint64_t offset = r.offset;
+    const std::size_t bytes = r.bytes;
+    future result = r.value;
+    world_.taskq.add(
+        [self, key, offset, bytes, result]() mutable {
+          std::vector<unsigned char> buffer(bytes);
+          self->file_->read(buffer.data(), buffer.size(), offset);
+          madness::archive::BufferInputArchive ar(buffer.data(),
+                                                  buffer.size());
+          T value;
+          ar& value;
+          result.set(std::move(value));
+          self->resident(key, bytes, true);
+        },
+        madness::TaskAttributes::hipri());
+  }
+
+  /// Account for tile \c key once it is in memory
+  void resident(const key_type key, const std::size_t bytes,
+                const bool was_read) {
+    std::vector<Transfer> writes;
+    {
+      madness::ScopedMutex<madness::Spinlock> locker(this);
+      Entry& entry = entries_[key];
+      TA_ASSERT(entry.state == State::pending ||
+                entry.state == State::reading);
+      if (was_read) ++stats_.reads;
+      entry.state = State::resident;
+      entry.bytes = bytes;
+      stats_.resident_bytes += bytes;
+      lru_.push_front(key);
+      entry.lru_it = lru_.begin();
+      writes = evict();
+    }
+    write(writes);
+  }
+
+  /// Account for a tile when its future is set
+
+  /// This is a future callback, not a task, so a tile that is requested but
+  /// never set does not keep a task pending, which would block fence.
+  class Watcher : public madness::CallbackInterface {
+    std::weak_ptr<TileSpill_> spill_;  ///< The spill that holds the tile
+    key_type key_;                     ///< The tile key
+    future value_;                     ///< The tile
+
+   public:
+    Watcher(const std::weak_ptr<TileSpill_>& spill, const key_type key,
+            const future& value)
+        : spill_(spill), key_(key), value_(value) {}
+
+    virtual void notify() {
+      if (auto spill = spill_.lock())
+        spill->resident(key_, value_bytes(value_.get()), false);
+      delete this;
+    }
+  };  // class Watcher
+
+  /// Account for tile \c key when its future is set
+  void watch(const key_type key, const future& value) {
+    Watcher* watcher = new Watcher(this->shared_from_this(), key, value);
+    if (value.probe())
+      watcher->notify();
+    else
+      const_cast<future&>(value).register_callback(watcher);
+  }
+
+  /// Mark tile \c key as used
+
+  /// \return A spilled tile that must be read, with a zero size otherwise
+  /// \note Assume the object is already locked
+  Transfer touch(const key_type key, Entry& entry) {
+    switch (entry.state) {
+      case State::resident:
+        lru_.splice(lru_.begin(), lru_, entry.lru_it);
+        break;
+      case State::writing:
+        // Keep the tile in memory; the write completes anyway, and the tile
+        // is not written again if it is evicted before then
+        entry.state = State::resident;
+        writing_bytes_ -= entry.bytes;
+        lru_.push_front(key);
+        entry.lru_it = lru_.begin();
+        break;
+      case State::spilled:
+        return start_read(key, entry);
+      default:
+        break;
+    }
+    return Transfer{key, future(), 0ul, 0ul};
+  }
+
+ public:
+  /// Constructor
+
+  /// \param world The world that owns the tiles
+  /// \param max_bytes The byte budget of the tiles held in memory
+  /// \param directory The directory of the spill file
+  /// \throw TiledArray::Exception When the spill file cannot be created
+  TileSpill(World& world, const std::size_t max_bytes,
+            const std::string& directory)
+      : madness::Spinlock(),
+        world_(world),
+        max_bytes_(max_bytes),
+        file_(PosixFile::temporary(directory)),
+        entries_(),
+        lru_(),
+        writing_bytes_(0ul),
+        stats_() {}
+
+  /// Default spill directory
+
+  /// \return The value of the \c TA_SPILL_DIR environment variable, or of
+  /// \c TMPDIR if it is not set, or \c /tmp
+  static std::string default_directory() {
+    if (const char* dir = std::getenv("TA_SPILL_DIR")) return dir;
+    if (const char* dir = std::getenv("TMPDIR")) return dir;
+    return "/tmp";
+  }
+
+  /// Tile accessor
+
+  /// Tiles that are on disk are read back. A tile that is not held yet is
+  /// inserted, and it must be set later.
+  /// \param key The tile key
+  /// \return The future of tile \c key
+  future get(const key_type key) {
+    future result;
+    Transfer r{key, future(), 0ul, 0ul};
+    bool inserted = false;
+    {
+      madness::ScopedMutex<madness::Spinlock> locker(this);
+      auto it = entries_.find(key);
+      if (it == entries_.end()) {
+        it = entries_
+                 .emplace(key, Entry{future(), State::pending, 0ul, 0ul,
+                                     false, false, lru_.end()})
+                 .first;
+        inserted = true;
+      } else {
+        r = touch(key, it->second);
+      }
+      result = it->second.value;
+    }
+
+    if (inserted) watch(key, result);
+    if (r.bytes != 0ul) read(r);
+    return result;
+  }
+
+  /// Insert a tile
+
+  /// \param key The tile key, which must not be held yet
+  /// \param value The tile future
+  void insert(const key_type key, const future& value) {
+    {
+      madness::ScopedMutex<madness::Spinlock> locker(this);
+      const bool inserted =
+          entries_
+              .emplace(key, Entry{value, State::pending, 0ul, 0ul, false, false,
+                                  lru_.end()})
+              .second;
+      TA_ASSERT(inserted);
+      (void)inserted;
+    }
+    watch(key, value);
+  }
+
+  /// Start reading a tile from disk
+
+  /// Marks tile \c key as recently used and, if it is on disk only, starts
+  /// reading it, so a later \c get() does not wait for I/O. Tiles that are
+  /// not held are ignored.
+  /// \param key The tile key
+  void prefetch(const key_type key) {
+    Transfer r{key, future(), 0ul, 0ul};
+    {
+      madness::ScopedMutex<madness::Spinlock> locker(this);
+      auto it = entries_.find(key);
+      if (it == entries_.end()) return;
+      r = touch(key, it->second);
+    }
+    if (r.bytes != 0ul) read(r);
+  }
+
+  /// Keys of the held tiles
+
+  /// \return The keys of all tiles, in memory or on disk
+  std::vector<key_type> keys() const {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    std::vector<key_type> result;
+    result.reserve(entries_.size());
+    for (const auto& entry : entries_) result.push_back(entry.first);
+    return result;
+  }
+
+  /// Number of held tiles
+
+  /// \return The number of tiles, in memory or on disk
+  std::size_t size() const {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    return entries_.size();
+  }
+
+  /// Byte budget accessor
+
+  /// \return The maximum size of the tiles held in memory, in bytes
+  std::size_t max_bytes() const { return max_bytes_; }
+
+  /// Spill statistics accessor
+
+  /// \return A snapshot of the spill statistics
+  TileSpillStats stats() const {
+    madness::ScopedMutex<madness::Spinlock> locker(this);
+    return stats_;
+  }
+
+};  // class TileSpill
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_TILE_SPILL_H__INCLUDED
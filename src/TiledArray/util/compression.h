@@ -0,0 +1,701 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  util/compression.h
+ *  Nov 22, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_UTIL_COMPRESSION_H__INCLUDED
+#define TILEDARRAY_UTIL_COMPRESSION_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/external/madness.h>
+#include <TiledArray/util/time.h>
+
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace TiledArray {
+namespace detail {
+
+/// Compression parameters of serialized tile data
+
+/// When compression is enabled, the elements of tensors of numeric type are
+/// byte-shuffled (the i-th bytes of all elements are grouped) and
+/// run-length encoded when they are serialized, which shrinks the exponent
+/// and sign bytes of data with many small or zero elements. A sample of the
+/// data is compressed first, and the data is sent uncompressed when the
+/// sample or the whole data does not compress to \c max_ratio of its size,
+/// so incompressible data costs little time.
+///
+/// When \c abs_error is positive, elements of floating-point and complex
+/// type are instead quantized to the nearest multiple of
+/// <tt>2 * abs_error</tt>, so every element (every real and imaginary part)
+/// is reconstructed with an absolute error of at most \c abs_error . This
+/// is meant for intermediates whose elements below the screening threshold
+/// are insignificant, see \c lossy_compression_params() .
+struct CompressionParams {
+  bool enabled = false;              ///< Compress serialized data
+  std::size_t min_bytes = 4096ul;    ///< Smaller data is not compressed
+  std::size_t sample_bytes = 16384;  ///< Size of the sample compressed first
+  double max_ratio = 0.8;  ///< Compressed to raw size ratio above which
+                           ///< data is not compressed
+  double abs_error = 0.0;  ///< Absolute error bound of lossy compression,
+                           ///< 0 for lossless compression
+
+  /// Default compression parameters
+
+  /// The default parameters apply to all serialized tensors, unless other
+  /// parameters are selected with a \c CompressionScope .
+  /// \return A reference to the default compression parameters
+  static CompressionParams& default_params() {
+    static CompressionParams value;
+    return value;
+  }
+};  // struct CompressionParams
+
+/// Snapshot of compression counters
+struct CompressionStats {
+  std::size_t compressed = 0ul;  ///< The number of compressed buffers
+  std::size_t skipped = 0ul;     ///< The number of buffers sent raw
+  std::size_t raw_bytes = 0ul;   ///< Size of compressed buffers, before
+  std::size_t compressed_bytes = 0ul;  ///< Size of compressed buffers, after
+  std::size_t lossy = 0ul;       ///< The number of quantized buffers
+  double max_error = 0.0;        ///< Largest error of quantized elements
+  double compress_time = 0.0;    ///< Time spent compressing, in seconds
+  double decompress_time = 0.0;  ///< Time spent decompressing, in seconds
+
+  /// Compression ratio
+
+  /// \return The raw size over the compressed size of compressed buffers
+  double ratio() const {
+    return (compressed_bytes ? double(raw_bytes) / double(compressed_bytes)
+                             : 0.0);
+  }
+};  // struct CompressionStats
+
+/// Compression counters
+class CompressionCounters {
+  std::atomic<std::size_t> compressed_{0ul};
+  std::atomic<std::size_t> skipped_{0ul};
+  std::atomic<std::size_t> raw_bytes_{0ul};
+  std::atomic<std::size_t> compressed_bytes_{0ul};
+  std::atomic<std::int64_t> compress_ns_{0};
+  std::atomic<std::int64_t> decompress_ns_{0};
+  std::atomic<std::size_t> lossy_{0ul};
+  std::atomic<double> max_error_{0.0};
+
+ public:
+  /// Record a buffer
+
+  /// \param raw The size of the buffer
+  /// \param compressed The size of the compressed buffer, 0 if it was sent
+  /// raw
+  void record(const std::size_t raw, const std::size_t compressed) {
+    if (compressed) {
+      compressed_.fetch_add(1ul, std::memory_order_relaxed);
+      raw_bytes_.fetch_add(raw, std::memory_order_relaxed);
+      compressed_bytes_.fetch_add(compressed, std::memory_order_relaxed);
+    } else {
+      skipped_.fetch_add(1ul, std::memory_order_relaxed);
+    }
+  }
+
+  /// Record a quantized buffer
+
+  /// \param max_error The largest absolute error of the buffer elements
+  void record_lossy(const double max_error) {
+    lossy_.fetch_add(1ul, std::memory_order_relaxed);
+    double current = max_error_.load(std::memory_order_relaxed);
+    while (current < max_error &&
+           !max_error_.compare_exchange_weak(current, max_error,
+                                             std::memory_order_relaxed))
+      ;
+  }
+
+  /// Record compression time
+  void record_compress(const std::int64_t ns) {
+    compress_ns_.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  /// Record decompression time
+  void record_decompress(const std::int64_t ns) {
+    decompress_ns_.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  /// \return The current value of the counters
+  CompressionStats snapshot() const {
+    CompressionStats result;
+    result.compressed = compressed_.load(std::memory_order_relaxed);
+    result.skipped = skipped_.load(std::memory_order_relaxed);
+    result.raw_bytes = raw_bytes_.load(std::memory_order_relaxed);
+    result.compressed_bytes =
+        compressed_bytes_.load(std::memory_order_relaxed);
+    result.compress_time = 1.0e-9 * compress_ns_.load(std::memory_order_relaxed);
+    result.decompress_time =
+        1.0e-9 * decompress_ns_.load(std::memory_order_relaxed);
+    result.lossy = lossy_.load(std::memory_order_relaxed);
+    result.max_error = max_error_.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  /// Set all counters to zero
+  void reset() {
+    compressed_ = 0ul;
+    skipped_ = 0ul;
+    raw_bytes_ = 0ul;
+    compressed_bytes_ = 0ul;
+    compress_ns_ = 0;
+    decompress_ns_ = 0;
+    lossy_ = 0ul;
+    max_error_ = 0.0;
+  }
+
+  /// Counters for all serialized tensors
+
+  /// \return A reference to the global compression counters
+  static CompressionCounters& global() {
+    static CompressionCounters value;
+    return value;
+  }
+};  // class CompressionCounters
+
+/// Elements compressed by the counting pass of a serialization
+struct CompressedElements {
+  const void* data;                   ///< The elements
+  std::size_t bytes;                  ///< The size of the elements
+  bool compressed;                    ///< The elements were compressed
+  double max_error;                   ///< Quantization error, or -1
+  std::vector<unsigned char> result;  ///< The compressed elements
+};  // struct CompressedElements
+
+/// Select the compression parameters of the calling thread
+
+/// While this object exists, tensors serialized by the calling thread use
+/// the selected parameters instead of the default parameters.
+///
+/// Active messages serialize their arguments twice, first to count their
+/// size then to store them. A scope that reuses compressed elements keeps
+/// the elements compressed by counting passes, and the next storing pass of
+/// the same elements takes them instead of compressing again; the kept
+/// elements are released when they are stored or when the scope ends. Such
+/// a scope must only enclose the serialization of objects that are neither
+/// modified nor destroyed while it exists, e.g. the arguments of one
+/// message.
+class CompressionScope {
+  typedef std::vector<CompressedElements> reuse_type;
+
+  /// Compression state of a thread
+  struct State {
+    const CompressionParams* params = nullptr;  ///< Selected parameters
+    reuse_type* reuse = nullptr;  ///< Elements compressed by counting passes
+  };  // struct State
+
+  State previous_;    ///< The state of the outer scope
+  reuse_type reuse_;  ///< Elements compressed by counting passes
+
+  static State& state() {
+    static thread_local State value;
+    return value;
+  }
+
+ public:
+  /// Constructor
+
+  /// \param params The selected parameters; if null, the current parameters
+  /// are kept
+  /// \param reuse Reuse the elements compressed by counting passes
+  explicit CompressionScope(const CompressionParams* params,
+                            const bool reuse = false)
+      : previous_(state()), reuse_() {
+    if (params) state().params = params;
+    state().reuse = (reuse ? &reuse_ : nullptr);
+  }
+
+  CompressionScope(const CompressionScope&) = delete;
+  CompressionScope& operator=(const CompressionScope&) = delete;
+
+  ~CompressionScope() { state() = previous_; }
+
+  /// Current parameters accessor
+
+  /// \return The parameters selected for the calling thread
+  static const CompressionParams& current() {
+    const CompressionParams* ptr = state().params;
+    return (ptr ? *ptr : CompressionParams::default_params());
+  }
+
+  /// Elements compressed by counting passes
+
+  /// \return The elements kept by the innermost scope of the calling thread,
+  /// or null if it does not reuse compressed elements
+  static reuse_type* reuse() { return state().reuse; }
+};  // class CompressionScope
+
+/// Size of a serialized object, without compression
+
+/// \tparam T The object type
+/// \param value The object
+/// \return The size of \c value when it is serialized uncompressed
+template <typename T>
+std::size_t uncompressed_bytes(const T& value) {
+  const CompressionParams none;
+  CompressionScope scope(&none);
+  madness::archive::BufferOutputArchive count;
+  count& value;
+  return count.size();
+}
+
+/// Flag of the element count of a compressed serialized tensor
+constexpr std::uint64_t compressed_flag = 1ull << 63;
+
+/// Flag of the element count of a compressed tensor with a codec byte
+
+/// The compressed elements of a tensor serialized with this flag start with
+/// a \c Codec byte; without it, they hold only the byte-shuffled and
+/// run-length encoded elements, as written before lossy compression was
+/// added.
+constexpr std::uint64_t codec_flag = 1ull << 62;
+
+/// Compressed buffer formats, stored in the first byte of the buffer
+enum class Codec : unsigned char {
+  shuffle_rle = 0,  ///< Lossless byte shuffle and run-length encoding
+  quantized = 1     ///< Error-bounded quantization and run-length encoding
+};
+
+/// Byte-shuffle and run-length encode a buffer
+
+/// The encoded stream is a sequence of literal blocks (a control byte
+/// \c c < 128 followed by <tt>c + 1</tt> bytes) and runs (a control byte
+/// \c c >= 128 followed by one byte, repeated <tt>c - 125</tt> times).
+/// \param data The buffer
+/// \param n The size of \c data in bytes, a multiple of \c width
+/// \param width The size of the elements of \c data
+/// \param[out] result The buffer the encoded data is appended to
+inline void shuffle_rle_encode(const unsigned char* data, const std::size_t n,
+                               const std::size_t width,
+                               std::vector<unsigned char>& result) {
+  TA_ASSERT(n % width == 0ul);
+  const std::size_t count = n / width;
+  std::vector<unsigned char> shuffled(n);
+  for (std::size_t b = 0ul; b < width; ++b)
+    for (std::size_t i = 0ul; i < count; ++i)
+      shuffled[b * count + i] = data[i * width + b];
+
+  result.reserve(result.size() + n / 4ul);
+  const unsigned char* const s = shuffled.data();
+  std::size_t i = 0ul;
+  while (i < n) {
+    std::size_t run = 1ul;
+    while (i + run < n && run < 130ul && s[i + run] == s[i]) ++run;
+    if (run >= 3ul) {
+      result.push_back(static_cast<unsigned char>(125ul + run));
+      result.push_back(s[i]);
+      i += run;
+    } else {
+      // Extend the literal block until a run starts
+      const std::size_t first = i;
+      while (i < n && i - first < 128ul &&
+             !(i + 2ul < n && s[i] == s[i + 1ul] && s[i] == s[i + 2ul]))
+        ++i;
+      result.push_back(static_cast<unsigned char>(i - first - 1ul));
+      result.insert(result.end(), s + first, s + i);
+    }
+  }
+}
+
+/// Decode a buffer encoded by \c shuffle_rle_encode
+
+/// \param encoded The encoded buffer
+/// \param size The size of \c encoded
+/// \param[out] data The decoded buffer
+/// \param n The size of \c data in bytes
+/// \param width The size of the elements of \c data
+/// \throw TiledArray::Exception When \c encoded is corrupt
+inline void shuffle_rle_decode(const unsigned char* encoded,
+                               const std::size_t size, unsigned char* data,
+                               const std::size_t n, const std::size_t width) {
+  std::vector<unsigned char> shuffled(n);
+  std::size_t pos = 0ul, i = 0ul;
+  while (pos < size) {
+    const std::size_t c = encoded[pos++];
+    const std::size_t len = (c < 128ul ? c + 1ul : c - 125ul);
+    if (i + len > n || pos + (c < 128ul ? len : 1ul) > size)
+      TA_EXCEPTION("shuffle_rle_decode: corrupt buffer");
+    if (c < 128ul) {
+      std::memcpy(shuffled.data() + i, encoded + pos, len);
+      pos += len;
+    } else {
+      std::memset(shuffled.data() + i, encoded[pos++], len);
+    }
+    i += len;
+  }
+  if (i != n) TA_EXCEPTION("shuffle_rle_decode: corrupt buffer");
+
+  const std::size_t count = n / width;
+  for (std::size_t b = 0ul; b < width; ++b)
+    for (std::size_t k = 0ul; k < count; ++k)
+      data[k * width + b] = shuffled[b * count + k];
+}
+
+/// Compress a buffer losslessly if it is worthwhile
+
+/// \param data The buffer
+/// \param n The size of \c data in bytes, a multiple of \c width
+/// \param width The size of the elements of \c data
+/// \param params The compression parameters
+/// \param[out] result The compressed buffer
+/// \return \c true if \c data was compressed to \c result
+inline bool compress_bytes(const unsigned char* data, const std::size_t n,
+                           const std::size_t width,
+                           const CompressionParams& params,
+                           std::vector<unsigned char>& result) {
+  if (!params.enabled || n < params.min_bytes) return false;
+
+  // Give up early when a sample does not compress
+  const std::size_t sample = params.sample_bytes / width * width;
+  if (sample > 0ul && n > 2ul * sample) {
+    result.clear();
+    shuffle_rle_encode(data, sample, width, result);
+    if (double(result.size()) > params.max_ratio * double(sample))
+      return false;
+  }
+
+  result.assign(1ul, static_cast<unsigned char>(Codec::shuffle_rle));
+  shuffle_rle_encode(data, n, width, result);
+  return double(result.size()) <= params.max_ratio * double(n);
+}
+
+/// Real components of element types that support lossy compression
+
+/// \c type is \c void for other element types.
+template <typename T>
+struct lossy_component {
+  typedef void type;
+};
+
+template <>
+struct lossy_component<float> {
+  typedef float type;
+};
+
+template <>
+struct lossy_component<double> {
+  typedef double type;
+};
+
+template <typename T>
+struct lossy_component<std::complex<T> > {
+  typedef typename lossy_component<T>::type type;
+};
+
+/// Quantize a buffer of real numbers with a bounded absolute error
+
+/// Every element \c x is replaced by <tt>q * 2 * abs_error</tt>, with \c q
+/// the nearest integer of <tt>x / (2 * abs_error)</tt>, and the integers
+/// \c q are stored as run-length encoded variable-length integers. The
+/// error of every reconstructed element is checked during encoding.
+/// \tparam R The real type
+/// \param data The buffer
+/// \param n The number of elements of \c data
+/// \param abs_error The bound of the absolute error of every element
+/// \param[out] result The compressed buffer
+/// \param[out] max_error The largest absolute error of the elements
+/// \return \c false if an element is not finite, is too large to be
+/// quantized, or cannot be reconstructed within \c abs_error
+template <typename R>
+bool quantize_encode(const R* data, const std::size_t n,
+                     const double abs_error, std::vector<unsigned char>& result,
+                     double& max_error) {
+  const double step = 2.0 * abs_error;
+  const double limit = step * 4.0e18;
+  max_error = 0.0;
+
+  std::vector<unsigned char> varints;
+  varints.reserve(n);
+  for (std::size_t i = 0ul; i < n; ++i) {
+    const double x = data[i];
+    if (!(std::abs(x) < limit)) return false;
+    const std::int64_t q = std::llround(x / step);
+    const double error = std::abs(x - double(R(double(q) * step)));
+    if (!(error <= abs_error)) return false;
+    if (error > max_error) max_error = error;
+
+    // Zig-zag and variable-length encoding, so small integers take a byte
+    std::uint64_t z = (std::uint64_t(q) << 1) ^ std::uint64_t(q >> 63);
+    while (z >= 0x80ull) {
+      varints.push_back(static_cast<unsigned char>(z | 0x80ull));
+      z >>= 7;
+    }
+    varints.push_back(static_cast<unsigned char>(z));
+  }
+
+  result.assign(1ul, static_cast<unsigned char>(Codec::quantized));
+  const unsigned char* const step_bytes =
+      reinterpret_cast<const unsigned char*>(&step);
+  result.insert(result.end(), step_bytes, step_bytes + sizeof(step));
+  shuffle_rle_encode(varints.data(), varints.size(), 1ul, result);
+  return true;
+}
+
+/// Decode a buffer encoded by \c quantize_encode
+
+/// \tparam R The real type
+/// \param encoded The encoded buffer, without the codec byte
+/// \param size The size of \c encoded
+/// \param[out] data The decoded buffer
+/// \param n The number of elements of \c data
+/// \throw TiledArray::Exception When \c encoded is corrupt
+template <typename R>
+void quantize_decode(const unsigned char* encoded, const std::size_t size,
+                     R* data, const std::size_t n) {
+  double step = 0.0;
+  if (size < sizeof(step)) TA_EXCEPTION("quantize_decode: corrupt buffer");
+  std::memcpy(&step, encoded, sizeof(step));
+
+  // The run-length encoded stream holds at most 10 bytes per element
+  std::vector<unsigned char> varints;
+  std::size_t pos = sizeof(step), count = 0ul;
+  while (pos < size) {
+    const std::size_t c = encoded[pos++];
+    const std::size_t len = (c < 128ul ? c + 1ul : c - 125ul);
+    if (pos + (c < 128ul ? len : 1ul) > size)
+      TA_EXCEPTION("quantize_decode: corrupt buffer");
+    if (c < 128ul) {
+      varints.insert(varints.end(), encoded + pos, encoded + pos + len);
+      pos += len;
+    } else {
+      varints.insert(varints.end(), len, encoded[pos++]);
+    }
+    if (varints.size() > 10ul * n)
+      TA_EXCEPTION("quantize_decode: corrupt buffer");
+  }
+
+  pos = 0ul;
+  for (; count < n && pos < varints.size(); ++count) {
+    std::uint64_t z = 0ull;
+    for (unsigned shift = 0u; pos < varints.size(); shift += 7u) {
+      const unsigned char byte = varints[pos++];
+      z |= std::uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) break;
+    }
+    const std::int64_t q = std::int64_t(z >> 1) ^ -std::int64_t(z & 1ull);
+    data[count] = R(double(q) * step);
+  }
+  if (count != n || pos != varints.size())
+    TA_EXCEPTION("quantize_decode: corrupt buffer");
+}
+
+/// Quantize elements of a floating-point or complex type
+template <typename T, typename R>
+bool encode_lossy(const T* data, const std::size_t n, const double abs_error,
+                  std::vector<unsigned char>& result, double& max_error,
+                  const R*) {
+  return quantize_encode(reinterpret_cast<const R*>(data),
+                         n * (sizeof(T) / sizeof(R)), abs_error, result,
+                         max_error);
+}
+
+/// Elements of other types are not quantized
+template <typename T>
+bool encode_lossy(const T*, const std::size_t, const double,
+                  std::vector<unsigned char>&, double&, const void*) {
+  return false;
+}
+
+/// Compress elements with the codec selected by \c params
+
+/// Elements of floating-point type are quantized when \c params.abs_error
+/// is positive; other elements, and elements that cannot be quantized, are
+/// compressed losslessly.
+/// \tparam T A trivially copyable element type
+/// \param data The elements
+/// \param n The number of elements
+/// \param params The compression parameters
+/// \param[out] result The compressed elements
+/// \param[out] max_error The largest error of the quantized elements, or -1
+/// if the elements were not quantized
+/// \return \c true if the elements were compressed to \c result
+template <typename T>
+bool encode_elements(const T* data, const std::size_t n,
+                     const CompressionParams& params,
+                     std::vector<unsigned char>& result, double& max_error) {
+  typedef typename lossy_component<T>::type real_type;
+  const std::size_t bytes = n * sizeof(T);
+  max_error = -1.0;
+  if (!params.enabled || bytes < params.min_bytes) return false;
+
+  if (params.abs_error > 0.0) {
+    double error = 0.0;
+    if (encode_lossy(data, n, params.abs_error, result, error,
+                     static_cast<real_type*>(nullptr))) {
+      const bool compressed =
+          double(result.size()) <= params.max_ratio * double(bytes);
+      if (compressed) max_error = error;
+      return compressed;
+    }
+  }
+
+  return compress_bytes(reinterpret_cast<const unsigned char*>(data), bytes,
+                        sizeof(T), params, result);
+}
+
+/// Decode quantized elements of a floating-point or complex type
+template <typename T, typename R>
+void decode_lossy(const unsigned char* encoded, const std::size_t size,
+                  T* data, const std::size_t n, const R*) {
+  quantize_decode(encoded, size, reinterpret_cast<R*>(data),
+                  n * (sizeof(T) / sizeof(R)));
+}
+
+/// Elements of other types are never quantized
+template <typename T>
+void decode_lossy(const unsigned char*, const std::size_t, T*,
+                  const std::size_t, const void*) {
+  TA_EXCEPTION("decode_elements: quantized elements of non-floating type");
+}
+
+/// Decompress elements encoded by \c encode_elements
+
+/// \tparam T A trivially copyable element type
+/// \param encoded The compressed elements
+/// \param[out] data The elements
+/// \param n The number of elements
+/// \param has_codec \c encoded starts with a \c Codec byte (see
+/// \c codec_flag ), otherwise it is encoded by \c shuffle_rle_encode
+/// \throw TiledArray::Exception When \c encoded is corrupt
+template <typename T>
+void decode_elements(const std::vector<unsigned char>& encoded, T* data,
+                     const std::size_t n, const bool has_codec = true) {
+  typedef typename lossy_component<T>::type real_type;
+  if (!has_codec) {
+    shuffle_rle_decode(encoded.data(), encoded.size(),
+                       reinterpret_cast<unsigned char*>(data), n * sizeof(T),
+                       sizeof(T));
+    return;
+  }
+  if (encoded.empty()) TA_EXCEPTION("decode_elements: corrupt buffer");
+  switch (static_cast<Codec>(encoded.front())) {
+    case Codec::shuffle_rle:
+      shuffle_rle_decode(encoded.data() + 1, encoded.size() - 1ul,
+                         reinterpret_cast<unsigned char*>(data),
+                         n * sizeof(T), sizeof(T));
+      break;
+    case Codec::quantized:
+      decode_lossy(encoded.data() + 1, encoded.size() - 1ul, data, n,
+                   static_cast<real_type*>(nullptr));
+      break;
+    default:
+      TA_EXCEPTION("decode_elements: unknown codec");
+  }
+}
+
+/// Count-only archive query
+
+/// \return \c true if \c ar only counts the size of serialized data
+inline bool is_count_only(const madness::archive::BufferOutputArchive& ar) {
+  return ar.count_only();
+}
+
+/// Count-only archive query
+
+/// \return \c false
+template <typename Archive>
+inline bool is_count_only(const Archive&) {
+  return false;
+}
+
+/// Compress the elements of a tensor for serialization
+
+/// Within a \c CompressionScope that reuses compressed elements, the result
+/// of a counting pass is kept and taken by the storing pass of the same
+/// elements, so the arguments of a message are compressed once; otherwise
+/// every pass compresses the elements.
+/// \tparam Archive The output archive type
+/// \tparam T A trivially copyable element type
+/// \param ar The archive the elements will be stored in
+/// \param data The elements
+/// \param n The number of elements
+/// \param[out] result The compressed elements
+/// \return \c true if the elements were compressed to \c result
+template <typename Archive, typename T>
+bool compress_elements(const Archive& ar, const T* data, const std::size_t n,
+                       std::vector<unsigned char>& result) {
+  const CompressionParams& params = CompressionScope::current();
+  const std::size_t bytes = n * sizeof(T);
+  if (!params.enabled || bytes < params.min_bytes) return false;
+
+  const bool count_only = is_count_only(ar);
+  auto* const reuse = CompressionScope::reuse();
+  bool compressed = false;
+  double max_error = -1.0;
+  bool reused = false;
+  if (reuse && !count_only) {
+    for (auto it = reuse->begin(); it != reuse->end(); ++it) {
+      if (it->data != data || it->bytes != bytes) continue;
+      compressed = it->compressed;
+      max_error = it->max_error;
+      result.swap(it->result);
+      reuse->erase(it);
+      reused = true;
+      break;
+    }
+  }
+  if (!reused) {
+    const auto start = now();
+    compressed = encode_elements(data, n, params, result, max_error);
+    CompressionCounters::global().record_compress(duration_in_ns(start, now()));
+  }
+
+  if (count_only) {
+    if (reuse)
+      reuse->push_back(
+          CompressedElements{data, bytes, compressed, max_error, result});
+  } else {
+    CompressionCounters::global().record(bytes,
+                                         (compressed ? result.size() : 0ul));
+    if (max_error >= 0.0) CompressionCounters::global().record_lossy(max_error);
+  }
+
+  return compressed;
+}
+
+/// Decompress the elements of a serialized tensor
+
+/// \tparam T A trivially copyable element type
+/// \param encoded The compressed elements
+/// \param[out] data The elements
+/// \param n The number of elements
+/// \param has_codec \c encoded starts with a \c Codec byte
+template <typename T>
+void decompress_elements(const std::vector<unsigned char>& encoded, T* data,
+                         const std::size_t n, const bool has_codec = true) {
+  const auto start = now();
+  decode_elements(encoded, data, n, has_codec);
+  CompressionCounters::global().record_decompress(
+      duration_in_ns(start, now()));
+}
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_UTIL_COMPRESSION_H__INCLUDED
@@ -0,0 +1,213 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  util/eval_counters.h
+ *  Dec 4, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_UTIL_EVAL_COUNTERS_H__INCLUDED
+#define TILEDARRAY_UTIL_EVAL_COUNTERS_H__INCLUDED
+
+#include <TiledArray/external/madness.h>
+#include <TiledArray/util/memory.h>
+#include <TiledArray/util/timeline.h>
+
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+
+namespace TiledArray {
+namespace detail {
+
+/// Performance statistics of an expression node
+struct EvalStats {
+  double time = 0.0;          ///< Wall time in s
+  double flops = 0.0;         ///< Floating point operations
+  double permuted = 0.0;      ///< Bytes of permuted tiles
+  double communicated = 0.0;  ///< Bytes of tiles moved between processes
+  double tiles = 0.0;         ///< Number of produced tiles
+  double screened = 0.0;      ///< Number of tiles screened out by the shape
+
+  /// Combine the statistics of all processes
+
+  /// The wall time is the maximum of all processes, the other statistics
+  /// are summed. This is a collective operation.
+  /// \param world The world of the evaluation
+  void reduce(World& world) {
+    double values[5] = {flops, permuted, communicated, tiles, screened};
+    world.gop.sum(values, 5);
+    world.gop.max(time);
+    flops = values[0];
+    permuted = values[1];
+    communicated = values[2];
+    tiles = values[3];
+    screened = values[4];
+  }
+};  // struct EvalStats
+
+/// Print a quantity with a decimal unit prefix, e.g. 12.3 GF
+inline void print_si(std::ostream& os, double value, const char* unit) {
+  static const char* const prefixes[] = {"", "K", "M", "G", "T", "P"};
+  unsigned int p = 0u;
+  for (; value >= 1000.0 && p < 5u; ++p) value /= 1000.0;
+  os << std::setprecision(3) << value << " " << prefixes[p] << unit;
+}
+
+/// Print performance statistics
+
+/// \param os The output stream
+/// \param stats The performance statistics
+/// \return A reference to the output stream
+inline std::ostream& operator<<(std::ostream& os, const EvalStats& stats) {
+  const auto precision = os.precision();
+  os << std::setprecision(3) << stats.time << " s ";
+  print_si(os, stats.flops, "F");
+  os << " ";
+  print_si(os, stats.permuted, "B");
+  os << " perm ";
+  print_si(os, stats.communicated, "B");
+  os << " comm " << std::size_t(stats.tiles) << " tiles "
+     << std::size_t(stats.screened) << " screened";
+  os.precision(precision);
+  return os;
+}
+
+/// Byte counter categories of \c EvalCounters
+enum class EvalBytes : unsigned int {
+  permuted = 0u,     ///< Bytes of permuted tiles
+  communicated = 1u  ///< Bytes of tiles moved between processes
+};
+
+/// Performance counters of an expression node
+
+/// The counters are updated by the distributed evaluator of the node on
+/// this process (see \c DistEvalImpl::counters() ).
+class EvalCounters {
+  std::atomic<std::int64_t> begin_{-1};  ///< Start of the evaluation in ns
+  std::atomic<std::int64_t> end_{-1};    ///< Time the last tile was set
+  std::atomic<std::uint64_t> flops_{0};
+  std::atomic<std::uint64_t> bytes_[2];
+  std::atomic<std::uint64_t> tiles_{0};
+  std::atomic<std::uint64_t> screened_{0};
+  bool permute_tiles_;  ///< The result tiles are permuted
+
+ public:
+  /// Constructor
+
+  /// \param permute_tiles The result tiles of the node are permuted
+  explicit EvalCounters(const bool permute_tiles = false)
+      : permute_tiles_(permute_tiles) {
+    for (auto& bytes : bytes_) bytes = 0ul;
+  }
+
+  EvalCounters(const EvalCounters&) = delete;
+  EvalCounters& operator=(const EvalCounters&) = delete;
+
+  /// \return \c true if the result tiles of the node are permuted
+  bool permute_tiles() const { return permute_tiles_; }
+
+  /// Record the start of the evaluation
+  void start() {
+    std::int64_t begin = -1;
+    begin_.compare_exchange_strong(begin, timeline_clock());
+  }
+
+  /// Record a produced tile
+  void add_tile() {
+    tiles_.fetch_add(1ul, std::memory_order_relaxed);
+    const std::int64_t now = timeline_clock();
+    std::int64_t end = end_.load(std::memory_order_relaxed);
+    while (end < now &&
+           !end_.compare_exchange_weak(end, now, std::memory_order_relaxed))
+      ;
+  }
+
+  /// Record tiles screened out by the shape
+  void add_screened(const std::uint64_t n) {
+    screened_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /// Record floating point operations
+  void add_flops(const std::uint64_t flops) {
+    flops_.fetch_add(flops, std::memory_order_relaxed);
+  }
+
+  /// Record bytes of a \c EvalBytes category
+  void add_bytes(const EvalBytes category, const std::uint64_t bytes) {
+    bytes_[static_cast<unsigned int>(category)].fetch_add(
+        bytes, std::memory_order_relaxed);
+  }
+
+  /// \return The statistics of this process
+  EvalStats stats() const {
+    EvalStats result;
+    const std::int64_t begin = begin_.load();
+    const std::int64_t end = end_.load();
+    if (begin >= 0 && end > begin) result.time = double(end - begin) * 1.0e-9;
+    result.flops = double(flops_.load());
+    result.permuted = double(bytes_[0].load());
+    result.communicated = double(bytes_[1].load());
+    result.tiles = double(tiles_.load());
+    result.screened = double(screened_.load());
+    return result;
+  }
+};  // class EvalCounters
+
+/// Record the size of a tile in evaluation counters when it is ready
+template <typename T>
+class EvalBytesCounter : public madness::CallbackInterface {
+  Future<T> future_;                        ///< The counted tile
+  std::shared_ptr<EvalCounters> counters_;  ///< The counters to update
+  EvalBytes category_;                      ///< The byte category
+
+ public:
+  EvalBytesCounter(const Future<T>& future,
+                   const std::shared_ptr<EvalCounters>& counters,
+                   const EvalBytes category)
+      : future_(future), counters_(counters), category_(category) {}
+
+  virtual void notify() {
+    counters_->add_bytes(category_, memory_bytes(future_.get()));
+    delete this;
+  }
+};  // class EvalBytesCounter
+
+/// Add the size of a tile to evaluation counters
+
+/// The size is added now if \c future is ready, otherwise when it is set.
+/// \tparam T The tile type
+/// \param future The tile
+/// \param counters The counters to update
+/// \param category The byte category of the tile
+template <typename T>
+inline void count_bytes(const Future<T>& future,
+                        const std::shared_ptr<EvalCounters>& counters,
+                        const EvalBytes category) {
+  if (future.probe())
+    counters->add_bytes(category, memory_bytes(future.get()));
+  else
+    const_cast<Future<T>&>(future).register_callback(
+        new EvalBytesCounter<T>(future, counters, category));
+}
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_UTIL_EVAL_COUNTERS_H__INCLUDED
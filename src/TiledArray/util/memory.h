@@ -0,0 +1,343 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  util/memory.h
+ *  Nov 29, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_UTIL_MEMORY_H__INCLUDED
+#define TILEDARRAY_UTIL_MEMORY_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/external/madness.h>
+#include <TiledArray/type_traits.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace TiledArray {
+namespace detail {
+
+/// Categories of accounted memory
+enum class MemoryCategory : unsigned int {
+  tiles = 0u,      ///< Tiles stored in arrays
+  shapes = 1u,     ///< Shape data of arrays
+  broadcast = 2u,  ///< Argument tiles received by contraction broadcasts
+  reduction = 3u   ///< Partial results of reduction tasks
+};
+
+/// Snapshot of memory counters
+struct MemoryStats {
+  std::size_t tiles = 0ul;      ///< Bytes of stored tiles
+  std::size_t shapes = 0ul;     ///< Bytes of shape data
+  std::size_t broadcast = 0ul;  ///< Bytes of received broadcast tiles
+  std::size_t reduction = 0ul;  ///< Bytes of partial reduction results
+  std::size_t peak = 0ul;       ///< Largest total since the last peak reset
+
+  /// \return The number of bytes of all categories
+  std::size_t total() const { return tiles + shapes + broadcast + reduction; }
+};  // struct MemoryStats
+
+/// Print memory statistics
+
+/// \param os The output stream
+/// \param stats The memory statistics
+/// \return A reference to the output stream
+inline std::ostream& operator<<(std::ostream& os, const MemoryStats& stats) {
+  os << "total=" << stats.total() << " peak=" << stats.peak
+     << " tiles=" << stats.tiles << " shapes=" << stats.shapes
+     << " broadcast=" << stats.broadcast << " reduction=" << stats.reduction;
+  return os;
+}
+
+/// Memory counters
+
+/// The counters hold the number of bytes of each \c MemoryCategory , and the
+/// high-water mark of their total. Changes are forwarded to the parent
+/// counters, if any, so e.g. the counters of an array roll up into the
+/// counters of its world (see \c memory_counters() ). Released counters
+/// return their bytes to the parent and ignore later changes.
+class MemoryCounters {
+  static constexpr unsigned int ncategories = 4u;
+
+  std::atomic<std::int64_t> bytes_[ncategories];
+  std::atomic<std::int64_t> total_{0};
+  std::atomic<std::int64_t> peak_{0};
+  std::atomic<bool> released_{false};
+  const std::shared_ptr<MemoryCounters> parent_;  ///< Accumulating counters
+
+  static std::size_t to_size(const std::int64_t bytes) {
+    return (bytes > 0 ? std::size_t(bytes) : 0ul);
+  }
+
+ public:
+  /// Constructor
+
+  /// \param parent The counters that accumulate these counters, or null
+  explicit MemoryCounters(std::shared_ptr<MemoryCounters> parent = {})
+      : parent_(std::move(parent)) {
+    for (auto& bytes : bytes_) bytes = 0;
+  }
+
+  MemoryCounters(const MemoryCounters&) = delete;
+  MemoryCounters& operator=(const MemoryCounters&) = delete;
+
+  ~MemoryCounters() { release(); }
+
+  /// Record allocated or freed memory
+
+  /// \param category The category of the memory
+  /// \param bytes The number of allocated bytes, negative if freed
+  void add(const MemoryCategory category, const std::int64_t bytes) {
+    if (bytes == 0 || released_.load(std::memory_order_relaxed)) return;
+    bytes_[static_cast<unsigned int>(category)].fetch_add(
+        bytes, std::memory_order_relaxed);
+    const std::int64_t total =
+        total_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    std::int64_t peak = peak_.load(std::memory_order_relaxed);
+    while (peak < total &&
+           !peak_.compare_exchange_weak(peak, total, std::memory_order_relaxed))
+      ;
+    if (parent_) parent_->add(category, bytes);
+  }
+
+  /// Return all memory to the parent counters
+
+  /// Changes recorded after the counters are released are ignored.
+  void release() {
+    if (released_.exchange(true)) return;
+    if (parent_)
+      for (unsigned int c = 0u; c < ncategories; ++c)
+        parent_->add(MemoryCategory(c), -bytes_[c].load());
+  }
+
+  /// Reset the high-water mark to the current total
+  void reset_peak() { peak_ = total_.load(); }
+
+  /// \return The current value of the counters
+  MemoryStats snapshot() const {
+    MemoryStats result;
+    result.tiles = to_size(bytes_[0].load(std::memory_order_relaxed));
+    result.shapes = to_size(bytes_[1].load(std::memory_order_relaxed));
+    result.broadcast = to_size(bytes_[2].load(std::memory_order_relaxed));
+    result.reduction = to_size(bytes_[3].load(std::memory_order_relaxed));
+    result.peak = to_size(peak_.load(std::memory_order_relaxed));
+    return result;
+  }
+};  // class MemoryCounters
+
+/// Memory counters of a world
+
+/// The counters of every array, and the temporaries of every evaluation,
+/// of \c world roll up into these counters. The counters are shared by
+/// their children, and are freed, along with their high-water mark, when
+/// nothing of \c world holds them.
+/// \param world The world
+/// \return A pointer to the memory counters of \c world
+inline std::shared_ptr<MemoryCounters> memory_counters(const World& world) {
+  static std::mutex mutex;
+  static std::map<unsigned long, std::weak_ptr<MemoryCounters> > counters;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<MemoryCounters> result = counters[world.id()].lock();
+  if (result) return result;
+
+  // Drop the entries of freed counters, e.g. of destroyed worlds
+  for (auto it = counters.begin(); it != counters.end();)
+    it = (it->second.expired() ? counters.erase(it) : std::next(it));
+  result = std::make_shared<MemoryCounters>();
+  counters[world.id()] = result;
+  return result;
+}
+
+/// Memory report stream
+
+/// When not null, the peak memory of every expression evaluation is
+/// written to this stream; the default is \c std::cout if the
+/// \c TA_MEMORY_REPORT environment variable is set, otherwise null.
+/// \return A reference to the memory report stream pointer
+inline std::ostream*& memory_report_stream() {
+  static std::ostream* value =
+      (std::getenv("TA_MEMORY_REPORT") ? &std::cout : nullptr);
+  return value;
+}
+
+/// Report of the memory of an evaluation
+
+/// When the memory report stream is set (see \c memory_report_stream() ),
+/// the high-water mark of the memory of a world is reset by the constructor,
+/// and the memory statistics are written to the stream by the destructor.
+class MemoryReport {
+  std::ostream* const os_;                    ///< The report stream
+  const World& world_;                        ///< The reported world
+  std::string label_;                         ///< The label of the report
+  std::shared_ptr<MemoryCounters> counters_;  ///< The reported counters
+
+ public:
+  /// Constructor
+
+  /// \tparam Label The type of the label, which is printable
+  /// \param world The world whose memory is reported
+  /// \param label The label of the evaluation, e.g. its target variables
+  template <typename Label>
+  MemoryReport(const World& world, const Label& label)
+      : os_(memory_report_stream()), world_(world) {
+    if (!os_) return;
+    std::stringstream ss;
+    ss << label;
+    label_ = ss.str();
+    counters_ = memory_counters(world_);
+    counters_->reset_peak();
+  }
+
+  MemoryReport(const MemoryReport&) = delete;
+  MemoryReport& operator=(const MemoryReport&) = delete;
+
+  ~MemoryReport() {
+    if (!os_) return;
+    std::stringstream ss;
+    ss << "TiledArray memory: rank=" << world_.rank() << " expr=" << label_
+       << " " << counters_->snapshot() << "\n";
+    *os_ << ss.str();
+  }
+};  // class MemoryReport
+
+template <typename T>
+std::size_t memory_bytes(const T& object);
+
+/// Size of an object that is not a container of elements
+template <typename T, typename Enabler = void>
+struct MemoryBytes {
+  static std::size_t get(const T&) { return 0ul; }
+};  // struct MemoryBytes
+
+/// Size of the element data of a container, e.g. a tensor
+template <typename T>
+struct MemoryBytes<T, std::enable_if_t<has_member_type_value_type_v<T> &&
+                                       has_member_function_size_anyreturn_v<
+                                           const T> > > {
+  // An empty tile may not hold an object that reports its size
+  template <typename U = T>
+  static std::enable_if_t<has_member_function_empty_anyreturn_v<const U>, bool>
+  empty(const T& object) {
+    return object.empty();
+  }
+
+  template <typename U = T>
+  static std::enable_if_t<!has_member_function_empty_anyreturn_v<const U>,
+                          bool>
+  empty(const T&) {
+    return false;
+  }
+
+  template <typename U = T>
+  static std::enable_if_t<is_numeric_v<typename U::value_type>, std::size_t>
+  get(const T& object) {
+    if (empty(object)) return 0ul;
+    return std::size_t(object.size()) * sizeof(typename T::value_type);
+  }
+
+  template <typename U = T>
+  static std::enable_if_t<!is_numeric_v<typename U::value_type>, std::size_t>
+  get(const T& object) {
+    if (empty(object)) return 0ul;
+    std::size_t result = 0ul;
+    for (const auto& element : object) result += memory_bytes(element);
+    return result;
+  }
+};  // struct MemoryBytes
+
+/// Size of the data held by an object
+
+/// The size of a tile is the size of its element data. Tile types with
+/// other storage provide an overload of \c memory_bytes() in their own
+/// namespace (e.g. \c LowRankTile ); other objects have size 0.
+/// \tparam T The object type
+/// \param object The object
+/// \return The number of bytes of data held by \c object
+template <typename T>
+inline std::size_t memory_bytes(const T& object) {
+  return MemoryBytes<T>::get(object);
+}
+
+/// Record the size of a tile when it is ready
+template <typename T>
+class MemoryTracker : public madness::CallbackInterface {
+  Future<T> future_;                          ///< The tracked tile
+  std::shared_ptr<MemoryCounters> counters_;  ///< The counters to update
+  MemoryCategory category_;                   ///< The memory category
+
+ public:
+  MemoryTracker(const Future<T>& future,
+                const std::shared_ptr<MemoryCounters>& counters,
+                const MemoryCategory category)
+      : future_(future), counters_(counters), category_(category) {}
+
+  virtual void notify() {
+    counters_->add(category_, std::int64_t(memory_bytes(future_.get())));
+    delete this;
+  }
+};  // class MemoryTracker
+
+/// Add the size of a tile to memory counters
+
+/// The size is added now if \c future is ready, otherwise when it is set.
+/// \tparam T The tile type
+/// \param future The tile
+/// \param counters The counters to update
+/// \param category The memory category of the tile
+template <typename T>
+inline void track_memory(const Future<T>& future,
+                         const std::shared_ptr<MemoryCounters>& counters,
+                         const MemoryCategory category) {
+  if (future.probe())
+    counters->add(category, std::int64_t(memory_bytes(future.get())));
+  else
+    const_cast<Future<T>&>(future).register_callback(
+        new MemoryTracker<T>(future, counters, category));
+}
+
+}  // namespace detail
+
+/// Memory statistics of a world
+
+/// Tiles and shapes of live arrays, tiles received by contraction
+/// broadcasts, and partial results of reductions, held by this process.
+/// \param world The world
+/// \return The memory statistics of \c world on this process
+inline detail::MemoryStats memory_stats(const World& world) {
+  return detail::memory_counters(world)->snapshot();
+}
+
+/// Reset the high-water mark of the memory of a world
+
+/// \param world The world
+inline void reset_memory_peak(const World& world) {
+  detail::memory_counters(world)->reset_peak();
+}
+
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_UTIL_MEMORY_H__INCLUDED
@@ -0,0 +1,360 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  util/metrics.h
+ *  Dec 5, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_UTIL_METRICS_H__INCLUDED
+#define TILEDARRAY_UTIL_METRICS_H__INCLUDED
+
+#include <TiledArray/util/timeline.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace TiledArray {
+namespace detail {
+
+/// Number of size buckets of each GEMM dimension
+
+/// Bucket \c b holds the sizes in <tt>[4^b, 4^(b+1))</tt>, and the last
+/// bucket also holds all larger sizes.
+constexpr unsigned int metrics_nbuckets = 8u;
+
+/// \return The bucket of a GEMM dimension of size \c size
+inline unsigned int metrics_bucket(std::uint64_t size) {
+  unsigned int bucket = 0u;
+  for (; size >= 4ul && bucket + 1u < metrics_nbuckets; size >>= 2) ++bucket;
+  return bucket;
+}
+
+/// Metrics of a class of GEMM kernels
+struct GemmMetrics {
+  std::uint64_t calls = 0ul;  ///< Number of calls
+  std::uint64_t flops = 0ul;  ///< Floating point operations
+  std::uint64_t ns = 0ul;     ///< Time in ns
+
+  /// \return The achieved GFLOP/s, or 0 if no time was recorded
+  double gflops() const { return (ns ? double(flops) / double(ns) : 0.0); }
+};  // struct GemmMetrics
+
+/// Snapshot of the kernel metrics of this process
+
+/// The difference of two snapshots holds the metrics of the work done
+/// between them.
+struct MetricsSnapshot {
+  static constexpr unsigned int ngemm =
+      metrics_nbuckets * metrics_nbuckets * metrics_nbuckets;
+
+  std::array<GemmMetrics, ngemm> gemm;  ///< GEMMs by (m,n,k) bucket
+  std::uint64_t permute_calls = 0ul;    ///< Number of tile permutations
+  std::uint64_t permute_bytes = 0ul;    ///< Bytes of permuted tiles
+  std::uint64_t permute_ns = 0ul;       ///< Time of tile permutations in ns
+  std::uint64_t allocations = 0ul;      ///< Number of tensor allocations
+  std::uint64_t allocated_bytes = 0ul;  ///< Bytes of tensor allocations
+
+  /// \return The index of the (m,n,k) bucket in \c gemm
+  static unsigned int gemm_index(const unsigned int m, const unsigned int n,
+                                 const unsigned int k) {
+    return (m * metrics_nbuckets + n) * metrics_nbuckets + k;
+  }
+
+  /// \return The metrics of all GEMMs
+  GemmMetrics gemm_total() const {
+    GemmMetrics result;
+    for (const auto& bucket : gemm) {
+      result.calls += bucket.calls;
+      result.flops += bucket.flops;
+      result.ns += bucket.ns;
+    }
+    return result;
+  }
+
+  /// Metrics of the work done since \c other was taken
+
+  /// \param other An earlier snapshot
+  /// \return The difference of this snapshot and \c other
+  MetricsSnapshot operator-(const MetricsSnapshot& other) const {
+    MetricsSnapshot result;
+    for (unsigned int i = 0u; i < ngemm; ++i) {
+      result.gemm[i].calls = gemm[i].calls - other.gemm[i].calls;
+      result.gemm[i].flops = gemm[i].flops - other.gemm[i].flops;
+      result.gemm[i].ns = gemm[i].ns - other.gemm[i].ns;
+    }
+    result.permute_calls = permute_calls - other.permute_calls;
+    result.permute_bytes = permute_bytes - other.permute_bytes;
+    result.permute_ns = permute_ns - other.permute_ns;
+    result.allocations = allocations - other.allocations;
+    result.allocated_bytes = allocated_bytes - other.allocated_bytes;
+    return result;
+  }
+};  // struct MetricsSnapshot
+
+/// Print the bounds of a size bucket
+inline void print_bucket(std::ostream& os, const unsigned int bucket) {
+  os << "[" << (1ul << (2u * bucket)) << ",";
+  if (bucket + 1u < metrics_nbuckets)
+    os << (1ul << (2u * bucket + 2u)) << ")";
+  else
+    os << "inf)";
+}
+
+/// Print kernel metrics
+
+/// The totals are followed by one line for each GEMM bucket that was used.
+/// \param os The output stream
+/// \param metrics The kernel metrics
+/// \return A reference to the output stream
+inline std::ostream& operator<<(std::ostream& os,
+                                const MetricsSnapshot& metrics) {
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+  os << std::fixed << std::setprecision(3);
+  const GemmMetrics total = metrics.gemm_total();
+  os << "gemm calls=" << total.calls << " flops=" << total.flops
+     << " time=" << double(total.ns) * 1.0e-9 << " s GFLOP/s=" << total.gflops()
+     << "\npermute calls=" << metrics.permute_calls
+     << " bytes=" << metrics.permute_bytes
+     << " time=" << double(metrics.permute_ns) * 1.0e-9
+     << " s\nalloc calls=" << metrics.allocations
+     << " bytes=" << metrics.allocated_bytes << "\n";
+  for (unsigned int m = 0u; m < metrics_nbuckets; ++m)
+    for (unsigned int n = 0u; n < metrics_nbuckets; ++n)
+      for (unsigned int k = 0u; k < metrics_nbuckets; ++k) {
+        const GemmMetrics& bucket =
+            metrics.gemm[MetricsSnapshot::gemm_index(m, n, k)];
+        if (!bucket.calls) continue;
+        os << "gemm m=";
+        print_bucket(os, m);
+        os << " n=";
+        print_bucket(os, n);
+        os << " k=";
+        print_bucket(os, k);
+        os << " calls=" << bucket.calls << " flops=" << bucket.flops
+           << " time=" << double(bucket.ns) * 1.0e-9
+           << " s GFLOP/s=" << bucket.gflops() << "\n";
+      }
+  os.flags(flags);
+  os.precision(precision);
+  return os;
+}
+
+/// Kernel metrics recorded by a thread
+
+/// Only the owning thread updates the counters, so they are updated without
+/// atomic read-modify-write operations; other threads only read them.
+class MetricsBlock {
+  typedef std::atomic<std::uint64_t> counter_type;
+
+  std::array<counter_type, 3u * MetricsSnapshot::ngemm> gemm_;
+  counter_type permute_[3];
+  counter_type alloc_[2];
+
+  static void add(counter_type& counter, const std::uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+  static std::uint64_t get(const counter_type& counter) {
+    return counter.load(std::memory_order_relaxed);
+  }
+
+ public:
+  MetricsBlock() {
+    for (auto& counter : gemm_) counter = 0ul;
+    for (auto& counter : permute_) counter = 0ul;
+    for (auto& counter : alloc_) counter = 0ul;
+  }
+
+  MetricsBlock(const MetricsBlock&) = delete;
+  MetricsBlock& operator=(const MetricsBlock&) = delete;
+
+  /// Record a GEMM of an m x k and a k x n matrix that took \c ns ns
+  void add_gemm(const std::uint64_t m, const std::uint64_t n,
+                const std::uint64_t k, const std::uint64_t ns) {
+    const unsigned int i =
+        3u * MetricsSnapshot::gemm_index(metrics_bucket(m), metrics_bucket(n),
+                                         metrics_bucket(k));
+    add(gemm_[i], 1ul);
+    add(gemm_[i + 1u], 2ul * m * n * k);
+    add(gemm_[i + 2u], ns);
+  }
+
+  /// Record a permutation of \c bytes bytes that took \c ns ns
+  void add_permute(const std::uint64_t bytes, const std::uint64_t ns) {
+    add(permute_[0], 1ul);
+    add(permute_[1], bytes);
+    add(permute_[2], ns);
+  }
+
+  /// Record an allocation of \c bytes bytes
+  void add_allocation(const std::uint64_t bytes) {
+    add(alloc_[0], 1ul);
+    add(alloc_[1], bytes);
+  }
+
+  /// Add the counters of this block to \c result
+  void accumulate(MetricsSnapshot& result) const {
+    for (unsigned int i = 0u; i < MetricsSnapshot::ngemm; ++i) {
+      result.gemm[i].calls += get(gemm_[3u * i]);
+      result.gemm[i].flops += get(gemm_[3u * i + 1u]);
+      result.gemm[i].ns += get(gemm_[3u * i + 2u]);
+    }
+    result.permute_calls += get(permute_[0]);
+    result.permute_bytes += get(permute_[1]);
+    result.permute_ns += get(permute_[2]);
+    result.allocations += get(alloc_[0]);
+    result.allocated_bytes += get(alloc_[1]);
+  }
+};  // class MetricsBlock
+
+/// Kernel metrics registry
+struct Metrics {
+  std::atomic<bool> enabled{false};  ///< Recording switch
+  bool report = false;  ///< Report the metrics at finalization
+  std::mutex mutex;     ///< Guards \c blocks
+  std::vector<std::unique_ptr<MetricsBlock> >
+      blocks;  ///< Blocks of every thread that recorded metrics
+
+  /// Recording, and the report at finalization, are enabled by setting the
+  /// \c TA_METRICS environment variable.
+  Metrics() {
+    if (std::getenv("TA_METRICS")) {
+      enabled = true;
+      report = true;
+    }
+  }
+};  // struct Metrics
+
+/// \return A reference to the kernel metrics registry
+inline Metrics& metrics() {
+  static Metrics value;
+  return value;
+}
+
+/// \return \c true if kernel metrics are recorded
+inline bool metrics_enabled() {
+  return metrics().enabled.load(std::memory_order_relaxed);
+}
+
+/// \return A reference to the metrics block of this thread
+inline MetricsBlock& metrics_block() {
+  static thread_local MetricsBlock* block = nullptr;
+  if (!block) {
+    Metrics& registry = metrics();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.blocks.emplace_back(new MetricsBlock());
+    block = registry.blocks.back().get();
+  }
+  return *block;
+}
+
+/// Record the time of a GEMM in the kernel metrics
+
+/// When recording is disabled, this costs a single load of a flag.
+class MetricsGemmScope {
+  std::uint64_t m_, n_, k_;  ///< GEMM dimensions
+  std::int64_t begin_;       ///< Start time, or -1 if not recorded
+
+ public:
+  /// Constructor
+
+  /// \param m The number of rows of the result
+  /// \param n The number of columns of the result
+  /// \param k The inner dimension
+  MetricsGemmScope(const std::uint64_t m, const std::uint64_t n,
+                   const std::uint64_t k)
+      : m_(m), n_(n), k_(k), begin_(metrics_enabled() ? timeline_clock() : -1) {
+  }
+
+  MetricsGemmScope(const MetricsGemmScope&) = delete;
+  MetricsGemmScope& operator=(const MetricsGemmScope&) = delete;
+
+  ~MetricsGemmScope() {
+    if (begin_ < 0) return;
+    metrics_block().add_gemm(m_, n_, k_, timeline_clock() - begin_);
+  }
+};  // class MetricsGemmScope
+
+/// Record the time of a tile permutation in the kernel metrics
+
+/// When recording is disabled, this costs a single load of a flag.
+class MetricsPermuteScope {
+  std::uint64_t bytes_;  ///< Size of the permuted tile
+  std::int64_t begin_;   ///< Start time, or -1 if not recorded
+
+ public:
+  /// Constructor
+
+  /// \param bytes The size of the permuted tile
+  explicit MetricsPermuteScope(const std::uint64_t bytes)
+      : bytes_(bytes), begin_(metrics_enabled() ? timeline_clock() : -1) {}
+
+  MetricsPermuteScope(const MetricsPermuteScope&) = delete;
+  MetricsPermuteScope& operator=(const MetricsPermuteScope&) = delete;
+
+  ~MetricsPermuteScope() {
+    if (begin_ < 0) return;
+    metrics_block().add_permute(bytes_, timeline_clock() - begin_);
+  }
+};  // class MetricsPermuteScope
+
+/// Record a tensor allocation in the kernel metrics
+
+/// \param bytes The size of the allocation
+inline void metrics_allocation(const std::uint64_t bytes) {
+  if (metrics_enabled()) metrics_block().add_allocation(bytes);
+}
+
+}  // namespace detail
+
+/// Enable or disable the recording of kernel metrics
+
+/// Recording is also enabled by setting the \c TA_METRICS environment
+/// variable, in which case \c TiledArray::finalize() writes the metrics of
+/// each rank to \c std::cout .
+/// \param enable The recording switch
+inline void metrics_enable(const bool enable = true) {
+  detail::metrics().enabled = enable;
+}
+
+/// Kernel metrics of this process
+
+/// GEMM calls, flops and time by (m,n,k) bucket, tile permutations and
+/// tensor allocations recorded since the start of the process; subtract an
+/// earlier snapshot to get the metrics of a part of a computation.
+/// \return A snapshot of the kernel metrics of this process
+inline detail::MetricsSnapshot metrics_snapshot() {
+  detail::MetricsSnapshot result;
+  detail::Metrics& registry = detail::metrics();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const auto& block : registry.blocks) block->accumulate(result);
+  return result;
+}
+
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_UTIL_METRICS_H__INCLUDED
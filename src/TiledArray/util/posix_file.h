@@ -0,0 +1,128 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  util/posix_file.h
+ *  Nov 20, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_UTIL_POSIX_FILE_H__INCLUDED
+#define TILEDARRAY_UTIL_POSIX_FILE_H__INCLUDED
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <TiledArray/error.h>
+
+namespace TiledArray {
+namespace detail {
+
+/// POSIX file handle that supports concurrent positioned I/O
+
+/// \c pread and \c pwrite do not use the file offset, so one handle may be
+/// shared by several tasks.
+class PosixFile {
+ private:
+  int fd_;  ///< The file descriptor
+
+  PosixFile(const PosixFile&) = delete;
+  PosixFile& operator=(const PosixFile&) = delete;
+
+  explicit PosixFile(const int fd) : fd_(fd) {}
+
+ public:
+  /// Open a file
+
+  /// \param filename The name of the file
+  /// \param flags The \c open flags
+  /// \throw TiledArray::Exception When the file cannot be opened
+  PosixFile(const std::string& filename, const int flags)
+      : fd_(::open(filename.c_str(), flags, 0644)) {
+    if (fd_ < 0) TA_EXCEPTION("PosixFile: unable to open file");
+  }
+
+  ~PosixFile() { ::close(fd_); }
+
+  /// Create an anonymous temporary file
+
+  /// The file is unlinked as soon as it is created, so it is removed when
+  /// it is closed, even if the process is terminated.
+  /// \param directory The directory that will hold the file
+  /// \return The temporary file, open for reading and writing
+  /// \throw TiledArray::Exception When the file cannot be created
+  static std::unique_ptr<PosixFile> temporary(const std::string& directory) {
+    std::string name = directory + "/tiledarray.XXXXXX";
+    const int fd = ::mkstemp(&name[0]);
+    if (fd < 0) TA_EXCEPTION("PosixFile: unable to create temporary file");
+    ::unlink(name.c_str());
+    return std::unique_ptr<PosixFile>(new PosixFile(fd));
+  }
+
+  /// File descriptor accessor
+
+  /// \return The file descriptor
+  int fd() const { return fd_; }
+
+  /// Read \c n bytes at \c offset
+
+  /// \throw TiledArray::Exception When the read fails or ends early
+  void read(void* buf, std::size_t n, std::uint64_t offset) const {
+    char* ptr = static_cast<char*>(buf);
+    while (n > 0ul) {
+      const ssize_t r = ::pread(fd_, ptr, n, off_t(offset));
+      if (r <= 0) TA_EXCEPTION("PosixFile: read failed");
+      ptr += r;
+      n -= r;
+      offset += r;
+    }
+  }
+
+  /// Write \c n bytes at \c offset
+
+  /// \throw TiledArray::Exception When the write fails
+  void write(const void* buf, std::size_t n, std::uint64_t offset) const {
+    const char* ptr = static_cast<const char*>(buf);
+    while (n > 0ul) {
+      const ssize_t r = ::pwrite(fd_, ptr, n, off_t(offset));
+      if (r <= 0) TA_EXCEPTION("PosixFile: write failed");
+      ptr += r;
+      n -= r;
+      offset += r;
+    }
+  }
+
+  /// File size accessor
+
+  /// \return The size of the file in bytes
+  std::uint64_t size() const {
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) TA_EXCEPTION("PosixFile: fstat failed");
+    return st.st_size;
+  }
+
+};  // class PosixFile
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_UTIL_POSIX_FILE_H__INCLUDED
@@ -0,0 +1,121 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  util/task_priority.h
+ *  Dec 19, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_UTIL_TASK_PRIORITY_H__INCLUDED
+#define TILEDARRAY_UTIL_TASK_PRIORITY_H__INCLUDED
+
+#include <TiledArray/external/madness.h>
+
+namespace TiledArray {
+
+/// Scheduling priority of the tile tasks of an expression
+
+/// MADNESS runs high priority tasks before the tasks of default priority
+/// that are already queued. With \c automatic priority, a tile task has high
+/// priority if the tile is waited on by another process (see
+/// \c detail::TaskRank ).
+enum class TaskPriority {
+  automatic,  ///< Rank the tile tasks by remote demand
+  high,       ///< Run all tile tasks with high priority
+  normal      ///< Run all tile tasks with default priority
+};
+
+namespace detail {
+
+/// Scheduling rank of the tile tasks of a distributed evaluator
+
+/// The rank combines the user priority of the expression and whether the
+/// tiles of the evaluator are broadcast to other processes, as the
+/// arguments of a contraction are. With automatic priority, the tasks of
+/// tiles that are sent or broadcast to other processes run with high
+/// priority, so remote consumers are not queued behind local work; the
+/// tasks of tiles that are consumed locally, including those of
+/// intermediate evaluators, keep the default priority, since MADNESS has no
+/// finer levels to order them by.
+class TaskRank {
+  TaskPriority priority_;  ///< The priority of the expression
+  bool broadcast_;         ///< The tiles are broadcast to other processes
+
+ public:
+  /// Construct the rank of the result of an expression
+
+  /// \param priority The priority of the expression
+  explicit TaskRank(const TaskPriority priority = TaskPriority::automatic)
+      : priority_(priority), broadcast_(false) {}
+
+  /// \return The priority of the expression
+  TaskPriority priority() const { return priority_; }
+
+  /// \return \c true if the tiles are broadcast to other processes
+  bool broadcast() const { return broadcast_; }
+
+  /// Rank of an argument of the evaluator
+
+  /// \param broadcast The argument tiles are broadcast to other processes
+  /// \return The rank of the argument, which inherits the priority
+  TaskRank arg(const bool broadcast) const {
+    TaskRank result(*this);
+    result.broadcast_ = broadcast;
+    return result;
+  }
+
+  /// Rank with the priority of a sub-expression
+
+  /// \param priority The priority of the sub-expression, which overrides
+  /// the inherited priority unless it is \c automatic
+  /// \return The rank of the sub-expression
+  TaskRank with_priority(const TaskPriority priority) const {
+    TaskRank result(*this);
+    if (priority != TaskPriority::automatic) result.priority_ = priority;
+    return result;
+  }
+
+  /// Query the priority of a tile task
+
+  /// \param remote The tile is sent to another process
+  /// \return \c true if the task has high priority
+  bool is_high(const bool remote) const {
+    switch (priority_) {
+      case TaskPriority::high:
+        return true;
+      case TaskPriority::normal:
+        return false;
+      default:
+        return remote || broadcast_;
+    }
+  }
+
+  /// Task attributes of a tile task
+
+  /// \param remote The tile is sent to another process
+  /// \return The task attributes
+  madness::TaskAttributes attr(const bool remote) const {
+    return (is_high(remote) ? madness::TaskAttributes::hipri()
+                            : madness::TaskAttributes());
+  }
+
+};  // class TaskRank
+
+}  // namespace detail
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_UTIL_TASK_PRIORITY_H__INCLUDED
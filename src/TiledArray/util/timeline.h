@@ -0,0 +1,351 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  util/timeline.h
+ *  Dec 3, 2019
+ *
+ */
+
+#ifndef TILEDARRAY_UTIL_TIMELINE_H__INCLUDED
+#define TILEDARRAY_UTIL_TIMELINE_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/external/madness.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace TiledArray {
+namespace detail {
+
+/// Categories of timeline events
+enum class TimelineCategory : unsigned int {
+  tile_op = 0u,  ///< Evaluation of a tile of an expression
+  gemm = 1u,     ///< Contraction of a pair of tiles
+  permute = 2u,  ///< Permutation of a tile
+  bcast = 3u,    ///< Posting of contraction broadcasts
+  send = 4u,     ///< Sending of a tile to another process
+  recv = 5u,     ///< Wait for a tile from another process
+  reduce = 6u    ///< Reduction of an argument into a partial result
+};
+
+/// \return The name of \c category
+inline const char* to_string(const TimelineCategory category) {
+  static const char* const names[] = {"tile_op", "gemm", "permute", "bcast",
+                                      "send",    "recv", "reduce"};
+  return names[static_cast<unsigned int>(category)];
+}
+
+/// A timed event
+struct TimelineEvent {
+  const char* name;           ///< Event name, a string literal
+  TimelineCategory category;  ///< Event category
+  std::int64_t begin;         ///< Start time in ns (see \c timeline_clock() )
+  std::int64_t end;           ///< End time in ns
+  std::uint64_t node;         ///< Expression node id, or 0
+  std::int64_t index;         ///< Tile index, or -1
+};
+
+/// Per-thread ring buffer of timeline events
+
+/// Only the owning thread records events; once the buffer is full the
+/// oldest events are overwritten.
+class TimelineBuffer {
+  std::vector<TimelineEvent> events_;  ///< Event storage
+  std::atomic<std::size_t> count_{0};  ///< Number of recorded events
+  const unsigned int thread_;          ///< Thread number of the owner
+
+ public:
+  /// Constructor
+
+  /// \param capacity The maximum number of stored events
+  /// \param thread The thread number of the owner
+  TimelineBuffer(const std::size_t capacity, const unsigned int thread)
+      : events_(capacity), thread_(thread) {
+    TA_ASSERT(capacity > 0ul);
+  }
+
+  /// Record an event
+  void push(const TimelineEvent& event) {
+    const std::size_t count = count_.load(std::memory_order_relaxed);
+    events_[count % events_.size()] = event;
+    count_.store(count + 1ul, std::memory_order_release);
+  }
+
+  /// Remove all events
+  void clear() { count_.store(0ul, std::memory_order_release); }
+
+  /// \return The thread number of the owner
+  unsigned int thread() const { return thread_; }
+
+  /// Visit the stored events, oldest first
+
+  /// \tparam Op The visitor type
+  /// \param op The visitor, which is called with each event
+  template <typename Op>
+  void for_each(Op&& op) const {
+    const std::size_t count = count_.load(std::memory_order_acquire);
+    const std::size_t size = std::min(count, events_.size());
+    for (std::size_t i = count - size; i < count; ++i)
+      op(events_[i % events_.size()]);
+  }
+};  // class TimelineBuffer
+
+/// Timeline recorder state
+struct Timeline {
+  std::atomic<bool> enabled{false};  ///< Recording switch
+  std::size_t capacity = 1ul << 16;  ///< Events per thread buffer
+  std::string prefix;  ///< File prefix of the export at finalization
+  std::mutex mutex;    ///< Guards \c buffers
+  std::vector<std::shared_ptr<TimelineBuffer> >
+      buffers;  ///< Buffers of every thread that recorded events
+
+  /// Recording is enabled by setting the \c TA_TIMELINE environment
+  /// variable to the file prefix of the export.
+  Timeline() {
+    const char* prefix_env = std::getenv("TA_TIMELINE");
+    if (prefix_env) {
+      prefix = prefix_env;
+      enabled = true;
+    }
+  }
+};  // struct Timeline
+
+/// \return A reference to the timeline recorder state
+inline Timeline& timeline() {
+  static Timeline value;
+  return value;
+}
+
+/// \return The time since the start of the process in ns
+inline std::int64_t timeline_clock() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/// \return \c true if timeline events are recorded
+inline bool timeline_enabled() {
+  return timeline().enabled.load(std::memory_order_relaxed);
+}
+
+/// \return A reference to the timeline buffer of this thread
+inline TimelineBuffer& timeline_buffer() {
+  static thread_local TimelineBuffer* buffer = nullptr;
+  if (!buffer) {
+    Timeline& state = timeline();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.buffers.emplace_back(std::make_shared<TimelineBuffer>(
+        state.capacity, static_cast<unsigned int>(state.buffers.size())));
+    buffer = state.buffers.back().get();
+  }
+  return *buffer;
+}
+
+/// Expression node and tile of the events that are recorded by this thread
+
+/// Nested events that do not name a node or tile inherit them, e.g. the
+/// GEMM in a reduction task of a contraction result tile.
+struct TimelineContext {
+  std::uint64_t node = 0ul;  ///< Expression node id
+  std::int64_t index = -1;   ///< Tile index
+};
+
+/// \return A reference to the event context of this thread
+inline TimelineContext& timeline_context() {
+  static thread_local TimelineContext context;
+  return context;
+}
+
+/// Record a timed event
+inline void timeline_record(const char* name, const TimelineCategory category,
+                            const std::int64_t begin, const std::int64_t end,
+                            const std::uint64_t node,
+                            const std::int64_t index) {
+  timeline_buffer().push(
+      TimelineEvent{name, category, begin, end, node, index});
+}
+
+/// Record the duration of a scope as a timeline event
+
+/// When recording is disabled, this costs a single load of a flag.
+class TimelineScope {
+  const char* name_;           ///< Event name
+  TimelineCategory category_;  ///< Event category
+  TimelineContext saved_;      ///< Event context of the enclosing scope
+  std::int64_t begin_;         ///< Start time, or -1 if not recorded
+
+ public:
+  /// Constructor
+
+  /// \param category The event category
+  /// \param name The event name, a string literal
+  /// \param node The expression node id, or 0 to inherit it
+  /// \param index The tile index, or -1 to inherit it
+  TimelineScope(const TimelineCategory category, const char* name,
+                const std::uint64_t node = 0ul, const std::int64_t index = -1)
+      : name_(name), category_(category), begin_(-1) {
+    if (!timeline_enabled()) return;
+    TimelineContext& context = timeline_context();
+    saved_ = context;
+    if (node != 0ul) context.node = node;
+    if (index >= 0) context.index = index;
+    begin_ = timeline_clock();
+  }
+
+  TimelineScope(const TimelineScope&) = delete;
+  TimelineScope& operator=(const TimelineScope&) = delete;
+
+  ~TimelineScope() {
+    if (begin_ < 0) return;
+    TimelineContext& context = timeline_context();
+    timeline_record(name_, category_, begin_, timeline_clock(), context.node,
+                    context.index);
+    context = saved_;
+  }
+};  // class TimelineScope
+
+/// Record the time until a future is set
+template <typename T>
+class TimelineFuture : public madness::CallbackInterface {
+  const char* name_;           ///< Event name
+  TimelineCategory category_;  ///< Event category
+  std::uint64_t node_;         ///< Expression node id
+  std::int64_t index_;         ///< Tile index
+  std::int64_t begin_;         ///< Start time
+
+ public:
+  TimelineFuture(const TimelineCategory category, const char* name,
+                 const std::uint64_t node, const std::int64_t index)
+      : name_(name),
+        category_(category),
+        node_(node),
+        index_(index),
+        begin_(timeline_clock()) {}
+
+  virtual void notify() {
+    timeline_record(name_, category_, begin_, timeline_clock(), node_, index_);
+    delete this;
+  }
+};  // class TimelineFuture
+
+/// Record the time until a future is set as a timeline event
+
+/// Nothing is recorded if \c future is ready or recording is disabled.
+/// \tparam T The future value type
+/// \param future The future
+/// \param category The event category
+/// \param name The event name, a string literal
+/// \param node The expression node id
+/// \param index The tile index
+template <typename T>
+inline void timeline_future(const Future<T>& future,
+                            const TimelineCategory category, const char* name,
+                            const std::uint64_t node,
+                            const std::int64_t index) {
+  if (!timeline_enabled() || future.probe()) return;
+  const_cast<Future<T>&>(future).register_callback(
+      new TimelineFuture<T>(category, name, node, index));
+}
+
+/// Write the recorded events as Chrome trace JSON
+
+/// The output can be loaded in \c chrome://tracing or Perfetto. Events are
+/// complete ("X") events with process id \c rank and one track per thread.
+/// \param os The output stream
+/// \param rank The process rank
+inline void write_timeline(std::ostream& os, const int rank) {
+  Timeline& state = timeline();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  std::stringstream ss;
+  ss.precision(3);
+  ss << std::fixed << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& buffer : state.buffers) {
+    const unsigned int thread = buffer->thread();
+    buffer->for_each([&](const TimelineEvent& event) {
+      ss << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name
+         << "\",\"cat\":\"" << to_string(event.category)
+         << "\",\"ph\":\"X\",\"ts\":" << double(event.begin) * 1.0e-3
+         << ",\"dur\":" << double(event.end - event.begin) * 1.0e-3
+         << ",\"pid\":" << rank << ",\"tid\":" << thread
+         << ",\"args\":{\"node\":" << event.node
+         << ",\"tile\":" << event.index << "}}";
+      first = false;
+    });
+  }
+  ss << "\n]}\n";
+  os << ss.str();
+}
+
+}  // namespace detail
+
+/// Enable or disable the recording of timeline events
+
+/// Recording is also enabled by setting the \c TA_TIMELINE environment
+/// variable, in which case \c TiledArray::finalize() writes the timeline of
+/// each rank to <tt>$TA_TIMELINE.<rank>.json</tt> .
+/// \param enable The recording switch
+/// \param capacity The number of events kept per thread; this only affects
+/// threads that have not recorded events yet
+inline void timeline_enable(const bool enable = true,
+                            const std::size_t capacity = 1ul << 16) {
+  TA_USER_ASSERT(capacity > 0ul, "The timeline capacity must be positive");
+  detail::Timeline& state = detail::timeline();
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.capacity = capacity;
+  }
+  state.enabled = enable;
+}
+
+/// Remove all recorded timeline events
+inline void timeline_clear() {
+  detail::Timeline& state = detail::timeline();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  for (auto& buffer : state.buffers) buffer->clear();
+}
+
+/// Write the timeline of this rank as Chrome trace JSON
+
+/// The timeline is written to <tt>prefix.<rank>.json</tt> . Tasks must not
+/// be running, e.g. call this after a fence.
+/// \param world The world whose rank names the file
+/// \param prefix The file prefix
+inline void write_timeline(const World& world, const std::string& prefix) {
+  std::stringstream filename;
+  filename << prefix << "." << world.rank() << ".json";
+  std::ofstream file(filename.str());
+  if (!file)
+    TA_EXCEPTION("The timeline file could not be opened for writing");
+  detail::write_timeline(file, world.rank());
+}
+
+}  // namespace TiledArray
+
+#endif  // TILEDARRAY_UTIL_TIMELINE_H__INCLUDED
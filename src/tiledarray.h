@@ -37,15 +37,22 @@
 #include <TiledArray/conversions/dense_to_sparse.h>
 #include <TiledArray/conversions/foreach.h>
 #include <TiledArray/conversions/make_array.h>
+#include <TiledArray/conversions/redistribute.h>
+#include <TiledArray/conversions/slice.h>
 #include <TiledArray/conversions/sparse_to_dense.h>
 #include <TiledArray/conversions/to_new_tile_type.h>
 #include <TiledArray/conversions/truncate.h>
+#include <TiledArray/expressions/func_expr.h>
+#include <TiledArray/expressions/partial_reduce_expr.h>
 #include <TiledArray/expressions/scal_expr.h>
 #include <TiledArray/expressions/tsr_expr.h>
 
 // Special Arrays
 #include <TiledArray/special/diagonal_array.h>
 
+// Special tile types
+#include <TiledArray/low_rank_tile.h>
+
 // Process maps
 #include <TiledArray/pmap/hash_pmap.h>
 #include <TiledArray/pmap/replicated_pmap.h>
@@ -57,6 +64,10 @@
 #include <TiledArray/algebra/conjgrad.h>
 #include <TiledArray/dist_array.h>
 
+// Parallel I/O
+#include <TiledArray/checkpoint.h>
+#include <TiledArray/tile_file.h>
+
 #ifdef TILEDARRAY_HAS_ELEMENTAL
 #include <TiledArray/external/elemental.h>
 #endif
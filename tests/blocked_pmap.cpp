@@ -109,4 +109,16 @@ BOOST_AUTO_TEST_CASE(local_group) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(local_ordinal) {
+  for (std::size_t tiles = 1ul; tiles < 100ul; ++tiles) {
+    TiledArray::detail::BlockedPmap pmap(*GlobalFixture::world, tiles);
+    BOOST_CHECK(pmap.known_local_ordinal());
+
+    // Check that local tiles are numbered consecutively from 0
+    std::size_t n = 0ul;
+    for (auto tile : pmap) BOOST_CHECK_EQUAL(pmap.local_ordinal(tile), n++);
+    BOOST_CHECK_EQUAL(n, pmap.local_size());
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
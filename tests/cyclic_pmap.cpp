@@ -203,4 +203,32 @@ BOOST_AUTO_TEST_CASE(local_group) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(local_ordinal) {
+  for (std::size_t x = 1ul; x < 10ul; ++x) {
+    for (std::size_t y = 1ul; y < 10ul; ++y) {
+      // Compute the limits for process rows
+      const std::size_t min_proc_rows = std::max<std::size_t>(
+          ((GlobalFixture::world->size() + y - 1ul) / y), 1ul);
+      const std::size_t max_proc_rows =
+          std::min<std::size_t>(GlobalFixture::world->size(), x);
+
+      // Compute process rows and process columns
+      const std::size_t p_rows = std::max<std::size_t>(
+          min_proc_rows,
+          std::min<std::size_t>(std::sqrt(GlobalFixture::world->size() * x / y),
+                                max_proc_rows));
+      const std::size_t p_cols = GlobalFixture::world->size() / p_rows;
+
+      TiledArray::detail::CyclicPmap pmap(*GlobalFixture::world, x, y, p_rows,
+                                          p_cols);
+      BOOST_CHECK(pmap.known_local_ordinal());
+
+      // Check that local tiles are numbered consecutively from 0
+      std::size_t n = 0ul;
+      for (auto tile : pmap) BOOST_CHECK_EQUAL(pmap.local_ordinal(tile), n++);
+      BOOST_CHECK_EQUAL(n, pmap.local_size());
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
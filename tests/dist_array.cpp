@@ -21,6 +21,7 @@
 #include <chrono>
 #include <cstdio>
 #include <random>
+#include <sstream>
 
 #include <madness/world/binary_fstream_archive.h>
 #include <madness/world/text_fstream_archive.h>
@@ -169,6 +170,66 @@ BOOST_AUTO_TEST_CASE(find_remote) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(find_remote_cached) {
+  a.set_remote_cache(1ul << 30);
+
+  std::size_t remote = 0ul;
+  for (int pass = 0; pass != 2; ++pass) {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      if (a.is_local(i)) continue;
+      if (pass == 0) ++remote;
+      Future<ArrayN::value_type> tile = a.find(i);
+      for (auto&& v : tile.get()) BOOST_CHECK_EQUAL(v, a.owner(i) + 1);
+    }
+  }
+
+  // The second pass is served by the cache
+  auto stats = a.remote_cache_stats();
+  BOOST_CHECK_EQUAL(stats.misses, remote);
+  BOOST_CHECK_EQUAL(stats.hits, remote);
+
+  // Fence invalidates the cache
+  world.gop.fence();
+  BOOST_CHECK_EQUAL(a.remote_cache_stats().bytes, 0ul);
+
+  a.set_remote_cache(0ul);
+}
+
+BOOST_AUTO_TEST_CASE(prefetch) {
+  std::vector<std::size_t> remote;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    if (!a.is_local(i)) remote.push_back(i);
+
+  // Prefetch stops at the budget instead of evicting prefetched tiles
+  if (!remote.empty()) {
+    const std::size_t tile_bytes =
+        a.trange().make_tile_range(remote.front()).volume() * sizeof(int);
+    a.set_remote_cache(tile_bytes);
+    BOOST_CHECK_EQUAL(a.prefetch(remote), remote.size() == 1ul);
+    BOOST_CHECK_EQUAL(a.remote_cache_stats().prefetches, 1ul);
+    BOOST_CHECK_EQUAL(a.remote_cache_stats().evictions, 0ul);
+    world.gop.fence();
+  }
+
+  a.set_remote_cache(1ul << 30);
+  BOOST_REQUIRE_NO_THROW(a.prefetch(remote));
+  BOOST_CHECK_EQUAL(a.remote_cache_stats().prefetches, remote.size());
+
+  // Prefetched tiles are found in the cache
+  for (auto i : remote) {
+    Future<ArrayN::value_type> tile = a.find(i);
+    for (auto&& v : tile.get()) BOOST_CHECK_EQUAL(v, a.owner(i) + 1);
+  }
+  BOOST_CHECK_EQUAL(a.remote_cache_stats().hits, remote.size());
+  BOOST_CHECK_EQUAL(a.remote_cache_stats().misses, 0ul);
+
+  // Prefetch a block of tiles
+  BOOST_REQUIRE_NO_THROW(
+      a.prefetch(a.range().lobound(), a.range().upbound()));
+
+  a.set_remote_cache(0ul);
+}
+
 BOOST_AUTO_TEST_CASE(fill_tiles) {
   ArrayN a(world, tr);
 
@@ -282,6 +343,109 @@ BOOST_AUTO_TEST_CASE(make_replicated) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(redistribute) {
+  auto pmap = std::make_shared<detail::HashPmap>(world, a.size());
+
+  // Copy the array to a different process map
+  ArrayN ar;
+  BOOST_REQUIRE_NO_THROW(ar = TiledArray::redistribute(a, pmap, 1ul));
+  world.gop.fence();
+
+  BOOST_CHECK_EQUAL(ar.pmap(), pmap);
+  BOOST_CHECK_EQUAL(ar.trange(), a.trange());
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (!ar.is_local(i)) continue;
+    Future<ArrayN::value_type> tile = ar.find(i);
+    BOOST_CHECK(tile.probe());
+    BOOST_CHECK_EQUAL(tile.get().range(), a.trange().make_tile_range(i));
+    for (auto&& v : tile.get()) BOOST_CHECK_EQUAL(v, a.owner(i) + 1);
+  }
+
+  // Move a sparse array in place
+  std::shared_ptr<SpArrayN::pmap_interface> distributed_pmap = b.pmap();
+  BOOST_REQUIRE_NO_THROW(b.redistribute(pmap));
+  world.gop.fence();
+
+  BOOST_CHECK_EQUAL(b.pmap(), pmap);
+  for (std::size_t i = 0; i < b.size(); ++i) {
+    if (b.is_zero(i) || !b.is_local(i)) continue;
+    Future<SpArrayN::value_type> tile = b.find(i);
+    BOOST_CHECK(tile.probe());
+    for (auto&& v : tile.get())
+      BOOST_CHECK_EQUAL(v, distributed_pmap->owner(i) + 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(element_slice) {
+  // Fill an array with the ordinals of its elements
+  ArrayN x(world, tr);
+  for (const auto i : *x.pmap()) {
+    ArrayN::value_type tile(x.trange().make_tile_range(i));
+    for (auto&& idx : tile.range())
+      tile[idx] = tr.elements_range().ordinal(idx);
+    x.set(i, tile);
+  }
+
+  // The slice bounds are not on tile boundaries
+  const std::vector<std::size_t> lobound(GlobalFixture::dim, 3ul);
+  const std::vector<std::size_t> upbound(GlobalFixture::dim, 20ul);
+  auto in_slice = [&](const std::vector<std::size_t>& idx) {
+    for (unsigned int d = 0u; d < idx.size(); ++d)
+      if ((idx[d] < lobound[d]) || (idx[d] >= upbound[d])) return false;
+    return true;
+  };
+
+  ArrayN s;
+  BOOST_REQUIRE_NO_THROW(s = TiledArray::slice(x, lobound, upbound));
+  world.gop.fence();
+
+  for (unsigned int d = 0u; d < GlobalFixture::dim; ++d) {
+    BOOST_CHECK_EQUAL(s.trange().data()[d].elements_range().first, 0ul);
+    BOOST_CHECK_EQUAL(s.trange().data()[d].elements_range().second, 17ul);
+  }
+  for (const auto i : *s.pmap()) {
+    const auto tile = s.find(i).get();
+    BOOST_CHECK_EQUAL(tile.range(), s.trange().make_tile_range(i));
+    for (auto&& idx : tile.range()) {
+      std::vector<std::size_t> x_idx(idx.begin(), idx.end());
+      for (unsigned int d = 0u; d < x_idx.size(); ++d) x_idx[d] += lobound[d];
+      BOOST_CHECK_EQUAL(tile[idx], tr.elements_range().ordinal(x_idx));
+    }
+  }
+
+  // Assign the negated slice to the array
+  ArrayN ns = s.clone();
+  for (const auto i : *ns.pmap()) {
+    auto tile = ns.find(i).get();
+    tile.scale_to(-1);
+  }
+  BOOST_REQUIRE_NO_THROW(TiledArray::assign_slice(x, lobound, upbound, ns));
+  world.gop.fence();
+
+  for (const auto i : *x.pmap()) {
+    const auto tile = x.find(i).get();
+    for (auto&& idx : tile.range()) {
+      const int ordinal = tr.elements_range().ordinal(idx);
+      BOOST_CHECK_EQUAL(tile[idx], (in_slice(idx) ? -ordinal : ordinal));
+    }
+  }
+
+  // Slice a sparse array
+  SpArrayN sb;
+  BOOST_REQUIRE_NO_THROW(sb = TiledArray::slice(b, lobound, upbound));
+  world.gop.fence();
+
+  for (std::size_t i = 0ul; i < sb.size(); ++i) {
+    const auto range = sb.trange().make_tile_range(i);
+    std::vector<std::size_t> b_tile(GlobalFixture::dim);
+    for (unsigned int d = 0u; d < GlobalFixture::dim; ++d)
+      b_tile[d] = tr.data()[d].element_to_tile(range.lobound(d) + lobound[d]);
+    BOOST_CHECK_EQUAL(sb.is_zero(i), b.is_zero(b_tile));
+    if (sb.is_zero(i) || !sb.is_local(i)) continue;
+    for (auto&& v : sb.find(i).get()) BOOST_CHECK_EQUAL(v, b.owner(b_tile) + 1);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(serialization_by_tile) {
   decltype(a) acopy(a.world(), a.trange(), a.shape());
 
@@ -403,4 +567,246 @@ BOOST_AUTO_TEST_CASE(parallel_sparse_serialization) {
   BOOST_CHECK_EQUAL_COLLECTIONS(bread.begin(), bread.end(), b.begin(), b.end());
 }
 
+BOOST_AUTO_TEST_CASE(tile_file) {
+  char file_name[] = "tmp.XXXXXX";
+  mktemp(file_name);
+  world.gop.broadcast(file_name, sizeof(file_name), 0);
+
+  // Write with the default pmap, read with a hashed pmap
+  BOOST_REQUIRE_NO_THROW(write_tile_file(b, file_name));
+  auto pmap = std::make_shared<detail::HashPmap>(world, b.size());
+  SpArrayN bread;
+  BOOST_REQUIRE_NO_THROW(bread = read_tile_file<SpArrayN>(world, file_name, pmap));
+  world.gop.fence();
+
+  BOOST_CHECK_EQUAL(bread.trange(), b.trange());
+  BOOST_REQUIRE(bread.shape() == b.shape());
+  BOOST_CHECK_EQUAL(bread.pmap(), pmap);
+  for (std::size_t i = 0; i < b.size(); ++i) {
+    if (b.is_zero(i) || !bread.is_local(i)) continue;
+    const auto tile = bread.find(i).get();
+    for (auto&& v : tile) BOOST_CHECK_EQUAL(v, b.owner(i) + 1);
+  }
+
+  // Reading into an array with another shape or element type fails
+  BOOST_CHECK_THROW(read_tile_file<ArrayN>(world, file_name),
+                    TiledArray::Exception);
+  BOOST_CHECK_THROW(read_tile_file<TSpArrayD>(world, file_name),
+                    TiledArray::Exception);
+
+  world.gop.fence();
+  if (world.rank() == 0) std::remove(file_name);
+}
+
+BOOST_AUTO_TEST_CASE(map_tile_file) {
+  char file_name[] = "tmp.XXXXXX";
+  mktemp(file_name);
+  world.gop.broadcast(file_name, sizeof(file_name), 0);
+  BOOST_REQUIRE_NO_THROW(write_tile_file(b, file_name));
+
+  SpArrayN bmap;
+  BOOST_REQUIRE_NO_THROW(bmap = map_tile_file<SpArrayN>(world, file_name));
+  world.gop.fence();
+
+  // The file can be removed once mapped
+  if (world.rank() == 0) std::remove(file_name);
+
+  BOOST_CHECK_EQUAL(bmap.trange(), b.trange());
+  BOOST_REQUIRE(bmap.shape() == b.shape());
+  for (std::size_t i = 0; i < b.size(); ++i) {
+    if (b.is_zero(i) || !bmap.is_local(i)) continue;
+    const auto tile = bmap.find(i).get();
+    BOOST_CHECK_EQUAL(tile.range(), b.trange().make_tile_range(i));
+    for (auto&& v : tile) BOOST_CHECK_EQUAL(v, b.owner(i) + 1);
+  }
+
+  // Mapped arrays can be used in expressions
+  SpArrayN c;
+  BOOST_REQUIRE_NO_THROW(c("a,b,c") = 2 * bmap("a,b,c"));
+  for (std::size_t i = 0; i < b.size(); ++i) {
+    if (b.is_zero(i) || !c.is_local(i)) continue;
+    for (auto&& v : c.find(i).get()) BOOST_CHECK_EQUAL(v, 2 * (b.owner(i) + 1));
+  }
+  world.gop.fence();
+}
+
+BOOST_AUTO_TEST_CASE(map_tile_file_version_1) {
+  char file_name[] = "tmp.XXXXXX";
+  mktemp(file_name);
+  world.gop.broadcast(file_name, sizeof(file_name), 0);
+  BOOST_REQUIRE_NO_THROW(write_tile_file(b, file_name));
+
+  // Mark the file as version 1, whose tile payloads need not be aligned
+  if (world.rank() == 0) {
+    detail::PosixFile file(file_name, O_RDWR);
+    const std::uint64_t version = 1ull;
+    file.write(&version, sizeof(version), sizeof(std::uint64_t));
+  }
+  world.gop.fence();
+
+  // Version 1 files are read instead of mapped
+  SpArrayN bmap;
+  BOOST_REQUIRE_NO_THROW(bmap = map_tile_file<SpArrayN>(world, file_name));
+  world.gop.fence();
+  if (world.rank() == 0) std::remove(file_name);
+
+  BOOST_REQUIRE(bmap.shape() == b.shape());
+  for (std::size_t i = 0; i < b.size(); ++i) {
+    if (b.is_zero(i) || !bmap.is_local(i)) continue;
+    for (auto&& v : bmap.find(i).get()) BOOST_CHECK_EQUAL(v, b.owner(i) + 1);
+  }
+  world.gop.fence();
+}
+
+BOOST_AUTO_TEST_CASE(checkpoint) {
+  char prefix[] = "tmp.XXXXXX";
+  mktemp(prefix);
+  world.gop.broadcast(prefix, sizeof(prefix), 0);
+
+  std::size_t local = 0ul;
+  for (std::size_t i = 0; i < b.size(); ++i)
+    if (b.is_local(i) && !b.is_zero(i)) ++local;
+
+  // The base holds all tiles, an unchanged array writes nothing
+  Checkpoint<SpArrayN> ckpt(prefix);
+  BOOST_CHECK_EQUAL(ckpt.write(b), local);
+  BOOST_CHECK_EQUAL(ckpt.write(b), 0ul);
+  BOOST_CHECK_EQUAL(ckpt.size(), 2ul);
+
+  // Change one local tile on each process
+  SpArrayN c;
+  c("a,b,c") = b("a,b,c");
+  world.gop.fence();
+  for (std::size_t i = 0; i < c.size(); ++i) {
+    if (!c.is_local(i) || c.is_zero(i)) continue;
+    c.find(i).get()[0] += 1;
+    break;
+  }
+  BOOST_CHECK_EQUAL(ckpt.write(c), (local ? 1ul : 0ul));
+
+  // Changes within the tolerance are not written
+  Checkpoint<SpArrayN> coarse(std::string(prefix) + ".coarse", 10.0);
+  BOOST_CHECK_EQUAL(coarse.write(b), local);
+  BOOST_CHECK_EQUAL(coarse.write(c), 0ul);
+
+  // Changes that keep the norm are measured by the norm of the difference
+  Checkpoint<SpArrayN> fine(std::string(prefix) + ".fine", 1.0);
+  BOOST_CHECK_EQUAL(fine.write(c), local);
+  SpArrayN d;
+  d("a,b,c") = c("a,b,c");
+  world.gop.fence();
+  for (std::size_t i = 0; i < d.size(); ++i) {
+    if (!d.is_local(i) || d.is_zero(i)) continue;
+    for (auto& v : d.find(i).get()) v = -v;
+    break;
+  }
+  BOOST_CHECK_EQUAL(fine.write(d), (local ? 1ul : 0ul));
+
+  // Restore replays the deltas
+  SpArrayN restored;
+  BOOST_REQUIRE_NO_THROW(restored =
+                             Checkpoint<SpArrayN>::restore(world, prefix));
+  world.gop.fence();
+  BOOST_CHECK_EQUAL(restored.trange(), c.trange());
+  BOOST_REQUIRE(restored.shape() == c.shape());
+  for (std::size_t i = 0; i < c.size(); ++i) {
+    if (c.is_zero(i) || !restored.is_local(i)) continue;
+    const auto tile = restored.find(i).get();
+    const auto expected = c.find(i).get();
+    BOOST_CHECK_EQUAL_COLLECTIONS(tile.begin(), tile.end(), expected.begin(),
+                                  expected.end());
+  }
+
+  world.gop.fence();
+  if (world.rank() == 0) {
+    for (std::size_t n = 0ul; n < 3ul; ++n)
+      std::remove(Checkpoint<SpArrayN>::filename(prefix, n).c_str());
+    for (std::size_t n = 0ul; n < 2ul; ++n) {
+      std::remove(
+          Checkpoint<SpArrayN>::filename(std::string(prefix) + ".coarse", n)
+              .c_str());
+      std::remove(
+          Checkpoint<SpArrayN>::filename(std::string(prefix) + ".fine", n)
+              .c_str());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(memory_stats) {
+  // Check that the local tiles are accounted
+  std::size_t bytes = 0ul;
+  for (auto it = a.begin(); it != a.end(); ++it)
+    bytes += it->get().size() * sizeof(int);
+  const detail::MemoryStats stats = a.memory_stats();
+  BOOST_CHECK_EQUAL(stats.tiles, bytes);
+  BOOST_CHECK_EQUAL(stats.shapes, 0ul);
+  BOOST_CHECK_GE(stats.peak, stats.total());
+
+  // Check that the shape of a sparse array is accounted
+  BOOST_CHECK_GT(b.memory_stats().shapes, 0ul);
+
+  // Check that the memory of arrays rolls up into the world counters
+  reset_memory_peak(world);
+  SpArrayN c;
+  c("a,b,c") = b("a,b,c") * 2;
+  world.gop.fence();
+  const detail::MemoryStats world_stats = TiledArray::memory_stats(world);
+  BOOST_CHECK_GE(world_stats.total(), stats.total() +
+                                          b.memory_stats().total() +
+                                          c.memory_stats().total());
+  BOOST_CHECK_GE(world_stats.peak, world_stats.total());
+  BOOST_CHECK_EQUAL(world_stats.broadcast, 0ul);
+}
+
+BOOST_AUTO_TEST_CASE(timeline) {
+  timeline_enable();
+  timeline_clear();
+  decltype(a) c;
+  c("i,j") = a("i,b,c") * a("j,b,c");
+  world.gop.fence();
+  timeline_enable(false);
+
+  // Check that tile ops and GEMMs are recorded
+  std::stringstream ss;
+  detail::write_timeline(ss, world.rank());
+  const std::string json = ss.str();
+  BOOST_CHECK_EQUAL(json.find("{\"displayTimeUnit\""), 0ul);
+  BOOST_CHECK_NE(json.find("\"cat\":\"gemm\""), std::string::npos);
+  BOOST_CHECK_NE(json.find("\"cat\":\"reduce\""), std::string::npos);
+
+  // Check that nothing is recorded while disabled
+  timeline_clear();
+  c("i,j") = a("i,b,c") * a("j,b,c");
+  world.gop.fence();
+  ss.str("");
+  detail::write_timeline(ss, world.rank());
+  BOOST_CHECK_EQUAL(ss.str().find("\"ph\""), std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(expr_trace_counters) {
+  std::stringstream ss;
+  std::ostream* const os = detail::expr_trace_stream();
+  detail::expr_trace_stream() = &ss;
+  decltype(a) c;
+  c("i,j") = a("i,b,c") * a("j,b,c");
+  world.gop.fence();
+  detail::expr_trace_stream() = os;
+
+  // Check that each node is printed with its counters, and that the
+  // contraction counted its flops
+  if (world.rank() == 0) {
+    const std::string trace = ss.str();
+    BOOST_CHECK_EQUAL(trace.find("i,j =\n"), 0ul);
+    BOOST_CHECK_NE(trace.find(" tiles "), std::string::npos);
+    BOOST_CHECK_NE(trace.find(" screened]"), std::string::npos);
+    const std::size_t first = trace.find("[*]");
+    BOOST_REQUIRE_NE(first, std::string::npos);
+    const std::string line =
+        trace.substr(first, trace.find('\n', first) - first);
+    BOOST_CHECK_EQUAL(line.find(" 0 F "), std::string::npos);
+  } else {
+    BOOST_CHECK(ss.str().empty());
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -18,7 +18,9 @@
  */
 
 #include "TiledArray/distributed_storage.h"
+#include <atomic>
 #include <iterator>
+#include <thread>
 #include "tiledarray.h"
 #include "unit_test_config.h"
 
@@ -51,6 +53,33 @@ struct DistributeOp {
 
 madness::AtomicInt DistributeOp::count;
 
+/// An element whose spill writes wait until the gate is opened
+struct GatedElement {
+  static std::atomic<bool> closed;
+
+  int value = 0;
+
+  GatedElement() = default;
+  explicit GatedElement(const int v) : value(v) {}
+
+  // Only writes to a buffer wait, not the size computations
+  static void wait(const madness::archive::BufferOutputArchive& ar) {
+    if (ar.count_only()) return;
+    while (closed) std::this_thread::yield();
+  }
+
+  template <typename Archive>
+  static void wait(const Archive&) {}
+
+  template <typename Archive>
+  void serialize(Archive& ar) {
+    wait(ar);
+    ar& value;
+  }
+};
+
+std::atomic<bool> GatedElement::closed{false};
+
 BOOST_FIXTURE_TEST_SUITE(distributed_storage_suite, DistributedStorageFixture)
 
 BOOST_AUTO_TEST_CASE(constructor) {
@@ -105,4 +134,125 @@ BOOST_AUTO_TEST_CASE(array_operator) {
 #endif  // TA_EXCEPTION_ERROR
 }
 
+BOOST_AUTO_TEST_CASE(aggregated_set) {
+  // Enable aggregation for storage objects constructed from here on
+  detail::SetAggregation& params = detail::SetAggregation::default_params();
+  const detail::SetAggregation saved_params = params;
+  params.max_bytes = 1ul << 20;
+  params.max_delay = 1.0;
+  Storage s(world, 10, pmap);
+  params = saved_params;
+  BOOST_CHECK(s.aggregation().enabled());
+
+  // Every process sets the elements with ordinal index i % size == rank
+  std::size_t sent = 0ul;
+  for (std::size_t i = 0; i < s.max_size(); ++i)
+    if (!s.is_local(i) && (i % world.size() == std::size_t(world.rank()))) {
+      s.set(i, world.rank());
+      ++sent;
+    }
+
+  world.gop.fence();
+  std::size_t n = s.size();
+  world.gop.sum(n);
+
+  std::size_t remote = 0ul;
+  for (std::size_t i = 0; i < s.max_size(); ++i)
+    if (pmap->owner(i) != i % world.size()) ++remote;
+  BOOST_CHECK_EQUAL(n, remote);
+
+  // Elements with the same destination may share a message
+  const auto stats = s.remote_set_stats();
+  BOOST_CHECK_EQUAL(stats.elements, sent);
+  BOOST_CHECK_LE(stats.messages, sent);
+  if (stats.messages) BOOST_CHECK_GE(stats.ratio(), 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(spill) {
+  const std::size_t max_bytes = 2ul * sizeof(int);
+  BOOST_REQUIRE_NO_THROW(t.set_spill(max_bytes));
+  BOOST_CHECK(t.has_spill());
+
+  std::size_t local = 0ul;
+  for (std::size_t i = 0; i < t.max_size(); ++i) {
+    if (!t.is_local(i)) continue;
+    t.set(i, int(i));
+    ++local;
+  }
+  world.gop.fence();
+
+  // Check that the elements past the budget were written to disk
+  const std::size_t spilled = (local > 2ul ? local - 2ul : 0ul);
+  detail::TileSpillStats stats = t.spill_stats();
+  BOOST_CHECK_EQUAL(t.size(), local);
+  BOOST_CHECK_LE(stats.resident_bytes, max_bytes);
+  BOOST_CHECK_EQUAL(stats.writes, spilled);
+  BOOST_CHECK_EQUAL(stats.file_bytes, spilled * sizeof(int));
+
+  // Check that spilled elements are read back, and never written again
+  for (std::size_t i = 0; i < t.max_size(); ++i)
+    if (t.is_local(i)) t.prefetch(i);
+  for (std::size_t i = 0; i < t.max_size(); ++i)
+    if (t.is_local(i)) BOOST_CHECK_EQUAL(t.get(i).get(), int(i));
+  world.gop.fence();
+
+  stats = t.spill_stats();
+  BOOST_CHECK_GE(stats.reads, spilled);
+  BOOST_CHECK_EQUAL(stats.writes, spilled);
+  BOOST_CHECK_LE(stats.resident_bytes, max_bytes);
+
+  // Check that disabling the spill moves the elements back to memory
+  BOOST_REQUIRE_NO_THROW(t.set_spill(0ul));
+  BOOST_CHECK(!t.has_spill());
+  BOOST_CHECK_EQUAL(t.size(), local);
+  for (std::size_t i = 0; i < t.max_size(); ++i)
+    if (t.is_local(i)) BOOST_CHECK_EQUAL(t.get(i).get(), int(i));
+}
+
+BOOST_AUTO_TEST_CASE(spill_unset_element) {
+  Storage s(world, 10, pmap);
+  BOOST_REQUIRE_NO_THROW(s.set_spill(sizeof(int)));
+
+  // Requesting local elements that are not set does not block fence
+  std::vector<Storage::future> requested;
+  for (std::size_t i = 0; i < s.max_size(); ++i)
+    if (s.is_local(i)) requested.push_back(s.get(i));
+  world.gop.fence();
+  for (const auto& f : requested) BOOST_CHECK(!f.probe());
+
+  // The elements are accounted when they are set
+  for (std::size_t i = 0; i < s.max_size(); ++i)
+    if (s.is_local(i)) s.set(i, int(i));
+  world.gop.fence();
+  for (std::size_t i = 0; i < s.max_size(); ++i)
+    if (s.is_local(i)) BOOST_CHECK_EQUAL(s.get(i).get(), int(i));
+  BOOST_CHECK_LE(s.spill_stats().resident_bytes, sizeof(int));
+}
+
+BOOST_AUTO_TEST_CASE(spill_evict_while_writing) {
+  typedef detail::TileSpill<GatedElement> spill_type;
+  typedef spill_type::future future;
+  auto spill = std::make_shared<spill_type>(world, sizeof(int),
+                                            spill_type::default_directory());
+
+  // Element 0 is evicted, and its write waits at the gate
+  GatedElement::closed = true;
+  spill->insert(0, future(GatedElement(0)));
+  spill->insert(1, future(GatedElement(1)));
+
+  // Element 0 is requested, then evicted again along with element 1
+  BOOST_CHECK_EQUAL(spill->get(0).get().value, 0);
+  spill->insert(2, future(GatedElement(2)));
+  GatedElement::closed = false;
+  world.gop.fence();
+
+  // Element 0 is written once, at its first offset
+  detail::TileSpillStats stats = spill->stats();
+  BOOST_CHECK_EQUAL(stats.writes, 2ul);
+  BOOST_CHECK_EQUAL(stats.file_bytes, 2ul * sizeof(int));
+  BOOST_CHECK_LE(stats.resident_bytes, sizeof(int));
+  for (std::size_t i = 0; i < 3ul; ++i)
+    BOOST_CHECK_EQUAL(spill->get(i).get().value, int(i));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
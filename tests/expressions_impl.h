@@ -2876,6 +2876,340 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(inner_product, F, Fixtures, F) {
   BOOST_CHECK_EQUAL(result, expected);
 }
 
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(cont_dot, F, Fixtures, F) {
+  auto& a = F::a;
+  auto& b = F::b;
+  auto& w = F::w;
+  auto x = F::make_array(F::trange2);
+  F::random_fill(x);
+  GlobalFixture::world->gop.fence();
+
+  // Compute the expected values from the stored contraction result
+  BOOST_REQUIRE_NO_THROW(w("i,j") = a("i,b,c") * b("j,b,c"));
+  typename F::element_type expected = 0;
+  BOOST_REQUIRE_NO_THROW(expected = w("i,j").dot(x("i,j")).get());
+
+  // Test the fused contraction and dot
+  typename F::element_type result = 0;
+  BOOST_REQUIRE_NO_THROW(
+      result = (a("i,b,c") * b("j,b,c")).dot(x("i,j")).get());
+  BOOST_CHECK_EQUAL(result, expected);
+
+  BOOST_REQUIRE_NO_THROW(
+      result = (a("i,b,c") * (3 * b("j,b,c"))).dot(x("i,j")).get());
+  BOOST_CHECK_EQUAL(result, expected * 3);
+
+  BOOST_REQUIRE_NO_THROW(expected = w("j,i").dot(x("i,j")).get());
+  BOOST_REQUIRE_NO_THROW(
+      result = (a("j,b,c") * b("i,b,c")).dot(x("i,j")).get());
+  BOOST_CHECK_EQUAL(result, expected);
+
+  BOOST_REQUIRE_NO_THROW(expected =
+                             w("i,j").inner_product(x("i,j")).get());
+  BOOST_REQUIRE_NO_THROW(
+      result = (a("i,b,c") * b("j,b,c")).inner_product(x("i,j")).get());
+  BOOST_CHECK_EQUAL(result, expected);
+
+  // Test that Hadamard products are not fused
+  BOOST_REQUIRE_NO_THROW(expected = (w("i,j") * x("i,j")).dot(x("i,j")).get());
+  BOOST_REQUIRE_NO_THROW(w("i,j") = w("i,j") * x("i,j"));
+  BOOST_REQUIRE_NO_THROW(result = w("i,j").dot(x("i,j")).get());
+  BOOST_CHECK_EQUAL(result, expected);
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(cont_plan, F, Fixtures, F) {
+  auto& a = F::a;
+  auto& b = F::b;
+  auto& w = F::w;
+  typename F::TArray c;
+  BOOST_REQUIRE_NO_THROW(w("i,j") = a("i,b,c") * b("j,b,c"));
+
+  // The first evaluation records the plan, the second one reuses the
+  // structure of all three nodes
+  TA::expressions::ExprPlan plan;
+  for (unsigned int i = 0u; i < 2u; ++i) {
+    BOOST_REQUIRE_NO_THROW(c("i,j") =
+                               (a("i,b,c") * b("j,b,c")).set_plan(plan));
+    BOOST_CHECK_EQUAL(plan.size(), 3ul);
+    BOOST_CHECK_EQUAL(plan.reused(), i * 3ul);
+
+    for (std::size_t index = 0ul; index < c.size(); ++index) {
+      BOOST_REQUIRE_EQUAL(c.is_zero(index), w.is_zero(index));
+      if (c.is_zero(index) || !c.is_local(index)) continue;
+      auto c_tile = c.find(index).get();
+      auto w_tile = w.find(index).get();
+      for (std::size_t j = 0ul; j < c_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(c_tile[j], w_tile[j]);
+    }
+  }
+
+  // Only the unchanged leaf is reused after an argument is replaced
+  auto x = F::make_array(F::tr);
+  F::random_fill(x);
+  GlobalFixture::world->gop.fence();
+  BOOST_REQUIRE_NO_THROW(c("i,j") = (a("i,b,c") * x("j,b,c")).set_plan(plan));
+  BOOST_CHECK_EQUAL(plan.reused(), 1ul);
+  BOOST_REQUIRE_NO_THROW(w("i,j") = a("i,b,c") * x("j,b,c"));
+  BOOST_CHECK_EQUAL(c("i,j").norm().get(), w("i,j").norm().get());
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(cont_cache, F, Fixtures, F) {
+  auto& a = F::a;
+  auto& b = F::b;
+  auto x = F::make_array(F::trange2);
+  F::random_fill(x);
+  GlobalFixture::world->gop.fence();
+
+  typename F::TArray r1, r2, e1, e2;
+  BOOST_REQUIRE_NO_THROW(e1("i,k") = (a("i,b,c") * b("j,b,c")) * x("j,k"));
+  BOOST_REQUIRE_NO_THROW(e2("i,k") =
+                             (a("i,b,c") * b("j,b,c")) * (2 * x("j,k")));
+
+  {
+    // The shared contraction is evaluated once
+    TA::expressions::ExprCache cache;
+    BOOST_REQUIRE_NO_THROW(r1("i,k") = (a("i,b,c") * b("j,b,c")) * x("j,k"));
+    BOOST_REQUIRE_NO_THROW(r2("i,k") =
+                               (a("i,b,c") * b("j,b,c")) * (2 * x("j,k")));
+    BOOST_CHECK_EQUAL(cache.misses(), 1ul);
+    BOOST_CHECK_EQUAL(cache.hits(), 1ul);
+    BOOST_CHECK_EQUAL((r1("i,k") - e1("i,k")).norm().get(), 0);
+    BOOST_CHECK_EQUAL((r2("i,k") - e2("i,k")).norm().get(), 0);
+
+    // A contraction of other array instances is not reused
+    auto y = F::make_array(F::tr);
+    F::random_fill(y);
+    GlobalFixture::world->gop.fence();
+    BOOST_REQUIRE_NO_THROW(r1("i,k") = (a("i,b,c") * y("j,b,c")) * x("j,k"));
+    typename F::TArray ay;
+    BOOST_REQUIRE_NO_THROW(ay("i,j") = a("i,b,c") * y("j,b,c"));
+    BOOST_REQUIRE_NO_THROW(e1("i,k") = ay("i,j") * x("j,k"));
+    BOOST_CHECK_EQUAL(cache.misses(), 2ul);
+    BOOST_CHECK_EQUAL(cache.size(), 2ul);
+    BOOST_CHECK_EQUAL((r1("i,k") - e1("i,k")).norm().get(), 0);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(block_shared_tiles, F, Fixtures, F) {
+  auto& a = F::a;
+  auto& b = F::b;
+  auto& c = F::c;
+  const auto a_copy = a.clone();
+
+  // A block assigned to an array is copied, so modifying the result does
+  // not modify the argument
+  BOOST_REQUIRE_NO_THROW(c("a,b,c") = a("a,b,c").block({3, 3, 3}, {5, 5, 5}));
+  for (auto it = c.begin(); it != c.end(); ++it) {
+    auto tile = it->get();
+    for (std::size_t j = 0ul; j < tile.range().volume(); ++j) tile[j] += 1;
+  }
+
+  // Tiles of block subexpressions share the data of the array tiles, which
+  // their consumers do not modify
+  BOOST_REQUIRE_NO_THROW(
+      c("a,b,c") = c("a,b,c") + b("a,b,c").block({3, 3, 3}, {5, 5, 5}));
+  BOOST_REQUIRE_NO_THROW(c("a,b,c") = a("a,b,c").block({3, 3, 3}, {5, 5, 5}) -
+                                      b("a,b,c").block({3, 3, 3}, {5, 5, 5}));
+  BOOST_REQUIRE_NO_THROW(c("a,b,c") =
+                             2 * a("a,b,c").block({3, 3, 3}, {5, 5, 5}));
+
+  for (std::size_t index = 0ul; index < a.size(); ++index) {
+    BOOST_CHECK_EQUAL(a.is_zero(index), a_copy.is_zero(index));
+    if (!a.is_zero(index)) {
+      auto tile = a.find(index).get();
+      auto copy_tile = a_copy.find(index).get();
+      BOOST_CHECK_EQUAL(tile.range(), copy_tile.range());
+      for (std::size_t j = 0ul; j < tile.range().volume(); ++j)
+        BOOST_CHECK_EQUAL(tile[j], copy_tile[j]);
+    }
+  }
+
+  // Check the result of the last expression
+  BlockRange block_range(a.trange().tiles_range(), {3, 3, 3}, {5, 5, 5});
+  for (std::size_t index = 0ul; index < block_range.volume(); ++index) {
+    if (!a.is_zero(block_range.ordinal(index))) {
+      auto arg_tile = a.find(block_range.ordinal(index)).get();
+      auto result_tile = c.find(index).get();
+      for (std::size_t j = 0ul; j < result_tile.range().volume(); ++j)
+        BOOST_CHECK_EQUAL(result_tile[j], 2 * arg_tile[j]);
+    } else {
+      BOOST_CHECK(c.is_zero(index));
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(partial_reduce, F, Fixtures, F) {
+  auto& a = F::a;
+  auto& u = F::u;
+  auto& v = F::v;
+  auto& w = F::w;
+  typename std::decay<decltype(a)>::type r;
+  F::random_fill(w);
+  GlobalFixture::world->gop.fence();
+
+  // Row, column, and permuted partial reductions
+  BOOST_REQUIRE_NO_THROW(u("i") = partial_sum(w("i,j")));
+  BOOST_REQUIRE_NO_THROW(v("j") = partial_sum(w("i,j")));
+  BOOST_REQUIRE_NO_THROW(r("a,c") = partial_sum(a("a,b,c")));
+
+  // Compare the results with the sums of the argument elements
+  auto check_sum = [](const auto& arg, const auto& result,
+                      const std::vector<std::size_t>& kept) {
+    typedef typename std::decay_t<decltype(arg)>::element_type element_type;
+    const auto& elements = result.trange().elements_range();
+    std::vector<element_type> sums(elements.volume(), element_type(0));
+    std::vector<std::size_t> index(kept.size());
+    for (std::size_t i = 0ul; i < arg.size(); ++i) {
+      if (arg.is_zero(i)) continue;
+      const auto tile = arg.find(i).get();
+      for (const auto& arg_index : tile.range()) {
+        for (std::size_t d = 0ul; d < kept.size(); ++d)
+          index[d] = arg_index[kept[d]];
+        sums[elements.ordinal(index)] += tile[arg_index];
+      }
+    }
+
+    for (std::size_t i = 0ul; i < result.size(); ++i) {
+      const auto range = result.trange().make_tile_range(i);
+      if (result.is_zero(i)) {
+        for (const auto& index : range)
+          BOOST_CHECK_EQUAL(sums[elements.ordinal(index)], element_type(0));
+      } else {
+        const auto tile = result.find(i).get();
+        for (const auto& index : range)
+          BOOST_CHECK_EQUAL(tile[index], sums[elements.ordinal(index)]);
+      }
+    }
+  };
+
+  check_sum(w, u, {0});
+  check_sum(w, v, {1});
+  check_sum(a, r, {0, 2});
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(element_function, F, Fixtures, F) {
+  auto& a = F::a;
+  auto& b = F::b;
+  auto& c = F::c;
+  auto square = [](const auto x) { return x * x; };
+
+  // Fused with a binary expression
+  BOOST_REQUIRE_NO_THROW(c("a,b,c") = apply(a("a,b,c"), square) * b("a,b,c"));
+
+  for (std::size_t i = 0ul; i < c.size(); ++i) {
+    if (!c.is_zero(i)) {
+      auto c_tile = c.find(i).get();
+      auto a_tile =
+          a.is_zero(i) ? F::make_zero_tile(c_tile.range()) : a.find(i).get();
+      auto b_tile =
+          b.is_zero(i) ? F::make_zero_tile(c_tile.range()) : b.find(i).get();
+
+      for (std::size_t j = 0ul; j < c_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(c_tile[j], (a_tile[j] * a_tile[j]) * b_tile[j]);
+    } else {
+      BOOST_CHECK(a.is_zero(i) || b.is_zero(i));
+    }
+  }
+
+  // Applied in-place to a consumable argument
+  BOOST_REQUIRE_NO_THROW(c("a,b,c") = apply(2 * a("a,b,c"), square));
+
+  for (std::size_t i = 0ul; i < c.size(); ++i) {
+    BOOST_CHECK_EQUAL(c.is_zero(i), a.is_zero(i));
+    if (!c.is_zero(i)) {
+      auto c_tile = c.find(i).get();
+      auto a_tile = a.find(i).get();
+
+      for (std::size_t j = 0ul; j < c_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(c_tile[j], (2 * a_tile[j]) * (2 * a_tile[j]));
+    }
+  }
+
+  // Applied to a permuted argument
+  Permutation perm({2, 1, 0});
+  BOOST_REQUIRE_NO_THROW(c("a,b,c") = apply(a("c,b,a"), square));
+
+  for (std::size_t i = 0ul; i < a.size(); ++i) {
+    const std::size_t perm_index = c.range().ordinal(perm * a.range().idx(i));
+    if (c.is_local(perm_index) && !c.is_zero(perm_index)) {
+      auto c_tile = c.find(perm_index).get();
+      auto perm_a_tile = perm * a.find(i).get();
+
+      BOOST_CHECK_EQUAL(c_tile.range(), perm_a_tile.range());
+      for (std::size_t j = 0ul; j < c_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(c_tile[j], perm_a_tile[j] * perm_a_tile[j]);
+    } else if (c.is_local(perm_index) && c.is_zero(perm_index)) {
+      BOOST_CHECK(a.is_zero(i));
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(task_priority, F, Fixtures, F) {
+  auto& a = F::a;
+  auto& b = F::b;
+  auto& c = F::c;
+  auto& w = F::w;
+  typename std::decay<decltype(w)>::type r;
+
+  // With automatic priority, only the tasks of tiles that other processes
+  // wait on have high priority
+  typedef TiledArray::detail::TaskRank TaskRank;
+  const TaskRank root;
+  const TaskRank arg = root.arg(false);
+  const TaskRank bcast = root.arg(true);
+  BOOST_CHECK(!root.is_high(false));
+  BOOST_CHECK(root.is_high(true));
+  BOOST_CHECK(!arg.is_high(false));
+  BOOST_CHECK(!arg.arg(false).is_high(false));
+  BOOST_CHECK(arg.is_high(true));
+  BOOST_CHECK(bcast.is_high(false));
+  BOOST_CHECK(!bcast.arg(false).is_high(false));
+
+  // Explicit priorities override the rank, and are inherited by arguments
+  for (const auto& rank : {root, arg, bcast}) {
+    for (const bool remote : {false, true}) {
+      const TaskRank high = rank.with_priority(TaskPriority::high);
+      const TaskRank normal = rank.with_priority(TaskPriority::normal);
+      BOOST_CHECK(high.is_high(remote));
+      BOOST_CHECK(high.arg(false).is_high(remote));
+      BOOST_CHECK(!normal.is_high(remote));
+      BOOST_CHECK(!normal.arg(true).is_high(remote));
+      BOOST_CHECK(normal.with_priority(TaskPriority::automatic).priority() ==
+                  TaskPriority::normal);
+      BOOST_CHECK(high.attr(remote).is_high_priority());
+      BOOST_CHECK(!normal.attr(remote).is_high_priority());
+      BOOST_CHECK_EQUAL(rank.attr(remote).is_high_priority(),
+                        rank.is_high(remote));
+    }
+  }
+
+  // The priority of the tile tasks does not change the result
+  typename std::decay<decltype(w)>::type e;
+  BOOST_REQUIRE_NO_THROW(c("i,j") = (a("i,b,c") + 2 * a("i,b,c")) * b("j,b,c"));
+  BOOST_REQUIRE_NO_THROW(e("i,j") = c("i,j") + 2 * c("j,i"));
+  auto check_equal = [](const auto& result, const auto& expected) {
+    for (std::size_t i = 0ul; i < result.size(); ++i) {
+      BOOST_CHECK_EQUAL(result.is_zero(i), expected.is_zero(i));
+      if (!result.is_zero(i)) {
+        auto result_tile = result.find(i).get();
+        auto expected_tile = expected.find(i).get();
+        for (std::size_t j = 0ul; j < result_tile.size(); ++j)
+          BOOST_CHECK_EQUAL(result_tile[j], expected_tile[j]);
+      }
+    }
+  };
+
+  for (const auto priority : {TaskPriority::high, TaskPriority::normal}) {
+    BOOST_REQUIRE_NO_THROW(
+        r("i,j") = (a("i,b,c") + (2 * a("i,b,c")).set_priority(priority)) *
+                   b("j,b,c"));
+    BOOST_REQUIRE_NO_THROW(w("i,j") = (r("i,j") + 2 * r("j,i"))
+                                          .set_priority(priority));
+    check_equal(r, c);
+    check_equal(w, e);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif  // TILEDARRAY_TEST_EXPRESSIONS_IMPL_H
@@ -29,5 +29,220 @@ typedef ExpressionsFixture<TiledArray::Tensor<int>, TA::SparsePolicy>
     EF_TAspTensorI;
 typedef boost::mpl::vector<EF_TAspTensorI> Fixtures;
 
+/// An element function with state, which is identified by its factor
+struct ScaleOp {
+  double factor;
+  double operator()(const double v) const { return factor * v; }
+};
+
+inline void func_key(std::ostream& os, const ScaleOp& op) {
+  os << "ScaleOp:" << std::hexfloat << op.factor << std::defaultfloat;
+}
+
 BOOST_AUTO_TEST_SUITE(expressions_sparse_suite)
 #include "expressions_impl.h"
+
+BOOST_AUTO_TEST_SUITE(expressions_sparse_batched_suite)
+
+BOOST_FIXTURE_TEST_CASE(batched_cont, EF_TAspTensorI) {
+  typedef EF_TAspTensorI::TArray TArray;
+  TArray expected;
+  expected("i,j") = a("i,b,c") * b("j,b,c");
+  const std::size_t rows = expected.trange().tiles_range().extent(0);
+
+  // Check that one row of tiles per batch reproduces the result
+  TArray result;
+  std::size_t batches = 0ul;
+  BOOST_REQUIRE_NO_THROW(batches = (a("i,b,c") * b("j,b,c"))
+                                       .eval_batched_to(result("i,j"), 1ul));
+  BOOST_CHECK_GT(batches, 0ul);
+  BOOST_CHECK_LE(batches, rows);
+  for (std::size_t i = 0ul; i < expected.size(); ++i) {
+    BOOST_CHECK_EQUAL(result.is_zero(i), expected.is_zero(i));
+    if (expected.is_zero(i) || !expected.is_local(i)) continue;
+    const auto tile = result.find(i).get();
+    const auto expected_tile = expected.find(i).get();
+    BOOST_CHECK_EQUAL_COLLECTIONS(tile.begin(), tile.end(),
+                                  expected_tile.begin(), expected_tile.end());
+  }
+
+  // Check that a sink sees every result tile, and that a large budget
+  // evaluates a single batch
+  auto squared_norm = expected("i,j").squared_norm().get();
+  decltype(squared_norm) batched_squared_norm = 0;
+  BOOST_REQUIRE_NO_THROW(batches = (a("i,b,c") * b("j,b,c"))
+                                       .eval_batched<TArray>(
+                                           "i,j", 1ul, [&](TArray& batch) {
+                                             batched_squared_norm +=
+                                                 batch("i,j")
+                                                     .squared_norm()
+                                                     .get();
+                                           }));
+  BOOST_CHECK_EQUAL(batched_squared_norm, squared_norm);
+  BOOST_REQUIRE_NO_THROW(batches = (a("i,b,c") * b("j,b,c"))
+                                       .eval_batched<TArray>(
+                                           "i,j", 1ul << 40,
+                                           [](TArray&) {}));
+  BOOST_CHECK_EQUAL(batches, 1ul);
+}
+
+BOOST_FIXTURE_TEST_CASE(partial_reduce_zero_tiles, EF_TAspTensorI) {
+  typedef EF_TAspTensorI::TArray TArray;
+  random_fill(w);
+  GlobalFixture::world->gop.fence();
+
+  // The elements of w, including the zeros of zero tiles
+  const auto& elements = w.trange().elements_range();
+  const std::size_t m = elements.extent(0);
+  const std::size_t n = elements.extent(1);
+  std::vector<int> values(elements.volume(), 0);
+  for (std::size_t i = 0ul; i < w.size(); ++i) {
+    if (w.is_zero(i)) continue;
+    const auto tile = w.find(i).get();
+    for (const auto& index : tile.range())
+      values[elements.ordinal(index)] = tile[index];
+  }
+
+  // Compare the rows (or columns) of a result with the reductions of the
+  // elements of w
+  auto check = [&](const TArray& result, const bool row, const int identity,
+                   const auto& op) {
+    std::vector<int> expected(row ? m : n, identity);
+    for (std::size_t i = 0ul; i < m; ++i)
+      for (std::size_t j = 0ul; j < n; ++j)
+        op(expected[row ? i : j], values[i * n + j]);
+
+    for (std::size_t i = 0ul; i < result.size(); ++i) {
+      const auto range = result.trange().make_tile_range(i);
+      if (result.is_zero(i)) {
+        for (const auto& index : range)
+          BOOST_CHECK_EQUAL(expected[index[0]], 0);
+      } else {
+        const auto tile = result.find(i).get();
+        for (const auto& index : range)
+          BOOST_CHECK_EQUAL(tile[index], expected[index[0]]);
+      }
+    }
+  };
+
+  // Zero tiles are reduced as zeros, which change the maxima of negative
+  // elements and the minima of positive elements
+  TArray r;
+  BOOST_REQUIRE_NO_THROW(r("i") = partial_max(-w("i,j")));
+  check(r, true, std::numeric_limits<int>::lowest(),
+        [](int& result, const int x) { result = std::max(result, -x); });
+  BOOST_REQUIRE_NO_THROW(r("j") = partial_min(w("i,j")));
+  check(r, false, std::numeric_limits<int>::max(),
+        [](int& result, const int x) { result = std::min(result, x); });
+  BOOST_REQUIRE_NO_THROW(r("i") = partial_squared_norm(w("i,j")));
+  check(r, true, 0, [](int& result, const int x) { result += x * x; });
+}
+
+BOOST_FIXTURE_TEST_CASE(element_function_factories, EF_TAspTensorI) {
+  typedef TA::DistArray<TA::Tensor<double>, TA::SparsePolicy> TArrayD;
+  TArrayD x(*GlobalFixture::world, trange2, s_tr2);
+  for (const auto index : *x.pmap()) {
+    if (x.is_zero(index)) continue;
+    TA::Tensor<double> tile(x.trange().make_tile_range(index));
+    for (std::size_t j = 0ul; j < tile.size(); ++j)
+      tile[j] = 0.5 + double((index + j) % 10) / 10;
+    x.set(index, tile);
+  }
+  GlobalFixture::world->gop.fence();
+
+  // Compare a result with the element function of the non-zero tiles of x;
+  // the zero tiles of x remain zero
+  auto check = [&x](const TArrayD& result, const auto& op) {
+    for (std::size_t i = 0ul; i < x.size(); ++i) {
+      BOOST_CHECK_EQUAL(result.is_zero(i), x.is_zero(i));
+      if (x.is_zero(i) || !x.is_local(i)) continue;
+      const auto tile = result.find(i).get();
+      const auto arg_tile = x.find(i).get();
+      for (std::size_t j = 0ul; j < tile.size(); ++j)
+        BOOST_CHECK_CLOSE(tile[j], op(arg_tile[j]), 1e-10);
+    }
+  };
+
+  TArrayD r;
+  BOOST_REQUIRE_NO_THROW(r("i,j") = exp(x("i,j")));
+  check(r, [](const double v) { return std::exp(v); });
+  BOOST_REQUIRE_NO_THROW(r("i,j") = log(x("i,j")));
+  check(r, [](const double v) { return std::log(v); });
+  BOOST_REQUIRE_NO_THROW(r("i,j") = sqrt(x("i,j")));
+  check(r, [](const double v) { return std::sqrt(v); });
+  BOOST_REQUIRE_NO_THROW(r("i,j") = inv(x("i,j")));
+  check(r, [](const double v) { return 1 / v; });
+  BOOST_REQUIRE_NO_THROW(r("i,j") = pow(x("i,j"), 3));
+  check(r, [](const double v) { return std::pow(v, 3); });
+  BOOST_REQUIRE_NO_THROW(r("i,j") = pow(x("i,j"), -0.5));
+  check(r, [](const double v) { return std::pow(v, -0.5); });
+
+  // Element functions with captures are cached only if they are identified
+  // by a func_key() overload, so the results of functions that capture
+  // values by reference are not reused when the values change
+  double factor = 2.0;
+  auto by_reference = [&factor](const double v) { return factor * v; };
+  TArrayD r2, r3, r4, e2;
+  {
+    TA::expressions::ExprCache cache;
+    BOOST_REQUIRE_NO_THROW(
+        r("i,l") = (apply(x("i,j"), by_reference) * x("k,j")) * x("k,l"));
+    factor = 3.0;
+    BOOST_REQUIRE_NO_THROW(
+        r2("i,l") = (apply(x("i,j"), by_reference) * x("k,j")) * x("k,l"));
+    BOOST_CHECK_EQUAL(cache.size(), 0ul);
+
+    for (unsigned int i = 0u; i < 2u; ++i)
+      BOOST_REQUIRE_NO_THROW(
+          r3("i,l") = (apply(x("i,j"), ScaleOp{3.0}) * x("k,j")) * x("k,l"));
+    BOOST_REQUIRE_NO_THROW(
+        r4("i,l") = (apply(x("i,j"), ScaleOp{2.0}) * x("k,j")) * x("k,l"));
+    BOOST_CHECK_EQUAL(cache.misses(), 2ul);
+    BOOST_CHECK_EQUAL(cache.hits(), 1ul);
+    BOOST_CHECK_EQUAL(cache.size(), 2ul);
+  }
+  BOOST_REQUIRE_NO_THROW(e2("i,l") = 1.5 * r("i,l"));
+  BOOST_CHECK_CLOSE(r2("i,l").norm().get(), e2("i,l").norm().get(), 1e-10);
+  BOOST_CHECK_CLOSE(r3("i,l").norm().get(), e2("i,l").norm().get(), 1e-10);
+  BOOST_CHECK_CLOSE(r4("i,l").norm().get(), r("i,l").norm().get(), 1e-10);
+}
+
+BOOST_FIXTURE_TEST_CASE(exact_factor_keys, EF_TAspTensorI) {
+  typedef TA::DistArray<TA::Tensor<double>, TA::SparsePolicy> TArrayD;
+  TArrayD x(*GlobalFixture::world, trange2, s_tr2);
+  for (const auto index : *x.pmap()) {
+    if (x.is_zero(index)) continue;
+    TA::Tensor<double> tile(x.trange().make_tile_range(index));
+    for (std::size_t j = 0ul; j < tile.size(); ++j)
+      tile[j] = 0.5 + double((index + j) % 10) / 10;
+    x.set(index, tile);
+  }
+  GlobalFixture::world->gop.fence();
+
+  // Factors that are printed alike are not confused by an expression cache
+  const double f1 = 1.0;
+  const double f2 = 1.0000001;
+  TArrayD r1, r2;
+  {
+    TA::expressions::ExprCache cache;
+    BOOST_REQUIRE_NO_THROW(r1("i,l") =
+                               (f1 * (x("i,j") * x("k,j"))) * x("k,l"));
+    BOOST_REQUIRE_NO_THROW(r2("i,l") =
+                               (f2 * (x("i,j") * x("k,j"))) * x("k,l"));
+    BOOST_CHECK_EQUAL(cache.misses(), 2ul);
+    BOOST_CHECK_EQUAL(cache.hits(), 0ul);
+  }
+  BOOST_CHECK_CLOSE(r2("i,l").norm().get(), f2 * r1("i,l").norm().get(),
+                    1e-10);
+
+  // ... nor by an evaluation plan, which reuses only the leaves
+  TA::expressions::ExprPlan plan;
+  BOOST_REQUIRE_NO_THROW(r1("i,k") =
+                             (f1 * (x("i,j") * x("k,j"))).set_plan(plan));
+  BOOST_REQUIRE_NO_THROW(r2("i,k") =
+                             (f2 * (x("i,j") * x("k,j"))).set_plan(plan));
+  BOOST_CHECK_EQUAL(plan.size(), 3ul);
+  BOOST_CHECK_EQUAL(plan.reused(), 2ul);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2019  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  low_rank_tile.cpp
+ *  Nov 28, 2019
+ *
+ */
+
+#include "TiledArray/low_rank_tile.h"
+#include "tiledarray.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+
+struct LowRankTileFixture {
+  typedef LowRankTile<double> TileD;
+
+  LowRankTileFixture()
+      : range({0, 0}, {40, 30}),
+        dense(make_dense(range, 3ul)),
+        tile(dense, 1.0e-10) {}
+
+  /// A matrix of rank \c rank
+  static Tensor<double> make_dense(const Range& range, const std::size_t rank) {
+    Tensor<double> result(range, 0.0);
+    for (std::size_t k = 0ul; k < rank; ++k)
+      for (auto i = range.lobound(0); i < range.upbound(0); ++i)
+        for (auto j = range.lobound(1); j < range.upbound(1); ++j)
+          result(i, j) += std::sin(double(i * (k + 1ul) + 1ul)) *
+                          std::cos(double(j + 3ul * k));
+    return result;
+  }
+
+  /// Largest difference of a tile and a tensor
+  static double max_error(const TileD& tile, const Tensor<double>& tensor) {
+    const auto dense = static_cast<Tensor<double> >(tile);
+    BOOST_CHECK_EQUAL(dense.range(), tensor.range());
+    double result = 0.0;
+    for (std::size_t i = 0ul; i < dense.size(); ++i)
+      result = std::max(result, std::abs(dense[i] - tensor[i]));
+    return result;
+  }
+
+  Range range;
+  Tensor<double> dense;
+  TileD tile;
+};  // struct LowRankTileFixture
+
+BOOST_FIXTURE_TEST_SUITE(low_rank_tile_suite, LowRankTileFixture)
+
+BOOST_AUTO_TEST_CASE(compress) {
+  BOOST_CHECK(!tile.empty());
+  BOOST_CHECK(TileD().empty());
+  BOOST_CHECK_EQUAL(tile.range(), range);
+  BOOST_CHECK_EQUAL(tile.rank(), 3ul);
+  BOOST_CHECK_SMALL(max_error(tile, dense), 1.0e-10);
+
+  // A zero tile has rank 0
+  TileD zero(range);
+  BOOST_CHECK_EQUAL(zero.rank(), 0ul);
+  BOOST_CHECK_EQUAL(zero.norm(), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(reductions) {
+  BOOST_CHECK_CLOSE(tile.norm(), dense.norm(), 1.0e-8);
+  BOOST_CHECK_CLOSE(tile.squared_norm(), dense.squared_norm(), 1.0e-8);
+  BOOST_CHECK_CLOSE(tile.sum(), dense.sum(), 1.0e-8);
+  BOOST_CHECK_CLOSE(tile.trace(), dense.trace(), 1.0e-8);
+}
+
+BOOST_AUTO_TEST_CASE(scale_permute) {
+  const Permutation perm({1, 0});
+  BOOST_CHECK_SMALL(max_error(tile.scale(2.5), dense.scale(2.5)), 1.0e-10);
+  BOOST_CHECK_SMALL(max_error(tile.permute(perm), dense.permute(perm)),
+                    1.0e-10);
+  BOOST_CHECK_SMALL(
+      max_error(tile.scale(-2.0, perm), dense.scale(-2.0, perm)), 1.0e-10);
+  BOOST_CHECK_SMALL(max_error(tile.neg(), dense.neg()), 1.0e-10);
+}
+
+BOOST_AUTO_TEST_CASE(add_recompresses) {
+  // The sum of a tile with itself has the same rank
+  const TileD sum = tile.add(tile);
+  BOOST_CHECK_EQUAL(sum.rank(), 3ul);
+  BOOST_CHECK_SMALL(max_error(sum, dense.add(dense)), 1.0e-9);
+
+  // The difference of a tile with itself is zero
+  const TileD zero = tile.subt(tile);
+  BOOST_CHECK_EQUAL(zero.rank(), 0ul);
+
+  const TileD other(make_dense(range, 2ul), 1.0e-10);
+  TileD result = tile.clone();
+  result.add_to(other, 3.0);
+  BOOST_CHECK_LE(result.rank(), 5ul);
+  BOOST_CHECK_SMALL(
+      max_error(result, dense.add(make_dense(range, 2ul), 3.0)), 1.0e-9);
+
+  // The original tile is not modified by the deep copy
+  BOOST_CHECK_EQUAL(tile.rank(), 3ul);
+}
+
+BOOST_AUTO_TEST_CASE(gemm) {
+  // right^T(20, 30) * tile^T(30, 40)
+  const Range right_range({0, 0}, {30, 20});
+  const Tensor<double> right_dense = make_dense(right_range, 4ul);
+  const TileD right(right_dense, 1.0e-10);
+
+  math::GemmHelper gemm_helper(madness::cblas::Trans, madness::cblas::NoTrans,
+                               2u, 2u, 2u);
+  const TileD result = right.gemm(tile.permute(Permutation({1, 0})), 2.0,
+                                  gemm_helper);
+  const Tensor<double> expected = right_dense.gemm(
+      dense.permute(Permutation({1, 0})), 2.0, gemm_helper);
+  BOOST_CHECK_LE(result.rank(), 3ul);
+  BOOST_CHECK_SMALL(max_error(result, expected), 1.0e-9);
+
+  // Accumulate into an existing result
+  TileD accumulated = result.clone();
+  accumulated.gemm(right, tile.permute(Permutation({1, 0})), 1.0,
+                   gemm_helper);
+  BOOST_CHECK_LE(accumulated.rank(), 3ul);
+  BOOST_CHECK_SMALL(max_error(accumulated, expected.scale(1.5)), 1.0e-9);
+}
+
+BOOST_AUTO_TEST_CASE(serialization) {
+  std::size_t buf_size = 100000ul;
+  unsigned char* buf = new unsigned char[buf_size];
+  madness::archive::BufferOutputArchive oar(buf, buf_size);
+  BOOST_REQUIRE_NO_THROW(oar & tile);
+  std::size_t nbyte = oar.size();
+  oar.close();
+
+  TileD result;
+  madness::archive::BufferInputArchive iar(buf, nbyte);
+  BOOST_REQUIRE_NO_THROW(iar & result);
+  iar.close();
+  delete[] buf;
+
+  BOOST_CHECK_EQUAL(result.rank(), tile.rank());
+  BOOST_CHECK_SMALL(max_error(result, dense), 1.0e-10);
+}
+
+BOOST_AUTO_TEST_CASE(sparse_array_contraction) {
+  World& world = *GlobalFixture::world;
+  const TiledRange trange{{0, 40, 80}, {0, 30, 60}};
+  auto a = make_array<TSpArrayD>(
+      world, trange, [](Tensor<double>& tile, const Range& range) {
+        tile = make_dense(range, 2ul);
+        return tile.norm();
+      });
+  auto a_lr = make_array<DistArray<TileD, SparsePolicy> >(
+      world, trange, [](TileD& tile, const Range& range) {
+        tile = TileD(make_dense(range, 2ul), 1.0e-10);
+        return tile.norm();
+      });
+
+  TSpArrayD c;
+  DistArray<TileD, SparsePolicy> c_lr;
+  c("i,j") = a("i,k") * a("j,k");
+  BOOST_REQUIRE_NO_THROW(c_lr("i,j") = a_lr("i,k") * a_lr("j,k"));
+
+  // Each result tile is a sum of two products of rank-2 tiles
+  for (auto it = c_lr.begin(); it != c_lr.end(); ++it) {
+    const TileD tile = it->get();
+    BOOST_CHECK_LE(tile.rank(), 4ul);
+    BOOST_CHECK_SMALL(max_error(tile, c.find(it.index()).get()), 1.0e-8);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
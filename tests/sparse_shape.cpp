@@ -75,6 +75,22 @@ BOOST_AUTO_TEST_CASE(default_constructor) {
 #endif  // TA_EXCEPTION_ERROR
 }
 
+BOOST_AUTO_TEST_CASE(rank_bound) {
+  const float tol = 0.1f;
+  for (auto ord = 0ul; ord < tr.tiles_range().volume(); ++ord) {
+    const auto range = tr.make_tile_range(ord);
+    const std::size_t rows = range.extent(0);
+    const std::size_t cols = range.volume() / rows;
+    const float norm = sparse_shape[ord] * float(range.volume());
+    const std::size_t bound = sparse_shape.rank_bound(ord, tol);
+
+    // At most norm^2 / tol^2 singular values exceed tol
+    BOOST_CHECK_LE(bound, std::min(rows, cols));
+    BOOST_CHECK_LE(double(bound), double(norm) * norm / (tol * tol) + 1.0e-3);
+    if (sparse_shape.is_zero(ord)) BOOST_CHECK_EQUAL(bound, 0ul);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(non_comm_constructor) {
   // Construct test tile norms
   Tensor<float> tile_norms = make_norm_tensor(tr, 1, 42);
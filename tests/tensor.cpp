@@ -105,6 +105,48 @@ BOOST_AUTO_TEST_CASE(iterator_copy_constructor) {
   for (std::size_t i = 0ul; i < x.size(); ++i) BOOST_CHECK_EQUAL(x[i], t[i]);
 }
 
+BOOST_AUTO_TEST_CASE(external_data_constructor) {
+  std::shared_ptr<int> data(new int[r.volume()],
+                            std::default_delete<int[]>());
+  std::fill_n(data.get(), r.volume(), 3);
+  BOOST_REQUIRE_NO_THROW(TensorN x(r, data));
+  TensorN x(r, data);
+
+  // Check that the data is shared, not copied
+  BOOST_CHECK_EQUAL(x.data(), data.get());
+  BOOST_CHECK_EQUAL(x.range(), r);
+  for (TensorN::const_iterator it = x.begin(); it != x.end(); ++it)
+    BOOST_CHECK_EQUAL(*it, 3);
+
+  // Check that the tensor keeps the data alive
+  std::weak_ptr<int> weak = data;
+  data.reset();
+  BOOST_CHECK(!weak.expired());
+  x = TensorN();
+  BOOST_CHECK(weak.expired());
+}
+
+BOOST_AUTO_TEST_CASE(shift_view) {
+  std::vector<long> bound_shift(r.rank(), -1l);
+  TensorN s = t.clone();
+  BOOST_REQUIRE_NO_THROW(s.shift_view(bound_shift));
+  TensorN x = s.shift_view(bound_shift);
+
+  // Check that the range is shifted and the data is shared, not copied
+  for (unsigned int d = 0u; d < r.rank(); ++d) {
+    BOOST_CHECK_EQUAL(x.range().lobound(d), s.range().lobound(d) - 1l);
+    BOOST_CHECK_EQUAL(x.range().upbound(d), s.range().upbound(d) - 1l);
+  }
+  BOOST_CHECK_EQUAL(s.range(), t.range());
+  BOOST_CHECK_EQUAL(x.data(), s.data());
+
+  // Check that the view keeps the data alive
+  const int* const data = s.data();
+  s = TensorN();
+  BOOST_CHECK_EQUAL(x.data(), data);
+  for (std::size_t i = 0ul; i < x.size(); ++i) BOOST_CHECK_EQUAL(x[i], t[i]);
+}
+
 BOOST_AUTO_TEST_CASE(copy_constructor) {
   // check constructor
   BOOST_REQUIRE_NO_THROW(TensorN tc(t));
@@ -376,6 +418,170 @@ BOOST_AUTO_TEST_CASE(serialization) {
   BOOST_CHECK_EQUAL_COLLECTIONS(t.begin(), t.end(), ts.begin(), ts.end());
 }
 
+BOOST_AUTO_TEST_CASE(compressed_serialization) {
+  // A tensor with many zeros compresses well
+  const range_type range(64, 64);
+  TensorN x(range, 0);
+  for (std::size_t i = 0ul; i < x.size(); i += 7ul) x[i] = int(i);
+
+  detail::CompressionParams params;
+  params.enabled = true;
+  params.min_bytes = 0ul;
+  detail::CompressionScope scope(&params);
+  const detail::CompressionStats stats0 =
+      detail::CompressionCounters::global().snapshot();
+
+  madness::archive::BufferOutputArchive count;
+  count& x;
+  std::vector<unsigned char> buf(count.size());
+  BOOST_CHECK_LT(buf.size(), x.size() * sizeof(int));
+  madness::archive::BufferOutputArchive oar(buf.data(), buf.size());
+  BOOST_REQUIRE_NO_THROW(oar & x);
+  BOOST_CHECK_EQUAL(oar.size(), buf.size());
+  oar.close();
+
+  const detail::CompressionStats stats1 =
+      detail::CompressionCounters::global().snapshot();
+  BOOST_CHECK_EQUAL(stats1.compressed, stats0.compressed + 1ul);
+  BOOST_CHECK_GT(stats1.ratio(), 1.0);
+
+  TensorN xs;
+  madness::archive::BufferInputArchive iar(buf.data(), buf.size());
+  BOOST_REQUIRE_NO_THROW(iar & xs);
+  iar.close();
+
+  BOOST_CHECK_EQUAL(x.range(), xs.range());
+  BOOST_CHECK_EQUAL_COLLECTIONS(x.begin(), x.end(), xs.begin(), xs.end());
+
+  // Incompressible data is sent raw
+  TensorN y(range);
+  rand_fill(17, y.size(), y.data());
+  params.max_ratio = 0.0;
+  madness::archive::BufferOutputArchive ycount;
+  ycount& y;
+  BOOST_CHECK_GE(ycount.size(), y.size() * sizeof(int));
+}
+
+BOOST_AUTO_TEST_CASE(compressed_serialization_after_count) {
+  const range_type range(64, 64);
+  TensorN x(range, 0);
+  for (std::size_t i = 0ul; i < x.size(); i += 7ul) x[i] = int(i);
+
+  detail::CompressionParams params;
+  params.enabled = true;
+  params.min_bytes = 0ul;
+  detail::CompressionScope scope(&params);
+
+  // A counting pass is not reused for data that changed since
+  madness::archive::BufferOutputArchive count;
+  count& x;
+  for (std::size_t i = 0ul; i < x.size(); i += 7ul) x[i] = -int(i);
+  std::vector<unsigned char> buf(2ul * x.size() * sizeof(int) + 1024ul);
+  madness::archive::BufferOutputArchive oar(buf.data(), buf.size());
+  BOOST_REQUIRE_NO_THROW(oar & x);
+  oar.close();
+
+  TensorN xs;
+  madness::archive::BufferInputArchive iar(buf.data(), buf.size());
+  BOOST_REQUIRE_NO_THROW(iar & xs);
+  iar.close();
+  BOOST_CHECK_EQUAL_COLLECTIONS(x.begin(), x.end(), xs.begin(), xs.end());
+
+  // Within a reusing scope, the counting pass is taken by the storing pass
+  const detail::CompressionStats stats0 =
+      detail::CompressionCounters::global().snapshot();
+  std::vector<unsigned char> bytes;
+  {
+    detail::CompressionScope reuse(nullptr, true);
+    madness::archive::BufferOutputArchive rcount;
+    rcount& x;
+    bytes.resize(rcount.size());
+    madness::archive::BufferOutputArchive rar(bytes.data(), bytes.size());
+    BOOST_REQUIRE_NO_THROW(rar & x);
+    BOOST_CHECK_EQUAL(rar.size(), bytes.size());
+    rar.close();
+  }
+  const detail::CompressionStats stats1 =
+      detail::CompressionCounters::global().snapshot();
+  BOOST_CHECK_EQUAL(stats1.compressed, stats0.compressed + 1ul);
+
+  TensorN xr;
+  madness::archive::BufferInputArchive rin(bytes.data(), bytes.size());
+  BOOST_REQUIRE_NO_THROW(rin & xr);
+  rin.close();
+  BOOST_CHECK_EQUAL_COLLECTIONS(x.begin(), x.end(), xr.begin(), xr.end());
+}
+
+BOOST_AUTO_TEST_CASE(legacy_compressed_serialization) {
+  const range_type range(64, 64);
+  TensorN x(range, 0);
+  for (std::size_t i = 0ul; i < x.size(); i += 7ul) x[i] = int(i);
+
+  // Compressed elements without a codec byte, as written by earlier versions
+  std::vector<unsigned char> packed;
+  detail::shuffle_rle_encode(reinterpret_cast<const unsigned char*>(x.data()),
+                             x.size() * sizeof(int), sizeof(int), packed);
+  const TensorN::size_type n = x.size();
+  std::vector<unsigned char> buf(2ul * x.size() * sizeof(int) + 1024ul);
+  madness::archive::BufferOutputArchive oar(buf.data(), buf.size());
+  oar& TensorN::size_type(n | detail::compressed_flag) & packed.size();
+  oar& madness::archive::wrap(packed.data(), packed.size());
+  oar& x.range();
+  oar.close();
+
+  TensorN xs;
+  madness::archive::BufferInputArchive iar(buf.data(), buf.size());
+  BOOST_REQUIRE_NO_THROW(iar & xs);
+  iar.close();
+  BOOST_CHECK_EQUAL(x.range(), xs.range());
+  BOOST_CHECK_EQUAL_COLLECTIONS(x.begin(), x.end(), xs.begin(), xs.end());
+}
+
+BOOST_AUTO_TEST_CASE(lossy_compressed_serialization) {
+  const range_type range(64, 64);
+  Tensor<double> x(range);
+  for (std::size_t i = 0ul; i < x.size(); ++i)
+    x[i] = (i % 5ul ? 0.0 : std::sin(double(i)) * 1.0e-3);
+
+  detail::CompressionParams params;
+  params.enabled = true;
+  params.min_bytes = 0ul;
+  params.abs_error = 1.0e-8;
+  detail::CompressionScope scope(&params);
+  const detail::CompressionStats stats0 =
+      detail::CompressionCounters::global().snapshot();
+
+  madness::archive::BufferOutputArchive count;
+  count& x;
+  std::vector<unsigned char> buf(count.size());
+  BOOST_CHECK_LT(buf.size(), x.size() * sizeof(double) / 2ul);
+  madness::archive::BufferOutputArchive oar(buf.data(), buf.size());
+  BOOST_REQUIRE_NO_THROW(oar & x);
+  oar.close();
+
+  const detail::CompressionStats stats1 =
+      detail::CompressionCounters::global().snapshot();
+  BOOST_CHECK_EQUAL(stats1.lossy, stats0.lossy + 1ul);
+  BOOST_CHECK_LE(stats1.max_error,
+                 std::max(params.abs_error, stats0.max_error));
+
+  Tensor<double> xs;
+  madness::archive::BufferInputArchive iar(buf.data(), buf.size());
+  BOOST_REQUIRE_NO_THROW(iar & xs);
+  iar.close();
+
+  // Every element is within the error bound
+  BOOST_CHECK_EQUAL(x.range(), xs.range());
+  for (std::size_t i = 0ul; i < x.size(); ++i)
+    BOOST_CHECK_LE(std::abs(x[i] - xs[i]), params.abs_error);
+
+  // The error bound follows the screening threshold
+  const auto lossy = lossy_compression_params(0.25);
+  BOOST_CHECK(lossy.enabled);
+  BOOST_CHECK_CLOSE(lossy.abs_error, 0.25 * SparseShape<float>::threshold(),
+                    1.0e-6);
+}
+
 BOOST_AUTO_TEST_CASE(swap) {
   TensorN s = make_tensor(79, 1559);
   rand_fill(431, s.size(), s.data());
@@ -559,4 +765,43 @@ BOOST_AUTO_TEST_CASE(inplace_conj_scal_op) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(kernel_metrics) {
+  Tensor<double> left(Range(5, 20)), right(Range(20, 70));
+  std::fill(left.begin(), left.end(), 1.0);
+  std::fill(right.begin(), right.end(), 1.0);
+  math::GemmHelper gemm_helper(madness::cblas::NoTrans, madness::cblas::NoTrans,
+                               2u, 2u, 2u);
+
+  // Check that nothing is recorded while disabled
+  metrics_enable(false);
+  const auto start = metrics_snapshot();
+  left.gemm(right, 1.0, gemm_helper);
+  BOOST_CHECK_EQUAL((metrics_snapshot() - start).gemm_total().calls, 0ul);
+
+  // Check that the GEMMs, permutation and allocations are recorded
+  metrics_enable();
+  const auto before = metrics_snapshot();
+  Tensor<double> result = left.gemm(right, 1.0, gemm_helper);
+  result.gemm(left, right, 1.0, gemm_helper);
+  permute(result, Permutation({1, 0}));
+  const auto delta = metrics_snapshot() - before;
+  metrics_enable(false);
+
+  const auto gemm = delta.gemm_total();
+  BOOST_CHECK_EQUAL(gemm.calls, 2ul);
+  BOOST_CHECK_EQUAL(gemm.flops, 2ul * 2ul * 5ul * 70ul * 20ul);
+  const auto& bucket = delta.gemm[detail::MetricsSnapshot::gemm_index(
+      detail::metrics_bucket(5), detail::metrics_bucket(70),
+      detail::metrics_bucket(20))];
+  BOOST_CHECK_EQUAL(bucket.calls, 2ul);
+  BOOST_CHECK_EQUAL(delta.permute_calls, 1ul);
+  BOOST_CHECK_EQUAL(delta.permute_bytes, 5ul * 70ul * sizeof(double));
+  BOOST_CHECK_GE(delta.allocations, 2ul);
+
+  std::stringstream ss;
+  ss << delta;
+  BOOST_CHECK_NE(ss.str().find("gemm m=[4,16) n=[64,256) k=[16,64) calls=2"),
+                 std::string::npos);
+}
+
 BOOST_AUTO_TEST_SUITE_END()